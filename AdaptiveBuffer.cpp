@@ -0,0 +1,119 @@
+#include "AdaptiveBuffer.h"
+
+#include "Utility.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Minimum buffer length for local files, in seconds.
+static const float s_FileBufferLength = 0.5f;
+
+// Buffer length for local files of a type that has not yet been measured, in seconds.
+static const float s_UnmeasuredBufferLength = 1.0f;
+
+// Minimum buffer length for optical drives, in seconds (to allow for spin up and seek times).
+static const float s_CDDABufferLength = 2.0f;
+
+// Minimum buffer length for network streams, in seconds.
+static const float s_URLBufferLength = 4.0f;
+
+// Maximum buffer length, in seconds.
+static const float s_MaximumBufferLength = 8.0f;
+
+// Realtime factor at or above which decoding is considered fast enough to use the minimum buffer length.
+static const double s_ReferenceRealtimeFactor = 20.0;
+
+// Minimum amount of decoded sample data for a throughput measurement to be used, in seconds.
+static const double s_MinimumMeasurement = 1.0;
+
+// Period over which throughput measurements are averaged, in seconds.
+static const double s_AveragingPeriod = 30.0;
+
+// Maximum underrun level.
+static const int s_MaximumUnderrunLevel = 3;
+
+// Amount of sample data to decode without underruns before the underrun level is reduced, in seconds.
+static const double s_UnderrunRecoverySeconds = 600.0;
+
+AdaptiveBuffer::AdaptiveBuffer() :
+	m_Statistics(),
+	m_Mutex()
+{
+}
+
+AdaptiveBuffer::~AdaptiveBuffer()
+{
+}
+
+float AdaptiveBuffer::GetBufferLength( const MediaInfo& mediaInfo )
+{
+	const float baseLength = GetBaseBufferLength( mediaInfo );
+	float bufferLength = (std::max)( baseLength, s_UnmeasuredBufferLength );
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+	const auto statistics = m_Statistics.find( GetKey( mediaInfo ) );
+	if ( m_Statistics.end() != statistics ) {
+		// Scale the buffer length up for media that decodes slowly, and for media that has recently suffered underruns.
+		const double throughputScale = ( statistics->second.DecodeTime > 0 ) ? (std::max)( 1.0, statistics->second.DecodeTime * s_ReferenceRealtimeFactor ) : ( bufferLength / baseLength );
+		const double underrunScale = std::pow( 2.0, statistics->second.UnderrunLevel );
+		bufferLength = static_cast<float>( baseLength * throughputScale * underrunScale );
+	}
+	bufferLength = (std::min)( bufferLength, s_MaximumBufferLength );
+	return bufferLength;
+}
+
+float AdaptiveBuffer::GetMaximumBufferLength()
+{
+	return s_MaximumBufferLength;
+}
+
+void AdaptiveBuffer::Update( const MediaInfo& mediaInfo, const double decodedSeconds, const double decodeTime, const long long underruns )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+	Statistics& statistics = m_Statistics[ GetKey( mediaInfo ) ];
+
+	if ( ( decodedSeconds >= s_MinimumMeasurement ) && ( decodeTime > 0 ) ) {
+		const double measurement = decodeTime / decodedSeconds;
+		if ( statistics.DecodeTime > 0 ) {
+			const double weight = (std::min)( 1.0, decodedSeconds / s_AveragingPeriod );
+			statistics.DecodeTime += ( measurement - statistics.DecodeTime ) * weight;
+		} else {
+			statistics.DecodeTime = measurement;
+		}
+	}
+
+	if ( underruns > 0 ) {
+		statistics.UnderrunLevel = (std::min)( statistics.UnderrunLevel + 1, s_MaximumUnderrunLevel );
+		statistics.CleanSeconds = 0;
+	} else if ( statistics.UnderrunLevel > 0 ) {
+		statistics.CleanSeconds += decodedSeconds;
+		if ( statistics.CleanSeconds >= s_UnderrunRecoverySeconds ) {
+			--statistics.UnderrunLevel;
+			statistics.CleanSeconds = 0;
+		}
+	}
+}
+
+std::wstring AdaptiveBuffer::GetKey( const MediaInfo& mediaInfo )
+{
+	std::wstring key;
+	if ( MediaInfo::Source::CDDA == mediaInfo.GetSource() ) {
+		key = L"CDDA";
+	} else if ( IsURL( mediaInfo.GetFilename() ) ) {
+		key = L"URL";
+	} else {
+		key = GetFileExtension( mediaInfo.GetFilename() );
+	}
+	return key;
+}
+
+float AdaptiveBuffer::GetBaseBufferLength( const MediaInfo& mediaInfo )
+{
+	float bufferLength = s_FileBufferLength;
+	if ( MediaInfo::Source::CDDA == mediaInfo.GetSource() ) {
+		bufferLength = s_CDDABufferLength;
+	} else if ( IsURL( mediaInfo.GetFilename() ) ) {
+		bufferLength = s_URLBufferLength;
+	}
+	return bufferLength;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "MediaInfo.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+
+// Chooses the decode buffer length for each track, based on the decoding throughput and underrun history measured for similar media.
+class AdaptiveBuffer
+{
+public:
+	AdaptiveBuffer();
+
+	virtual ~AdaptiveBuffer();
+
+	// Returns the decode buffer length to use for 'mediaInfo', in seconds.
+	float GetBufferLength( const MediaInfo& mediaInfo );
+
+	// Returns the maximum decode buffer length, in seconds.
+	static float GetMaximumBufferLength();
+
+	// Updates the decoding statistics for 'mediaInfo'.
+	// 'decodedSeconds' - amount of sample data decoded, in seconds.
+	// 'decodeTime' - time taken to decode the sample data, in seconds.
+	// 'underruns' - number of underruns that occurred while the sample data was output.
+	void Update( const MediaInfo& mediaInfo, const double decodedSeconds, const double decodeTime, const long long underruns );
+
+private:
+	// Decoding statistics for a type of media.
+	struct Statistics {
+		// Average time taken to decode one second of sample data, in seconds.
+		double DecodeTime = 0;
+
+		// Underrun level, which doubles the buffer length for each level.
+		int UnderrunLevel = 0;
+
+		// Amount of sample data decoded without underruns since the underrun level last changed, in seconds.
+		double CleanSeconds = 0;
+	};
+
+	// Returns the key with which to group statistics for 'mediaInfo'.
+	static std::wstring GetKey( const MediaInfo& mediaInfo );
+
+	// Returns the minimum buffer length for 'mediaInfo', in seconds.
+	static float GetBaseBufferLength( const MediaInfo& mediaInfo );
+
+	// Decoding statistics, for each type of media.
+	std::map<std::wstring, Statistics> m_Statistics;
+
+	// Statistics mutex.
+	std::mutex m_Mutex;
+};
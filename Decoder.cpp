@@ -1,20 +1,32 @@
 #include "Decoder.h"
 
+#include "SampleKernels.h"
 #include "Settings.h"
 
 #include "ebur128.h"
 
 #include <windows.h>
 
+#include <algorithm>
+#include <cmath>
 #include <random>
 #include <string>
 
+// Interval between the points in a seek index, in seconds.
+static const long s_SeekPointInterval = 1;
+
 Decoder::Decoder() :
 	m_Duration( 0 ),
 	m_SampleRate( 0 ),
 	m_Channels( 0 ),
 	m_BPS(),
-	m_Bitrate()
+	m_Bitrate(),
+	m_Pushback(),
+	m_PushbackOffset( 0 ),
+	m_FrameBuffer(),
+	m_SeekIndex(),
+	m_SeekIndexBuilder(),
+	m_SeekIndexBuilt()
 {
 }
 
@@ -116,17 +128,137 @@ std::optional<float> Decoder::CalculateTrackGain( CanContinue canContinue, const
 	return trackGain;
 }
 
-void Decoder::SkipSilence()
+long Decoder::Read( float* buffer, const long sampleCount )
+{
+	long samplesRead = 0;
+	if ( ( m_PushbackOffset < m_Pushback.size() ) && ( m_Channels > 0 ) && ( sampleCount > 0 ) ) {
+		const long samplesAvailable = static_cast<long>( ( m_Pushback.size() - m_PushbackOffset ) / m_Channels );
+		samplesRead = (std::min)( samplesAvailable, sampleCount );
+		const size_t valueCount = static_cast<size_t>( samplesRead * m_Channels );
+		std::copy( m_Pushback.begin() + m_PushbackOffset, m_Pushback.begin() + m_PushbackOffset + valueCount, buffer );
+		m_PushbackOffset += valueCount;
+		if ( m_PushbackOffset >= m_Pushback.size() ) {
+			m_Pushback.clear();
+			m_PushbackOffset = 0;
+		}
+	}
+	if ( samplesRead < sampleCount ) {
+		const long samplesDecoded = ReadSamples( buffer + samplesRead * m_Channels, sampleCount - samplesRead );
+		if ( 0 == samplesDecoded ) {
+			OnEndOfStream();
+		}
+		samplesRead += samplesDecoded;
+	}
+	return samplesRead;
+}
+
+long Decoder::ReadFrame( FrameView& view, const long maximumSamples )
+{
+	view = {};
+	long samplesRead = 0;
+	if ( ( m_Channels > 0 ) && ( maximumSamples > 0 ) ) {
+		// Pushed back sample data is only released once it has been consumed, as the previous view may have referred to it.
+		if ( !m_Pushback.empty() && ( m_PushbackOffset >= m_Pushback.size() ) ) {
+			m_Pushback.clear();
+			m_PushbackOffset = 0;
+		}
+		if ( m_PushbackOffset < m_Pushback.size() ) {
+			const long samplesAvailable = static_cast<long>( ( m_Pushback.size() - m_PushbackOffset ) / m_Channels );
+			samplesRead = (std::min)( samplesAvailable, maximumSamples );
+			view.Planes[ 0 ] = m_Pushback.data() + m_PushbackOffset;
+			m_PushbackOffset += static_cast<size_t>( samplesRead * m_Channels );
+		} else {
+			samplesRead = ReadFrameView( view, maximumSamples );
+			if ( 0 == samplesRead ) {
+				OnEndOfStream();
+			}
+		}
+		view.SampleCount = samplesRead;
+		view.Channels = m_Channels;
+		view.SampleRate = m_SampleRate;
+	}
+	return samplesRead;
+}
+
+long Decoder::ReadFrameView( FrameView& view, const long maximumSamples )
+{
+	const size_t valueCount = static_cast<size_t>( maximumSamples * m_Channels );
+	if ( m_FrameBuffer.size() < valueCount ) {
+		m_FrameBuffer.resize( valueCount );
+	}
+	const long samplesRead = ReadSamples( m_FrameBuffer.data(), maximumSamples );
+	view.Planes[ 0 ] = m_FrameBuffer.data();
+	return samplesRead;
+}
+
+const float* Decoder::FrameView::GetInterleavedFloat( std::vector<float>& buffer ) const
+{
+	const float* samples = nullptr;
+	if ( !Planar && ( Type::Float == DataType ) ) {
+		samples = static_cast<const float*>( Planes[ 0 ] );
+	} else if ( ( SampleCount > 0 ) && ( Channels > 0 ) ) {
+		const size_t valueCount = static_cast<size_t>( SampleCount * Channels );
+		if ( buffer.size() < valueCount ) {
+			buffer.resize( valueCount );
+		}
+		if ( Type::Int32 == DataType ) {
+			if ( Planar ) {
+				InterleaveInt32ToFloat( buffer.data(), reinterpret_cast<const int32_t* const*>( Planes.data() ), 0 /*offset*/, static_cast<size_t>( SampleCount ), Channels, BitsPerSample );
+			} else {
+				ConvertInt32ToFloat( buffer.data(), static_cast<const int32_t*>( Planes[ 0 ] ), valueCount, BitsPerSample );
+			}
+		} else {
+			for ( long channel = 0; channel < Channels; channel++ ) {
+				const float* plane = static_cast<const float*>( Planes[ channel ] );
+				for ( long sample = 0; sample < SampleCount; sample++ ) {
+					buffer[ sample * Channels + channel ] = plane[ sample ];
+				}
+			}
+		}
+		samples = buffer.data();
+	}
+	return samples;
+}
+
+float Decoder::Seek( const float position )
 {
+	m_Pushback.clear();
+	m_PushbackOffset = 0;
+
+	// A seek index can only be built by decoding the whole stream from the start, so any index being built is restarted or abandoned.
+	if ( m_SeekIndexBuilder || m_SeekIndexBuilt ) {
+		m_SeekIndexBuilder.reset( ( !m_SeekIndex && m_SeekIndexBuilt && ( position <= 0 ) ) ? new SeekIndex( static_cast<long long>( m_SampleRate ) * s_SeekPointInterval ) : nullptr );
+	}
+	return SeekTo( position );
+}
+
+float Decoder::SkipSilence( const std::optional<float> threshold )
+{
+	long long samplesSkipped = 0;
 	if ( m_Channels > 0 ) {
-		std::vector<float> buffer( m_Channels );
-		bool silence = true;
-		while ( silence && Read( &buffer[ 0 ], 1 /*sampleCount*/ ) > 0 ) {
-			for ( auto sample = buffer.begin(); silence && ( sample != buffer.end() ); sample++ ) {
-				silence = ( 0 == *sample );
+		const float level = threshold.has_value() ? std::pow( 10.0f, threshold.value() / 20 ) : 0.0f;
+		const long blockSize = 4096;
+		std::vector<float> buffer( blockSize * m_Channels );
+		long samplesRead = Read( buffer.data(), blockSize );
+		while ( samplesRead > 0 ) {
+			const size_t valueCount = static_cast<size_t>( samplesRead * m_Channels );
+			const size_t firstSound = FindFirstAboveLevel( buffer.data(), valueCount, level );
+			if ( firstSound < valueCount ) {
+				// Push back the sample data from the first non-silent sample onwards (ahead of any sample data that is still pushed back).
+				const size_t firstSample = firstSound / m_Channels;
+				samplesSkipped += static_cast<long long>( firstSample );
+				std::vector<float> pushback( buffer.begin() + firstSample * m_Channels, buffer.begin() + valueCount );
+				pushback.insert( pushback.end(), m_Pushback.begin() + m_PushbackOffset, m_Pushback.end() );
+				m_Pushback.swap( pushback );
+				m_PushbackOffset = 0;
+				break;
 			}
+			samplesSkipped += samplesRead;
+			samplesRead = Read( buffer.data(), blockSize );
 		}
 	}
+	const float seconds = ( m_SampleRate > 0 ) ? ( static_cast<float>( samplesSkipped ) / m_SampleRate ) : 0;
+	return seconds;
 }
 
 bool Decoder::SupportsStreamTitles() const
@@ -134,7 +266,50 @@ bool Decoder::SupportsStreamTitles() const
 	return false;
 }
 
+bool Decoder::SupportsSeekIndex() const
+{
+	return false;
+}
+
+void Decoder::SetSeekIndex( const SeekIndex::Ptr index, SeekIndexBuilt onBuilt )
+{
+	m_SeekIndex = index;
+	m_SeekIndexBuilt = onBuilt;
+	m_SeekIndexBuilder.reset( ( !m_SeekIndex && m_SeekIndexBuilt && ( m_SampleRate > 0 ) ) ? new SeekIndex( static_cast<long long>( m_SampleRate ) * s_SeekPointInterval ) : nullptr );
+}
+
+SeekIndex::Ptr Decoder::GetSeekIndex() const
+{
+	return m_SeekIndex;
+}
+
+void Decoder::AddSeekPoint( const long long sample, const long long offset )
+{
+	if ( m_SeekIndexBuilder ) {
+		m_SeekIndexBuilder->Add( sample, offset );
+	}
+}
+
+void Decoder::OnEndOfStream()
+{
+	if ( m_SeekIndexBuilder ) {
+		// The completed index is used for any subsequent seeks, as well as being passed on to be stored.
+		std::shared_ptr<SeekIndex> index( m_SeekIndexBuilder.release() );
+		if ( !index->IsEmpty() ) {
+			m_SeekIndex = index;
+			if ( m_SeekIndexBuilt ) {
+				m_SeekIndexBuilt( *index );
+			}
+		}
+	}
+}
+
 std::pair<float /*seconds*/, std::wstring /*title*/> Decoder::GetStreamTitle()
 {
 	return {};
 }
+
+float Decoder::GetStreamTitlePosition()
+{
+	return 0;
+}
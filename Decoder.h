@@ -1,9 +1,13 @@
 #pragma once
 
+#include "SeekIndex.h"
+
+#include <array>
 #include <functional>
 #include <memory>
 #include <optional>
 #include <stdexcept>
+#include <vector>
 
 // Decoder interface.
 class Decoder
@@ -19,15 +23,64 @@ public:
 	// A callback which returns true to continue.
 	using CanContinue = std::function<bool()>;
 
-	// Reads sample data.
+	// A callback which receives the seek index built while decoding.
+	using SeekIndexBuilt = std::function<void( const SeekIndex& index )>;
+
+	// A read-only view of a block of decoded sample data, which can refer directly to a buffer held by the decoder.
+	struct FrameView {
+		// Sample data type.
+		enum class Type {
+			// Floating point values, scaled to +/-1.0f.
+			Float,
+			// Signed 32-bit integer values, with 'BitsPerSample' significant (right justified) bits.
+			Int32
+		};
+
+		// Maximum number of channels for planar sample data.
+		static constexpr long MaximumPlanes = 8;
+
+		// Returns the sample data as interleaved floating point values (scaled to +/-1.0f).
+		// 'buffer' - buffer into which the sample data is converted, if it is not already interleaved floating point data.
+		const float* GetInterleavedFloat( std::vector<float>& buffer ) const;
+
+		// Sample data, either one buffer for each channel (for planar data), or a single buffer (for interleaved data), each starting at the first sample in the view.
+		std::array<const void*, MaximumPlanes> Planes = {};
+
+		// Indicates whether the sample data is planar rather than interleaved.
+		bool Planar = false;
+
+		// Sample data type.
+		Type DataType = Type::Float;
+
+		// Number of significant bits in each integer value.
+		long BitsPerSample = 32;
+
+		// Number of samples per channel.
+		long SampleCount = 0;
+
+		// Number of channels.
+		long Channels = 0;
+
+		// Sample rate.
+		long SampleRate = 0;
+	};
+
+	// Reads sample data, starting with any sample data pushed back when skipping silence.
 	// 'buffer' - output buffer (floating point format scaled to +/-1.0f).
 	// 'sampleCount' - number of samples to read.
 	// Returns the number of samples read, or zero if the stream has ended.
-	virtual long Read( float* buffer, const long sampleCount ) = 0;
+	long Read( float* buffer, const long sampleCount );
+
+	// Reads the next block of sample data as a read-only view, which refers directly to the decoder's own buffer where the decoder supports it.
+	// This allows analysis to run on the native sample data, and is otherwise equivalent to Read(), with any pushed back sample data returned first.
+	// 'view' - out, the frame view, which remains valid until the next read or seek.
+	// 'maximumSamples' - maximum number of samples per channel to return in the view.
+	// Returns the number of samples per channel in the view, or zero if the stream has ended.
+	long ReadFrame( FrameView& view, const long maximumSamples );
 
 	// Seeks to a 'position' in the stream, in seconds.
 	// Returns the new position in seconds.
-	virtual float Seek( const float position ) = 0;
+	float Seek( const float position );
 
 	// Returns the duration in seconds.
 	float GetDuration() const;
@@ -49,16 +102,47 @@ public:
 	// 'secondslimit' - number of seconds to devote to calculating an estimate, or 0 to perform a complete calculation.
 	virtual std::optional<float> CalculateTrackGain( CanContinue canContinue, const float secondsLimit = 0 );
 
-	// Skips any leading silence.
-	void SkipSilence();
+	// Skips any leading silence, so that the next read starts at the first non-silent sample.
+	// 'threshold' - level, in dBFS, at or below which sample values are considered silent (or nullopt to only consider zero values silent).
+	// Returns the amount of silence skipped, in seconds.
+	float SkipSilence( const std::optional<float> threshold = std::nullopt );
 
 	// Returns whether stream titles are supported.
 	virtual bool SupportsStreamTitles() const;
 
+	// Returns whether the decoder can seek using a seek index, rather than searching the file for the seek position.
+	virtual bool SupportsSeekIndex() const;
+
+	// Sets the seek index for the stream.
+	// 'index' - seek index, or nullptr if there is no index (in which case an index is built if the whole stream is then decoded without seeking).
+	// 'onBuilt' - callback which receives the index once it has been built (or nullptr to not build an index).
+	void SetSeekIndex( const SeekIndex::Ptr index, SeekIndexBuilt onBuilt );
+
 	// Returns the current stream title, and the position (in seconds) at which the title last changed.
 	virtual std::pair<float /*seconds*/, std::wstring /*title*/> GetStreamTitle();
 
+	// Returns the position (in seconds) at which the stream title last changed.
+	virtual float GetStreamTitlePosition();
+
 protected:
+	// Reads sample data from the stream.
+	// 'buffer' - output buffer (floating point format scaled to +/-1.0f).
+	// 'sampleCount' - number of samples to read.
+	// Returns the number of samples read, or zero if the stream has ended.
+	virtual long ReadSamples( float* buffer, const long sampleCount ) = 0;
+
+	// Reads the next block of sample data from the stream as a read-only view.
+	// The default implementation reads interleaved floating point data into a buffer held by the decoder.
+	// Decoders which hold whole frames of sample data can override this to refer to their own buffers instead.
+	// 'view' - out, the frame view (the sample count, channels and sample rate are filled in by the caller).
+	// 'maximumSamples' - maximum number of samples per channel to return in the view.
+	// Returns the number of samples per channel in the view, or zero if the stream has ended.
+	virtual long ReadFrameView( FrameView& view, const long maximumSamples );
+
+	// Seeks the stream to a 'position', in seconds.
+	// Returns the new position in seconds.
+	virtual float SeekTo( const float position ) = 0;
+
 	// Sets the 'duration'.
 	void SetDuration( const float duration );
 
@@ -74,7 +158,18 @@ protected:
 	// Sets the 'bitrate' in kbps.
 	void SetBitrate( const std::optional<float> bitrate );
 
+	// Returns the seek index, or nullptr if there is no index.
+	SeekIndex::Ptr GetSeekIndex() const;
+
+	// Adds a seek point to the index being built, if any, as each frame is decoded.
+	// 'sample' - position of the first sample in the frame, in samples from the start of the stream.
+	// 'offset' - offset of the frame, in bytes from the start of the file.
+	void AddSeekPoint( const long long sample, const long long offset );
+
 private:
+	// Called when the end of the stream has been reached, to complete any seek index being built.
+	void OnEndOfStream();
+
 	// Duration in seconds.
 	float m_Duration;
 
@@ -89,4 +184,22 @@ private:
 
 	// Bitrate in kbps (if relevant).
 	std::optional<float> m_Bitrate;
+
+	// Sample data read ahead when skipping silence, which is returned by subsequent reads.
+	std::vector<float> m_Pushback;
+
+	// Offset of the next value to return from the pushed back sample data.
+	size_t m_PushbackOffset;
+
+	// Sample data buffer for frame views, for decoders which do not hold their own.
+	std::vector<float> m_FrameBuffer;
+
+	// Seek index.
+	SeekIndex::Ptr m_SeekIndex;
+
+	// Seek index being built, while the stream is decoded from the start without seeking.
+	std::unique_ptr<SeekIndex> m_SeekIndexBuilder;
+
+	// Callback which receives the seek index once it has been built.
+	SeekIndexBuilt m_SeekIndexBuilt;
 };
@@ -1,5 +1,6 @@
 #include "DecoderBass.h"
 
+#include "SampleKernels.h"
 #include "VUPlayer.h"
 #include "Utility.h"
 
@@ -141,6 +142,7 @@ DecoderBass::DecoderBass( const std::wstring& filename ) :
 	m_FadeStartPosition( 0 ),
 	m_FadeEndPosition( 0 ),
 	m_CurrentPosition( 0 ),
+	m_FadeRamp(),
 	m_IsURL( IsURL( filename ) ),
 	m_CurrentSilenceSamples( 0 ),
 	m_StreamTitle( {} ),
@@ -244,7 +246,7 @@ DecoderBass::~DecoderBass()
 	}
 }
 
-long DecoderBass::Read( float* buffer, const long sampleCount )
+long DecoderBass::ReadSamples( float* buffer, const long sampleCount )
 {
 	long samplesRead = 0;
 	const long channels = GetChannels();
@@ -261,15 +263,12 @@ long DecoderBass::Read( float* buffer, const long sampleCount )
 		if ( m_CurrentPosition > m_FadeEndPosition ) {
 			samplesRead = 0;
 		} else if ( m_CurrentPosition > m_FadeStartPosition ) {
-			for ( long pos = 0; pos < samplesRead; pos++ ) {
-				float scale = static_cast<float>( m_FadeEndPosition - m_CurrentPosition - pos ) / ( m_FadeEndPosition - m_FadeStartPosition );
-				if ( ( scale < 0 ) || ( scale > 1.0f ) ) {
-					scale = 0;
-				}
-				for ( long channel = 0; channel < channels; channel++ ) {
-					buffer[ pos * channels + channel ] *= scale;
-				}
+			if ( m_FadeRamp.size() < static_cast<size_t>( samplesRead ) ) {
+				m_FadeRamp.resize( samplesRead );
 			}
+			const float fadeLength = static_cast<float>( m_FadeEndPosition - m_FadeStartPosition );
+			GenerateGainRamp( m_FadeRamp.data(), samplesRead, static_cast<float>( m_FadeEndPosition - m_CurrentPosition ) / fadeLength, 1.0f / fadeLength, false /*equalPower*/ );
+			ApplyGainRamp( buffer, samplesRead, channels, m_FadeRamp.data() );
 		}
 		m_CurrentPosition += samplesRead;
 	}
@@ -292,7 +291,7 @@ long DecoderBass::Read( float* buffer, const long sampleCount )
 	return samplesRead;
 }
 
-float DecoderBass::Seek( const float position )
+float DecoderBass::SeekTo( const float position )
 {
 	DWORD flags = BASS_POS_BYTE;
 	BASS_CHANNELINFO info = {};
@@ -344,9 +343,16 @@ bool DecoderBass::SupportsStreamTitles() const
 
 std::pair<float /*seconds*/, std::wstring /*title*/> DecoderBass::GetStreamTitle()
 {
+	std::lock_guard<std::mutex> lock( m_StreamTitleMutex );
 	return m_StreamTitle;	
 }
 
+float DecoderBass::GetStreamTitlePosition()
+{
+	std::lock_guard<std::mutex> lock( m_StreamTitleMutex );
+	return m_StreamTitle.first;
+}
+
 void CALLBACK DecoderBass::MetadataSyncProc( HSYNC /*handle*/, DWORD channel, DWORD /*data*/, void *user )
 {
 	if ( DecoderBass* decoder = static_cast<DecoderBass*>( user ); nullptr != decoder ) {
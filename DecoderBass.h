@@ -6,6 +6,7 @@
 
 #include <mutex>
 #include <string>
+#include <vector>
 
 // Bass decoder
 class DecoderBass : public Decoder
@@ -17,16 +18,6 @@ public:
 
 	~DecoderBass() override;
 
-	// Reads sample data.
-	// 'buffer' - output buffer (floating point format scaled to +/-1.0f).
-	// 'sampleCount' - number of samples to read.
-	// Returns the number of samples read, or zero if the stream has ended.
-	long Read( float* buffer, const long sampleCount ) override;
-
-	// Seeks to a 'position' in the stream, in seconds.
-	// Returns the new position in seconds.
-	float Seek( const float position ) override;
-
 	// Returns the track gain, in dB, or nullopt if the calculation failed.
 	// 'canContinue' - callback which returns whether the calculation can continue.
 	// 'secondslimit' - number of seconds to devote to calculating an estimate, or 0 to perform a complete calculation.
@@ -38,6 +29,20 @@ public:
 	// Returns the current stream title, and the position (in seconds) at which the title last changed.
 	std::pair<float /*seconds*/, std::wstring /*title*/> GetStreamTitle() override;
 
+	// Returns the position (in seconds) at which the stream title last changed.
+	float GetStreamTitlePosition() override;
+
+protected:
+	// Reads sample data.
+	// 'buffer' - output buffer (floating point format scaled to +/-1.0f).
+	// 'sampleCount' - number of samples to read.
+	// Returns the number of samples read, or zero if the stream has ended.
+	long ReadSamples( float* buffer, const long sampleCount ) override;
+
+	// Seeks to a 'position' in the stream, in seconds.
+	// Returns the new position in seconds.
+	float SeekTo( const float position ) override;
+
 private:
 	// URL stream metadata callback.
 	static void CALLBACK MetadataSyncProc( HSYNC handle, DWORD channel, DWORD data, void *user );
@@ -57,6 +62,9 @@ private:
 	// Current decoding position.
 	QWORD m_CurrentPosition;
 
+	// Fade gain values, applied when fading out MOD music.
+	std::vector<float> m_FadeRamp;
+
 	// Indicates whether the current stream is a URL.
 	bool m_IsURL;
 
@@ -27,7 +27,7 @@ DecoderCDDA::~DecoderCDDA()
 	m_CDDAMedia.Close( m_Handle );
 }
 
-long DecoderCDDA::Read( float* buffer, const long sampleCount )
+long DecoderCDDA::ReadSamples( float* buffer, const long sampleCount )
 {
 	long samplesRead = 0;
 	long outputBufPos = 0;
@@ -47,7 +47,7 @@ long DecoderCDDA::Read( float* buffer, const long sampleCount )
 	return samplesRead;
 }
 
-float DecoderCDDA::Seek( const float position )
+float DecoderCDDA::SeekTo( const float position )
 {
 	float seekPosition = 0;
 	const float duration = GetDuration();
@@ -16,20 +16,21 @@ public:
 
 	~DecoderCDDA() override;
 
+	// Returns the track gain, in dB, or nullopt if the calculation failed.
+	// 'canContinue' - callback which returns whether the calculation can continue.
+	// 'secondslimit' - number of seconds to devote to calculating an estimate, or 0 to perform a complete calculation.
+	std::optional<float> CalculateTrackGain( CanContinue canContinue, const float secondsLimit = 0 ) override;
+
+protected:
 	// Reads sample data.
 	// 'buffer' - output buffer (floating point format scaled to +/-1.0f).
 	// 'sampleCount' - number of samples to read.
 	// Returns the number of samples read, or zero if the stream has ended.
-	long Read( float* buffer, const long sampleCount ) override;
+	long ReadSamples( float* buffer, const long sampleCount ) override;
 
 	// Seeks to a 'position' in the stream, in seconds.
 	// Returns the new position in seconds.
-	float Seek( const float position ) override;
-
-	// Returns the track gain, in dB, or nullopt if the calculation failed.
-	// 'canContinue' - callback which returns whether the calculation can continue.
-	// 'secondslimit' - number of seconds to devote to calculating an estimate, or 0 to perform a complete calculation.
-	std::optional<float> CalculateTrackGain( CanContinue canContinue, const float secondsLimit = 0 ) override;
+	float SeekTo( const float position ) override;
 
 private:
 	// CD audio disc information.
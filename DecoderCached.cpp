@@ -0,0 +1,243 @@
+#include "DecoderCached.h"
+
+#include "SampleKernels.h"
+
+#include <algorithm>
+#include <array>
+
+// Maximum distance of a seek ahead of the recorded position which is made by decoding through to the seek position, in seconds.
+static const float s_MaximumDecodeThrough = 30.0f;
+
+// Number of samples per channel to decode at a time, when decoding through to a seek position.
+static const long s_DecodeThroughBlock = 4096;
+
+
+DecoderCached::DecoderCached( const PCMCache::TrackPtr track ) :
+	Decoder(),
+	m_Track( track ),
+	m_Position( 0 ),
+	m_Decoder(),
+	m_Cache( nullptr ),
+	m_Filename(),
+	m_Filetime( 0 ),
+	m_Recording(),
+	m_RecordBuffer()
+{
+	if ( m_Track ) {
+		SetDuration( m_Track->Duration );
+		SetSampleRate( m_Track->SampleRate );
+		SetChannels( m_Track->Channels );
+		SetBPS( m_Track->BitsPerSample );
+		SetBitrate( m_Track->Bitrate );
+	}
+}
+
+DecoderCached::DecoderCached( const Decoder::Ptr decoder, PCMCache& cache, const std::wstring& filename, const long long filetime ) :
+	Decoder(),
+	m_Track(),
+	m_Position( 0 ),
+	m_Decoder( decoder ),
+	m_Cache( &cache ),
+	m_Filename( filename ),
+	m_Filetime( filetime ),
+	m_Recording(),
+	m_RecordBuffer()
+{
+	if ( m_Decoder ) {
+		SetDuration( m_Decoder->GetDuration() );
+		SetSampleRate( m_Decoder->GetSampleRate() );
+		SetChannels( m_Decoder->GetChannels() );
+		SetBPS( m_Decoder->GetBPS() );
+		SetBitrate( m_Decoder->GetBitrate() );
+
+		const long bytesPerValue = GetBytesPerValue( GetBPS() );
+		if ( ( bytesPerValue > 0 ) && ( GetChannels() > 0 ) && ( GetSampleRate() > 0 ) ) {
+			m_Recording = std::make_shared<PCMCache::Track>();
+			m_Recording->Duration = GetDuration();
+			m_Recording->SampleRate = GetSampleRate();
+			m_Recording->Channels = GetChannels();
+			m_Recording->BitsPerSample = GetBPS();
+			m_Recording->Bitrate = GetBitrate();
+			m_Recording->BytesPerValue = bytesPerValue;
+			m_Recording->ChunkSamples = static_cast<long long>( PCMCache::ChunkSize / ( GetChannels() * bytesPerValue ) );
+		}
+	}
+}
+
+DecoderCached::~DecoderCached()
+{
+	ResetRecording( false /*restart*/ );
+}
+
+long DecoderCached::GetBytesPerValue( const std::optional<long> bitsPerSample )
+{
+	long bytesPerValue = 0;
+	if ( bitsPerSample.has_value() && ( bitsPerSample.value() > 0 ) ) {
+		if ( bitsPerSample.value() <= 16 ) {
+			bytesPerValue = 2;
+		} else if ( bitsPerSample.value() <= 24 ) {
+			bytesPerValue = 3;
+		}
+	}
+	return bytesPerValue;
+}
+
+long DecoderCached::ReadSamples( float* buffer, const long sampleCount )
+{
+	long samplesRead = 0;
+	if ( m_Track ) {
+		const long channels = m_Track->Channels;
+		samplesRead = static_cast<long>( std::clamp<long long>( m_Track->SampleCount - m_Position, 0, sampleCount ) );
+		long remaining = samplesRead;
+		float* output = buffer;
+		while ( remaining > 0 ) {
+			// Convert up to the end of the current chunk.
+			const size_t chunkIndex = static_cast<size_t>( m_Position / m_Track->ChunkSamples );
+			const long long chunkPosition = m_Position % m_Track->ChunkSamples;
+			const long count = static_cast<long>( std::min<long long>( remaining, m_Track->ChunkSamples - chunkPosition ) );
+			const size_t valueCount = static_cast<size_t>( count * channels );
+			const unsigned char* input = m_Track->Chunks[ chunkIndex ].data() + chunkPosition * channels * m_Track->BytesPerValue;
+			if ( 2 == m_Track->BytesPerValue ) {
+				ConvertInt16ToFloat( output, reinterpret_cast<const int16_t*>( input ), valueCount );
+			} else {
+				ConvertInt24ToFloat( output, input, valueCount );
+			}
+			output += valueCount;
+			m_Position += count;
+			remaining -= count;
+		}
+	} else if ( m_Decoder ) {
+		samplesRead = m_Decoder->Read( buffer, sampleCount );
+		if ( samplesRead > 0 ) {
+			FrameView view;
+			view.Planes[ 0 ] = buffer;
+			view.SampleCount = samplesRead;
+			view.Channels = GetChannels();
+			view.SampleRate = GetSampleRate();
+			Record( view );
+		} else {
+			EndRecording();
+		}
+	}
+	return samplesRead;
+}
+
+long DecoderCached::ReadFrameView( FrameView& view, const long maximumSamples )
+{
+	long samplesRead = 0;
+	if ( m_Decoder ) {
+		samplesRead = m_Decoder->ReadFrame( view, maximumSamples );
+		if ( samplesRead > 0 ) {
+			Record( view );
+		} else {
+			EndRecording();
+		}
+	} else {
+		samplesRead = Decoder::ReadFrameView( view, maximumSamples );
+	}
+	return samplesRead;
+}
+
+float DecoderCached::SeekTo( const float position )
+{
+	float seekPosition = 0;
+	const long sampleRate = GetSampleRate();
+	if ( m_Track ) {
+		if ( sampleRate > 0 ) {
+			m_Position = std::clamp<long long>( static_cast<long long>( position * sampleRate ), 0, m_Track->SampleCount );
+			seekPosition = static_cast<float>( m_Position ) / sampleRate;
+		}
+	} else if ( m_Decoder ) {
+		const long long recorded = m_Recording ? m_Recording->SampleCount : 0;
+		const long long target = static_cast<long long>( position * sampleRate );
+		if ( m_Recording && ( target >= recorded ) && ( ( target - recorded ) <= static_cast<long long>( s_MaximumDecodeThrough * sampleRate ) ) ) {
+			std::vector<float> buffer( static_cast<size_t>( s_DecodeThroughBlock * GetChannels() ) );
+			long long remaining = target - recorded;
+			while ( remaining > 0 ) {
+				const long samplesRead = ReadSamples( buffer.data(), static_cast<long>( std::min<long long>( s_DecodeThroughBlock, remaining ) ) );
+				if ( 0 == samplesRead ) {
+					break;
+				}
+				remaining -= samplesRead;
+			}
+			seekPosition = static_cast<float>( target - remaining ) / sampleRate;
+		} else {
+			// The recording restarts if the source decoder is returned to the start of the track, and is otherwise abandoned.
+			ResetRecording( position <= 0 );
+			seekPosition = m_Decoder->Seek( position );
+		}
+	}
+	return seekPosition;
+}
+
+void DecoderCached::Record( const FrameView& view )
+{
+	if ( m_Recording && ( view.SampleCount > 0 ) && ( view.Channels == m_Recording->Channels ) ) {
+		const long channels = view.Channels;
+		const long bytesPerValue = m_Recording->BytesPerValue;
+		const long containerBits = bytesPerValue * 8;
+		const size_t frameSize = static_cast<size_t>( channels * bytesPerValue );
+		bool lossless = ( ( static_cast<size_t>( m_Recording->SampleCount + view.SampleCount ) * frameSize ) <= m_Cache->GetMaximumSize() );
+
+		const bool integer = ( FrameView::Type::Int32 == view.DataType ) && ( view.BitsPerSample > 0 ) && ( view.BitsPerSample <= containerBits );
+		const float* samples = ( lossless && !integer ) ? view.GetInterleavedFloat( m_RecordBuffer ) : nullptr;
+
+		// Integer sample data is shifted up to the packed size, which is exact, with interleaved sample data packed as a single channel.
+		const long shift = containerBits - view.BitsPerSample;
+		std::array<const int32_t*, FrameView::MaximumPlanes> planes = {};
+		if ( integer ) {
+			for ( long plane = 0; plane < ( view.Planar ? channels : 1 ); plane++ ) {
+				planes[ plane ] = static_cast<const int32_t*>( view.Planes[ plane ] );
+			}
+		}
+
+		// Sample data is appended to fixed size chunks taken from the cache's pool, so that recording never has to allocate, reallocate or copy what has been recorded so far.
+		const long long chunkSamples = m_Recording->ChunkSamples;
+		long sample = 0;
+		while ( lossless && ( sample < view.SampleCount ) ) {
+			const long long chunkPosition = m_Recording->SampleCount % chunkSamples;
+			if ( 0 == chunkPosition ) {
+				m_Recording->Chunks.push_back( m_Cache->TakeChunk() );
+			}
+			const long count = static_cast<long>( std::min<long long>( view.SampleCount - sample, chunkSamples - chunkPosition ) );
+			std::vector<unsigned char>& chunk = m_Recording->Chunks.back();
+			chunk.resize( static_cast<size_t>( chunkPosition + count ) * frameSize );
+			unsigned char* output = chunk.data() + chunkPosition * frameSize;
+			if ( !integer ) {
+				// Floating point sample data is only held if every value converts exactly to the packed size.
+				lossless = PackFloatExact( output, samples + static_cast<size_t>( sample ) * channels, static_cast<size_t>( count ) * channels, bytesPerValue );
+			} else if ( view.Planar ) {
+				PackInt32( output, planes.data(), static_cast<size_t>( sample ), static_cast<size_t>( count ), channels, shift, bytesPerValue );
+			} else {
+				PackInt32( output, planes.data(), static_cast<size_t>( sample ) * channels, static_cast<size_t>( count ) * channels, 1 /*channels*/, shift, bytesPerValue );
+			}
+			sample += count;
+			m_Recording->SampleCount += count;
+		}
+		if ( !lossless ) {
+			ResetRecording( false /*restart*/ );
+		}
+	}
+}
+
+void DecoderCached::EndRecording()
+{
+	if ( m_Recording ) {
+		if ( m_Recording->SampleCount > 0 ) {
+			// The cache finalises and adds the track on its own thread.
+			m_Cache->Add( m_Filename, m_Filetime, m_Recording );
+		}
+		m_Recording.reset();
+	}
+}
+
+void DecoderCached::ResetRecording( const bool restart )
+{
+	if ( m_Recording ) {
+		m_Cache->ReturnChunks( m_Recording->Chunks );
+		m_Recording->SampleCount = 0;
+		if ( !restart ) {
+			m_Recording.reset();
+		}
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Decoder.h"
+#include "PCMCache.h"
+
+#include <string>
+#include <vector>
+
+// Decodes a track from the decoded audio cache, or passes through another decoder while adding its sample data to the cache.
+// Sample data is only added to the cache once the other decoder has been read from the start to the end of the track without seeking.
+class DecoderCached : public Decoder
+{
+public:
+	// Decodes a 'track' from the cache.
+	DecoderCached( const PCMCache::TrackPtr track );
+
+	// Passes through another decoder, adding its sample data to the cache.
+	// 'decoder' - source decoder (positioned at the start of the track).
+	// 'cache' - cache to which the sample data is added.
+	// 'filename' - file name of the track.
+	// 'filetime' - file time of the track.
+	DecoderCached( const Decoder::Ptr decoder, PCMCache& cache, const std::wstring& filename, const long long filetime );
+
+	~DecoderCached() override;
+
+	// Returns the number of bytes in each packed value for a stream with 'bitsPerSample', or zero if the stream cannot be held losslessly in the cache.
+	static long GetBytesPerValue( const std::optional<long> bitsPerSample );
+
+protected:
+	// Reads sample data.
+	// 'buffer' - output buffer (floating point format scaled to +/-1.0f).
+	// 'sampleCount' - number of samples to read.
+	// Returns the number of samples read, or zero if the stream has ended.
+	long ReadSamples( float* buffer, const long sampleCount ) override;
+
+	// Reads the next block of sample data as a read-only view, which refers to the source decoder's view when passing through another decoder.
+	// 'view' - out, the frame view.
+	// 'maximumSamples' - maximum number of samples per channel to return in the view.
+	// Returns the number of samples per channel in the view, or zero if the stream has ended.
+	long ReadFrameView( FrameView& view, const long maximumSamples ) override;
+
+	// Seeks to a 'position' in the stream, in seconds.
+	// When passing through another decoder, a short seek forward is made by decoding through to the position, so that the track can still be added to the cache.
+	// Returns the new position in seconds.
+	float SeekTo( const float position ) override;
+
+private:
+	// Adds the sample data in 'view' to the track being recorded, abandoning the recording if the sample data cannot be held losslessly.
+	void Record( const FrameView& view );
+
+	// Passes the recorded track to the cache, once the end of the track has been reached.
+	void EndRecording();
+
+	// Returns the chunks of the track being recorded to the cache, and then either restarts or abandons the recording.
+	// 'restart' - true to restart the recording from the start of the track, false to abandon it.
+	void ResetRecording( const bool restart );
+
+	// Cached track, when decoding from the cache.
+	PCMCache::TrackPtr m_Track;
+
+	// Position of the next sample to decode from the cached track, in samples.
+	long long m_Position;
+
+	// Source decoder, when passing through another decoder.
+	Decoder::Ptr m_Decoder;
+
+	// Cache to which the sample data from the source decoder is added.
+	PCMCache* m_Cache;
+
+	// File name of the track.
+	const std::wstring m_Filename;
+
+	// File time of the track.
+	const long long m_Filetime;
+
+	// Track being recorded from the source decoder, or nullptr if the track is not being recorded.
+	std::shared_ptr<PCMCache::Track> m_Recording;
+
+	// Conversion buffer for recording sample data which is not in floating point format.
+	std::vector<float> m_RecordBuffer;
+};
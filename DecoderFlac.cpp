@@ -1,16 +1,20 @@
 #include "DecoderFlac.h"
 
-DecoderFlac::DecoderFlac( const std::wstring& filename ) :
+#include "SampleKernels.h"
+
+#include <algorithm>
+
+DecoderFlac::DecoderFlac( const std::wstring& filename, const bool readAhead ) :
 	Decoder(),
 	FLAC::Decoder::Stream(),
-	m_FileStream(),
+	m_FileSource(),
 	m_FLACFrame(),
 	m_FLACBuffer( nullptr ),
 	m_FLACFramePos( 0 ),
 	m_Valid( false )
 {
-	m_FileStream.open( filename, std::ios::binary | std::ios::in );
-	if ( m_FileStream.is_open() ) {
+	m_FileSource = FileSource::Open( filename, readAhead );
+	if ( m_FileSource ) {
 		if ( init() == FLAC__STREAM_DECODER_INIT_STATUS_OK )	{
 			process_until_end_of_metadata();
 		}
@@ -20,7 +24,7 @@ DecoderFlac::DecoderFlac( const std::wstring& filename ) :
 		SetBitrate( CalculateBitrate() );
 	} else {
 		finish();
-		m_FileStream.close();
+		m_FileSource.reset();
 		throw std::runtime_error( "DecoderFlac could not load file" );
 	}
 }
@@ -28,36 +32,75 @@ DecoderFlac::DecoderFlac( const std::wstring& filename ) :
 DecoderFlac::~DecoderFlac()
 {
 	finish();
-	m_FileStream.close();
+	m_FileSource.reset();
 }
 
-long DecoderFlac::Read( float* buffer, const long sampleCount )
+long DecoderFlac::ReadSamples( float* buffer, const long sampleCount )
 {
 	long samplesRead = 0;
-	while ( samplesRead < sampleCount ) {
-		if ( m_FLACFramePos >= m_FLACFrame.header.blocksize ) {
-			m_FLACFramePos = 0;
-			m_FLACFrame = {};
-			if ( !process_single() || ( 0 == m_FLACFrame.header.blocksize ) ) {
-				break;
+	while ( ( samplesRead < sampleCount ) && DecodeFrame() ) {
+		// Convert as much of the remainder of the frame as is required in one go.
+		const long channels = static_cast<long>( m_FLACFrame.header.channels );
+		const unsigned int count = std::min<unsigned int>( m_FLACFrame.header.blocksize - m_FLACFramePos, static_cast<unsigned int>( sampleCount - samplesRead ) );
+		InterleaveInt32ToFloat( buffer + samplesRead * channels, m_FLACBuffer, m_FLACFramePos, count, channels, static_cast<long>( m_FLACFrame.header.bits_per_sample ) );
+		samplesRead += static_cast<long>( count );
+		m_FLACFramePos += count;
+	}
+	return samplesRead;
+}
+
+long DecoderFlac::ReadFrameView( FrameView& view, const long maximumSamples )
+{
+	long samplesRead = 0;
+	if ( DecodeFrame() ) {
+		// The view refers directly to the remainder of the decoded frame.
+		const long channels = static_cast<long>( m_FLACFrame.header.channels );
+		if ( channels <= FrameView::MaximumPlanes ) {
+			samplesRead = static_cast<long>( std::min<unsigned int>( m_FLACFrame.header.blocksize - m_FLACFramePos, static_cast<unsigned int>( maximumSamples ) ) );
+			for ( long channel = 0; channel < channels; channel++ ) {
+				view.Planes[ channel ] = m_FLACBuffer[ channel ] + m_FLACFramePos;
 			}
+			view.Planar = true;
+			view.DataType = FrameView::Type::Int32;
+			view.BitsPerSample = static_cast<long>( m_FLACFrame.header.bits_per_sample );
+			m_FLACFramePos += static_cast<unsigned int>( samplesRead );
+		} else {
+			samplesRead = Decoder::ReadFrameView( view, maximumSamples );
 		}
-		for ( unsigned int channel = 0; channel < m_FLACFrame.header.channels; channel++ ) {
-			buffer[ samplesRead * m_FLACFrame.header.channels + channel ] = 
-					static_cast<float>( m_FLACBuffer[ channel ][ m_FLACFramePos ] ) / ( 1 << ( m_FLACFrame.header.bits_per_sample - 1 ) );
-		}
-		++samplesRead;
-		++m_FLACFramePos;
 	}
-	
 	return samplesRead;
 }
 
-float DecoderFlac::Seek( const float position )
+bool DecoderFlac::SupportsSeekIndex() const
+{
+	return true;
+}
+
+bool DecoderFlac::DecodeFrame()
+{
+	if ( m_FLACFramePos >= m_FLACFrame.header.blocksize ) {
+		m_FLACFramePos = 0;
+		m_FLACFrame = {};
+		FLAC__uint64 offset = 0;
+		const bool hasOffset = get_decode_position( &offset );
+		if ( !process_single() ) {
+			m_FLACFrame = {};
+		} else if ( hasOffset && ( m_FLACFrame.header.blocksize > 0 ) ) {
+			AddSeekPoint( static_cast<long long>( m_FLACFrame.header.number.sample_number ), static_cast<long long>( offset ) );
+		}
+	}
+	const bool available = ( m_FLACFramePos < m_FLACFrame.header.blocksize );
+	return available;
+}
+
+float DecoderFlac::SeekTo( const float position )
 {
 	float seekPosition = 0;
 	m_FLACFramePos = 0;
-	if ( ( GetSampleRate() > 0 ) && seek_absolute( static_cast<FLAC__uint64>( position * GetSampleRate() ) ) ) {
+	const FLAC__uint64 sample = static_cast<FLAC__uint64>( position * GetSampleRate() );
+	if ( ( GetSampleRate() > 0 ) && SeekIndexed( sample ) ) {
+		seekPosition = static_cast<float>( sample ) / GetSampleRate();
+	} else if ( ( GetSampleRate() > 0 ) && seek_absolute( sample ) ) {
 		process_single();
 		seekPosition = static_cast<float>( m_FLACFrame.header.number.sample_number ) / GetSampleRate();
 	}
@@ -67,22 +110,43 @@ float DecoderFlac::Seek( const float position )
 	return seekPosition;
 }
 
+bool DecoderFlac::SeekIndexed( const FLAC__uint64 sample )
+{
+	bool success = false;
+	const SeekIndex::Ptr index = GetSeekIndex();
+	const std::optional<SeekIndex::Point> point = index ? index->Find( static_cast<long long>( sample ) ) : std::nullopt;
+	if ( point && flush() && m_FileSource->Seek( point->Offset ) ) {
+		// Decode the indexed frame (checking that it is the expected one), then any following frames up to the one containing the seek position.
+		m_FLACFrame = {};
+		bool decoded = process_single() && ( m_FLACFrame.header.blocksize > 0 ) && ( static_cast<long long>( m_FLACFrame.header.number.sample_number ) == point->Sample );
+		while ( decoded && ( ( m_FLACFrame.header.number.sample_number + m_FLACFrame.header.blocksize ) <= sample ) ) {
+			m_FLACFrame = {};
+			decoded = process_single() && ( m_FLACFrame.header.blocksize > 0 );
+		}
+		if ( decoded ) {
+			m_FLACFramePos = static_cast<unsigned int>( sample - m_FLACFrame.header.number.sample_number );
+			success = true;
+		} else {
+			m_FLACFrame = {};
+			m_FLACFramePos = 0;
+		}
+	}
+	return success;
+}
+
 std::optional<float> DecoderFlac::CalculateBitrate()
 {
 	std::optional<float> bitrate;
-	if ( const float duration = GetDuration(); ( duration > 0 ) && m_FileStream.good() ) {
-		const auto initial = m_FileStream.tellg();
-
-		m_FileStream.seekg( 0, std::ios_base::end );
-		const long long filesize = m_FileStream.tellg();
-		m_FileStream.seekg( 0, std::ios_base::beg );
+	if ( const float duration = GetDuration(); ( duration > 0 ) && m_FileSource ) {
+		const long long initial = m_FileSource->GetPosition();
+		const long long filesize = m_FileSource->GetSize();
+		m_FileSource->Seek( 0 );
 
 		std::vector<char> block( 4 );
-		m_FileStream.read( block.data(), 4 );
-		if ( ( 'f' == block[ 0 ] ) && ( 'L' == block[ 1 ] ) && ( 'a' ==  block[ 2 ] ) && ('C' == block[ 3 ] ) ) {
-			m_FileStream.read( block.data(), 4 );
-			while ( m_FileStream.good() ) {
-				const long long currentPos = m_FileStream.tellg();
+		if ( ( 4 == m_FileSource->Read( block.data(), 4 ) ) && ( 'f' == block[ 0 ] ) && ( 'L' == block[ 1 ] ) && ( 'a' ==  block[ 2 ] ) && ('C' == block[ 3 ] ) ) {
+			bool good = ( 4 == m_FileSource->Read( block.data(), 4 ) );
+			while ( good ) {
+				const long long currentPos = m_FileSource->GetPosition();
 				const unsigned long blockSize = ( static_cast<unsigned char>( block[ 1 ] ) << 16 ) | ( static_cast<unsigned char>( block[ 2 ] ) << 8 ) | static_cast<unsigned char>( block[ 3 ] );
 				if ( ( currentPos + blockSize ) < filesize ) {
 					const bool lastBlock = block[ 0 ] & 0x80;
@@ -94,68 +158,43 @@ std::optional<float> DecoderFlac::CalculateBitrate()
 				} else {
 					break;
 				}
-				m_FileStream.seekg( blockSize, std::ios_base::cur );
-				m_FileStream.read( block.data(), 4 );
+				good = m_FileSource->Seek( blockSize, SEEK_CUR ) && ( 4 == m_FileSource->Read( block.data(), 4 ) );
 			};
 		}
 
-		if ( !m_FileStream.good() ) {
-			m_FileStream.clear();
-		}
-		m_FileStream.seekg( initial );
+		m_FileSource->Seek( initial );
 	}
 	return bitrate;
 }
 
 FLAC__StreamDecoderReadStatus DecoderFlac::read_callback( FLAC__byte buf[], size_t * size )
 {
-	FLAC__StreamDecoderReadStatus status = FLAC__STREAM_DECODER_READ_STATUS_ABORT;
-	if ( m_FileStream.eof() ) {
-		*size = 0;
-		status = FLAC__STREAM_DECODER_READ_STATUS_END_OF_STREAM;
-	} else {
-		m_FileStream.read( reinterpret_cast<char*>( buf ), *size );
-		*size = static_cast<size_t>( m_FileStream.gcount() );
-		if ( *size > 0 ) {
-			status = FLAC__STREAM_DECODER_READ_STATUS_CONTINUE;
-		}
-	}
+	*size = m_FileSource->Read( buf, *size );
+	const FLAC__StreamDecoderReadStatus status = ( *size > 0 ) ? FLAC__STREAM_DECODER_READ_STATUS_CONTINUE : FLAC__STREAM_DECODER_READ_STATUS_END_OF_STREAM;
 	return status;
 }
 
 FLAC__StreamDecoderSeekStatus DecoderFlac::seek_callback( FLAC__uint64 pos )
 {
-	if ( !m_FileStream.good() ) {
-		m_FileStream.clear();
-	}
-	m_FileStream.seekg( pos, std::ios_base::beg );
-	return FLAC__STREAM_DECODER_SEEK_STATUS_OK;
+	const FLAC__StreamDecoderSeekStatus status = m_FileSource->Seek( static_cast<long long>( pos ) ) ? FLAC__STREAM_DECODER_SEEK_STATUS_OK : FLAC__STREAM_DECODER_SEEK_STATUS_ERROR;
+	return status;
 }
 
 FLAC__StreamDecoderTellStatus DecoderFlac::tell_callback( FLAC__uint64 * pos )
 {
-	if ( !m_FileStream.good() ) {
-		m_FileStream.clear();
-	}
-	*pos = m_FileStream.tellg();
+	*pos = static_cast<FLAC__uint64>( m_FileSource->GetPosition() );
 	return FLAC__STREAM_DECODER_TELL_STATUS_OK;
 }
 
 FLAC__StreamDecoderLengthStatus DecoderFlac::length_callback( FLAC__uint64 * pos )
 {
-	if ( !m_FileStream.good() ) {
-		m_FileStream.clear();
-	}
-	const std::streampos currentPos = m_FileStream.tellg();
-	m_FileStream.seekg( 0, std::ios_base::end );
-	*pos = m_FileStream.tellg();
-	m_FileStream.seekg( currentPos );
+	*pos = static_cast<FLAC__uint64>( m_FileSource->GetSize() );
 	return FLAC__STREAM_DECODER_LENGTH_STATUS_OK;
 }
 
 bool DecoderFlac::eof_callback()
 {
-	const bool eof = m_FileStream.eof();
+	const bool eof = m_FileSource->IsEOF();
 	return eof;
 }
 
@@ -1,9 +1,9 @@
 #pragma once
 #include "Decoder.h"
+#include "FileSource.h"
 
 #include "FLAC++\all.h"
 
-#include <fstream>
 #include <vector>
 
 // FLAC decoder
@@ -11,22 +11,32 @@ class DecoderFlac : public Decoder, public FLAC::Decoder::Stream
 {
 public:
 	// 'filename' - file name.
+	// 'readAhead' - whether to read ahead of the decoder, which is only worthwhile when the whole file is streamed for playback.
 	// Throws a std::runtime_error exception if the file could not be loaded.
-	DecoderFlac( const std::wstring& filename );
+	DecoderFlac( const std::wstring& filename, const bool readAhead );
 
 	~DecoderFlac() override;
 
+	// Returns whether the decoder can seek using a seek index.
+	bool SupportsSeekIndex() const override;
+
+protected:
 	// Reads sample data.
 	// 'buffer' - output buffer (floating point format scaled to +/-1.0f).
 	// 'sampleCount' - number of samples to read.
 	// Returns the number of samples read, or zero if the stream has ended.
-	long Read( float* buffer, const long sampleCount ) override;
+	long ReadSamples( float* buffer, const long sampleCount ) override;
 
 	// Seeks to a 'position' in the stream, in seconds.
 	// Returns the new position in seconds.
-	float Seek( const float position ) override;
+	float SeekTo( const float position ) override;
+
+	// Reads the next block of sample data from the stream as a read-only view, which refers directly to the planar sample data of the current frame.
+	// 'view' - out, the frame view.
+	// 'maximumSamples' - maximum number of samples per channel to return in the view.
+	// Returns the number of samples per channel in the view, or zero if the stream has ended.
+	long ReadFrameView( FrameView& view, const long maximumSamples ) override;
 
-protected:
 	// FLAC callbacks
 	FLAC__StreamDecoderReadStatus read_callback( FLAC__byte [], size_t * ) override;
 	FLAC__StreamDecoderSeekStatus seek_callback( FLAC__uint64 ) override;
@@ -41,8 +51,16 @@ private:
 	// Calculates the bitrate of the FLAC stream (returns nullopt if the bitrate was not calculated).
 	std::optional<float> CalculateBitrate();
 
-	// Input file stream.
-	std::ifstream m_FileStream;
+	// Decodes the next frame, once the current frame has been consumed.
+	// Returns whether there is sample data remaining in the current frame.
+	bool DecodeFrame();
+
+	// Seeks to a 'sample' position using the seek index, decoding forward from the nearest indexed frame.
+	// Returns whether the seek was successful.
+	bool SeekIndexed( const FLAC__uint64 sample );
+
+	// Input file source.
+	FileSource::Ptr m_FileSource;
 
 	// Current FLAC frame.
 	FLAC__Frame m_FLACFrame;
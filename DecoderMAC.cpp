@@ -1,11 +1,88 @@
 #include "DecoderMAC.h"
 
+#include "SampleKernels.h"
 #include "Utility.h"
 
-DecoderMAC::DecoderMAC( const std::wstring& filename ) :
+DecoderMAC::FileSourceIO::FileSourceIO( const FileSource::Ptr source, const std::wstring& filename ) :
+	APE::CIO(),
+	m_Source( source ),
+	m_Filename( filename )
+{
+}
+
+DecoderMAC::FileSourceIO::~FileSourceIO()
+{
+}
+
+int DecoderMAC::FileSourceIO::Open( const wchar_t* /*pName*/, bool /*bOpenReadOnly*/ )
+{
+	return ERROR_UNDEFINED;
+}
+
+int DecoderMAC::FileSourceIO::Close()
+{
+	return ERROR_SUCCESS;
+}
+
+int DecoderMAC::FileSourceIO::Read( void* pBuffer, unsigned int nBytesToRead, unsigned int* pBytesRead )
+{
+	*pBytesRead = static_cast<unsigned int>( m_Source->Read( pBuffer, nBytesToRead ) );
+	return ERROR_SUCCESS;
+}
+
+int DecoderMAC::FileSourceIO::Write( const void* /*pBuffer*/, unsigned int /*nBytesToWrite*/, unsigned int* pBytesWritten )
+{
+	*pBytesWritten = 0;
+	return ERROR_IO_WRITE;
+}
+
+APE::int64 DecoderMAC::FileSourceIO::PerformSeek()
+{
+	// The APE seek methods correspond to the standard seek origins.
+	return m_Source->Seek( m_nSeekPosition, static_cast<int>( m_nSeekMethod ) ) ? ERROR_SUCCESS : ERROR_UNDEFINED;
+}
+
+int DecoderMAC::FileSourceIO::Create( const wchar_t* /*pName*/ )
+{
+	return ERROR_UNDEFINED;
+}
+
+int DecoderMAC::FileSourceIO::Delete()
+{
+	return ERROR_UNDEFINED;
+}
+
+int DecoderMAC::FileSourceIO::SetEOF()
+{
+	return ERROR_UNDEFINED;
+}
+
+APE::int64 DecoderMAC::FileSourceIO::GetPosition()
+{
+	return m_Source->GetPosition();
+}
+
+APE::int64 DecoderMAC::FileSourceIO::GetSize()
+{
+	return m_Source->GetSize();
+}
+
+int DecoderMAC::FileSourceIO::GetName( wchar_t* pBuffer )
+{
+	wcsncpy_s( pBuffer, MAX_PATH, m_Filename.c_str(), _TRUNCATE );
+	return ERROR_SUCCESS;
+}
+
+DecoderMAC::DecoderMAC( const std::wstring& filename, const bool readAhead ) :
 	Decoder(),
-	m_decompress( CreateIAPEDecompress( filename.c_str() )  )
+	m_IO(),
+	m_decompress(),
+	m_Buffer()
 {
+	if ( const FileSource::Ptr source = FileSource::Open( filename, readAhead ); source ) {
+		m_IO = std::make_unique<FileSourceIO>( source, filename );
+		m_decompress.reset( CreateIAPEDecompressEx( m_IO.get() ) );
+	}
 	if ( m_decompress ) {
 		const auto bps =  m_decompress->GetInfo( APE::APE_INFO_BITS_PER_SAMPLE );
 		const auto channels = m_decompress->GetInfo( APE::APE_INFO_CHANNELS );
@@ -27,45 +104,36 @@ DecoderMAC::DecoderMAC( const std::wstring& filename ) :
 	}
 }
 
-long DecoderMAC::Read( float* destBuffer, const long sampleCount )
+long DecoderMAC::ReadSamples( float* destBuffer, const long sampleCount )
 {
 	long samplesRead = 0;
 	const long blockAlign = static_cast<long>( m_decompress->GetInfo( APE::APE_INFO_BLOCK_ALIGN ) );
 	if ( blockAlign > 0 ) {
-		std::vector<char> srcBuffer( sampleCount * blockAlign );
+		const size_t bufferSize = static_cast<size_t>( sampleCount ) * blockAlign;
+		if ( m_Buffer.size() < bufferSize ) {
+			m_Buffer.resize( bufferSize );
+		}
 		long long blocksRead = 0;
-		m_decompress->GetData( srcBuffer.data(), sampleCount, &blocksRead );
+		m_decompress->GetData( reinterpret_cast<char*>( m_Buffer.data() ), sampleCount, &blocksRead );
 		if ( blocksRead > 0 ) {
 			samplesRead = static_cast<long>( blocksRead );
-			const long channels = GetChannels();
+			const size_t valueCount = static_cast<size_t>( blocksRead * GetChannels() );
 			const long bps = GetBPS().value_or( 0 );
 			switch ( bps ) {
 				case 8 : {
-					unsigned char* uBuf = reinterpret_cast<unsigned char*>( srcBuffer.data() );
-					for ( long long block = 0; block < blocksRead * channels; block++ ) {
-						*destBuffer++ = static_cast<float>( static_cast<int>( uBuf[ block ] ) - 128 ) / 128;
-					}
+					ConvertUInt8ToFloat( destBuffer, m_Buffer.data(), valueCount );
 					break;
 				}
 				case 16 : {
-					short* sBuf = reinterpret_cast<short*>( srcBuffer.data() );
-					for ( long long block = 0; block < blocksRead * channels; block++ ) {
-						*destBuffer++ = static_cast<float>( sBuf[ block ] ) / 32768;
-					}
+					ConvertInt16ToFloat( destBuffer, reinterpret_cast<const int16_t*>( m_Buffer.data() ), valueCount );
 					break;
 				}
 				case 24 : {
-					unsigned char* uBuf = reinterpret_cast<unsigned char*>( srcBuffer.data() );
-					for ( long long block = 0; block < blocksRead * channels; block++ ) {
-						*destBuffer++ = static_cast<float>( ( uBuf[ block * 3 + 2 ] << 24 ) | ( uBuf[ block * 3 + 1 ] << 16 ) | ( uBuf[ block * 3 ] << 8 ) ) / 2147483648ul;
-					}
+					ConvertInt24ToFloat( destBuffer, m_Buffer.data(), valueCount );
 					break;
 				}
 				case 32 : {
-					int32_t* iBuf = reinterpret_cast<int32_t*>( srcBuffer.data() );
-					for ( long long block = 0; block < blocksRead * channels; block++ ) {
-						*destBuffer++ = static_cast<float>( iBuf[ block ] ) / 2147483648ul;
-					}
+					ConvertInt32ToFloat( destBuffer, reinterpret_cast<const int32_t*>( m_Buffer.data() ), valueCount, bps );
 					break;
 				}
 				default : {
@@ -78,7 +146,7 @@ long DecoderMAC::Read( float* destBuffer, const long sampleCount )
 	return samplesRead;
 }
 
-float DecoderMAC::Seek( const float position )
+float DecoderMAC::SeekTo( const float position )
 {
 	const long long blockOffset = static_cast<long long>( GetSampleRate() * position );
 	m_decompress->Seek( blockOffset );
@@ -1,31 +1,72 @@
 #pragma once
 
 #include "Decoder.h"
+#include "FileSource.h"
 
 #include "All.h"
 #include "maclib.h"
 #include "APETag.h"
 
 #include <string>
+#include <vector>
 
 class DecoderMAC : public Decoder
 {
 public:
 	// 'filename' - file name.
+	// 'readAhead' - whether to read ahead of the decoder, which is only worthwhile when the whole file is streamed for playback.
 	// Throws a std::runtime_error exception if the file could not be loaded.
-	DecoderMAC( const std::wstring& filename );
+	DecoderMAC( const std::wstring& filename, const bool readAhead );
 
+protected:
 	// Reads sample data.
 	// 'buffer' - output buffer (floating point format scaled to +/-1.0f).
 	// 'sampleCount' - number of samples to read.
 	// Returns the number of samples read, or zero if the stream has ended.
-	long Read( float* buffer, const long sampleCount ) override;
+	long ReadSamples( float* buffer, const long sampleCount ) override;
 
 	// Seeks to a 'position' in the stream, in seconds.
 	// Returns the new position in seconds.
-	float Seek( const float position ) override;
+	float SeekTo( const float position ) override;
 
 private:
+	// Adapts a file source to the APE I/O interface.
+	class FileSourceIO : public APE::CIO
+	{
+	public:
+		// 'source' - file source.
+		// 'filename' - file name.
+		FileSourceIO( const FileSource::Ptr source, const std::wstring& filename );
+
+		~FileSourceIO() override;
+
+		// APE I/O interface (files are read only).
+		int Open( const wchar_t* pName, bool bOpenReadOnly = false ) override;
+		int Close() override;
+		int Read( void* pBuffer, unsigned int nBytesToRead, unsigned int* pBytesRead ) override;
+		int Write( const void* pBuffer, unsigned int nBytesToWrite, unsigned int* pBytesWritten ) override;
+		APE::int64 PerformSeek() override;
+		int Create( const wchar_t* pName ) override;
+		int Delete() override;
+		int SetEOF() override;
+		APE::int64 GetPosition() override;
+		APE::int64 GetSize() override;
+		int GetName( wchar_t* pBuffer ) override;
+
+	private:
+		// File source.
+		const FileSource::Ptr m_Source;
+
+		// File name.
+		const std::wstring m_Filename;
+	};
+
+	// APE I/O (which must outlive the decompressor).
+	std::unique_ptr<FileSourceIO> m_IO;
+
 	// APE decompressor.
 	std::unique_ptr<APE::IAPEDecompress> m_decompress;
+
+	// Native sample data buffer, reused between reads.
+	std::vector<uint8_t> m_Buffer;
 };
@@ -2,9 +2,37 @@
 
 #include "Utility.h"
 
-DecoderMPC::DecoderMPC( const std::wstring& filename ) :
+#include <algorithm>
+
+// MPC reader callbacks, where the reader data is a file source.
+static mpc_int32_t ReadCallback( mpc_reader* p_reader, void* ptr, mpc_int32_t size )
+{
+	return static_cast<mpc_int32_t>( static_cast<FileSource*>( p_reader->data )->Read( ptr, static_cast<size_t>( size ) ) );
+}
+
+static mpc_bool_t SeekCallback( mpc_reader* p_reader, mpc_int32_t offset )
+{
+	return static_cast<FileSource*>( p_reader->data )->Seek( offset ) ? MPC_TRUE : MPC_FALSE;
+}
+
+static mpc_int32_t TellCallback( mpc_reader* p_reader )
+{
+	return static_cast<mpc_int32_t>( static_cast<FileSource*>( p_reader->data )->GetPosition() );
+}
+
+static mpc_int32_t GetSizeCallback( mpc_reader* p_reader )
+{
+	return static_cast<mpc_int32_t>( static_cast<FileSource*>( p_reader->data )->GetSize() );
+}
+
+static mpc_bool_t CanSeekCallback( mpc_reader* /*p_reader*/ )
+{
+	return MPC_TRUE;
+}
+
+DecoderMPC::DecoderMPC( const std::wstring& filename, const bool readAhead ) :
 	Decoder(),
-	m_file( nullptr ),
+	m_FileSource( FileSource::Open( filename, readAhead ) ),
 	m_reader(),
 	m_demux(),
 	m_buffer( MPC_DECODER_BUFFER_LENGTH ),
@@ -12,31 +40,24 @@ DecoderMPC::DecoderMPC( const std::wstring& filename ) :
 	m_bufferpos( 0 ),
 	m_eos( false )
 {
-	if ( 0 == _wfopen_s( &m_file, filename.c_str(), L"rb" ) && ( nullptr != m_file ) ) {
-		if ( MPC_STATUS_OK == mpc_reader_init_stdio_stream( &m_reader, m_file ) ) {
-			m_demux = mpc_demux_init( &m_reader );
-			if ( nullptr != m_demux ) {
-				mpc_streaminfo info = {};
-				mpc_demux_get_info( m_demux, &info );
-				SetChannels( static_cast<long>( info.channels ) );
-				SetSampleRate( static_cast<long>( info.sample_freq ) );
-				SetBitrate( static_cast<float>( info.average_bitrate ) / 1000 );
-				SetDuration( static_cast<float>( mpc_streaminfo_get_length( &info ) ) );
-				if ( ( 0 == GetChannels() ) || ( 0 == GetSampleRate() ) || ( GetDuration() <= 0 ) ) {
-					mpc_demux_exit( m_demux );
-					m_demux = nullptr;
-				}
-			}
-			if ( nullptr == m_demux ) {
-				mpc_reader_exit_stdio( &m_reader );
+	if ( m_FileSource ) {
+		m_reader = { ReadCallback, SeekCallback, TellCallback, GetSizeCallback, CanSeekCallback, m_FileSource.get() };
+		m_demux = mpc_demux_init( &m_reader );
+		if ( nullptr != m_demux ) {
+			mpc_streaminfo info = {};
+			mpc_demux_get_info( m_demux, &info );
+			SetChannels( static_cast<long>( info.channels ) );
+			SetSampleRate( static_cast<long>( info.sample_freq ) );
+			SetBitrate( static_cast<float>( info.average_bitrate ) / 1000 );
+			SetDuration( static_cast<float>( mpc_streaminfo_get_length( &info ) ) );
+			if ( ( 0 == GetChannels() ) || ( 0 == GetSampleRate() ) || ( GetDuration() <= 0 ) ) {
+				mpc_demux_exit( m_demux );
+				m_demux = nullptr;
 			}
 		}
 	}
 
 	if ( nullptr == m_demux ) {
-		if ( nullptr != m_file ) {
-			fclose( m_file );
-		}
 		throw std::runtime_error( "DecoderMPC could not load file" );
 	}
 }
@@ -44,35 +65,54 @@ DecoderMPC::DecoderMPC( const std::wstring& filename ) :
 DecoderMPC::~DecoderMPC()
 {
 	mpc_demux_exit( m_demux );
-	mpc_reader_exit_stdio( &m_reader );
-	fclose( m_file );
 }
 
-long DecoderMPC::Read( float* destBuffer, const long sampleCount )
+long DecoderMPC::ReadSamples( float* destBuffer, const long sampleCount )
 {
 	long samplesRead = 0;
 	const long channels = GetChannels();
-	while ( !m_eos && ( samplesRead < sampleCount ) ) {
-		if ( m_bufferpos < m_buffercount ) {
-			for ( long channel = 0; channel < channels; channel++ ) {
-				*destBuffer++ = m_buffer[ m_bufferpos++ ];
-			}
-			++samplesRead;
-		} else {
-			m_bufferpos = 0;
-			m_buffercount = 0;
-			mpc_frame_info frame = {};
-			frame.buffer = m_buffer.data();
-			if ( ( MPC_STATUS_OK == mpc_demux_decode( m_demux, &frame ) ) && ( -1 != frame.bits ) ) {
-				m_buffercount = frame.samples * channels;
-			}
-			m_eos = ( 0 == m_buffercount );
-		}
+	while ( ( samplesRead < sampleCount ) && DecodeFrame() ) {
+		// Copy as much of the remainder of the frame as is required in one go.
+		const long count = static_cast<long>( std::min<size_t>( ( m_buffercount - m_bufferpos ) / channels, static_cast<size_t>( sampleCount - samplesRead ) ) );
+		const size_t valueCount = static_cast<size_t>( count * channels );
+		std::copy( m_buffer.data() + m_bufferpos, m_buffer.data() + m_bufferpos + valueCount, destBuffer );
+		destBuffer += valueCount;
+		m_bufferpos += valueCount;
+		samplesRead += count;
 	}
 	return samplesRead;
 }
 
-float DecoderMPC::Seek( const float position )
+long DecoderMPC::ReadFrameView( FrameView& view, const long maximumSamples )
+{
+	long samplesRead = 0;
+	if ( DecodeFrame() ) {
+		// The view refers directly to the remainder of the decoded frame.
+		const long channels = GetChannels();
+		samplesRead = static_cast<long>( std::min<size_t>( ( m_buffercount - m_bufferpos ) / channels, static_cast<size_t>( maximumSamples ) ) );
+		view.Planes[ 0 ] = m_buffer.data() + m_bufferpos;
+		m_bufferpos += static_cast<size_t>( samplesRead * channels );
+	}
+	return samplesRead;
+}
+
+bool DecoderMPC::DecodeFrame()
+{
+	if ( !m_eos && ( m_bufferpos >= m_buffercount ) ) {
+		m_bufferpos = 0;
+		m_buffercount = 0;
+		mpc_frame_info frame = {};
+		frame.buffer = m_buffer.data();
+		if ( ( MPC_STATUS_OK == mpc_demux_decode( m_demux, &frame ) ) && ( -1 != frame.bits ) ) {
+			m_buffercount = frame.samples * GetChannels();
+		}
+		m_eos = ( 0 == m_buffercount );
+	}
+	const bool available = ( m_bufferpos < m_buffercount );
+	return available;
+}
+
+float DecoderMPC::SeekTo( const float position )
 {
 	m_bufferpos = 0;
 	m_buffercount = 0;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Decoder.h"
+#include "FileSource.h"
 
 #include "mpc/streaminfo.h"
 #include "mpc/mpcdec.h"
@@ -11,24 +12,36 @@ class DecoderMPC : public Decoder
 {
 public:
 	// 'filename' - file name.
+	// 'readAhead' - whether to read ahead of the decoder, which is only worthwhile when the whole file is streamed for playback.
 	// Throws a std::runtime_error exception if the file could not be loaded.
-	DecoderMPC( const std::wstring& filename );
+	DecoderMPC( const std::wstring& filename, const bool readAhead );
 
 	~DecoderMPC() override;
 
+protected:
 	// Reads sample data.
 	// 'buffer' - output buffer (floating point format scaled to +/-1.0f).
 	// 'sampleCount' - number of samples to read.
 	// Returns the number of samples read, or zero if the stream has ended.
-	long Read( float* buffer, const long sampleCount ) override;
+	long ReadSamples( float* buffer, const long sampleCount ) override;
 
 	// Seeks to a 'position' in the stream, in seconds.
 	// Returns the new position in seconds.
-	float Seek( const float position ) override;
+	float SeekTo( const float position ) override;
+
+	// Reads the next block of sample data from the stream as a read-only view, which refers directly to the interleaved sample data of the current frame.
+	// 'view' - out, the frame view.
+	// 'maximumSamples' - maximum number of samples per channel to return in the view.
+	// Returns the number of samples per channel in the view, or zero if the stream has ended.
+	long ReadFrameView( FrameView& view, const long maximumSamples ) override;
 
 private:
-	// File handle.
-	FILE* m_file;
+	// Decodes the next frame, once the current frame has been consumed.
+	// Returns whether there is sample data remaining in the current frame.
+	bool DecodeFrame();
+
+	// Input file source.
+	FileSource::Ptr m_FileSource;
 
 	// MPC reader.
 	mpc_reader m_reader;
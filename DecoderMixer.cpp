@@ -0,0 +1,212 @@
+#include "DecoderMixer.h"
+
+#include "SampleKernels.h"
+
+#include <algorithm>
+#include <map>
+
+// Number of samples per channel to read from the source decoder at a time.
+static const long s_ReadBlock = 1024;
+
+// Mixing level for a speaker that is distributed across a pair of speakers (-3dB).
+static const float s_PairLevel = 0.70710678f;
+
+DecoderMixer::DecoderMixer( const Decoder::Ptr decoder, const long channels ) :
+	Decoder(),
+	m_Decoder( decoder ),
+	m_Matrix(),
+	m_ReadBuffer()
+{
+	if ( m_Decoder ) {
+		SetDuration( m_Decoder->GetDuration() );
+		SetSampleRate( m_Decoder->GetSampleRate() );
+		SetChannels( channels );
+		SetBPS( m_Decoder->GetBPS() );
+		SetBitrate( m_Decoder->GetBitrate() );
+
+		const long inputChannels = m_Decoder->GetChannels();
+		if ( ( inputChannels > 0 ) && ( channels > 0 ) ) {
+			m_Matrix = CalculateMatrix( inputChannels, channels );
+			m_ReadBuffer.resize( s_ReadBlock * inputChannels );
+		}
+	}
+}
+
+DecoderMixer::~DecoderMixer()
+{
+}
+
+long DecoderMixer::ReadSamples( float* buffer, const long sampleCount )
+{
+	long samplesRead = 0;
+	const long channels = GetChannels();
+	const long inputChannels = m_Decoder ? m_Decoder->GetChannels() : 0;
+	if ( ( nullptr != buffer ) && !m_Matrix.empty() && ( channels > 0 ) && ( inputChannels > 0 ) ) {
+		while ( samplesRead < sampleCount ) {
+			const long samplesToRead = std::min( sampleCount - samplesRead, s_ReadBlock );
+			const long samplesDecoded = m_Decoder->Read( m_ReadBuffer.data(), samplesToRead );
+			if ( samplesDecoded > 0 ) {
+				MixChannels( buffer + samplesRead * channels, channels, m_ReadBuffer.data(), inputChannels, samplesDecoded, m_Matrix.data() );
+				samplesRead += samplesDecoded;
+			}
+			if ( samplesDecoded < samplesToRead ) {
+				break;
+			}
+		}
+	}
+	return samplesRead;
+}
+
+float DecoderMixer::SeekTo( const float position )
+{
+	return m_Decoder ? m_Decoder->Seek( position ) : 0;
+}
+
+std::optional<float> DecoderMixer::CalculateTrackGain( CanContinue canContinue, const float secondsLimit )
+{
+	// Calculate the gain using the original channel layout, so that it matches the gain calculated for the track elsewhere.
+	return m_Decoder ? m_Decoder->CalculateTrackGain( canContinue, secondsLimit ) : std::nullopt;
+}
+
+bool DecoderMixer::SupportsStreamTitles() const
+{
+	return m_Decoder && m_Decoder->SupportsStreamTitles();
+}
+
+std::pair<float /*seconds*/, std::wstring /*title*/> DecoderMixer::GetStreamTitle()
+{
+	return m_Decoder ? m_Decoder->GetStreamTitle() : std::pair<float, std::wstring>();
+}
+
+float DecoderMixer::GetStreamTitlePosition()
+{
+	return m_Decoder ? m_Decoder->GetStreamTitlePosition() : 0;
+}
+
+std::vector<DecoderMixer::Speaker> DecoderMixer::GetSpeakers( const long channels )
+{
+	switch ( channels ) {
+		case 1 : {
+			return { FrontCenter };
+		}
+		case 2 : {
+			return { FrontLeft, FrontRight };
+		}
+		case 3 : {
+			return { FrontLeft, FrontRight, FrontCenter };
+		}
+		case 4 : {
+			return { FrontLeft, FrontRight, RearLeft, RearRight };
+		}
+		case 5 : {
+			return { FrontLeft, FrontRight, FrontCenter, RearLeft, RearRight };
+		}
+		case 6 : {
+			return { FrontLeft, FrontRight, FrontCenter, LFE, RearLeft, RearRight };
+		}
+		case 7 : {
+			return { FrontLeft, FrontRight, FrontCenter, LFE, RearCenter, SideLeft, SideRight };
+		}
+		case 8 : {
+			return { FrontLeft, FrontRight, FrontCenter, LFE, RearLeft, RearRight, SideLeft, SideRight };
+		}
+		default : {
+			return {};
+		}
+	}
+}
+
+std::vector<float> DecoderMixer::CalculateMatrix( const long inputChannels, const long outputChannels )
+{
+	std::vector<float> matrix( static_cast<size_t>( inputChannels ) * outputChannels, 0.0f );
+	const std::vector<Speaker> inputSpeakers = GetSpeakers( inputChannels );
+	const std::vector<Speaker> outputSpeakers = GetSpeakers( outputChannels );
+	if ( inputSpeakers.empty() || outputSpeakers.empty() ) {
+		// Unknown layout, so map each channel directly.
+		for ( long channel = 0; ( channel < inputChannels ) && ( channel < outputChannels ); channel++ ) {
+			matrix[ channel * inputChannels + channel ] = 1.0f;
+		}
+		return matrix;
+	}
+
+	int outputMask = 0;
+	std::map<Speaker, long> outputIndices;
+	for ( long channel = 0; channel < outputChannels; channel++ ) {
+		outputMask |= outputSpeakers[ channel ];
+		outputIndices.insert( { outputSpeakers[ channel ], channel } );
+	}
+
+	// Distributes the 'input' channel to the 'speakers' (that are available) at the specified 'level', returning whether any speakers were available.
+	auto distribute = [ &matrix, &outputIndices, outputMask, inputChannels ] ( const long input, const std::vector<Speaker>& speakers, const float level ) {
+		const bool available = std::all_of( speakers.begin(), speakers.end(), [ outputMask ] ( const Speaker speaker ) { return 0 != ( outputMask & speaker ); } );
+		if ( available ) {
+			for ( const auto& speaker : speakers ) {
+				matrix[ outputIndices[ speaker ] * inputChannels + input ] += level;
+			}
+		}
+		return available;
+	};
+
+	const float rearLevel = s_PairLevel * s_PairLevel;
+	for ( long input = 0; input < inputChannels; input++ ) {
+		const Speaker speaker = inputSpeakers[ input ];
+		if ( ( 1 == inputChannels ) && distribute( input, { FrontLeft, FrontRight }, 1.0f ) ) {
+			// Mono is played at full level on both front speakers.
+			continue;
+		}
+		if ( distribute( input, { speaker }, 1.0f ) ) {
+			continue;
+		}
+		switch ( speaker ) {
+			case FrontLeft :
+			case FrontRight : {
+				distribute( input, { FrontCenter }, s_PairLevel );
+				break;
+			}
+			case FrontCenter : {
+				distribute( input, { FrontLeft, FrontRight }, s_PairLevel );
+				break;
+			}
+			case RearLeft : {
+				distribute( input, { SideLeft }, 1.0f ) || distribute( input, { FrontLeft }, s_PairLevel ) || distribute( input, { FrontCenter }, rearLevel );
+				break;
+			}
+			case RearRight : {
+				distribute( input, { SideRight }, 1.0f ) || distribute( input, { FrontRight }, s_PairLevel ) || distribute( input, { FrontCenter }, rearLevel );
+				break;
+			}
+			case SideLeft : {
+				distribute( input, { RearLeft }, 1.0f ) || distribute( input, { FrontLeft }, s_PairLevel ) || distribute( input, { FrontCenter }, rearLevel );
+				break;
+			}
+			case SideRight : {
+				distribute( input, { RearRight }, 1.0f ) || distribute( input, { FrontRight }, s_PairLevel ) || distribute( input, { FrontCenter }, rearLevel );
+				break;
+			}
+			case RearCenter : {
+				distribute( input, { RearLeft, RearRight }, s_PairLevel ) || distribute( input, { SideLeft, SideRight }, s_PairLevel ) ||
+					distribute( input, { FrontLeft, FrontRight }, rearLevel ) || distribute( input, { FrontCenter }, s_PairLevel );
+				break;
+			}
+			default : {
+				// The LFE channel is discarded when there is no output LFE channel.
+				break;
+			}
+		}
+	}
+
+	// Normalise any downmixed output channels, to prevent clipping.
+	for ( long output = 0; output < outputChannels; output++ ) {
+		float* coefficients = &matrix[ output * inputChannels ];
+		float total = 0;
+		for ( long input = 0; input < inputChannels; input++ ) {
+			total += coefficients[ input ];
+		}
+		if ( total > 1.0f ) {
+			for ( long input = 0; input < inputChannels; input++ ) {
+				coefficients[ input ] /= total;
+			}
+		}
+	}
+	return matrix;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Decoder.h"
+
+#include <string>
+#include <vector>
+
+// Mixes the channels of another decoder to a different channel layout.
+// Channel layouts are assumed to follow the BASS channel ordering.
+class DecoderMixer : public Decoder
+{
+public:
+	// 'decoder' - source decoder.
+	// 'channels' - output number of channels.
+	DecoderMixer( const Decoder::Ptr decoder, const long channels );
+
+	~DecoderMixer() override;
+
+	// Returns the track gain, in dB, or nullopt if the calculation failed.
+	// 'canContinue' - callback which returns whether the calculation can continue.
+	// 'secondslimit' - number of seconds to devote to calculating an estimate, or 0 to perform a complete calculation.
+	std::optional<float> CalculateTrackGain( CanContinue canContinue, const float secondsLimit = 0 ) override;
+
+	// Returns whether stream titles are supported.
+	bool SupportsStreamTitles() const override;
+
+	// Returns the current stream title, and the position (in seconds) at which the title last changed.
+	std::pair<float /*seconds*/, std::wstring /*title*/> GetStreamTitle() override;
+
+	// Returns the position (in seconds) at which the stream title last changed.
+	float GetStreamTitlePosition() override;
+
+protected:
+	// Reads sample data.
+	// 'buffer' - output buffer (floating point format scaled to +/-1.0f).
+	// 'sampleCount' - number of samples to read.
+	// Returns the number of samples read, or zero if the stream has ended.
+	long ReadSamples( float* buffer, const long sampleCount ) override;
+
+	// Seeks to a 'position' in the stream, in seconds.
+	// Returns the new position in seconds.
+	float SeekTo( const float position ) override;
+
+private:
+	// Speaker positions.
+	enum Speaker {
+		FrontLeft = 0x1,
+		FrontRight = 0x2,
+		FrontCenter = 0x4,
+		LFE = 0x8,
+		RearLeft = 0x10,
+		RearRight = 0x20,
+		RearCenter = 0x40,
+		SideLeft = 0x80,
+		SideRight = 0x100
+	};
+
+	// Returns the speaker positions for a number of 'channels', in BASS channel order.
+	static std::vector<Speaker> GetSpeakers( const long channels );
+
+	// Calculates the mixing matrix from the 'inputChannels' layout to the 'outputChannels' layout.
+	static std::vector<float> CalculateMatrix( const long inputChannels, const long outputChannels );
+
+	// Source decoder.
+	Decoder::Ptr m_Decoder;
+
+	// Mixing matrix.
+	std::vector<float> m_Matrix;
+
+	// Scratch buffer for reading sample data from the source decoder.
+	std::vector<float> m_ReadBuffer;
+};
@@ -2,13 +2,42 @@
 
 #include "Utility.h"
 
-DecoderOpus::DecoderOpus( const std::wstring& filename ) :
+#include <algorithm>
+#include <vector>
+
+// Opus file callbacks, where the '_stream' is a file source.
+static int ReadCallback( void* _stream, unsigned char* _ptr, int _nbytes )
+{
+	return static_cast<int>( static_cast<FileSource*>( _stream )->Read( _ptr, static_cast<size_t>( _nbytes ) ) );
+}
+
+static int SeekCallback( void* _stream, opus_int64 _offset, int _whence )
+{
+	return static_cast<FileSource*>( _stream )->Seek( _offset, _whence ) ? 0 : -1;
+}
+
+static opus_int64 TellCallback( void* _stream )
+{
+	return static_cast<FileSource*>( _stream )->GetPosition();
+}
+
+// Amount of sample data to decode and discard ahead of a seek position, for the decoder to converge when seeking using the seek index.
+static const ogg_int64_t s_PreRoll = 3840;
+
+// Maximum number of indexed pages from which to attempt a seek.
+static const int s_MaximumIndexedSeeks = 3;
+
+static const OpusFileCallbacks s_Callbacks = { ReadCallback, SeekCallback, TellCallback, nullptr /*close*/ };
+
+DecoderOpus::DecoderOpus( const std::wstring& filename, const bool readAhead ) :
 	Decoder(),
+	m_FileSource( FileSource::Open( filename, readAhead ) ),
 	m_OpusFile( nullptr )
 {
 	int error = 0;
-	const std::string filepath = WideStringToUTF8( filename );
-	m_OpusFile = op_open_file( filepath.c_str(), &error );
+	if ( m_FileSource ) {
+		m_OpusFile = op_open_callbacks( m_FileSource.get(), &s_Callbacks, nullptr /*initialData*/, 0 /*initialBytes*/, &error );
+	}
 	if ( nullptr != m_OpusFile ) {
 		const OpusHead* head = op_head( m_OpusFile, -1 /*link*/ );
 		if ( nullptr != head ) {
@@ -33,11 +62,12 @@ DecoderOpus::~DecoderOpus()
 	}
 }
 
-long DecoderOpus::Read( float* buffer, const long sampleCount )
+long DecoderOpus::ReadSamples( float* buffer, const long sampleCount )
 {
 	long samplesRead = 0;
 	const long channels = GetChannels();
 	if ( ( channels > 0 ) && ( sampleCount > 0 ) ) {
+		AddSeekPoint( op_pcm_tell( m_OpusFile ), op_raw_tell( m_OpusFile ) );
 		while ( samplesRead < sampleCount ) {
 			const int samplesToRead = sampleCount - samplesRead;
 			const int bufSize = samplesToRead * channels;
@@ -127,9 +157,55 @@ long DecoderOpus::Read( float* buffer, const long sampleCount )
 	return samplesRead;
 }
 
-float DecoderOpus::Seek( const float position )
+bool DecoderOpus::SupportsSeekIndex() const
+{
+	return true;
+}
+
+float DecoderOpus::SeekTo( const float position )
 {
 	const ogg_int64_t offset = static_cast<ogg_int64_t>( position * GetSampleRate() );
-	const float seekPosition = ( 0 == op_pcm_seek( m_OpusFile, offset ) ) ? position : 0;
+	const float seekPosition = ( SeekIndexed( offset ) || ( 0 == op_pcm_seek( m_OpusFile, offset ) ) ) ? position : 0;
 	return seekPosition;
 }
+
+bool DecoderOpus::SeekIndexed( const ogg_int64_t sample )
+{
+	bool success = false;
+	const SeekIndex::Ptr index = GetSeekIndex();
+	const long channels = GetChannels();
+	if ( index && ( channels > 0 ) ) {
+		// Each seek point records the read position when its sample was decoded, which can be beyond the start of the page containing the sample.
+		// So the position reached from a seek point is checked, falling back to an earlier seek point if it is too late to allow for the pre-roll.
+		std::optional<SeekIndex::Point> point = index->Find( sample - s_PreRoll );
+		ogg_int64_t landed = -1;
+		for ( int attempt = 0; point && ( attempt < s_MaximumIndexedSeeks ) && ( landed < 0 ); attempt++ ) {
+			if ( 0 == op_raw_seek( m_OpusFile, point->Offset ) ) {
+				const ogg_int64_t pcmPosition = op_pcm_tell( m_OpusFile );
+				if ( ( pcmPosition >= 0 ) && ( pcmPosition <= ( sample - s_PreRoll ) ) ) {
+					landed = pcmPosition;
+				} else {
+					point = index->Find( std::min<ogg_int64_t>( pcmPosition, point->Sample ) - 1 );
+				}
+			} else {
+				point.reset();
+			}
+		}
+
+		if ( landed >= 0 ) {
+			// Decode and discard the sample data up to the seek position.
+			const long blockSize = 4096;
+			std::vector<float> buffer( blockSize * channels );
+			ogg_int64_t remaining = sample - landed;
+			while ( remaining > 0 ) {
+				const long samplesRead = ReadSamples( buffer.data(), static_cast<long>( std::min<ogg_int64_t>( blockSize, remaining ) ) );
+				if ( 0 == samplesRead ) {
+					break;
+				}
+				remaining -= samplesRead;
+			}
+			success = ( 0 == remaining );
+		}
+	}
+	return success;
+}
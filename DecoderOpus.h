@@ -1,5 +1,6 @@
 #pragma once
 #include "Decoder.h"
+#include "FileSource.h"
 
 #include <string>
 
@@ -10,22 +11,34 @@ class DecoderOpus : public Decoder
 {
 public:
 	// 'filename' - file name.
+	// 'readAhead' - whether to read ahead of the decoder, which is only worthwhile when the whole file is streamed for playback.
 	// Throws a std::runtime_error exception if the file could not be loaded.
-	DecoderOpus( const std::wstring& filename );
+	DecoderOpus( const std::wstring& filename, const bool readAhead );
 
 	~DecoderOpus() override;
 
+	// Returns whether the decoder can seek using a seek index.
+	bool SupportsSeekIndex() const override;
+
+protected:
 	// Reads sample data.
 	// 'buffer' - output buffer (floating point format scaled to +/-1.0f).
 	// 'sampleCount' - number of samples to read.
 	// Returns the number of samples read, or zero if the stream has ended.
-	long Read( float* buffer, const long sampleCount ) override;
+	long ReadSamples( float* buffer, const long sampleCount ) override;
 
 	// Seeks to a 'position' in the stream, in seconds.
 	// Returns the new position in seconds.
-	float Seek( const float position ) override;
+	float SeekTo( const float position ) override;
 
 private:
+	// Seeks to a 'sample' position using the seek index, decoding forward from the nearest indexed page.
+	// Returns whether the seek was successful.
+	bool SeekIndexed( const ogg_int64_t sample );
+
+	// Input file source.
+	FileSource::Ptr m_FileSource;
+
 	// Opus file
 	OggOpusFile* m_OpusFile;
 };
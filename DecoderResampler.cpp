@@ -0,0 +1,244 @@
+#include "DecoderResampler.h"
+
+#include "SampleKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+// Stopband attenuation, in dB.
+static const double s_StopbandAttenuation = 100.0;
+
+// Passband edge, relative to the Nyquist frequency of the lower of the input and output sample rates.
+// The stopband starts at the Nyquist frequency, and the filter cutoff is halfway between the two.
+static const double s_Passband = 0.9;
+
+// Maximum number of filter taps per phase.
+static const long s_MaxTaps = 1024;
+
+// Maximum number of filter phases.
+static const long s_MaxPhases = 1024;
+
+// Kaiser window beta, for the stopband attenuation (Kaiser's formula, for attenuation above 50dB).
+static const double s_KaiserBeta = 0.1102 * ( s_StopbandAttenuation - 8.7 );
+
+// Pi.
+static const double s_Pi = 3.14159265358979323846;
+
+// Number of samples per channel to read from the source decoder at a time.
+static const long s_ReadBlock = 1024;
+
+// Returns the zeroth order modified Bessel function of the first kind, for 'x'.
+static double BesselI0( const double x )
+{
+	double result = 1.0;
+	double term = 1.0;
+	for ( int k = 1; k < 50; k++ ) {
+		term *= ( x / ( 2 * k ) ) * ( x / ( 2 * k ) );
+		result += term;
+		if ( term < ( result * 1e-12 ) ) {
+			break;
+		}
+	}
+	return result;
+}
+
+DecoderResampler::DecoderResampler( const Decoder::Ptr decoder, const long sampleRate ) :
+	Decoder(),
+	m_Decoder( decoder ),
+	m_Interpolation( 1 ),
+	m_Decimation( 1 ),
+	m_Taps( 0 ),
+	m_Coefficients(),
+	m_History(),
+	m_HistoryCount( 0 ),
+	m_HistoryPosition( 0 ),
+	m_Phase( 0 ),
+	m_ReadBuffer(),
+	m_SourceRemaining( 0 ),
+	m_SourceFinished( false )
+{
+	if ( m_Decoder ) {
+		SetDuration( m_Decoder->GetDuration() );
+		SetSampleRate( sampleRate );
+		SetChannels( m_Decoder->GetChannels() );
+		SetBPS( m_Decoder->GetBPS() );
+		SetBitrate( m_Decoder->GetBitrate() );
+
+		const long inputRate = m_Decoder->GetSampleRate();
+		if ( ( inputRate > 0 ) && ( sampleRate > 0 ) ) {
+			const long divisor = std::gcd( inputRate, sampleRate );
+			m_Interpolation = sampleRate / divisor;
+			m_Decimation = inputRate / divisor;
+			if ( m_Interpolation > s_MaxPhases ) {
+				// Approximate unusual sample rate ratios.
+				m_Decimation = std::max( 1l, std::lround( static_cast<double>( m_Decimation ) * s_MaxPhases / m_Interpolation ) );
+				m_Interpolation = s_MaxPhases;
+			}
+		}
+		m_Taps = CalculateTaps();
+
+		const long channels = std::max( GetChannels(), 1l );
+		m_History.resize( channels, std::vector<float>( m_Taps + 2 * s_ReadBlock ) );
+		m_ReadBuffer.resize( s_ReadBlock * channels );
+		CalculateCoefficients();
+		Reset();
+	}
+}
+
+DecoderResampler::~DecoderResampler()
+{
+}
+
+long DecoderResampler::ReadSamples( float* buffer, const long sampleCount )
+{
+	long samplesRead = 0;
+	const long channels = GetChannels();
+	if ( m_Decoder && ( nullptr != buffer ) && ( channels > 0 ) ) {
+		while ( ( samplesRead < sampleCount ) && FillHistory() ) {
+			const float* coefficients = &m_Coefficients[ m_Phase * m_Taps ];
+			float* output = buffer + samplesRead * channels;
+			for ( long channel = 0; channel < channels; channel++ ) {
+				output[ channel ] = DotProduct( &m_History[ channel ][ m_HistoryPosition ], coefficients, m_Taps );
+			}
+			++samplesRead;
+
+			m_Phase += m_Decimation;
+			const long advance = m_Phase / m_Interpolation;
+			m_Phase %= m_Interpolation;
+			m_HistoryPosition += advance;
+			m_SourceRemaining -= advance;
+		}
+	}
+	return samplesRead;
+}
+
+float DecoderResampler::SeekTo( const float position )
+{
+	float seekPosition = 0;
+	if ( m_Decoder ) {
+		seekPosition = m_Decoder->Seek( position );
+		Reset();
+	}
+	return seekPosition;
+}
+
+std::optional<float> DecoderResampler::CalculateTrackGain( CanContinue canContinue, const float secondsLimit )
+{
+	// Loudness is independent of the sample rate, so calculate the gain from the source decoder directly.
+	std::optional<float> trackGain;
+	if ( m_Decoder ) {
+		trackGain = m_Decoder->CalculateTrackGain( canContinue, secondsLimit );
+		Reset();
+	}
+	return trackGain;
+}
+
+bool DecoderResampler::SupportsStreamTitles() const
+{
+	return m_Decoder && m_Decoder->SupportsStreamTitles();
+}
+
+std::pair<float /*seconds*/, std::wstring /*title*/> DecoderResampler::GetStreamTitle()
+{
+	return m_Decoder ? m_Decoder->GetStreamTitle() : std::pair<float, std::wstring>();
+}
+
+float DecoderResampler::GetStreamTitlePosition()
+{
+	return m_Decoder ? m_Decoder->GetStreamTitlePosition() : 0;
+}
+
+void DecoderResampler::CalculateCoefficients()
+{
+	// Each phase interpolates an output sample at an offset of 'phase / interpolation' from the input sample at the centre of the filter.
+	const long halfTaps = m_Taps / 2;
+	const double cutoff = 0.25 * ( 1.0 + s_Passband ) * std::min( 1.0, static_cast<double>( m_Interpolation ) / m_Decimation );
+	const double window = BesselI0( s_KaiserBeta );
+	m_Coefficients.resize( static_cast<size_t>( m_Interpolation ) * m_Taps );
+	for ( long phase = 0; phase < m_Interpolation; phase++ ) {
+		float* coefficients = &m_Coefficients[ phase * m_Taps ];
+		double total = 0;
+		for ( long tap = 0; tap < m_Taps; tap++ ) {
+			const double x = static_cast<double>( phase ) / m_Interpolation + halfTaps - 1 - tap;
+			const double r = x / halfTaps;
+			double coefficient = 0;
+			if ( fabs( r ) < 1.0 ) {
+				const double sincX = 2 * s_Pi * cutoff * x;
+				const double sinc = ( 0 == sincX ) ? 1.0 : ( sin( sincX ) / sincX );
+				coefficient = sinc * BesselI0( s_KaiserBeta * sqrt( 1.0 - r * r ) ) / window;
+			}
+			coefficients[ tap ] = static_cast<float>( coefficient );
+			total += coefficient;
+		}
+		if ( 0 != total ) {
+			for ( long tap = 0; tap < m_Taps; tap++ ) {
+				coefficients[ tap ] = static_cast<float>( coefficients[ tap ] / total );
+			}
+		}
+	}
+}
+
+long DecoderResampler::CalculateTaps() const
+{
+	// Kaiser's estimate of the filter length for the stopband attenuation and the transition band width (in cycles per input sample).
+	// The transition band narrows when decimating, so the filter widens accordingly.
+	const double transition = 0.5 * ( 1.0 - s_Passband ) * std::min( 1.0, static_cast<double>( m_Interpolation ) / m_Decimation );
+	const long taps = 1 + static_cast<long>( ceil( ( s_StopbandAttenuation - 7.95 ) / ( 14.36 * transition ) ) );
+
+	// Round up to a multiple of 4, to suit the dot product kernel.
+	return std::min( ( taps + 3 ) & ~3l, s_MaxTaps );
+}
+
+void DecoderResampler::Reset()
+{
+	// Prime the filter history with silence, so that the first output sample is centred on the first input sample.
+	m_HistoryCount = m_Taps / 2 - 1;
+	for ( auto& history : m_History ) {
+		std::fill( history.begin(), history.begin() + m_HistoryCount, 0.0f );
+	}
+	m_HistoryPosition = 0;
+	m_Phase = 0;
+	m_SourceRemaining = 0;
+	m_SourceFinished = false;
+}
+
+bool DecoderResampler::FillHistory()
+{
+	const long channels = static_cast<long>( m_History.size() );
+	const long capacity = m_History.empty() ? 0 : static_cast<long>( m_History.front().size() );
+	while ( m_HistoryCount < ( m_HistoryPosition + m_Taps ) ) {
+		if ( ( m_HistoryCount + s_ReadBlock ) > capacity ) {
+			// Discard history that is no longer required.
+			for ( auto& history : m_History ) {
+				std::copy( history.begin() + m_HistoryPosition, history.begin() + m_HistoryCount, history.begin() );
+			}
+			m_HistoryCount -= m_HistoryPosition;
+			m_HistoryPosition = 0;
+		}
+
+		if ( m_SourceFinished ) {
+			// Pad with silence, to flush out the filter.
+			for ( auto& history : m_History ) {
+				std::fill( history.begin() + m_HistoryCount, history.begin() + m_HistoryPosition + m_Taps, 0.0f );
+			}
+			m_HistoryCount = m_HistoryPosition + m_Taps;
+		} else {
+			const long samplesRead = m_Decoder->Read( m_ReadBuffer.data(), s_ReadBlock );
+			if ( samplesRead > 0 ) {
+				for ( long channel = 0; channel < channels; channel++ ) {
+					float* history = &m_History[ channel ][ m_HistoryCount ];
+					const float* input = m_ReadBuffer.data() + channel;
+					for ( long sampleIndex = 0; sampleIndex < samplesRead; sampleIndex++, input += channels ) {
+						history[ sampleIndex ] = *input;
+					}
+				}
+				m_HistoryCount += samplesRead;
+				m_SourceRemaining += samplesRead;
+			} else {
+				m_SourceFinished = true;
+			}
+		}
+	}
+	return ( m_SourceRemaining > 0 );
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Decoder.h"
+
+#include <string>
+#include <vector>
+
+// Converts the sample rate of another decoder, using a polyphase Kaiser windowed sinc filter with a 100dB stopband.
+class DecoderResampler : public Decoder
+{
+public:
+	// 'decoder' - source decoder.
+	// 'sampleRate' - output sample rate.
+	DecoderResampler( const Decoder::Ptr decoder, const long sampleRate );
+
+	~DecoderResampler() override;
+
+	// Returns the track gain, in dB, or nullopt if the calculation failed.
+	// 'canContinue' - callback which returns whether the calculation can continue.
+	// 'secondslimit' - number of seconds to devote to calculating an estimate, or 0 to perform a complete calculation.
+	std::optional<float> CalculateTrackGain( CanContinue canContinue, const float secondsLimit = 0 ) override;
+
+	// Returns whether stream titles are supported.
+	bool SupportsStreamTitles() const override;
+
+	// Returns the current stream title, and the position (in seconds) at which the title last changed.
+	std::pair<float /*seconds*/, std::wstring /*title*/> GetStreamTitle() override;
+
+	// Returns the position (in seconds) at which the stream title last changed.
+	float GetStreamTitlePosition() override;
+
+protected:
+	// Reads sample data.
+	// 'buffer' - output buffer (floating point format scaled to +/-1.0f).
+	// 'sampleCount' - number of samples to read.
+	// Returns the number of samples read, or zero if the stream has ended.
+	long ReadSamples( float* buffer, const long sampleCount ) override;
+
+	// Seeks to a 'position' in the stream, in seconds.
+	// Returns the new position in seconds.
+	float SeekTo( const float position ) override;
+
+private:
+	// Returns the number of filter taps per phase required for the stopband attenuation, given the interpolation and decimation factors.
+	long CalculateTaps() const;
+
+	// Calculates the polyphase filter coefficients.
+	void CalculateCoefficients();
+
+	// Resets the filter state.
+	void Reset();
+
+	// Ensures that the filter history contains the sample data required for the next output sample, reading from the source decoder as necessary.
+	// Returns whether there is any sample data remaining to be output.
+	bool FillHistory();
+
+	// Source decoder.
+	Decoder::Ptr m_Decoder;
+
+	// Interpolation factor (number of filter phases).
+	long m_Interpolation;
+
+	// Decimation factor.
+	long m_Decimation;
+
+	// Number of filter taps per phase.
+	long m_Taps;
+
+	// Filter coefficients, for each phase.
+	std::vector<float> m_Coefficients;
+
+	// Filter history, for each channel.
+	std::vector<std::vector<float>> m_History;
+
+	// Number of samples per channel in the filter history.
+	long m_HistoryCount;
+
+	// Filter history position of the first tap for the next output sample.
+	long m_HistoryPosition;
+
+	// Filter phase of the next output sample.
+	long m_Phase;
+
+	// Scratch buffer for reading interleaved sample data from the source decoder.
+	std::vector<float> m_ReadBuffer;
+
+	// Number of source samples per channel that remain to be output.
+	long long m_SourceRemaining;
+
+	// Indicates whether the source decoder has reached the end of the stream.
+	bool m_SourceFinished;
+};
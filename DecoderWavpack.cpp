@@ -1,15 +1,75 @@
 #include "DecoderWavpack.h"
 
+#include "SampleKernels.h"
 #include "Utility.h"
 
-DecoderWavpack::DecoderWavpack( const std::wstring& filename ) :
+// WavPack reader callbacks, where the 'id' is a file source.
+static int32_t ReadBytes( void* id, void* data, int32_t bcount )
+{
+	return static_cast<int32_t>( static_cast<FileSource*>( id )->Read( data, static_cast<size_t>( bcount ) ) );
+}
+
+static int32_t WriteBytes( void* /*id*/, void* /*data*/, int32_t /*bcount*/ )
+{
+	return 0;
+}
+
+static int64_t GetPos( void* id )
+{
+	return static_cast<FileSource*>( id )->GetPosition();
+}
+
+static int SetPosAbs( void* id, int64_t pos )
+{
+	return static_cast<FileSource*>( id )->Seek( pos ) ? 0 : -1;
+}
+
+static int SetPosRel( void* id, int64_t delta, int mode )
+{
+	return static_cast<FileSource*>( id )->Seek( delta, mode ) ? 0 : -1;
+}
+
+static int PushBackByte( void* id, int c )
+{
+	return static_cast<FileSource*>( id )->Seek( -1, SEEK_CUR ) ? c : EOF;
+}
+
+static int64_t GetLength( void* id )
+{
+	return static_cast<FileSource*>( id )->GetSize();
+}
+
+static int CanSeek( void* /*id*/ )
+{
+	return 1;
+}
+
+static int TruncateHere( void* /*id*/ )
+{
+	return -1;
+}
+
+static int Close( void* /*id*/ )
+{
+	return 0;
+}
+
+static WavpackStreamReader64 s_Reader = { ReadBytes, WriteBytes, GetPos, SetPosAbs, SetPosRel, PushBackByte, GetLength, CanSeek, TruncateHere, Close };
+
+DecoderWavpack::DecoderWavpack( const std::wstring& filename, const bool readAhead ) :
 	Decoder(),
-	m_Context( nullptr )
+	m_FileSource( FileSource::Open( filename, readAhead ) ),
+	m_CorrectionSource(),
+	m_Context( nullptr ),
+	m_Buffer()
 {
-	char* error = nullptr;
-	const int flags = OPEN_WVC | OPEN_NORMALIZE | OPEN_DSD_AS_PCM | OPEN_FILE_UTF8;
-	const int offset = 0;
-	m_Context = WavpackOpenFileInput( WideStringToUTF8( filename ).c_str(), error, flags, offset );
+	if ( m_FileSource ) {
+		m_CorrectionSource = FileSource::Open( filename + L"c", readAhead );
+		char error[ 80 ] = {};
+		const int flags = OPEN_WVC | OPEN_NORMALIZE | OPEN_DSD_AS_PCM;
+		const int offset = 0;
+		m_Context = WavpackOpenFileInputEx64( &s_Reader, m_FileSource.get(), m_CorrectionSource.get(), error, flags, offset );
+	}
 	if ( nullptr != m_Context ) {
 		SetBPS( static_cast<long>( WavpackGetBitsPerSample( m_Context ) ) );
 		SetChannels( static_cast<long>( WavpackGetNumChannels( m_Context ) ) );
@@ -28,21 +88,32 @@ DecoderWavpack::~DecoderWavpack()
 	WavpackCloseFile( m_Context );
 }
 
-long DecoderWavpack::Read( float* buffer, const long sampleCount )
+long DecoderWavpack::ReadSamples( float* buffer, const long sampleCount )
 {
 	const long samplesRead = ( sampleCount > 0 ) ? static_cast<long>( WavpackUnpackSamples( m_Context, reinterpret_cast<int32_t*>( buffer ), sampleCount ) ) : 0;
 	if ( !( WavpackGetMode( m_Context ) & MODE_FLOAT ) ) {
-		int32_t* nativeBuffer = reinterpret_cast<int32_t*>( buffer );
-		const long bufferSize = samplesRead * GetChannels();
-		const int bitsPerSample = WavpackGetBytesPerSample( m_Context ) * 8;
-		for ( long index = 0; index < bufferSize; index++ ) {
-			buffer[ index ] = static_cast<float>( nativeBuffer[ index ] ) / ( 1 << ( bitsPerSample - 1 ) );
-		}
+		ConvertInt32ToFloat( buffer, reinterpret_cast<const int32_t*>( buffer ), static_cast<size_t>( samplesRead * GetChannels() ), WavpackGetBytesPerSample( m_Context ) * 8 );
+	}
+	return samplesRead;
+}
+
+long DecoderWavpack::ReadFrameView( FrameView& view, const long maximumSamples )
+{
+	const size_t valueCount = static_cast<size_t>( maximumSamples * GetChannels() );
+	if ( m_Buffer.size() < valueCount ) {
+		m_Buffer.resize( valueCount );
+	}
+	const long samplesRead = ( maximumSamples > 0 ) ? static_cast<long>( WavpackUnpackSamples( m_Context, m_Buffer.data(), maximumSamples ) ) : 0;
+	view.Planes[ 0 ] = m_Buffer.data();
+	if ( !( WavpackGetMode( m_Context ) & MODE_FLOAT ) ) {
+		// Integer sample data is left for the consumer to convert (or to analyse natively).
+		view.DataType = FrameView::Type::Int32;
+		view.BitsPerSample = WavpackGetBytesPerSample( m_Context ) * 8;
 	}
 	return samplesRead;
 }
 
-float DecoderWavpack::Seek( const float position )
+float DecoderWavpack::SeekTo( const float position )
 {
 	float seekPosition = position;
 	const int64_t samplePosition = static_cast<int64_t>( position * GetSampleRate() );
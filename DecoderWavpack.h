@@ -1,31 +1,50 @@
 #pragma once
 
 #include "Decoder.h"
+#include "FileSource.h"
 
 #include "wavpack.h"
 
 #include <string>
+#include <vector>
 
 class DecoderWavpack : public Decoder
 {
 public:
 	// 'filename' - file name.
+	// 'readAhead' - whether to read ahead of the decoder, which is only worthwhile when the whole file is streamed for playback.
 	// Throws a std::runtime_error exception if the file could not be loaded.
-	DecoderWavpack( const std::wstring& filename );
+	DecoderWavpack( const std::wstring& filename, const bool readAhead );
 
 	~DecoderWavpack() override;
 
+protected:
 	// Reads sample data.
 	// 'buffer' - output buffer (floating point format scaled to +/-1.0f).
 	// 'sampleCount' - number of samples to read.
 	// Returns the number of samples read, or zero if the stream has ended.
-	long Read( float* buffer, const long sampleCount ) override;
+	long ReadSamples( float* buffer, const long sampleCount ) override;
 
 	// Seeks to a 'position' in the stream, in seconds.
 	// Returns the new position in seconds.
-	float Seek( const float position ) override;
+	float SeekTo( const float position ) override;
+
+	// Reads the next block of sample data from the stream as a read-only view, which refers directly to the unpacked (native integer or floating point) sample data.
+	// 'view' - out, the frame view.
+	// 'maximumSamples' - maximum number of samples per channel to return in the view.
+	// Returns the number of samples per channel in the view, or zero if the stream has ended.
+	long ReadFrameView( FrameView& view, const long maximumSamples ) override;
 
 private:
+	// Input file source.
+	FileSource::Ptr m_FileSource;
+
+	// Correction file source (or nullptr if there is no correction file).
+	FileSource::Ptr m_CorrectionSource;
+
 	// WavPack context.
 	WavpackContext* m_Context;
+
+	// Unpacked sample data, referred to by frame views.
+	std::vector<int32_t> m_Buffer;
 };
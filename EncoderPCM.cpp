@@ -2,16 +2,51 @@
 
 #include "Utility.h"
 
-#include <mmreg.h>
-
 #include <vector>
 
 // Maximum number of bytes that can be written.
 static const long long s_MaxBytes = UINT_MAX;
 
-EncoderPCM::EncoderPCM() :
+// IEEE floating point sub-format (KSDATAFORMAT_SUBTYPE_IEEE_FLOAT).
+static const GUID s_SubFormatFloat = { 0x00000003, 0x0000, 0x0010, { 0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71 } };
+
+// Returns the speaker channel mask for a number of 'channels', or zero if there is no standard layout.
+static DWORD GetChannelMask( const long channels )
+{
+	DWORD channelMask = 0;
+	switch ( channels ) {
+		case 1 : {
+			channelMask = SPEAKER_FRONT_CENTER;
+			break;
+		}
+		case 2 : {
+			channelMask = SPEAKER_FRONT_LEFT | SPEAKER_FRONT_RIGHT;
+			break;
+		}
+		case 4 : {
+			channelMask = SPEAKER_FRONT_LEFT | SPEAKER_FRONT_RIGHT | SPEAKER_BACK_LEFT | SPEAKER_BACK_RIGHT;
+			break;
+		}
+		case 6 : {
+			channelMask = SPEAKER_FRONT_LEFT | SPEAKER_FRONT_RIGHT | SPEAKER_FRONT_CENTER | SPEAKER_LOW_FREQUENCY | SPEAKER_BACK_LEFT | SPEAKER_BACK_RIGHT;
+			break;
+		}
+		case 8 : {
+			channelMask = SPEAKER_FRONT_LEFT | SPEAKER_FRONT_RIGHT | SPEAKER_FRONT_CENTER | SPEAKER_LOW_FREQUENCY | SPEAKER_BACK_LEFT | SPEAKER_BACK_RIGHT | SPEAKER_SIDE_LEFT | SPEAKER_SIDE_RIGHT;
+			break;
+		}
+		default : {
+			break;
+		}
+	}
+	return channelMask;
+}
+
+EncoderPCM::EncoderPCM( const bool floatingPoint ) :
 	Encoder(),
+	m_FloatingPoint( floatingPoint ),
 	m_header( {} ),
+	m_headerExtensible( {} ),
 	m_file( nullptr )
 {
 }
@@ -23,7 +58,32 @@ EncoderPCM::~EncoderPCM()
 bool EncoderPCM::Open( std::wstring& filename, const long sampleRate, const long channels, const std::optional<long> bitsPerSample, const std::string& /*settings*/ )
 {
 	bool success = false;
-	if ( ( 1 == channels ) || ( 2 == channels ) ) {
+	if ( m_FloatingPoint ) {
+		if ( ( channels > 0 ) && ( channels <= USHRT_MAX / 4 ) && ( sampleRate > 0 ) ) {
+			memcpy( m_headerExtensible.hdrRIFF, "RIFF", 4 );
+			memcpy( m_headerExtensible.hdrWAVE, "WAVE", 4 );
+			memcpy( m_headerExtensible.hdrFMT, "fmt ", 4 );
+			memcpy( m_headerExtensible.hdrFACT, "fact", 4 );
+			memcpy( m_headerExtensible.hdrDATA, "data", 4 );
+			m_headerExtensible.nFmtLength = sizeof( WAVEFORMATEXTENSIBLE );
+			m_headerExtensible.nFactLength = sizeof( DWORD );
+
+			WAVEFORMATEXTENSIBLE& format = m_headerExtensible.format;
+			format.Format.wFormatTag = WAVE_FORMAT_EXTENSIBLE;
+			format.Format.nChannels = static_cast<WORD>( channels );
+			format.Format.nSamplesPerSec = static_cast<DWORD>( sampleRate );
+			format.Format.wBitsPerSample = 32;
+			format.Format.nBlockAlign = format.Format.nChannels * format.Format.wBitsPerSample / 8;
+			format.Format.nAvgBytesPerSec = format.Format.nSamplesPerSec * format.Format.nBlockAlign;
+			format.Format.cbSize = sizeof( WAVEFORMATEXTENSIBLE ) - sizeof( WAVEFORMATEX );
+			format.Samples.wValidBitsPerSample = 32;
+			format.dwChannelMask = GetChannelMask( channels );
+			format.SubFormat = s_SubFormatFloat;
+			filename += L".wav";
+
+			success = OpenFile( filename, &m_headerExtensible, sizeof( WaveFileHeaderExtensible ) );
+		}
+	} else if ( ( 1 == channels ) || ( 2 == channels ) ) {
 		memcpy( m_header.hdrRIFF, "RIFF" ,4 );
 		memcpy( m_header.hdrFMT, "fmt ", 4 );
 		memcpy( m_header.hdrDATA, "data", 4 );
@@ -38,14 +98,20 @@ bool EncoderPCM::Open( std::wstring& filename, const long sampleRate, const long
 		m_header.nAvgBytesPerSec = m_header.nSamplesPerSec * m_header.nBlockAlign;
 		filename += L".wav";
 
-		m_file = _wfsopen( filename.c_str(), L"wb", _SH_DENYRW );
-		if ( nullptr != m_file ) {
-			const int headerSize = sizeof( WaveFileHeader );
-			success = ( 1 == fwrite( &m_header, sizeof( WaveFileHeader ), 1, m_file ) );
-			if ( !success ) {
-				fclose( m_file );
-				m_file = nullptr;
-			}
+		success = OpenFile( filename, &m_header, sizeof( WaveFileHeader ) );
+	}
+	return success;
+}
+
+bool EncoderPCM::OpenFile( const std::wstring& filename, const void* header, const size_t headerSize )
+{
+	bool success = false;
+	m_file = _wfsopen( filename.c_str(), L"wb", _SH_DENYRW );
+	if ( nullptr != m_file ) {
+		success = ( 1 == fwrite( header, headerSize, 1, m_file ) );
+		if ( !success ) {
+			fclose( m_file );
+			m_file = nullptr;
 		}
 	}
 	return success;
@@ -54,44 +120,67 @@ bool EncoderPCM::Open( std::wstring& filename, const long sampleRate, const long
 bool EncoderPCM::Write( float* samples, const long sampleCount )
 {
 	bool success = false;
-	const long outputBufferSize = m_header.nChannels * sampleCount;
-	const long long filePosition = _ftelli64( m_file );
-	if ( 8 == m_header.wBitsPerSample ) {
-		std::vector<unsigned char> outputBuffer( outputBufferSize );
-		for ( long sampleIndex = 0; sampleIndex < outputBufferSize; sampleIndex++ ) {
-			outputBuffer[ sampleIndex ] = FloatToUnsigned8( samples[ sampleIndex ] );
-		}
+	if ( m_FloatingPoint ) {
+		success = WriteFloatingPoint( samples, sampleCount );
+	} else {
+		const long outputBufferSize = m_header.nChannels * sampleCount;
+		const long long filePosition = _ftelli64( m_file );
+		if ( 8 == m_header.wBitsPerSample ) {
+			std::vector<unsigned char> outputBuffer( outputBufferSize );
+			for ( long sampleIndex = 0; sampleIndex < outputBufferSize; sampleIndex++ ) {
+				outputBuffer[ sampleIndex ] = FloatToUnsigned8( samples[ sampleIndex ] );
+			}
 
-		size_t elementCount = static_cast<size_t>( outputBufferSize );
-		if ( ( filePosition + outputBufferSize ) > s_MaxBytes ) {
-			if ( filePosition < s_MaxBytes ) {
-				elementCount = static_cast<size_t>( s_MaxBytes - filePosition );
-				elementCount -= ( elementCount % m_header.nBlockAlign );
-			} else {
-				elementCount = 0;
+			size_t elementCount = static_cast<size_t>( outputBufferSize );
+			if ( ( filePosition + outputBufferSize ) > s_MaxBytes ) {
+				if ( filePosition < s_MaxBytes ) {
+					elementCount = static_cast<size_t>( s_MaxBytes - filePosition );
+					elementCount -= ( elementCount % m_header.nBlockAlign );
+				} else {
+					elementCount = 0;
+				}
 			}
-		}
 
-		success = ( static_cast<size_t>( outputBufferSize ) == fwrite( &outputBuffer[ 0 ], 1 /*elementSize*/, elementCount, m_file ) );
-	} else if ( 16 == m_header.wBitsPerSample ) {
-		std::vector<short> outputBuffer( outputBufferSize );
-		for ( long sampleIndex = 0; sampleIndex < outputBufferSize; sampleIndex++ ) {
-			outputBuffer[ sampleIndex ] = FloatTo16( samples[ sampleIndex ] );
-		}
+			success = ( static_cast<size_t>( outputBufferSize ) == fwrite( &outputBuffer[ 0 ], 1 /*elementSize*/, elementCount, m_file ) );
+		} else if ( 16 == m_header.wBitsPerSample ) {
+			std::vector<short> outputBuffer( outputBufferSize );
+			for ( long sampleIndex = 0; sampleIndex < outputBufferSize; sampleIndex++ ) {
+				outputBuffer[ sampleIndex ] = FloatTo16( samples[ sampleIndex ] );
+			}
 
-		size_t elementCount = static_cast<size_t>( outputBufferSize );
-		if ( ( filePosition + ( outputBufferSize * 2 ) ) > s_MaxBytes ) {
-			if ( filePosition < s_MaxBytes ) {
-				elementCount = static_cast<size_t>( s_MaxBytes - filePosition );
-				elementCount -= ( elementCount % m_header.nBlockAlign );
-				elementCount /= 2;
-			} else {
-				elementCount = 0;
+			size_t elementCount = static_cast<size_t>( outputBufferSize );
+			if ( ( filePosition + ( outputBufferSize * 2 ) ) > s_MaxBytes ) {
+				if ( filePosition < s_MaxBytes ) {
+					elementCount = static_cast<size_t>( s_MaxBytes - filePosition );
+					elementCount -= ( elementCount % m_header.nBlockAlign );
+					elementCount /= 2;
+				} else {
+					elementCount = 0;
+				}
 			}
+
+			success = ( static_cast<size_t>( outputBufferSize ) == fwrite( &outputBuffer[ 0 ], 2 /*elementSize*/, elementCount, m_file ) );
 		}
+	}
+	return success;
+}
 
-		success = ( static_cast<size_t>( outputBufferSize ) == fwrite( &outputBuffer[ 0 ], 2 /*elementSize*/, elementCount, m_file ) );
+bool EncoderPCM::WriteFloatingPoint( const float* samples, const long sampleCount )
+{
+	const long outputBufferSize = m_headerExtensible.format.Format.nChannels * sampleCount;
+	const long long filePosition = _ftelli64( m_file );
+	size_t elementCount = static_cast<size_t>( outputBufferSize );
+	if ( ( filePosition + ( outputBufferSize * 4 ) ) > s_MaxBytes ) {
+		if ( filePosition < s_MaxBytes ) {
+			elementCount = static_cast<size_t>( s_MaxBytes - filePosition );
+			elementCount -= ( elementCount % m_headerExtensible.format.Format.nBlockAlign );
+			elementCount /= 4;
+		} else {
+			elementCount = 0;
+		}
 	}
+
+	const bool success = ( static_cast<size_t>( outputBufferSize ) == fwrite( samples, 4 /*elementSize*/, elementCount, m_file ) );
 	return success;
 }
 
@@ -99,11 +188,21 @@ void EncoderPCM::Close()
 {
 	if ( nullptr != m_file ) {
 		const long long bytesWritten = _ftelli64( m_file );
-		m_header.dwTotalLength = static_cast<DWORD>( bytesWritten - 8 );
-		m_header.nDataLength = static_cast<DWORD>( bytesWritten - sizeof( WaveFileHeader ) );
+		if ( m_FloatingPoint ) {
+			m_headerExtensible.dwTotalLength = static_cast<DWORD>( bytesWritten - 8 );
+			m_headerExtensible.nDataLength = static_cast<DWORD>( bytesWritten - sizeof( WaveFileHeaderExtensible ) );
+			m_headerExtensible.dwSampleLength = ( m_headerExtensible.format.Format.nBlockAlign > 0 ) ? ( m_headerExtensible.nDataLength / m_headerExtensible.format.Format.nBlockAlign ) : 0;
+
+			if ( 0 == fseek( m_file, 0, SEEK_SET ) ) {
+				fwrite( &m_headerExtensible, sizeof( WaveFileHeaderExtensible ), 1, m_file );
+			}
+		} else {
+			m_header.dwTotalLength = static_cast<DWORD>( bytesWritten - 8 );
+			m_header.nDataLength = static_cast<DWORD>( bytesWritten - sizeof( WaveFileHeader ) );
 
-		if ( 0 == fseek( m_file, 0, SEEK_SET ) ) {
-			fwrite( &m_header, sizeof( WaveFileHeader ), 1, m_file );
+			if ( 0 == fseek( m_file, 0, SEEK_SET ) ) {
+				fwrite( &m_header, sizeof( WaveFileHeader ), 1, m_file );
+			}
 		}
 
 		fclose( m_file );
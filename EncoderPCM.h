@@ -4,11 +4,14 @@
 
 #include "Encoder.h"
 
+#include <mmreg.h>
+
 // PCM encoder
 class EncoderPCM : public Encoder
 {
 public:
-	EncoderPCM();
+	// 'floatingPoint' - true to write 32-bit floating point sample data (as WAVE_FORMAT_EXTENSIBLE, with any number of channels), false to write 8 or 16-bit PCM sample data (mono or stereo).
+	EncoderPCM( const bool floatingPoint = false );
 
 	virtual ~EncoderPCM();
 
@@ -49,9 +52,44 @@ private:
 		DWORD nDataLength;
 	};
 
+	// RIFF header, for extensible floating point format.
+	struct WaveFileHeaderExtensible
+	{
+		BYTE hdrRIFF[ 4 ];
+		DWORD dwTotalLength;
+		BYTE hdrWAVE[ 4 ];
+		BYTE hdrFMT[ 4 ];
+		DWORD nFmtLength;
+		WAVEFORMATEXTENSIBLE format;
+		BYTE hdrFACT[ 4 ];
+		DWORD nFactLength;
+		DWORD dwSampleLength;
+		BYTE hdrDATA[ 4 ];
+		DWORD nDataLength;
+	};
+
+	// Opens the output file and writes the 'header'.
+	// 'filename' - output file name.
+	// 'header' - header data.
+	// 'headerSize' - header size, in bytes.
+	// Returns whether the file was opened and the header written.
+	bool OpenFile( const std::wstring& filename, const void* header, const size_t headerSize );
+
+	// Writes 32-bit floating point sample data.
+	// 'samples' - input samples (floating point format scaled to +/-1.0f).
+	// 'sampleCount' - number of samples to write.
+	// Returns whether the samples were written successfully.
+	bool WriteFloatingPoint( const float* samples, const long sampleCount );
+
+	// Indicates whether 32-bit floating point sample data is written.
+	const bool m_FloatingPoint;
+
 	// Wave file header.
 	WaveFileHeader m_header;
 
+	// Wave file header, for extensible floating point format.
+	WaveFileHeaderExtensible m_headerExtensible;
+
 	// Output file.
 	FILE* m_file;
 };
@@ -0,0 +1,184 @@
+#include "FileSource.h"
+
+#include "FileSourceBuffered.h"
+#include "FileSourceMapped.h"
+#include "FileSourcePrefetch.h"
+#include "FileSourceThrottled.h"
+
+#include <winioctl.h>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+// Read-ahead configuration.
+static FileSource::ReadAhead s_ReadAhead;
+
+// Maps a volume path to whether the volume is considered to be slow storage.
+static std::map<std::wstring, bool> s_SlowStorage;
+
+// Read-ahead configuration & slow storage mutex.
+static std::mutex s_ReadAheadMutex;
+
+// Returns whether the storage device for the volume at 'volumePath' incurs a seek penalty (i.e. it is a rotational disk).
+static bool HasSeekPenalty( const std::wstring& volumePath )
+{
+	bool seekPenalty = false;
+	WCHAR volumeName[ MAX_PATH ] = {};
+	if ( GetVolumeNameForVolumeMountPoint( volumePath.c_str(), volumeName, MAX_PATH ) ) {
+		// The volume device is opened without the trailing backslash, and without any access rights, so that no elevation is required.
+		std::wstring device( volumeName );
+		if ( !device.empty() && ( '\\' == device.back() ) ) {
+			device.pop_back();
+		}
+		const HANDLE handle = CreateFile( device.c_str(), 0 /*access*/, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL /*securityAttributes*/, OPEN_EXISTING, 0 /*flags*/, NULL /*template*/ );
+		if ( INVALID_HANDLE_VALUE != handle ) {
+			STORAGE_PROPERTY_QUERY query = {};
+			query.PropertyId = StorageDeviceSeekPenaltyProperty;
+			query.QueryType = PropertyStandardQuery;
+			DEVICE_SEEK_PENALTY_DESCRIPTOR descriptor = {};
+			DWORD bytesReturned = 0;
+			if ( DeviceIoControl( handle, IOCTL_STORAGE_QUERY_PROPERTY, &query, sizeof( query ), &descriptor, sizeof( descriptor ), &bytesReturned, NULL /*overlapped*/ ) && ( bytesReturned >= sizeof( descriptor ) ) ) {
+				seekPenalty = ( FALSE != descriptor.IncursSeekPenalty );
+			}
+			CloseHandle( handle );
+		}
+	}
+	return seekPenalty;
+}
+
+// Returns whether 'filename' is on slow storage (a network drive, removable drive, optical drive or hard disk), which benefits from read-ahead.
+static bool IsSlowStorage( const std::wstring& filename )
+{
+	bool slowStorage = false;
+	WCHAR volumePath[ MAX_PATH ] = {};
+	if ( GetVolumePathName( filename.c_str(), volumePath, MAX_PATH ) ) {
+		std::lock_guard<std::mutex> lock( s_ReadAheadMutex );
+		const auto volume = s_SlowStorage.find( volumePath );
+		if ( s_SlowStorage.end() != volume ) {
+			slowStorage = volume->second;
+		} else {
+			switch ( GetDriveType( volumePath ) ) {
+				case DRIVE_REMOTE :
+				case DRIVE_REMOVABLE :
+				case DRIVE_CDROM : {
+					slowStorage = true;
+					break;
+				}
+				case DRIVE_FIXED : {
+					slowStorage = HasSeekPenalty( volumePath );
+					break;
+				}
+				default : {
+					break;
+				}
+			}
+			s_SlowStorage.insert( std::make_pair( volumePath, slowStorage ) );
+		}
+	}
+	return slowStorage;
+}
+
+FileSource::FileSource() :
+	m_Size( 0 ),
+	m_Position( 0 )
+{
+}
+
+FileSource::~FileSource()
+{
+}
+
+void FileSource::SetReadAhead( const ReadAhead& readAhead )
+{
+	std::lock_guard<std::mutex> lock( s_ReadAheadMutex );
+	s_ReadAhead = readAhead;
+}
+
+FileSource::ReadAhead FileSource::GetReadAhead()
+{
+	std::lock_guard<std::mutex> lock( s_ReadAheadMutex );
+	return s_ReadAhead;
+}
+
+FileSource::Ptr FileSource::Open( const std::wstring& filename, const bool readAhead )
+{
+	Ptr fileSource;
+	ReadAhead config = GetReadAhead();
+	config.Enabled = config.Enabled && readAhead;
+	try {
+		if ( config.Throttle > 0 ) {
+			// Throttled reads simulate slow storage, and are read ahead (when enabled) regardless of where the file actually resides.
+			fileSource = std::make_shared<FileSourceThrottled>( std::make_shared<FileSourceBuffered>( filename ), config.Throttle );
+			if ( config.Enabled ) {
+				fileSource = std::make_shared<FileSourcePrefetch>( fileSource, config.WindowSize );
+			}
+		} else if ( config.Enabled && IsSlowStorage( filename ) ) {
+			fileSource = std::make_shared<FileSourcePrefetch>( std::make_shared<FileSourceBuffered>( filename ), config.WindowSize );
+		} else {
+			fileSource = std::make_shared<FileSourceMapped>( filename );
+		}
+	} catch ( const std::runtime_error& ) {
+		try {
+			fileSource = std::make_shared<FileSourceBuffered>( filename );
+		} catch ( const std::runtime_error& ) {
+
+		}
+	}
+	return fileSource;
+}
+
+size_t FileSource::Read( void* buffer, const size_t byteCount )
+{
+	size_t bytesRead = 0;
+	if ( ( nullptr != buffer ) && ( byteCount > 0 ) && ( m_Position < m_Size ) ) {
+		const size_t bytesToRead = static_cast<size_t>( (std::min)( static_cast<long long>( byteCount ), m_Size - m_Position ) );
+		bytesRead = ReadAt( m_Position, buffer, bytesToRead );
+		m_Position += bytesRead;
+	}
+	return bytesRead;
+}
+
+bool FileSource::Seek( const long long offset, const int origin )
+{
+	long long position = offset;
+	switch ( origin ) {
+		case SEEK_CUR : {
+			position += m_Position;
+			break;
+		}
+		case SEEK_END : {
+			position += m_Size;
+			break;
+		}
+		default : {
+			break;
+		}
+	}
+	const bool success = ( position >= 0 );
+	if ( success ) {
+		m_Position = position;
+	}
+	return success;
+}
+
+long long FileSource::GetPosition() const
+{
+	return m_Position;
+}
+
+long long FileSource::GetSize() const
+{
+	return m_Size;
+}
+
+bool FileSource::IsEOF() const
+{
+	return ( m_Position >= m_Size );
+}
+
+void FileSource::SetSize( const long long size )
+{
+	m_Size = size;
+}
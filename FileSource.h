@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+// Provides random access reads from a file, for decoders which supply their own input callbacks.
+// Seeking only moves the read position, so that decoders can seek and query the file size without any system calls.
+class FileSource
+{
+public:
+	FileSource();
+
+	virtual ~FileSource();
+
+	// File source shared pointer type.
+	using Ptr = std::shared_ptr<FileSource>;
+
+	// Read-ahead configuration.
+	struct ReadAhead {
+		// Indicates whether files on network drives, removable drives and hard disks are read ahead on a background thread.
+		bool Enabled = true;
+
+		// Amount of upcoming file data to read ahead, in bytes.
+		size_t WindowSize = 0x1000000;
+
+		// Rate to which file reads are limited, in bytes per second, so that read-ahead can be tested on local storage (or 0 for no limit).
+		long long Throttle = 0;
+	};
+
+	// Sets the read-ahead configuration, which applies to file sources opened subsequently.
+	static void SetReadAhead( const ReadAhead& readAhead );
+
+	// Returns the read-ahead configuration.
+	static ReadAhead GetReadAhead();
+
+	// Opens a file source.
+	// Files on slow storage are read ahead on a background thread, when enabled, and other files are memory mapped where possible.
+	// Buffered reads are used when neither is possible.
+	// 'filename' - file name.
+	// 'readAhead' - whether to read ahead (when enabled by the configuration), for callers which stream the whole file during playback.
+	// Returns the file source, or nullptr if the file could not be opened.
+	static Ptr Open( const std::wstring& filename, const bool readAhead = false );
+
+	// Reads data from the current position.
+	// 'buffer' - output buffer.
+	// 'byteCount' - number of bytes to read.
+	// Returns the number of bytes read, or zero if the end of the file has been reached.
+	size_t Read( void* buffer, const size_t byteCount );
+
+	// Seeks to a position in the file.
+	// 'offset' - offset in bytes.
+	// 'origin' - position from which the offset is applied (SEEK_SET, SEEK_CUR or SEEK_END).
+	// Returns false if the new position would be before the start of the file, in which case the position is unchanged.
+	bool Seek( const long long offset, const int origin = SEEK_SET );
+
+	// Returns the current position, in bytes.
+	long long GetPosition() const;
+
+	// Returns the file size, in bytes.
+	long long GetSize() const;
+
+	// Returns whether the current position is at (or beyond) the end of the file.
+	bool IsEOF() const;
+
+protected:
+	// Reads data from a 'position' in the file.
+	// 'buffer' - output buffer.
+	// 'byteCount' - number of bytes to read (the data to read always lies within the file).
+	// Returns the number of bytes read.
+	virtual size_t ReadAt( const long long position, void* buffer, const size_t byteCount ) = 0;
+
+	// Sets the file 'size', in bytes.
+	void SetSize( const long long size );
+
+private:
+	// File size, in bytes.
+	long long m_Size;
+
+	// Current position, in bytes.
+	long long m_Position;
+};
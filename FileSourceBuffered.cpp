@@ -0,0 +1,72 @@
+#include "FileSourceBuffered.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+// Block buffer size, in bytes.
+static const size_t s_BlockSize = 0x40000;
+
+FileSourceBuffered::FileSourceBuffered( const std::wstring& filename ) :
+	FileSource(),
+	m_File( INVALID_HANDLE_VALUE ),
+	m_Block( s_BlockSize ),
+	m_BlockPosition( 0 ),
+	m_BlockBytes( 0 )
+{
+	m_File = CreateFile( filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL /*securityAttributes*/, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL /*template*/ );
+	LARGE_INTEGER fileSize = {};
+	if ( ( INVALID_HANDLE_VALUE != m_File ) && GetFileSizeEx( m_File, &fileSize ) ) {
+		SetSize( fileSize.QuadPart );
+	} else {
+		if ( INVALID_HANDLE_VALUE != m_File ) {
+			CloseHandle( m_File );
+		}
+		throw std::runtime_error( "FileSourceBuffered could not open file" );
+	}
+}
+
+FileSourceBuffered::~FileSourceBuffered()
+{
+	CloseHandle( m_File );
+}
+
+size_t FileSourceBuffered::ReadAt( const long long position, void* buffer, const size_t byteCount )
+{
+	size_t bytesRead = 0;
+	BYTE* output = static_cast<BYTE*>( buffer );
+	bool continueReading = true;
+	while ( continueReading && ( bytesRead < byteCount ) ) {
+		const long long readPosition = position + bytesRead;
+		const size_t bytesRemaining = byteCount - bytesRead;
+		if ( ( readPosition >= m_BlockPosition ) && ( readPosition < ( m_BlockPosition + static_cast<long long>( m_BlockBytes ) ) ) ) {
+			const size_t offset = static_cast<size_t>( readPosition - m_BlockPosition );
+			const size_t count = (std::min)( bytesRemaining, m_BlockBytes - offset );
+			memcpy( output + bytesRead, m_Block.data() + offset, count );
+			bytesRead += count;
+		} else if ( bytesRemaining >= m_Block.size() ) {
+			// Large reads bypass the block buffer.
+			const size_t count = ReadFromFile( readPosition, output + bytesRead, bytesRemaining );
+			bytesRead += count;
+			continueReading = ( count > 0 );
+		} else {
+			m_BlockPosition = readPosition;
+			m_BlockBytes = ReadFromFile( readPosition, m_Block.data(), m_Block.size() );
+			continueReading = ( m_BlockBytes > 0 );
+		}
+	}
+	return bytesRead;
+}
+
+size_t FileSourceBuffered::ReadFromFile( const long long position, void* buffer, const size_t byteCount )
+{
+	// The read position is passed with each read, rather than moving the file pointer separately.
+	OVERLAPPED overlapped = {};
+	overlapped.Offset = static_cast<DWORD>( position & 0xffffffff );
+	overlapped.OffsetHigh = static_cast<DWORD>( position >> 32 );
+	const DWORD bytesToRead = static_cast<DWORD>( (std::min)( byteCount, static_cast<size_t>( MAXDWORD ) ) );
+	DWORD bytesRead = 0;
+	if ( !ReadFile( m_File, buffer, bytesToRead, &bytesRead, &overlapped ) ) {
+		bytesRead = 0;
+	}
+	return bytesRead;
+}
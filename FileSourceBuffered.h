@@ -0,0 +1,44 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include "FileSource.h"
+
+#include <vector>
+
+// A file source which reads the file in large blocks, for files which cannot be memory mapped.
+class FileSourceBuffered : public FileSource
+{
+public:
+	// 'filename' - file name.
+	// Throws a std::runtime_error exception if the file could not be opened.
+	FileSourceBuffered( const std::wstring& filename );
+
+	~FileSourceBuffered() override;
+
+protected:
+	// Reads data from a 'position' in the file.
+	// 'buffer' - output buffer.
+	// 'byteCount' - number of bytes to read (the data to read always lies within the file).
+	// Returns the number of bytes read.
+	size_t ReadAt( const long long position, void* buffer, const size_t byteCount ) override;
+
+private:
+	// Reads directly from a 'position' in the file.
+	// 'buffer' - output buffer.
+	// 'byteCount' - number of bytes to read.
+	// Returns the number of bytes read.
+	size_t ReadFromFile( const long long position, void* buffer, const size_t byteCount );
+
+	// File handle.
+	HANDLE m_File;
+
+	// Block buffer.
+	std::vector<BYTE> m_Block;
+
+	// Position of the block buffer in the file, in bytes.
+	long long m_BlockPosition;
+
+	// Number of valid bytes in the block buffer.
+	size_t m_BlockBytes;
+};
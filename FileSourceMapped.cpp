@@ -0,0 +1,70 @@
+#include "FileSourceMapped.h"
+
+#include <stdexcept>
+
+// Maximum size of file to map, in bytes (limited for 32-bit builds, to conserve address space).
+#ifdef _WIN64
+static const long long s_MaximumMappedSize = 0x7fffffffffffffffll;
+#else
+static const long long s_MaximumMappedSize = 0x10000000ll;
+#endif
+
+FileSourceMapped::FileSourceMapped( const std::wstring& filename ) :
+	FileSource(),
+	m_File( INVALID_HANDLE_VALUE ),
+	m_Mapping( NULL ),
+	m_View( nullptr )
+{
+	m_File = CreateFile( filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL /*securityAttributes*/, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL /*template*/ );
+	if ( INVALID_HANDLE_VALUE != m_File ) {
+		LARGE_INTEGER fileSize = {};
+		if ( GetFileSizeEx( m_File, &fileSize ) && ( fileSize.QuadPart > 0 ) && ( fileSize.QuadPart <= s_MaximumMappedSize ) ) {
+			m_Mapping = CreateFileMapping( m_File, NULL /*attributes*/, PAGE_READONLY, 0 /*maximumSizeHigh*/, 0 /*maximumSizeLow*/, NULL /*name*/ );
+			if ( NULL != m_Mapping ) {
+				m_View = static_cast<const BYTE*>( MapViewOfFile( m_Mapping, FILE_MAP_READ, 0 /*offsetHigh*/, 0 /*offsetLow*/, 0 /*bytesToMap*/ ) );
+				if ( nullptr != m_View ) {
+					SetSize( fileSize.QuadPart );
+				}
+			}
+		}
+	}
+
+	if ( nullptr == m_View ) {
+		Close();
+		throw std::runtime_error( "FileSourceMapped could not map file" );
+	}
+}
+
+FileSourceMapped::~FileSourceMapped()
+{
+	Close();
+}
+
+size_t FileSourceMapped::ReadAt( const long long position, void* buffer, const size_t byteCount )
+{
+	size_t bytesRead = 0;
+	// An I/O error on the mapped file (such as a network drive becoming unavailable) is raised as an in-page exception.
+	__try {
+		memcpy( buffer, m_View + position, byteCount );
+		bytesRead = byteCount;
+	} __except ( ( EXCEPTION_IN_PAGE_ERROR == GetExceptionCode() ) ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH ) {
+		bytesRead = 0;
+	}
+	return bytesRead;
+}
+
+void FileSourceMapped::Close()
+{
+	if ( nullptr != m_View ) {
+		UnmapViewOfFile( m_View );
+		m_View = nullptr;
+	}
+	if ( NULL != m_Mapping ) {
+		CloseHandle( m_Mapping );
+		m_Mapping = NULL;
+	}
+	if ( INVALID_HANDLE_VALUE != m_File ) {
+		CloseHandle( m_File );
+		m_File = INVALID_HANDLE_VALUE;
+	}
+}
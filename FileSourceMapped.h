@@ -0,0 +1,36 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include "FileSource.h"
+
+// A file source which maps the whole file into memory, so that reads are memory copies.
+class FileSourceMapped : public FileSource
+{
+public:
+	// 'filename' - file name.
+	// Throws a std::runtime_error exception if the file could not be mapped.
+	FileSourceMapped( const std::wstring& filename );
+
+	~FileSourceMapped() override;
+
+protected:
+	// Reads data from a 'position' in the file.
+	// 'buffer' - output buffer.
+	// 'byteCount' - number of bytes to read (the data to read always lies within the file).
+	// Returns the number of bytes read.
+	size_t ReadAt( const long long position, void* buffer, const size_t byteCount ) override;
+
+private:
+	// Closes the file.
+	void Close();
+
+	// File handle.
+	HANDLE m_File;
+
+	// File mapping handle.
+	HANDLE m_Mapping;
+
+	// Mapped file contents.
+	const BYTE* m_View;
+};
@@ -0,0 +1,245 @@
+#include "FileSourcePrefetch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+// Number of bytes read by the background thread at a time.
+static const size_t s_ChunkSize = 0x100000;
+
+// Number of bytes retained behind the decoder read position, so that small backward seeks are satisfied from the window.
+static const long long s_BackMargin = 0x10000;
+
+// Number of reads which were satisfied without waiting.
+static std::atomic<long long> s_Hits( 0 );
+
+// Number of reads which had to wait.
+static std::atomic<long long> s_Misses( 0 );
+
+// Total time spent waiting, in microseconds.
+static std::atomic<long long> s_StallMicroseconds( 0 );
+
+// Total number of bytes read by the background threads.
+static std::atomic<long long> s_BytesPrefetched( 0 );
+
+DWORD WINAPI FileSourcePrefetch::PrefetchThreadProc( LPVOID lpParam )
+{
+	FileSourcePrefetch* fileSource = reinterpret_cast<FileSourcePrefetch*>( lpParam );
+	if ( nullptr != fileSource ) {
+		fileSource->PrefetchHandler();
+	}
+	return 0;
+}
+
+FileSourcePrefetch::FileSourcePrefetch( const Ptr source, const size_t windowSize ) :
+	FileSource(),
+	m_Source( source ),
+	m_Window(),
+	m_WindowStart( 0 ),
+	m_WindowEnd( 0 ),
+	m_ReaderPosition( 0 ),
+	m_RequestPosition( -1 ),
+	m_Failed( false ),
+	m_Idle( false ),
+	m_Mutex(),
+	m_StopEvent( CreateEvent( NULL /*attributes*/, TRUE /*manualReset*/, FALSE /*initialState*/, L"" /*name*/ ) ),
+	m_WakeEvent( CreateEvent( NULL /*attributes*/, FALSE /*manualReset*/, FALSE /*initialState*/, L"" /*name*/ ) ),
+	m_DataEvent( CreateEvent( NULL /*attributes*/, FALSE /*manualReset*/, FALSE /*initialState*/, L"" /*name*/ ) ),
+	m_Thread( NULL )
+{
+	if ( m_Source && ( NULL != m_StopEvent ) && ( NULL != m_WakeEvent ) && ( NULL != m_DataEvent ) ) {
+		SetSize( m_Source->GetSize() );
+
+		// The window need be no larger than the file.
+		m_Window.resize( static_cast<size_t>( std::clamp<long long>( GetSize(), 1, static_cast<long long>( (std::max)( windowSize, s_ChunkSize ) ) ) ) );
+		m_Thread = CreateThread( NULL /*attributes*/, 0 /*stackSize*/, PrefetchThreadProc, reinterpret_cast<LPVOID>( this ), 0 /*flags*/, NULL /*threadId*/ );
+	}
+	if ( NULL == m_Thread ) {
+		for ( const HANDLE handle : { m_StopEvent, m_WakeEvent, m_DataEvent } ) {
+			if ( NULL != handle ) {
+				CloseHandle( handle );
+			}
+		}
+		throw std::runtime_error( "FileSourcePrefetch could not start read-ahead" );
+	}
+}
+
+FileSourcePrefetch::~FileSourcePrefetch()
+{
+	SetEvent( m_StopEvent );
+	WaitForSingleObject( m_Thread, INFINITE );
+	CloseHandle( m_Thread );
+	CloseHandle( m_StopEvent );
+	CloseHandle( m_WakeEvent );
+	CloseHandle( m_DataEvent );
+}
+
+FileSourcePrefetch::Statistics FileSourcePrefetch::GetStatistics()
+{
+	Statistics statistics;
+	statistics.Hits = s_Hits;
+	statistics.Misses = s_Misses;
+	statistics.StallSeconds = s_StallMicroseconds / 1e6;
+	statistics.BytesPrefetched = s_BytesPrefetched;
+	return statistics;
+}
+
+bool FileSourcePrefetch::WriteMetrics( const std::wstring& filename )
+{
+	bool success = false;
+	std::ofstream stream( filename, std::ios::out | std::ios::app );
+	if ( stream.is_open() ) {
+		const Statistics statistics = GetStatistics();
+		const long long reads = statistics.Hits + statistics.Misses;
+		stream << std::fixed << std::setprecision( 3 );
+		stream << std::endl;
+		stream << "Read-ahead,Value" << std::endl;
+		stream << "Reads," << reads << std::endl;
+		stream << "Hits," << statistics.Hits << std::endl;
+		stream << "Misses," << statistics.Misses << std::endl;
+		stream << "Hit rate (%)," << ( ( reads > 0 ) ? ( 100.0 * statistics.Hits / reads ) : 0 ) << std::endl;
+		stream << "Stall time (s)," << statistics.StallSeconds << std::endl;
+		stream << "Bytes prefetched," << statistics.BytesPrefetched << std::endl;
+		success = stream.good();
+		stream.close();
+	}
+	return success;
+}
+
+size_t FileSourcePrefetch::ReadAt( const long long position, void* buffer, const size_t byteCount )
+{
+	size_t bytesRead = 0;
+	BYTE* output = static_cast<BYTE*>( buffer );
+	bool stalled = false;
+	std::chrono::steady_clock::time_point stallStart;
+
+	std::unique_lock<std::mutex> lock( m_Mutex );
+	bool continueReading = true;
+	while ( continueReading && ( bytesRead < byteCount ) ) {
+		const long long readPosition = position + bytesRead;
+		m_ReaderPosition = readPosition;
+		if ( ( readPosition >= m_WindowStart ) && ( readPosition < m_WindowEnd ) ) {
+			bytesRead += CopyFromWindow( readPosition, output + bytesRead, byteCount - bytesRead );
+		} else if ( m_Failed && ( m_RequestPosition < 0 ) && ( readPosition >= m_WindowEnd ) ) {
+			continueReading = false;
+		} else {
+			// Data just ahead of the window will soon be read by the background thread, otherwise the window is restarted from the read position.
+			const long long windowStart = ( m_RequestPosition < 0 ) ? m_WindowStart : m_RequestPosition;
+			const long long windowEnd = ( m_RequestPosition < 0 ) ? m_WindowEnd : m_RequestPosition;
+			if ( ( readPosition < windowStart ) || ( readPosition >= ( windowEnd + static_cast<long long>( s_ChunkSize ) ) ) ) {
+				m_RequestPosition = readPosition;
+			}
+			if ( m_Idle ) {
+				m_Idle = false;
+				SetEvent( m_WakeEvent );
+			}
+			if ( !stalled ) {
+				stalled = true;
+				stallStart = std::chrono::steady_clock::now();
+			}
+			lock.unlock();
+			WaitForSingleObject( m_DataEvent, INFINITE );
+			lock.lock();
+		}
+	}
+
+	// Wake the background thread once there is space for it to continue reading ahead.
+	if ( m_Idle && !m_Failed && ( m_WindowEnd < GetSize() ) ) {
+		const long long discardPosition = (std::min)( m_ReaderPosition - s_BackMargin, m_WindowEnd );
+		const long long freeBytes = static_cast<long long>( m_Window.size() ) - ( m_WindowEnd - (std::max)( m_WindowStart, discardPosition ) );
+		if ( freeBytes >= static_cast<long long>( (std::min)( s_ChunkSize, m_Window.size() / 2 ) ) ) {
+			m_Idle = false;
+			SetEvent( m_WakeEvent );
+		}
+	}
+	lock.unlock();
+
+	if ( stalled ) {
+		++s_Misses;
+		s_StallMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - stallStart ).count();
+	} else {
+		++s_Hits;
+	}
+	return bytesRead;
+}
+
+void FileSourcePrefetch::PrefetchHandler()
+{
+	std::vector<BYTE> chunk( (std::min)( s_ChunkSize, m_Window.size() ) );
+	const HANDLE waitHandles[] = { m_StopEvent, m_WakeEvent };
+	bool continuePrefetch = true;
+	while ( continuePrefetch ) {
+		long long readPosition = 0;
+		size_t bytesToRead = 0;
+		{
+			std::lock_guard<std::mutex> lock( m_Mutex );
+			if ( m_RequestPosition >= 0 ) {
+				m_WindowStart = m_WindowEnd = m_RequestPosition;
+				m_RequestPosition = -1;
+				m_Failed = false;
+			}
+
+			// Data well behind the decoder read position is discarded, to make space for reading further ahead.
+			const long long discardPosition = (std::min)( m_ReaderPosition - s_BackMargin, m_WindowEnd );
+			if ( discardPosition > m_WindowStart ) {
+				m_WindowStart = discardPosition;
+			}
+
+			if ( !m_Failed ) {
+				const long long freeBytes = static_cast<long long>( m_Window.size() ) - ( m_WindowEnd - m_WindowStart );
+				bytesToRead = static_cast<size_t>( (std::min)( { static_cast<long long>( chunk.size() ), freeBytes, GetSize() - m_WindowEnd } ) );
+			}
+			readPosition = m_WindowEnd;
+			m_Idle = ( 0 == bytesToRead );
+		}
+
+		if ( bytesToRead > 0 ) {
+			// The file is read outside of the lock, so that the decoder can continue to read from the window in the meantime.
+			size_t bytesRead = 0;
+			if ( m_Source->Seek( readPosition ) ) {
+				bytesRead = m_Source->Read( chunk.data(), bytesToRead );
+			}
+			{
+				std::lock_guard<std::mutex> lock( m_Mutex );
+				if ( m_RequestPosition < 0 ) {
+					if ( bytesRead > 0 ) {
+						CopyToWindow( readPosition, chunk.data(), bytesRead );
+						s_BytesPrefetched += bytesRead;
+					} else {
+						m_Failed = true;
+					}
+				}
+			}
+			SetEvent( m_DataEvent );
+			continuePrefetch = ( WAIT_OBJECT_0 != WaitForSingleObject( m_StopEvent, 0 ) );
+		} else {
+			continuePrefetch = ( ( WAIT_OBJECT_0 + 1 ) == WaitForMultipleObjects( 2 /*count*/, waitHandles, FALSE /*waitAll*/, INFINITE ) );
+		}
+	}
+}
+
+size_t FileSourcePrefetch::CopyFromWindow( const long long position, BYTE* buffer, const size_t byteCount ) const
+{
+	const size_t bytesToCopy = static_cast<size_t>( (std::min)( static_cast<long long>( byteCount ), m_WindowEnd - position ) );
+	const size_t offset = static_cast<size_t>( position % static_cast<long long>( m_Window.size() ) );
+	const size_t firstCount = (std::min)( bytesToCopy, m_Window.size() - offset );
+	memcpy( buffer, m_Window.data() + offset, firstCount );
+	if ( firstCount < bytesToCopy ) {
+		memcpy( buffer + firstCount, m_Window.data(), bytesToCopy - firstCount );
+	}
+	return bytesToCopy;
+}
+
+void FileSourcePrefetch::CopyToWindow( const long long position, const BYTE* buffer, const size_t byteCount )
+{
+	const size_t offset = static_cast<size_t>( position % static_cast<long long>( m_Window.size() ) );
+	const size_t firstCount = (std::min)( byteCount, m_Window.size() - offset );
+	memcpy( m_Window.data() + offset, buffer, firstCount );
+	if ( firstCount < byteCount ) {
+		memcpy( m_Window.data(), buffer + firstCount, byteCount - firstCount );
+	}
+	m_WindowEnd = position + byteCount;
+}
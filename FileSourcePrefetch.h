@@ -0,0 +1,103 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include "FileSource.h"
+
+#include <mutex>
+#include <vector>
+
+// A file source which reads ahead of the decoder on a background thread, for files on network or other slow storage.
+// Upcoming file data is held in a window of fixed size, so that decoder reads are memory copies except when the decoder seeks outside the window.
+class FileSourcePrefetch : public FileSource
+{
+public:
+	// 'source' - file source from which to read ahead (which is then only read by the background thread).
+	// 'windowSize' - amount of upcoming file data to read ahead, in bytes.
+	// Throws a std::runtime_error exception if the file source is not valid, or the background thread could not be started.
+	FileSourcePrefetch( const Ptr source, const size_t windowSize );
+
+	~FileSourcePrefetch() override;
+
+	// Read-ahead statistics, accumulated over all prefetching file sources.
+	struct Statistics {
+		// Number of reads which were satisfied without waiting for the background thread.
+		long long Hits = 0;
+
+		// Number of reads which had to wait for the background thread.
+		long long Misses = 0;
+
+		// Total time spent waiting for the background thread, in seconds.
+		double StallSeconds = 0;
+
+		// Total number of bytes read by the background thread.
+		long long BytesPrefetched = 0;
+	};
+
+	// Returns the read-ahead statistics.
+	static Statistics GetStatistics();
+
+	// Appends the read-ahead statistics to the metrics report in 'filename'.
+	// Returns whether the statistics were written.
+	static bool WriteMetrics( const std::wstring& filename );
+
+protected:
+	// Reads data from a 'position' in the file.
+	// 'buffer' - output buffer.
+	// 'byteCount' - number of bytes to read (the data to read always lies within the file).
+	// Returns the number of bytes read.
+	size_t ReadAt( const long long position, void* buffer, const size_t byteCount ) override;
+
+private:
+	// Prefetch thread procedure.
+	static DWORD WINAPI PrefetchThreadProc( LPVOID lpParam );
+
+	// Prefetch thread handler.
+	void PrefetchHandler();
+
+	// Copies window data to a 'buffer', starting from a file 'position' which lies within the window, and returns the number of bytes copied.
+	// 'byteCount' - maximum number of bytes to copy.
+	size_t CopyFromWindow( const long long position, BYTE* buffer, const size_t byteCount ) const;
+
+	// Copies 'byteCount' bytes from a 'buffer' into the window, at the file 'position' at which the window ends.
+	void CopyToWindow( const long long position, const BYTE* buffer, const size_t byteCount );
+
+	// File source from which to read ahead.
+	const Ptr m_Source;
+
+	// Window buffer, in which file data is held as a ring.
+	std::vector<BYTE> m_Window;
+
+	// File position at which the window data starts, in bytes.
+	long long m_WindowStart;
+
+	// File position at which the window data ends, in bytes.
+	long long m_WindowEnd;
+
+	// File position of the most recent decoder read, in bytes.
+	long long m_ReaderPosition;
+
+	// File position from which the background thread is requested to restart reading, or -1 if there is no request.
+	long long m_RequestPosition;
+
+	// Indicates whether the background thread failed to read from the end of the window.
+	bool m_Failed;
+
+	// Indicates whether the background thread is waiting to be woken.
+	bool m_Idle;
+
+	// Window mutex.
+	std::mutex m_Mutex;
+
+	// Handle to stop the background thread.
+	HANDLE m_StopEvent;
+
+	// Handle to wake the background thread.
+	HANDLE m_WakeEvent;
+
+	// Handle which is signalled when the background thread adds data to the window.
+	HANDLE m_DataEvent;
+
+	// Background thread.
+	HANDLE m_Thread;
+};
@@ -0,0 +1,38 @@
+#include "FileSourceThrottled.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+// Latency added to each read.
+static const std::chrono::milliseconds s_Latency( 2 );
+
+FileSourceThrottled::FileSourceThrottled( const Ptr source, const long long bytesPerSecond ) :
+	FileSource(),
+	m_Source( source ),
+	m_BytesPerSecond( bytesPerSecond ),
+	m_Available( Clock::now() )
+{
+	if ( !m_Source || ( m_BytesPerSecond <= 0 ) ) {
+		throw std::runtime_error( "FileSourceThrottled could not open file" );
+	}
+	SetSize( m_Source->GetSize() );
+}
+
+FileSourceThrottled::~FileSourceThrottled()
+{
+}
+
+size_t FileSourceThrottled::ReadAt( const long long position, void* buffer, const size_t byteCount )
+{
+	size_t bytesRead = 0;
+	if ( m_Source->Seek( position ) ) {
+		bytesRead = m_Source->Read( buffer, byteCount );
+	}
+
+	// Reads are serviced in turn, so any time left over from the previous read is carried forward.
+	const auto transferTime = std::chrono::duration_cast<Clock::duration>( std::chrono::duration<double>( static_cast<double>( bytesRead ) / m_BytesPerSecond ) );
+	m_Available = (std::max)( m_Available, Clock::now() ) + s_Latency + transferTime;
+	std::this_thread::sleep_until( m_Available );
+	return bytesRead;
+}
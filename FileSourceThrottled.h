@@ -0,0 +1,40 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include "FileSource.h"
+
+#include <chrono>
+
+// A file source which limits the rate at which another file source is read, and adds a fixed latency to each read.
+// This simulates network or other slow storage, so that read-ahead can be tested with files on local storage.
+class FileSourceThrottled : public FileSource
+{
+public:
+	// 'source' - file source from which to read.
+	// 'bytesPerSecond' - rate to which reads are limited.
+	// Throws a std::runtime_error exception if the file source is not valid.
+	FileSourceThrottled( const Ptr source, const long long bytesPerSecond );
+
+	~FileSourceThrottled() override;
+
+protected:
+	// Reads data from a 'position' in the file.
+	// 'buffer' - output buffer.
+	// 'byteCount' - number of bytes to read (the data to read always lies within the file).
+	// Returns the number of bytes read.
+	size_t ReadAt( const long long position, void* buffer, const size_t byteCount ) override;
+
+private:
+	// Throttle clock.
+	using Clock = std::chrono::steady_clock;
+
+	// File source from which to read.
+	const Ptr m_Source;
+
+	// Rate to which reads are limited, in bytes per second.
+	const long long m_BytesPerSecond;
+
+	// Time at which the storage becomes available for the next read.
+	Clock::time_point m_Available;
+};
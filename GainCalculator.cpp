@@ -1,9 +1,14 @@
 #include "GainCalculator.h"
 
+#include "TrackAnalysis.h"
 #include "Utility.h"
 
 #include "ebur128.h"
 
+#include <fstream>
+#include <iomanip>
+#include <thread>
+
 DWORD WINAPI GainCalculator::CalcThreadProc( LPVOID lpParam )
 {
 	GainCalculator* gainCalculator = reinterpret_cast<GainCalculator*>( lpParam );
@@ -13,6 +18,30 @@ DWORD WINAPI GainCalculator::CalcThreadProc( LPVOID lpParam )
 	return 0;
 }
 
+DWORD WINAPI GainCalculator::WorkerThreadProc( LPVOID lpParam )
+{
+	Worker* worker = reinterpret_cast<Worker*>( lpParam );
+	if ( ( nullptr != worker ) && ( nullptr != worker->Calculator ) ) {
+		worker->Calculator->WorkerHandler( *worker );
+	}
+	return 0;
+}
+
+double GainCalculator::Throughput::GetTracksPerSecond() const
+{
+	return ( ElapsedSeconds > 0 ) ? ( Tracks / ElapsedSeconds ) : 0;
+}
+
+double GainCalculator::Throughput::GetRealtimeFactor() const
+{
+	return ( ElapsedSeconds > 0 ) ? ( TrackSeconds / ElapsedSeconds ) : 0;
+}
+
+double GainCalculator::DecodeThroughput::GetRealtimeFactor() const
+{
+	return ( DecodeSeconds > 0 ) ? ( TrackSeconds / DecodeSeconds ) : 0;
+}
+
 GainCalculator::GainCalculator( Library& library, const Handlers& handlers ) :
 	m_Library( library ),
 	m_Handlers( handlers ),
@@ -20,11 +49,34 @@ GainCalculator::GainCalculator( Library& library, const Handlers& handlers ) :
 	m_Mutex(),
 	m_StopEvent( CreateEvent( NULL /*attributes*/, TRUE /*manualReset*/, FALSE /*initialState*/, L"" /*name*/ ) ),
 	m_WakeEvent( CreateEvent( NULL /*attributes*/, TRUE /*manualReset*/, FALSE /*initialState*/, L"" /*name*/ ) ),
+	m_TaskTakenEvent( CreateEvent( NULL /*attributes*/, FALSE /*manualReset*/, FALSE /*initialState*/, L"" /*name*/ ) ),
+	m_TaskSemaphore( CreateSemaphore( NULL /*attributes*/, 0 /*initialCount*/, LONG_MAX /*maximumCount*/, NULL /*name*/ ) ),
 	m_Thread( NULL ),
-	m_PendingCount( {} )
+	m_Workers(),
+	m_NextWorker( 0 ),
+	m_QueuedTasks( 0 ),
+	m_ActiveTasks( 0 ),
+	m_PendingCount( {} ),
+	m_Throughput(),
+	m_DecodeThroughput(),
+	m_BusyStart(),
+	m_TasksInProgress( 0 ),
+	m_ThroughputMutex()
 {
-	if ( ( NULL != m_StopEvent ) && ( NULL != m_WakeEvent ) ) {
-		m_Thread = CreateThread( NULL /*attributes*/, 0 /*stackSize*/, CalcThreadProc, reinterpret_cast<LPVOID>( this ), 0 /*flags*/, NULL /*threadId*/ );
+	if ( ( NULL != m_StopEvent ) && ( NULL != m_WakeEvent ) && ( NULL != m_TaskTakenEvent ) && ( NULL != m_TaskSemaphore ) ) {
+		const size_t workerCount = max( 1, static_cast<size_t>( std::thread::hardware_concurrency() ) );
+		for ( size_t index = 0; index < workerCount; index++ ) {
+			std::unique_ptr<Worker> worker = std::make_unique<Worker>();
+			worker->Calculator = this;
+			worker->Index = index;
+			worker->Thread = CreateThread( NULL /*attributes*/, 0 /*stackSize*/, WorkerThreadProc, reinterpret_cast<LPVOID>( worker.get() ), 0 /*flags*/, NULL /*threadId*/ );
+			if ( NULL != worker->Thread ) {
+				m_Workers.push_back( std::move( worker ) );
+			}
+		}
+		if ( !m_Workers.empty() ) {
+			m_Thread = CreateThread( NULL /*attributes*/, 0 /*stackSize*/, CalcThreadProc, reinterpret_cast<LPVOID>( this ), 0 /*flags*/, NULL /*threadId*/ );
+		}
 	}
 }
 
@@ -46,15 +98,32 @@ void GainCalculator::Calculate( const Playlist::ItemList& items )
 
 void GainCalculator::Stop()
 {
-	if ( NULL != m_Thread ) {
+	if ( NULL != m_StopEvent ) {
 		SetEvent( m_StopEvent );
-		WaitForSingleObject( m_Thread, INFINITE );
+		if ( NULL != m_Thread ) {
+			WaitForSingleObject( m_Thread, INFINITE );
+			CloseHandle( m_Thread );
+			m_Thread = NULL;
+		}
+		for ( auto& worker : m_Workers ) {
+			WaitForSingleObject( worker->Thread, INFINITE );
+			CloseHandle( worker->Thread );
+		}
+		m_Workers.clear();
 		CloseHandle( m_StopEvent );
 		m_StopEvent = NULL;
+	}
+	if ( NULL != m_WakeEvent ) {
 		CloseHandle( m_WakeEvent );
 		m_WakeEvent = NULL;
-		CloseHandle( m_Thread );
-		m_Thread = NULL;
+	}
+	if ( NULL != m_TaskTakenEvent ) {
+		CloseHandle( m_TaskTakenEvent );
+		m_TaskTakenEvent = NULL;
+	}
+	if ( NULL != m_TaskSemaphore ) {
+		CloseHandle( m_TaskSemaphore );
+		m_TaskSemaphore = NULL;
 	}
 }
 
@@ -84,140 +153,251 @@ void GainCalculator::AddPending( const Playlist::Item& item )
 void GainCalculator::Handler()
 {
 	HANDLE eventHandles[ 2 ] = { m_StopEvent, m_WakeEvent };
+	HANDLE takenHandles[ 2 ] = { m_StopEvent, m_TaskTakenEvent };
 	while ( WaitForMultipleObjects( 2, eventHandles, FALSE /*waitAll*/, INFINITE ) != WAIT_OBJECT_0 ) {
-		AlbumKey albumKey = {};
-		Playlist::ItemList pendingItems;
-		{
-			std::lock_guard<std::mutex> lock( m_Mutex );
-			const auto iter = m_AlbumQueue.begin();
-			if ( m_AlbumQueue.end() == iter ) {
-				ResetEvent( m_WakeEvent );
-			} else {
-				albumKey = iter->first;
-				pendingItems = iter->second;
-				m_AlbumQueue.erase( iter );
+		if ( m_QueuedTasks < static_cast<long>( m_Workers.size() ) ) {
+			// Albums are only dispatched when workers are running short of tasks, so that any items subsequently added to a pending album are calculated along with it.
+			AlbumKey albumKey = {};
+			Playlist::ItemList pendingItems;
+			{
+				std::lock_guard<std::mutex> lock( m_Mutex );
+				const auto iter = m_AlbumQueue.begin();
+				if ( m_AlbumQueue.end() == iter ) {
+					ResetEvent( m_WakeEvent );
+				} else {
+					albumKey = iter->first;
+					pendingItems = iter->second;
+					m_AlbumQueue.erase( iter );
+				}
 			}
+			if ( !pendingItems.empty() ) {
+				Dispatch( albumKey, pendingItems );
+			}
+		} else if ( WaitForMultipleObjects( 2, takenHandles, FALSE /*waitAll*/, INFINITE ) == WAIT_OBJECT_0 ) {
+			break;
 		}
+	}
+}
 
-		if ( !pendingItems.empty() ) {
-			std::mutex itemMutex;
-			std::mutex r128StatesMutex;
+void GainCalculator::Dispatch( const AlbumKey& albumKey, const Playlist::ItemList& items )
+{
+	const std::shared_ptr<AlbumTask> album = std::make_shared<AlbumTask>();
+	album->Key = albumKey;
+	album->Remaining = items.size();
 
-			std::vector<ebur128_state*> r128States;
-			r128States.reserve( pendingItems.size() );
+	{
+		std::lock_guard<std::mutex> lock( m_ThroughputMutex );
+		if ( 0 == m_TasksInProgress ) {
+			m_BusyStart = Clock::now();
+		}
+		m_TasksInProgress += static_cast<long>( items.size() );
+	}
 
-			Decoder::CanContinue canContinue( [ stopEvent = m_StopEvent ] ()
-			{
-				return ( WAIT_OBJECT_0 != WaitForSingleObject( stopEvent, 0 ) );
-			} );
-
-			// Update track gain for all items.
-			Playlist::ItemList processedItems;
-			const size_t threadCount = min( pendingItems.size(), max( 1, static_cast<size_t>( std::thread::hardware_concurrency() ) ) );
-			std::list<std::thread> threads;
-			for ( size_t threadIndex = 0; threadIndex < threadCount; threadIndex++ ) {
-				threads.push_back( std::thread( [ &pendingItems, &processedItems, &itemMutex, &r128States, &r128StatesMutex, canContinue, this ]() 
+	for ( const auto& item : items ) {
+		Worker& worker = *m_Workers[ m_NextWorker ];
+		m_NextWorker = ( m_NextWorker + 1 ) % m_Workers.size();
+		{
+			std::lock_guard<std::mutex> lock( worker.Mutex );
+			worker.Tasks.push_back( { item, album } );
+		}
+		++m_QueuedTasks;
+		ReleaseSemaphore( m_TaskSemaphore, 1 /*releaseCount*/, NULL /*previousCount*/ );
+	}
+}
+
+bool GainCalculator::TakeTask( Worker& worker, TrackTask& task )
+{
+	bool taken = false;
+	{
+		std::lock_guard<std::mutex> lock( worker.Mutex );
+		if ( !worker.Tasks.empty() ) {
+			task = worker.Tasks.front();
+			worker.Tasks.pop_front();
+			taken = true;
+		}
+	}
+	for ( size_t offset = 1; !taken && ( offset < m_Workers.size() ); offset++ ) {
+		Worker& victim = *m_Workers[ ( worker.Index + offset ) % m_Workers.size() ];
+		std::lock_guard<std::mutex> lock( victim.Mutex );
+		if ( !victim.Tasks.empty() ) {
+			task = victim.Tasks.back();
+			victim.Tasks.pop_back();
+			taken = true;
+		}
+	}
+	if ( taken ) {
+		--m_QueuedTasks;
+		SetEvent( m_TaskTakenEvent );
+	}
+	return taken;
+}
+
+void GainCalculator::WorkerHandler( Worker& worker )
+{
+	HANDLE eventHandles[ 2 ] = { m_StopEvent, m_TaskSemaphore };
+	while ( WaitForMultipleObjects( 2, eventHandles, FALSE /*waitAll*/, INFINITE ) != WAIT_OBJECT_0 ) {
+		TrackTask task;
+		if ( TakeTask( worker, task ) ) {
+			RunTask( worker, task );
+		}
+	}
+}
+
+void GainCalculator::RunTask( Worker& worker, const TrackTask& task )
+{
+	++m_ActiveTasks;
+	if ( task.Subtask ) {
+		task.Subtask();
+	} else {
+		AnalyseTrack( worker, task );
+	}
+	--m_ActiveTasks;
+}
+
+void GainCalculator::RunSubtasks( Worker& worker, const std::vector<std::function<void()>>& subtasks )
+{
+	// The subtasks are taken from the front of the worker queue by the worker itself, and from the back by any idle workers.
+	// Rather than blocking while other workers complete the subtasks they have taken, the worker carries on running queued tasks.
+	HANDLE completedEvent = CreateEvent( NULL /*attributes*/, TRUE /*manualReset*/, FALSE /*initialState*/, NULL /*name*/ );
+	if ( NULL != completedEvent ) {
+		std::atomic<size_t> remaining( subtasks.size() );
+		{
+			std::lock_guard<std::mutex> lock( worker.Mutex );
+			for ( auto iter = subtasks.rbegin(); subtasks.rend() != iter; iter++ ) {
+				worker.Tasks.push_front( { Playlist::Item(), nullptr, [ subtask = *iter, &remaining, completedEvent ] ()
 				{
-					Playlist::Item item = {};
-					{
-						std::lock_guard<std::mutex> lock( itemMutex );
-						if ( !pendingItems.empty() ) {
-							item = pendingItems.front();
-							pendingItems.pop_front();
-						}
+					subtask();
+					if ( 0 == --remaining ) {
+						SetEvent( completedEvent );
 					}
+				} } );
+			}
+		}
+		m_QueuedTasks += static_cast<long>( subtasks.size() );
+		ReleaseSemaphore( m_TaskSemaphore, static_cast<LONG>( subtasks.size() ), NULL /*previousCount*/ );
 
-					while ( 0 != item.ID ) {					
-						Decoder::Ptr decoder = OpenDecoder( item );
-						if ( decoder ) {
-							const unsigned int channels = static_cast<unsigned int>( decoder->GetChannels() );
-							const unsigned long samplerate = static_cast<unsigned long>( decoder->GetSampleRate() );
-							ebur128_state* r128State = ebur128_init( channels, samplerate, EBUR128_MODE_I );
-							if ( nullptr != r128State ) {
-								const long sampleSize = 4096;
-								std::vector<float> buffer( sampleSize * channels );
-
-								int errorState = EBUR128_SUCCESS;
-								long samplesRead = decoder->Read( &buffer[ 0 ], sampleSize );
-								while ( ( EBUR128_SUCCESS == errorState ) && ( samplesRead > 0 ) && canContinue() ) {
-									errorState = ebur128_add_frames_float( r128State, &buffer[ 0 ], static_cast<size_t>( samplesRead ) );
-									samplesRead = decoder->Read( &buffer[ 0 ], sampleSize );
-								}
-								decoder.reset();
-
-								if ( ( EBUR128_SUCCESS == errorState ) && canContinue() ) {
-									double loudness = 0;
-									errorState = ebur128_loudness_global( r128State, &loudness );
-									if ( EBUR128_SUCCESS == errorState ) {
-										const float trackGain = LOUDNESS_REFERENCE - static_cast<float>( loudness );
-										if ( trackGain != item.Info.GetGainTrack() ) {
-											MediaInfo previousMediaInfo( item.Info );
-											item.Info.SetGainTrack( trackGain );
-											m_Library.UpdateMediaTags( previousMediaInfo, item.Info );
-
-											for ( const auto& duplicate : item.Duplicates ) {
-												previousMediaInfo.SetFilename( duplicate );
-												MediaInfo updatedMediaInfo( item.Info );
-												updatedMediaInfo.SetFilename( duplicate );
-												m_Library.UpdateMediaTags( previousMediaInfo, updatedMediaInfo );
-											}
-										}
-										std::lock_guard<std::mutex> itemLock( itemMutex );
-										processedItems.push_back( item );
-										std::lock_guard<std::mutex> lock( r128StatesMutex );
-										r128States.push_back( r128State );
-									}
-								}
-							}
-						}
-
-						item = {};
-						if ( canContinue() ) {
-							std::lock_guard<std::mutex> lock( itemMutex );
-							if ( !pendingItems.empty() ) {
-								item = pendingItems.front();
-								pendingItems.pop_front();
-							}
-						}
-
-						--m_PendingCount;
-					}
-				}	) );
+		HANDLE eventHandles[ 2 ] = { completedEvent, m_TaskSemaphore };
+		while ( WaitForMultipleObjects( 2, eventHandles, FALSE /*waitAll*/, INFINITE ) != WAIT_OBJECT_0 ) {
+			TrackTask task;
+			if ( TakeTask( worker, task ) ) {
+				RunTask( worker, task );
 			}
-			for ( auto& thread : threads ) {
-				thread.join();
+		}
+		CloseHandle( completedEvent );
+	} else {
+		for ( const auto& subtask : subtasks ) {
+			subtask();
+		}
+	}
+}
+
+void GainCalculator::AnalyseTrack( Worker& worker, const TrackTask& task )
+{
+	Playlist::Item item = task.Item;
+
+	// Files which were scanned without a fingerprint are fingerprinted now, so that the results are kept should the file be moved, renamed or retagged.
+	// The fingerprint does not cover the whole track, so the track is analysed in any case.
+	if ( item.Info.GetFingerprint().empty() && ( MediaInfo::Source::File == item.Info.GetSource() ) ) {
+		if ( const Decoder::Ptr decoder = OpenDecoder( item ); decoder ) {
+			m_Library.UpdateFingerprint( item.Info, *decoder );
+		}
+	}
+
+	// Analyse the track in a single pass, storing the track gain along with the peak level, silence durations and crossfade position.
+	// When there are fewer tasks than workers, long tracks are also divided into segments which are analysed in parallel.
+	const std::shared_ptr<TrackAnalysis> analysis = std::make_shared<TrackAnalysis>( OpenDecoder( item ) );
+	const size_t tasks = max( 1, static_cast<size_t>( m_ActiveTasks + m_QueuedTasks ) );
+	const size_t maximumSegments = m_Workers.size() / tasks;
+	if ( ( maximumSegments > 1 ) && ( MediaInfo::Source::File == item.Info.GetSource() ) ) {
+		analysis->EnableParallel( [ &item, this ] () { return OpenDecoder( item ); }, [ &worker, this ] ( const std::vector<std::function<void()>>& subtasks ) { RunSubtasks( worker, subtasks ); }, maximumSegments );
+	}
+	const bool analysed = analysis->Analyse( [ this ] () { return CanContinue(); } ) && analysis->GetResult().Gain.has_value();
+
+	if ( analysed ) {
+		MediaInfo previousMediaInfo( task.Item.Info );
+		analysis->UpdateMediaInfo( item.Info );
+		m_Library.UpdateMediaTags( previousMediaInfo, item.Info );
+		m_Library.UpdateTrackAnalysis( previousMediaInfo, item.Info );
+
+		for ( const auto& duplicate : item.Duplicates ) {
+			previousMediaInfo.SetFilename( duplicate );
+			MediaInfo updatedMediaInfo( item.Info );
+			updatedMediaInfo.SetFilename( duplicate );
+			m_Library.UpdateMediaTags( previousMediaInfo, updatedMediaInfo );
+			m_Library.UpdateTrackAnalysis( previousMediaInfo, updatedMediaInfo );
+		}
+	}
+
+	bool finaliseAlbum = false;
+	{
+		std::lock_guard<std::mutex> lock( task.Album->Mutex );
+		if ( analysed ) {
+			task.Album->ProcessedItems.push_back( item );
+			task.Album->Analyses.push_back( analysis );
+		}
+		finaliseAlbum = ( 0 == --task.Album->Remaining );
+	}
+	if ( finaliseAlbum ) {
+		FinaliseAlbum( *task.Album );
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( m_ThroughputMutex );
+		if ( analysed ) {
+			++m_Throughput.Tracks;
+			m_Throughput.TrackSeconds += item.Info.GetDuration();
+			if ( MediaInfo::Source::File == item.Info.GetSource() ) {
+				DecodeThroughput& decodeThroughput = m_DecodeThroughput[ GetFileExtension( item.Info.GetFilename() ) ];
+				++decodeThroughput.Tracks;
+				decodeThroughput.TrackSeconds += item.Info.GetDuration();
+				decodeThroughput.DecodeSeconds += analysis->GetDecodeSeconds();
 			}
+		}
+		if ( 0 == --m_TasksInProgress ) {
+			m_Throughput.ElapsedSeconds += std::chrono::duration<double>( Clock::now() - m_BusyStart ).count();
+		}
+	}
+
+	--m_PendingCount;
+}
+
+void GainCalculator::FinaliseAlbum( AlbumTask& album )
+{
+	const std::wstring& albumName = std::get< 2 >( album.Key );
+	if ( CanContinue() && !albumName.empty() && !album.Analyses.empty() ) {
+		// Update album gain for all items.
+		std::vector<ebur128_state*> r128States;
+		r128States.reserve( album.Analyses.size() );
+		for ( const auto& analysis : album.Analyses ) {
+			const std::vector<ebur128_state*> states = analysis->GetLoudnessStates();
+			r128States.insert( r128States.end(), states.begin(), states.end() );
+		}
+		double loudness = 0;
+		int errorState = ebur128_loudness_global_multiple( &r128States[ 0 ], r128States.size(), &loudness );
+		if ( EBUR128_SUCCESS == errorState ) {
+			const float albumGain = LOUDNESS_REFERENCE - static_cast<float>( loudness );
+			for ( auto item = album.ProcessedItems.begin(); ( album.ProcessedItems.end() != item ) && CanContinue(); item++ ) {
+				if ( albumGain != item->Info.GetGainAlbum() ) {
+					MediaInfo previousMediaInfo( item->Info );
+					item->Info.SetGainAlbum( albumGain );
+					m_Library.UpdateMediaTags( previousMediaInfo, item->Info );
 
-			const std::wstring& album = std::get< 2 >( albumKey );
-			if ( canContinue() && !album.empty() ) {
-				// Update album gain for all items.
-				double loudness = 0;
-				int errorState = ebur128_loudness_global_multiple( &r128States[ 0 ], r128States.size(), &loudness );
-				if ( EBUR128_SUCCESS == errorState ) {
-					const float albumGain = LOUDNESS_REFERENCE - static_cast<float>( loudness );
-					for ( auto item = processedItems.begin(); ( processedItems.end() != item ) && canContinue(); item++ ) {
-						if ( albumGain != item->Info.GetGainAlbum() ) {
-							MediaInfo previousMediaInfo( item->Info );
-							item->Info.SetGainAlbum( albumGain );
-							m_Library.UpdateMediaTags( previousMediaInfo, item->Info );
-
-							for ( const auto& duplicate : item->Duplicates ) {
-								previousMediaInfo.SetFilename( duplicate );
-								MediaInfo updatedMediaInfo( item->Info );
-								updatedMediaInfo.SetFilename( duplicate );
-								m_Library.UpdateMediaTags( previousMediaInfo, updatedMediaInfo );
-							}
-						}
+					for ( const auto& duplicate : item->Duplicates ) {
+						previousMediaInfo.SetFilename( duplicate );
+						MediaInfo updatedMediaInfo( item->Info );
+						updatedMediaInfo.SetFilename( duplicate );
+						m_Library.UpdateMediaTags( previousMediaInfo, updatedMediaInfo );
 					}
 				}
 			}
-
-			for ( const auto& state : r128States ) {
-				ebur128_state* r128State = state;
-				ebur128_destroy( &r128State );
-			}
 		}
 	}
+	album.Analyses.clear();
+}
+
+bool GainCalculator::CanContinue() const
+{
+	return ( WAIT_OBJECT_0 != WaitForSingleObject( m_StopEvent, 0 ) );
 }
 
 int GainCalculator::GetPendingCount() const
@@ -225,6 +405,51 @@ int GainCalculator::GetPendingCount() const
 	return m_PendingCount.load();
 }
 
+GainCalculator::Throughput GainCalculator::GetThroughput() const
+{
+	std::lock_guard<std::mutex> lock( m_ThroughputMutex );
+	Throughput throughput = m_Throughput;
+	if ( m_TasksInProgress > 0 ) {
+		throughput.ElapsedSeconds += std::chrono::duration<double>( Clock::now() - m_BusyStart ).count();
+	}
+	return throughput;
+}
+
+GainCalculator::DecodeThroughputMap GainCalculator::GetDecodeThroughput() const
+{
+	std::lock_guard<std::mutex> lock( m_ThroughputMutex );
+	return m_DecodeThroughput;
+}
+
+bool GainCalculator::WriteMetrics( const std::wstring& filename ) const
+{
+	bool success = false;
+	std::ofstream stream( filename, std::ios::out | std::ios::app );
+	if ( stream.is_open() ) {
+		const Throughput throughput = GetThroughput();
+		stream << std::fixed << std::setprecision( 3 );
+		stream << std::endl;
+		stream << "Gain calculation,Value" << std::endl;
+		stream << "Tracks," << throughput.Tracks << std::endl;
+		stream << "Track duration (s)," << throughput.TrackSeconds << std::endl;
+		stream << "Elapsed (s)," << throughput.ElapsedSeconds << std::endl;
+		stream << "Tracks per second," << throughput.GetTracksPerSecond() << std::endl;
+		stream << "Realtime factor," << throughput.GetRealtimeFactor() << std::endl;
+
+		const DecodeThroughputMap decodeThroughput = GetDecodeThroughput();
+		if ( !decodeThroughput.empty() ) {
+			stream << std::endl;
+			stream << "Decoding,Tracks,Track duration (s),Decode time (s),Realtime factor" << std::endl;
+			for ( const auto& [ extension, formatThroughput ] : decodeThroughput ) {
+				stream << WideStringToUTF8( extension ) << "," << formatThroughput.Tracks << "," << formatThroughput.TrackSeconds << "," << formatThroughput.DecodeSeconds << "," << formatThroughput.GetRealtimeFactor() << std::endl;
+			}
+		}
+		success = stream.good();
+		stream.close();
+	}
+	return success;
+}
+
 Decoder::Ptr GainCalculator::OpenDecoder( const Playlist::Item& item ) const
 {
 	Decoder::Ptr decoder;
@@ -240,15 +465,3 @@ Decoder::Ptr GainCalculator::OpenDecoder( const Playlist::Item& item ) const
 	}
 	return decoder;
 }
-
-std::optional<float> GainCalculator::CalculateTrackGain( const std::wstring& filename, const Handlers& handlers, Decoder::CanContinue canContinue )
-{
-	std::optional<float> gain;
-	if ( ( nullptr != canContinue ) && !IsURL( filename ) ) {
-		const Decoder::Ptr decoder = handlers.OpenDecoder( filename );
-		if ( decoder ) {
-			gain = decoder->CalculateTrackGain( canContinue );
-		}
-	}
-	return gain;
-}
@@ -5,9 +5,18 @@
 #include "Decoder.h"
 
 #include <atomic>
+#include <chrono>
+#include <deque>
 #include <functional>
+#include <map>
+#include <memory>
 #include <tuple>
+#include <vector>
 
+class TrackAnalysis;
+
+// Calculates track and album gain values, using a persistent pool of worker threads.
+// Tracks from several albums can be analysed at once, with idle workers taking tasks queued for busy ones.
 class GainCalculator
 {
 public:
@@ -17,12 +26,41 @@ public:
 
 	virtual ~GainCalculator();
 
-	// Calculates track gain for a single file.
-	// 'filename' - media filename.
-	// 'handlers' - media handlers.
-	// 'canContinue' - callback which returns whether the calculation can continue.
-	// Returns the track gain, or nullopt if the calculation failed or was cancelled.
-	static std::optional<float> CalculateTrackGain( const std::wstring& filename, const Handlers& handlers, Decoder::CanContinue canContinue );
+	// Gain calculation throughput.
+	struct Throughput {
+		// Returns the number of tracks analysed per second.
+		double GetTracksPerSecond() const;
+
+		// Returns the realtime factor (the duration of the tracks analysed relative to the time taken).
+		double GetRealtimeFactor() const;
+
+		// Number of tracks analysed.
+		long long Tracks = 0;
+
+		// Total duration of the tracks analysed, in seconds.
+		double TrackSeconds = 0;
+
+		// Time during which gain calculations were in progress, in seconds.
+		double ElapsedSeconds = 0;
+	};
+
+	// Decoding throughput for a file format.
+	struct DecodeThroughput {
+		// Returns the realtime factor (the duration of the tracks decoded relative to the time spent decoding).
+		double GetRealtimeFactor() const;
+
+		// Number of tracks decoded.
+		long long Tracks = 0;
+
+		// Total duration of the tracks decoded, in seconds.
+		double TrackSeconds = 0;
+
+		// Time spent decoding, in seconds (summed over all worker threads).
+		double DecodeSeconds = 0;
+	};
+
+	// Maps a file extension to the decoding throughput for that format.
+	typedef std::map<std::wstring, DecodeThroughput> DecodeThroughputMap;
 
 	// Calculates gain values for the playlist 'items'.
 	void Calculate( const Playlist::ItemList& items );
@@ -33,6 +71,16 @@ public:
 	// Returns the number of gain calculations pending.
 	int GetPendingCount() const;
 
+	// Returns the gain calculation throughput.
+	Throughput GetThroughput() const;
+
+	// Returns the decoding throughput for each file format.
+	DecodeThroughputMap GetDecodeThroughput() const;
+
+	// Appends the gain calculation and decoding throughput to the metrics report in 'filename'.
+	// Returns whether the throughput was written.
+	bool WriteMetrics( const std::wstring& filename ) const;
+
 private:
 	// Gain album key.
 	typedef std::tuple<long,long,std::wstring> AlbumKey;
@@ -40,15 +88,96 @@ private:
 	// Associates an album key with a list of items.
 	typedef std::map<AlbumKey,Playlist::ItemList> AlbumMap;
 
-	// Calculation thread procedure.
+	// An album being calculated, whose album gain is finalised once all of its tracks have been analysed.
+	struct AlbumTask {
+		// Album key.
+		AlbumKey Key;
+
+		// Number of tracks still to be analysed.
+		size_t Remaining = 0;
+
+		// Tracks which were successfully analysed.
+		Playlist::ItemList ProcessedItems;
+
+		// Analyses of the tracks which were successfully analysed.
+		std::vector<std::shared_ptr<TrackAnalysis>> Analyses;
+
+		// Album mutex.
+		std::mutex Mutex;
+	};
+
+	// A track analysis task.
+	struct TrackTask {
+		// Playlist item.
+		Playlist::Item Item;
+
+		// Album to which the track belongs.
+		std::shared_ptr<AlbumTask> Album;
+
+		// Part of a track analysis (such as one segment of a long track), which is run instead of analysing the item when set.
+		std::function<void()> Subtask;
+	};
+
+	// A worker thread, with its own task queue.
+	struct Worker {
+		// Gain calculator.
+		GainCalculator* Calculator = nullptr;
+
+		// Worker index.
+		size_t Index = 0;
+
+		// Worker thread.
+		HANDLE Thread = NULL;
+
+		// Task queue.
+		std::deque<TrackTask> Tasks;
+
+		// Task queue mutex.
+		std::mutex Mutex;
+	};
+
+	// Throughput clock.
+	using Clock = std::chrono::steady_clock;
+
+	// Dispatch thread procedure.
 	static DWORD WINAPI CalcThreadProc( LPVOID lpParam );
 
-	// Calculation thread handler.
+	// Worker thread procedure.
+	static DWORD WINAPI WorkerThreadProc( LPVOID lpParam );
+
+	// Dispatch thread handler, which passes pending albums to the worker threads.
 	void Handler();
 
+	// Worker thread handler.
+	// 'worker' - the worker.
+	void WorkerHandler( Worker& worker );
+
 	// Adds an 'item' to the queue of pending tasks.
 	void AddPending( const Playlist::Item& item );
 
+	// Passes the 'items' of an album, with 'albumKey', to the worker threads.
+	void Dispatch( const AlbumKey& albumKey, const Playlist::ItemList& items );
+
+	// Takes the next task for a 'worker', from its own queue or else from the back of another worker's queue.
+	// 'task' - out, the task.
+	// Returns whether a task was taken.
+	bool TakeTask( Worker& worker, TrackTask& task );
+
+	// Runs a 'task' on a 'worker' thread.
+	void RunTask( Worker& worker, const TrackTask& task );
+
+	// Analyses the track for a 'task' on a 'worker' thread.
+	void AnalyseTrack( Worker& worker, const TrackTask& task );
+
+	// Adds the 'subtasks' of a track analysis to the front of a 'worker' queue, and runs queued tasks until all of the subtasks have completed.
+	void RunSubtasks( Worker& worker, const std::vector<std::function<void()>>& subtasks );
+
+	// Calculates the album gain for an 'album', once all of its tracks have been analysed.
+	void FinaliseAlbum( AlbumTask& album );
+
+	// Returns whether calculations can continue.
+	bool CanContinue() const;
+
 	// Returns a decoder for the 'item', or nullptr if a decoder could not be opened.
 	Decoder::Ptr OpenDecoder( const Playlist::Item& item ) const;
 
@@ -64,15 +193,48 @@ private:
 	// The mutex for the task queue.
 	std::mutex m_Mutex;
 
-	// Handle to stop the calculation thread.
+	// Handle to stop the calculation threads.
 	HANDLE m_StopEvent;
 
-	// Handle to wake the calculation thread.
+	// Handle to wake the dispatch thread.
 	HANDLE m_WakeEvent;
 
-	// Calculation thread.
+	// Handle which is signalled when a worker takes a task.
+	HANDLE m_TaskTakenEvent;
+
+	// Semaphore counting the tasks in the worker queues.
+	HANDLE m_TaskSemaphore;
+
+	// Dispatch thread.
 	HANDLE m_Thread;
 
+	// Worker threads.
+	std::vector<std::unique_ptr<Worker>> m_Workers;
+
+	// Worker to which the next task is passed.
+	size_t m_NextWorker;
+
+	// Number of tasks in the worker queues.
+	std::atomic<long> m_QueuedTasks;
+
+	// Number of tasks being analysed.
+	std::atomic<long> m_ActiveTasks;
+
 	// Number of gain calculations pending.
 	std::atomic<int> m_PendingCount;
+
+	// Gain calculation throughput.
+	Throughput m_Throughput;
+
+	// Decoding throughput for each file format.
+	DecodeThroughputMap m_DecodeThroughput;
+
+	// Time at which the current period of calculation started.
+	Clock::time_point m_BusyStart;
+
+	// Number of tasks dispatched but not yet completed.
+	long m_TasksInProgress;
+
+	// Throughput mutex.
+	mutable std::mutex m_ThroughputMutex;
 };
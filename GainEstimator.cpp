@@ -0,0 +1,148 @@
+#include "GainEstimator.h"
+
+#include "MediaInfo.h"
+#include "TrackAnalysis.h"
+
+#include <algorithm>
+#include <cmath>
+#include <list>
+#include <thread>
+
+// Number of samples to decode at a time.
+static const long s_BlockSize = 4096;
+
+// Number of windows measured across the track.
+static const size_t s_WindowCount = 4;
+
+// Maximum window length, in seconds.
+static const float s_WindowLength = 3.0f;
+
+// Spread of window loudness values, in LU, which halves the confidence placed in the windows agreeing with each other.
+static const double s_LoudnessSpreadTolerance = 6.0;
+
+GainEstimator::GainEstimator( const Decoder::Ptr decoder, OpenDecoder openDecoder ) :
+	m_Decoder( decoder ),
+	m_OpenDecoder( openDecoder ),
+	m_Channels( decoder ? decoder->GetChannels() : 0 ),
+	m_SampleRate( decoder ? decoder->GetSampleRate() : 0 ),
+	m_Windows()
+{
+}
+
+GainEstimator::~GainEstimator()
+{
+	for ( auto& window : m_Windows ) {
+		if ( nullptr != window.LoudnessState ) {
+			ebur128_destroy( &window.LoudnessState );
+		}
+	}
+}
+
+GainEstimator::Estimate GainEstimator::Calculate( const float secondsLimit )
+{
+	Estimate estimate;
+	if ( m_Decoder && ( m_Channels > 0 ) && ( m_SampleRate > 0 ) && m_Windows.empty() ) {
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<float>( secondsLimit ) );
+
+		// Windows are centred within equal parts of the track, so that quiet and loud passages anywhere in the track are represented.
+		// A track of unknown duration can only be measured from the start.
+		const float duration = m_Decoder->GetDuration();
+		const size_t windowCount = ( duration > 0 ) ? s_WindowCount : 1;
+		const float windowLength = ( duration > 0 ) ? std::min( s_WindowLength, duration / windowCount ) : s_WindowLength;
+		m_Windows.resize( windowCount );
+		for ( size_t index = 0; index < windowCount; index++ ) {
+			Window& window = m_Windows[ index ];
+			window.Start = ( duration > 0 ) ? ( duration * ( 2 * index + 1 ) / ( 2 * windowCount ) - windowLength / 2 ) : 0;
+			window.LoudnessState = ebur128_init( static_cast<unsigned int>( m_Channels ), static_cast<unsigned long>( m_SampleRate ), EBUR128_MODE_I );
+		}
+		m_Windows.front().Stream = m_Decoder;
+		m_Decoder.reset();
+
+		const long long length = static_cast<long long>( windowLength * m_SampleRate );
+		if ( m_OpenDecoder && ( m_Windows.size() > 1 ) ) {
+			std::list<std::thread> threads;
+			for ( auto& window : m_Windows ) {
+				threads.push_back( std::thread( [ this, &window, length, deadline ] ()
+				{
+					MeasureWindow( window, length, deadline );
+				} ) );
+			}
+			for ( auto& thread : threads ) {
+				thread.join();
+			}
+		} else {
+			// Without additional decoders, the windows are measured in turn using the one decoder.
+			const Decoder::Ptr decoder = m_Windows.front().Stream;
+			for ( auto& window : m_Windows ) {
+				window.Stream = decoder;
+				MeasureWindow( window, length, deadline );
+			}
+		}
+
+		estimate = CalculateEstimate( duration );
+	}
+	m_Decoder.reset();
+	return estimate;
+}
+
+void GainEstimator::MeasureWindow( Window& window, const long long length, const std::chrono::steady_clock::time_point deadline )
+{
+	if ( !window.Stream && m_OpenDecoder ) {
+		window.Stream = m_OpenDecoder();
+		if ( window.Stream && ( ( window.Stream->GetChannels() != m_Channels ) || ( window.Stream->GetSampleRate() != m_SampleRate ) ) ) {
+			window.Stream.reset();
+		}
+	}
+	if ( window.Stream && ( nullptr != window.LoudnessState ) ) {
+		if ( window.Start > 0 ) {
+			window.Stream->Seek( window.Start );
+		}
+		std::vector<float> buffer( s_BlockSize * m_Channels );
+		bool continueMeasurement = ( std::chrono::steady_clock::now() < deadline );
+		while ( continueMeasurement && ( window.Measured < length ) ) {
+			const long samplesToRead = static_cast<long>( std::min<long long>( s_BlockSize, length - window.Measured ) );
+			Decoder::FrameView view;
+			const long sampleCount = window.Stream->ReadFrame( view, samplesToRead );
+			if ( sampleCount > 0 ) {
+				continueMeasurement = TrackAnalysis::AddLoudnessFrames( window.LoudnessState, view, buffer ) && ( std::chrono::steady_clock::now() < deadline );
+				window.Measured += sampleCount;
+			} else {
+				continueMeasurement = false;
+			}
+		}
+	}
+	window.Stream.reset();
+}
+
+GainEstimator::Estimate GainEstimator::CalculateEstimate( const float duration ) const
+{
+	Estimate estimate;
+	std::vector<ebur128_state*> states;
+	double minimumLoudness = 0;
+	double maximumLoudness = 0;
+	long long measured = 0;
+	for ( const auto& window : m_Windows ) {
+		double loudness = 0;
+		if ( ( nullptr != window.LoudnessState ) && ( EBUR128_SUCCESS == ebur128_loudness_global( window.LoudnessState, &loudness ) ) && std::isfinite( loudness ) ) {
+			if ( states.empty() ) {
+				minimumLoudness = maximumLoudness = loudness;
+			} else {
+				minimumLoudness = std::min( minimumLoudness, loudness );
+				maximumLoudness = std::max( maximumLoudness, loudness );
+			}
+			states.push_back( window.LoudnessState );
+			measured += window.Measured;
+		}
+	}
+
+	double loudness = 0;
+	if ( !states.empty() && ( EBUR128_SUCCESS == ebur128_loudness_global_multiple( states.data(), states.size(), &loudness ) ) && std::isfinite( loudness ) ) {
+		estimate.Gain = LOUDNESS_REFERENCE - static_cast<float>( loudness );
+
+		// Confidence increases with the proportion of the track that was measured, and with the number of windows which agree with each other.
+		const float coverage = ( duration > 0 ) ? std::min( 1.0f, static_cast<float>( measured ) / m_SampleRate / duration ) : 0;
+		const float agreement = static_cast<float>( states.size() ) / m_Windows.size() / static_cast<float>( 1.0 + ( maximumLoudness - minimumLoudness ) / s_LoudnessSpreadTolerance );
+		estimate.Confidence = std::clamp( coverage + ( 1.0f - coverage ) * agreement, 0.0f, 1.0f );
+	}
+	return estimate;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Decoder.h"
+
+#include "ebur128.h"
+
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <vector>
+
+// Estimates the track gain within a time limit, by measuring several short windows spread across the track, each decoded in parallel.
+class GainEstimator
+{
+public:
+	// A callback which opens a new decoder for the track, returning nullptr if the decoder could not be opened.
+	using OpenDecoder = std::function<Decoder::Ptr()>;
+
+	// 'decoder' - decoder from which to read the track (positioned at the start of the track).
+	// 'openDecoder' - callback which opens a decoder for each additional window (or nullptr to only use 'decoder').
+	GainEstimator( const Decoder::Ptr decoder, OpenDecoder openDecoder );
+
+	virtual ~GainEstimator();
+
+	// Gain estimate.
+	struct Estimate {
+		// Track gain, in dB.
+		std::optional<float> Gain;
+
+		// Confidence in the estimate, from 0 (none) to 1 (the whole track was measured).
+		float Confidence = 0;
+	};
+
+	// Calculates the estimate, releasing the decoder(s) when done.
+	// 'secondsLimit' - number of seconds to devote to calculating the estimate.
+	Estimate Calculate( const float secondsLimit );
+
+private:
+	// A window of the track, which is decoded and measured independently.
+	struct Window {
+		// Decoder.
+		Decoder::Ptr Stream;
+
+		// Loudness measurement state.
+		ebur128_state* LoudnessState = nullptr;
+
+		// Position at which the window starts, in seconds.
+		float Start = 0;
+
+		// Number of samples measured.
+		long long Measured = 0;
+	};
+
+	// Decodes and measures a 'window'.
+	// 'length' - window length, in samples.
+	// 'deadline' - time at which measurement must stop.
+	void MeasureWindow( Window& window, const long long length, const std::chrono::steady_clock::time_point deadline );
+
+	// Calculates the estimate from the measured windows, for a track of 'duration' seconds.
+	Estimate CalculateEstimate( const float duration ) const;
+
+	// Decoder.
+	Decoder::Ptr m_Decoder;
+
+	// Callback which opens a decoder for each additional window.
+	OpenDecoder m_OpenDecoder;
+
+	// Number of channels.
+	const long m_Channels;
+
+	// Sample rate.
+	const long m_SampleRate;
+
+	// Track windows.
+	std::vector<Window> m_Windows;
+};
@@ -8,6 +8,7 @@
 #include <list>
 #include <map>
 #include <memory>
+#include <optional>
 #include <set>
 #include <string>
 
@@ -31,6 +32,27 @@ public:
 	// A list of handlers.
 	typedef std::list<Ptr> List;
 
+	// Stream properties, read from the file headers.
+	struct StreamInfo {
+		// Duration, in seconds.
+		float Duration = 0;
+
+		// Sample rate.
+		long SampleRate = 0;
+
+		// Number of channels.
+		long Channels = 0;
+
+		// Bits per sample (if relevant).
+		std::optional<long> BitsPerSample;
+
+		// Bitrate in kbps (if relevant).
+		std::optional<float> Bitrate;
+
+		// Hash of the decoded audio content, as recorded in the file headers (e.g. the FLAC STREAMINFO MD5), or an empty string if not recorded.
+		std::string ContentHash;
+	};
+
 	// Returns a description of the handler.
 	virtual std::wstring GetDescription() const = 0;
 
@@ -44,7 +66,16 @@ public:
 	virtual bool SetTags( const std::wstring& filename, const Tags& tags ) const = 0;
 
 	// Returns a decoder for 'filename', or nullptr if a decoder cannot be created.
-	virtual Decoder::Ptr OpenDecoder( const std::wstring& filename ) const = 0;
+	// 'readAhead' - whether the decoder should read ahead of the file position.
+	virtual Decoder::Ptr OpenDecoder( const std::wstring& filename, const bool readAhead ) const = 0;
+
+	// Reads the stream properties of 'filename' from the file headers only, without opening a decoder.
+	// 'info' - out, stream properties.
+	// Returns whether the stream properties were read (if not, a decoder should be opened to obtain them instead).
+	virtual bool Probe( const std::wstring& /*filename*/, StreamInfo& /*info*/ ) const
+	{
+		return false;
+	}
 
 	// Returns an encoder, or nullptr if an encoder cannot be created.
 	virtual Encoder::Ptr OpenEncoder() const = 0;
@@ -131,7 +131,7 @@ bool HandlerBass::SetTags( const std::wstring& filename, const Tags& tags ) cons
 	return success;
 }
 
-Decoder::Ptr HandlerBass::OpenDecoder( const std::wstring& filename ) const
+Decoder::Ptr HandlerBass::OpenDecoder( const std::wstring& filename, const bool /*readAhead*/ ) const
 {
 	DecoderBass* streamBass = nullptr;
 	try {
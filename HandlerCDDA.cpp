@@ -40,7 +40,7 @@ bool HandlerCDDA::SetTags( const std::wstring& /*filename*/, const Tags& /*tags*
 	return false;
 }
 
-Decoder::Ptr HandlerCDDA::OpenDecoder( const std::wstring& filename ) const
+Decoder::Ptr HandlerCDDA::OpenDecoder( const std::wstring& filename, const bool /*readAhead*/ ) const
 {
 	DecoderCDDA* decoderCDDA = nullptr;
 	try {
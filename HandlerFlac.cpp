@@ -2,11 +2,16 @@
 
 #include "DecoderFlac.h"
 #include "EncoderFlac.h"
+#include "FileSource.h"
 
 #include <share/windows_unicode_filenames.h>
 
 #include "Utility.h"
 
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
 // Amount of padding to add when writing out FLAC files that don't contain any padding.
 static const unsigned int s_PaddingSize = 1024;
 
@@ -312,11 +317,11 @@ bool HandlerFlac::SetTags( const std::wstring& filename, const Tags& tags ) cons
 	return success;
 }
 
-Decoder::Ptr HandlerFlac::OpenDecoder( const std::wstring& filename ) const
+Decoder::Ptr HandlerFlac::OpenDecoder( const std::wstring& filename, const bool readAhead ) const
 {
 	DecoderFlac* streamFlac = nullptr;
 	try {
-		streamFlac = new DecoderFlac( filename );
+		streamFlac = new DecoderFlac( filename, readAhead );
 	} catch ( const std::runtime_error& ) {
 
 	}
@@ -324,6 +329,63 @@ Decoder::Ptr HandlerFlac::OpenDecoder( const std::wstring& filename ) const
 	return stream;
 }
 
+bool HandlerFlac::Probe( const std::wstring& filename, StreamInfo& info ) const
+{
+	bool success = false;
+	if ( const FileSource::Ptr source = FileSource::Open( filename, false /*readAhead*/ ); source ) {
+		const long long filesize = source->GetSize();
+		unsigned char header[ 4 ] = {};
+		if ( ( 4 == source->Read( header, 4 ) ) && ( 'f' == header[ 0 ] ) && ( 'L' == header[ 1 ] ) && ( 'a' == header[ 2 ] ) && ( 'C' == header[ 3 ] ) ) {
+			// Walk the metadata blocks, reading the STREAMINFO block and locating the start of the audio frames.
+			unsigned long long totalSamples = 0;
+			bool good = ( 4 == source->Read( header, 4 ) );
+			while ( good ) {
+				const long long position = source->GetPosition();
+				const unsigned long blockSize = ( header[ 1 ] << 16 ) | ( header[ 2 ] << 8 ) | header[ 3 ];
+				if ( ( position + blockSize ) >= filesize ) {
+					break;
+				}
+				const unsigned char blockType = header[ 0 ] & 0x7f;
+				if ( ( 0 == blockType ) && ( blockSize >= 18 ) ) {
+					unsigned char streamInfo[ 34 ] = {};
+					const size_t streamInfoSize = ( blockSize >= 34 ) ? 34 : 18;
+					if ( streamInfoSize == source->Read( streamInfo, streamInfoSize ) ) {
+						info.SampleRate = ( streamInfo[ 10 ] << 12 ) | ( streamInfo[ 11 ] << 4 ) | ( streamInfo[ 12 ] >> 4 );
+						info.Channels = ( ( streamInfo[ 12 ] >> 1 ) & 0x7 ) + 1;
+						info.BitsPerSample = ( ( ( streamInfo[ 12 ] & 0x1 ) << 4 ) | ( streamInfo[ 13 ] >> 4 ) ) + 1;
+						totalSamples = ( static_cast<unsigned long long>( streamInfo[ 13 ] & 0xf ) << 32 ) | ( static_cast<unsigned long long>( streamInfo[ 14 ] ) << 24 ) |
+							( streamInfo[ 15 ] << 16 ) | ( streamInfo[ 16 ] << 8 ) | streamInfo[ 17 ];
+
+						// The MD5 signature of the unencoded audio data is all zeros if it was not calculated by the encoder.
+						const unsigned char* md5 = streamInfo + 18;
+						if ( ( 34 == streamInfoSize ) && std::any_of( md5, md5 + 16, [] ( const unsigned char value ) { return 0 != value; } ) ) {
+							std::ostringstream stream;
+							stream << std::hex << std::setfill( '0' );
+							for ( int index = 0; index < 16; index++ ) {
+								stream << std::setw( 2 ) << static_cast<int>( md5[ index ] );
+							}
+							info.ContentHash = stream.str();
+						}
+					}
+				}
+				const bool lastBlock = header[ 0 ] & 0x80;
+				if ( lastBlock ) {
+					// The duration is unknown when the total number of samples is not recorded, so the decoder is left to determine it.
+					if ( ( info.SampleRate > 0 ) && ( totalSamples > 0 ) ) {
+						info.Duration = static_cast<float>( totalSamples ) / info.SampleRate;
+						const long long streamsize = filesize - position - blockSize;
+						info.Bitrate = ( streamsize * 8 ) / ( info.Duration * 1000 );
+						success = true;
+					}
+					break;
+				}
+				good = source->Seek( position + blockSize ) && ( 4 == source->Read( header, 4 ) );
+			}
+		}
+	}
+	return success;
+}
+
 Encoder::Ptr HandlerFlac::OpenEncoder() const
 {
 	Encoder::Ptr encoder( new EncoderFlac() );
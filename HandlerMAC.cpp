@@ -1,6 +1,9 @@
 #include "HandlerMAC.h"
 
 #include "DecoderMAC.h"
+#include "FileSource.h"
+
+#include <cmath>
 
 // Supported APE tags.
 static const std::map<std::wstring,Tag> s_SupportedAPETags = {
@@ -15,6 +18,18 @@ static const std::map<std::wstring,Tag> s_SupportedAPETags = {
 	{ L"DATE",									Tag::Year }
 };
 
+// Returns the little endian 16-bit value at 'data'.
+static uint16_t ReadUInt16( const unsigned char* data )
+{
+	return static_cast<uint16_t>( data[ 0 ] | ( data[ 1 ] << 8 ) );
+}
+
+// Returns the little endian 32-bit value at 'data'.
+static uint32_t ReadUInt32( const unsigned char* data )
+{
+	return data[ 0 ] | ( data[ 1 ] << 8 ) | ( data[ 2 ] << 16 ) | ( static_cast<uint32_t>( data[ 3 ] ) << 24 );
+}
+
 HandlerMAC::HandlerMAC()
 {
 }
@@ -95,11 +110,11 @@ bool HandlerMAC::SetTags( const std::wstring& filename, const Tags& tags ) const
 	return success;
 }
 
-Decoder::Ptr HandlerMAC::OpenDecoder( const std::wstring& filename ) const
+Decoder::Ptr HandlerMAC::OpenDecoder( const std::wstring& filename, const bool readAhead ) const
 {
 	DecoderMAC* decoderMAC = nullptr;
 	try {
-		decoderMAC = new DecoderMAC( filename );
+		decoderMAC = new DecoderMAC( filename, readAhead );
 	} catch ( const std::runtime_error& ) {
 
 	}
@@ -107,6 +122,41 @@ Decoder::Ptr HandlerMAC::OpenDecoder( const std::wstring& filename ) const
 	return stream;
 }
 
+bool HandlerMAC::Probe( const std::wstring& filename, StreamInfo& info ) const
+{
+	bool success = false;
+	if ( const FileSource::Ptr source = FileSource::Open( filename, false /*readAhead*/ ); source ) {
+		// Only files with a descriptor (version 3.98 onwards) are read, older files are left to the decoder.
+		unsigned char descriptor[ 12 ] = {};
+		if ( ( 12 == source->Read( descriptor, 12 ) ) && ( 'M' == descriptor[ 0 ] ) && ( 'A' == descriptor[ 1 ] ) && ( 'C' == descriptor[ 2 ] ) && ( ' ' == descriptor[ 3 ] ) &&
+				( ReadUInt16( descriptor + 4 ) >= 3980 ) ) {
+			const uint32_t descriptorBytes = ReadUInt32( descriptor + 8 );
+			unsigned char header[ 24 ] = {};
+			if ( source->Seek( descriptorBytes ) && ( 24 == source->Read( header, 24 ) ) ) {
+				const uint32_t blocksPerFrame = ReadUInt32( header + 4 );
+				const uint32_t finalFrameBlocks = ReadUInt32( header + 8 );
+				const uint32_t totalFrames = ReadUInt32( header + 12 );
+				const uint16_t bps = ReadUInt16( header + 16 );
+				const uint16_t channels = ReadUInt16( header + 18 );
+				const uint32_t sampleRate = ReadUInt32( header + 20 );
+				if ( ( totalFrames > 0 ) && ( channels > 0 ) && ( sampleRate > 0 ) && ( ( 8 == bps ) || ( 16 == bps ) || ( 24 == bps ) || ( 32 == bps ) ) ) {
+					const long long totalBlocks = static_cast<long long>( totalFrames - 1 ) * blocksPerFrame + finalFrameBlocks;
+					const long long lengthMS = static_cast<long long>( std::floor( static_cast<double>( totalBlocks ) * 1000 / sampleRate ) );
+					if ( lengthMS > 0 ) {
+						info.BitsPerSample = bps;
+						info.Channels = channels;
+						info.SampleRate = static_cast<long>( sampleRate );
+						info.Duration = static_cast<float>( lengthMS ) / 1000;
+						info.Bitrate = static_cast<float>( source->GetSize() * 8 / lengthMS );
+						success = true;
+					}
+				}
+			}
+		}
+	}
+	return success;
+}
+
 Encoder::Ptr HandlerMAC::OpenEncoder() const
 {
 	return nullptr;
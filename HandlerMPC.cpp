@@ -1,6 +1,49 @@
 #include "HandlerMPC.h"
 
 #include "DecoderMPC.h"
+#include "FileSource.h"
+
+#include <array>
+#include <vector>
+
+// SV8 sample rates, indexed by the sample frequency field of the stream header.
+static const std::array<long,4> s_SampleRates = { 44100, 48000, 37800, 32000 };
+
+// Maximum size of the stream header packet.
+static const unsigned long long s_MaximumHeaderSize = 0x100;
+
+// Reads a variable length SV8 value from 'source'.
+// 'value' - out, the value.
+// 'length' - out, number of bytes read.
+// Returns whether the value was read.
+static bool ReadSize( FileSource& source, unsigned long long& value, unsigned long long& length )
+{
+	value = 0;
+	length = 0;
+	unsigned char byte = 0x80;
+	while ( ( byte & 0x80 ) && ( length < 8 ) && ( 1 == source.Read( &byte, 1 ) ) ) {
+		value = ( value << 7 ) | ( byte & 0x7f );
+		++length;
+	}
+	const bool success = !( byte & 0x80 );
+	return success;
+}
+
+// Reads a variable length SV8 value from 'data'.
+// 'offset' - in, the offset of the value, out, the offset following the value.
+// 'value' - out, the value.
+// Returns whether the value was read.
+static bool ReadSize( const std::vector<unsigned char>& data, size_t& offset, unsigned long long& value )
+{
+	value = 0;
+	unsigned char byte = 0x80;
+	for ( size_t length = 0; ( byte & 0x80 ) && ( length < 8 ) && ( offset < data.size() ); length++ ) {
+		byte = data[ offset++ ];
+		value = ( value << 7 ) | ( byte & 0x7f );
+	}
+	const bool success = !( byte & 0x80 );
+	return success;
+}
 
 HandlerMPC::HandlerMPC()
 {
@@ -32,11 +75,11 @@ bool HandlerMPC::SetTags( const std::wstring& /*filename*/, const Tags& /*tags*/
 	return false;
 }
 
-Decoder::Ptr HandlerMPC::OpenDecoder( const std::wstring& filename ) const
+Decoder::Ptr HandlerMPC::OpenDecoder( const std::wstring& filename, const bool readAhead ) const
 {
 	DecoderMPC* decoderMPC = nullptr;
 	try {
-		decoderMPC = new DecoderMPC( filename );
+		decoderMPC = new DecoderMPC( filename, readAhead );
 	} catch ( const std::runtime_error& ) {
 
 	}
@@ -44,6 +87,52 @@ Decoder::Ptr HandlerMPC::OpenDecoder( const std::wstring& filename ) const
 	return stream;
 }
 
+bool HandlerMPC::Probe( const std::wstring& filename, StreamInfo& info ) const
+{
+	bool success = false;
+	if ( const FileSource::Ptr source = FileSource::Open( filename, false /*readAhead*/ ); source ) {
+		// Only SV8 files are read, SV7 files are left to the decoder.
+		char magic[ 4 ] = {};
+		if ( ( 4 == source->Read( magic, 4 ) ) && ( 0 == memcmp( magic, "MPCK", 4 ) ) ) {
+			char key[ 2 ] = {};
+			unsigned long long packetSize = 0;
+			unsigned long long sizeLength = 0;
+			bool good = ( 2 == source->Read( key, 2 ) ) && ReadSize( *source, packetSize, sizeLength );
+			while ( good ) {
+				const long long position = source->GetPosition();
+				const unsigned long long headerSize = 2 + sizeLength;
+				if ( packetSize < headerSize ) {
+					break;
+				}
+				const unsigned long long payloadSize = packetSize - headerSize;
+				if ( ( 'S' == key[ 0 ] ) && ( 'H' == key[ 1 ] ) ) {
+					std::vector<unsigned char> header( static_cast<size_t>( ( std::min )( payloadSize, s_MaximumHeaderSize ) ) );
+					if ( header.size() == source->Read( header.data(), header.size() ) ) {
+						size_t offset = 5 /*CRC & version*/;
+						unsigned long long samples = 0;
+						unsigned long long silence = 0;
+						if ( ReadSize( header, offset, samples ) && ReadSize( header, offset, silence ) && ( ( offset + 2 ) <= header.size() ) && ( samples > silence ) &&
+								( static_cast<size_t>( header[ offset ] >> 5 ) < s_SampleRates.size() ) ) {
+							info.SampleRate = s_SampleRates[ header[ offset ] >> 5 ];
+							info.Channels = ( header[ offset + 1 ] >> 4 ) + 1;
+							info.Duration = static_cast<float>( samples - silence ) / info.SampleRate;
+							info.Bitrate = ( source->GetSize() * 8 ) / ( info.Duration * 1000 );
+							success = true;
+						}
+					}
+					break;
+				}
+				// Stop at the first audio packet, the stream header should have preceded it.
+				if ( ( 'A' == key[ 0 ] ) && ( 'P' == key[ 1 ] ) ) {
+					break;
+				}
+				good = source->Seek( position + static_cast<long long>( payloadSize ) ) && ( 2 == source->Read( key, 2 ) ) && ReadSize( *source, packetSize, sizeLength );
+			}
+		}
+	}
+	return success;
+}
+
 Encoder::Ptr HandlerMPC::OpenEncoder() const
 {
 	return nullptr;
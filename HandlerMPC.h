@@ -22,7 +22,13 @@ public:
 	bool SetTags( const std::wstring& filename, const Tags& tags ) const override;
 
 	// Returns a decoder for 'filename', or nullptr if a decoder cannot be created.
-	Decoder::Ptr OpenDecoder( const std::wstring& filename ) const override;
+	// 'readAhead' - whether the decoder should read ahead of the file position.
+	Decoder::Ptr OpenDecoder( const std::wstring& filename, const bool readAhead ) const override;
+
+	// Reads the stream properties of 'filename' from the file headers only, without opening a decoder.
+	// 'info' - out, stream properties.
+	// Returns whether the stream properties were read.
+	bool Probe( const std::wstring& filename, StreamInfo& info ) const override;
 
 	// Returns an encoder, or nullptr if an encoder cannot be created.
 	Encoder::Ptr OpenEncoder() const override;
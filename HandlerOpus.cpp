@@ -2,6 +2,7 @@
 
 #include "DecoderOpus.h"
 #include "EncoderOpus.h"
+#include "FileSource.h"
 
 #include "OpusComment.h"
 
@@ -15,6 +16,24 @@
 // R128 reference level in LUFS.
 static const float LOUDNESS_R128 = -23.0f;
 
+// Size of the Ogg page header, excluding the segment table.
+static const size_t s_OggPageHeaderSize = 27;
+
+// Maximum amount of data read from the end of the file when looking for the last Ogg page.
+static const size_t s_MaximumTailSize = 0x40000;
+
+// Returns the little endian 32-bit value at 'data'.
+static uint32_t ReadUInt32( const unsigned char* data )
+{
+	return data[ 0 ] | ( data[ 1 ] << 8 ) | ( data[ 2 ] << 16 ) | ( static_cast<uint32_t>( data[ 3 ] ) << 24 );
+}
+
+// Returns the little endian 64-bit value at 'data'.
+static int64_t ReadInt64( const unsigned char* data )
+{
+	return static_cast<int64_t>( ReadUInt32( data ) | ( static_cast<uint64_t>( ReadUInt32( data + 4 ) ) << 32 ) );
+}
+
 // Supported tags and their Opus field names.
 static const std::map<Tag,std::string> s_SupportedTags = {
 	{ Tag::Album,				"ALBUM" },
@@ -150,11 +169,11 @@ bool HandlerOpus::SetTags( const std::wstring& filename, const Tags& tags ) cons
 	return success;
 }
 
-Decoder::Ptr HandlerOpus::OpenDecoder( const std::wstring& filename ) const
+Decoder::Ptr HandlerOpus::OpenDecoder( const std::wstring& filename, const bool readAhead ) const
 {
 	DecoderOpus* streamOpus = nullptr;
 	try {
-		streamOpus = new DecoderOpus( filename );
+		streamOpus = new DecoderOpus( filename, readAhead );
 	} catch ( const std::runtime_error& ) {
 
 	}
@@ -162,6 +181,57 @@ Decoder::Ptr HandlerOpus::OpenDecoder( const std::wstring& filename ) const
 	return stream;
 }
 
+bool HandlerOpus::Probe( const std::wstring& filename, StreamInfo& info ) const
+{
+	bool success = false;
+	if ( const FileSource::Ptr source = FileSource::Open( filename, false /*readAhead*/ ); source ) {
+		// The first page contains the identification header, and the granule position of the last page gives the length of the stream.
+		const long long filesize = source->GetSize();
+		std::vector<unsigned char> page( s_OggPageHeaderSize + 255 + 19 );
+		if ( ( s_OggPageHeaderSize == source->Read( page.data(), s_OggPageHeaderSize ) ) && ( 0 == memcmp( page.data(), "OggS", 4 ) ) ) {
+			const uint32_t serial = ReadUInt32( page.data() + 14 );
+			const size_t segmentCount = page[ 26 ];
+			if ( ( segmentCount + 19 ) == source->Read( page.data() + s_OggPageHeaderSize, segmentCount + 19 ) ) {
+				const unsigned char* head = page.data() + s_OggPageHeaderSize + segmentCount;
+				if ( 0 == memcmp( head, "OpusHead", 8 ) ) {
+					const long channels = head[ 9 ];
+					const long preSkip = head[ 10 ] | ( head[ 11 ] << 8 );
+
+					// Chained streams are left to the decoder, so the last page must belong to the same logical stream as the first.
+					int64_t granule = -1;
+					bool chained = false;
+					std::vector<unsigned char> tail;
+					size_t tailSize = 0x10000;
+					while ( ( granule < 0 ) && !chained && ( tail.size() < static_cast<size_t>( filesize ) ) && ( tail.size() < s_MaximumTailSize ) ) {
+						tailSize = static_cast<size_t>( ( std::min<long long> )( std::min( tailSize, s_MaximumTailSize ), filesize ) );
+						tail.resize( tailSize );
+						if ( !source->Seek( filesize - tailSize ) || ( tailSize != source->Read( tail.data(), tailSize ) ) ) {
+							break;
+						}
+						for ( size_t offset = tailSize - s_OggPageHeaderSize; ( granule < 0 ) && !chained && ( offset != static_cast<size_t>( -1 ) ); offset-- ) {
+							if ( ( 0 == memcmp( tail.data() + offset, "OggS", 4 ) ) && ( 0 == tail[ offset + 4 ] ) ) {
+								granule = ReadInt64( tail.data() + offset + 6 );
+								chained = ( granule >= 0 ) && ( serial != ReadUInt32( tail.data() + offset + 14 ) );
+							}
+						}
+						tailSize *= 2;
+					}
+
+					const int64_t pcmTotal = granule - preSkip;
+					if ( !chained && ( channels > 0 ) && ( pcmTotal > 0 ) ) {
+						info.SampleRate = 48000;
+						info.Channels = channels;
+						info.Duration = static_cast<float>( pcmTotal ) / 48000;
+						info.Bitrate = ( filesize * 8 ) / ( info.Duration * 1000 );
+						success = true;
+					}
+				}
+			}
+		}
+	}
+	return success;
+}
+
 Encoder::Ptr HandlerOpus::OpenEncoder() const
 {
 	Encoder::Ptr encoder( new EncoderOpus() );
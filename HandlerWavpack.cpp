@@ -3,6 +3,7 @@
 #include "resource.h"
 
 #include "DecoderWavpack.h"
+#include "FileSource.h"
 #include "Utility.h"
 
 #include <array>
@@ -21,6 +22,15 @@ static const std::map<Tag,std::string> s_SupportedTags = {
 	{ Tag::Year,				"DATE" }
 };
 
+// Standard sample rates, indexed by the rate field of the block header flags.
+static const std::array<long,15> s_SampleRates = { 6000, 8000, 9600, 11025, 12000, 16000, 22050, 24000, 32000, 44100, 48000, 64000, 88200, 96000, 192000 };
+
+// Returns the little endian 32-bit value at 'data'.
+static uint32_t ReadUInt32( const unsigned char* data )
+{
+	return data[ 0 ] | ( data[ 1 ] << 8 ) | ( data[ 2 ] << 16 ) | ( static_cast<uint32_t>( data[ 3 ] ) << 24 );
+}
+
 HandlerWavpack::HandlerWavpack()
 {
 }
@@ -147,11 +157,11 @@ bool HandlerWavpack::SetTags( const std::wstring& filename, const Tags& tags ) c
 	return success;
 }
 
-Decoder::Ptr HandlerWavpack::OpenDecoder( const std::wstring& filename ) const
+Decoder::Ptr HandlerWavpack::OpenDecoder( const std::wstring& filename, const bool readAhead ) const
 {
 	DecoderWavpack* decoderWavpack = nullptr;
 	try {
-		decoderWavpack = new DecoderWavpack( filename );
+		decoderWavpack = new DecoderWavpack( filename, readAhead );
 	} catch ( const std::runtime_error& ) {
 
 	}
@@ -159,6 +169,91 @@ Decoder::Ptr HandlerWavpack::OpenDecoder( const std::wstring& filename ) const
 	return stream;
 }
 
+bool HandlerWavpack::Probe( const std::wstring& filename, StreamInfo& info ) const
+{
+	bool success = false;
+	if ( const FileSource::Ptr source = FileSource::Open( filename, false /*readAhead*/ ); source ) {
+		unsigned char header[ 32 ] = {};
+		if ( ( 32 == source->Read( header, 32 ) ) && ( 'w' == header[ 0 ] ) && ( 'v' == header[ 1 ] ) && ( 'p' == header[ 2 ] ) && ( 'k' == header[ 3 ] ) ) {
+			const uint32_t blockSize = ReadUInt32( header + 4 );
+			const uint32_t totalSamplesLow = ReadUInt32( header + 12 );
+			const uint32_t flags = ReadUInt32( header + 24 );
+			const unsigned long long totalSamples = ( static_cast<unsigned long long>( header[ 11 ] ) << 32 ) | totalSamplesLow;
+			const bool isDSD = ( 0 != ( flags & 0x80000000 ) );
+			const bool isFloat = ( 0 != ( flags & 0x80 ) );
+			const bool isMono = ( 0 != ( flags & 0x4 ) );
+			const bool isFinalBlock = ( 0 != ( flags & 0x1000 ) );
+			const size_t rateIndex = ( flags >> 23 ) & 0xf;
+
+			// Files with an unknown number of samples, and DSD files, are left to the decoder.
+			if ( !isDSD && ( 0xffffffff != totalSamplesLow ) && ( totalSamples > 0 ) && ( blockSize > 24 ) ) {
+				info.SampleRate = ( rateIndex < s_SampleRates.size() ) ? s_SampleRates[ rateIndex ] : 0;
+				info.Channels = isMono ? 1 : 2;
+
+				// Read the metadata sub-blocks of the first block, for a non-standard sample rate and for multichannel configurations.
+				std::vector<unsigned char> block( blockSize - 24 );
+				if ( block.size() == source->Read( block.data(), block.size() ) ) {
+					size_t offset = 0;
+					while ( ( offset + 2 ) <= block.size() ) {
+						const unsigned char id = block[ offset ];
+						const bool isLarge = ( 0 != ( id & 0x80 ) );
+						const bool isOdd = ( 0 != ( id & 0x40 ) );
+						size_t words = block[ offset + 1 ];
+						offset += 2;
+						if ( isLarge ) {
+							if ( ( offset + 2 ) > block.size() ) {
+								break;
+							}
+							words |= ( block[ offset ] << 8 ) | ( block[ offset + 1 ] << 16 );
+							offset += 2;
+						}
+						const size_t dataSize = words * 2;
+						if ( ( offset + dataSize ) > block.size() ) {
+							break;
+						}
+						const size_t size = isOdd ? ( dataSize - 1 ) : dataSize;
+						switch ( id & 0x3f ) {
+							case 0x0d : {
+								// Channel information.
+								if ( !isFinalBlock && ( size >= 1 ) ) {
+									info.Channels = block[ offset ];
+								}
+								break;
+							}
+							case 0x27 : {
+								// Non-standard sample rate.
+								if ( size >= 3 ) {
+									info.SampleRate = block[ offset ] | ( block[ offset + 1 ] << 8 ) | ( block[ offset + 2 ] << 16 );
+								}
+								break;
+							}
+							default : {
+								break;
+							}
+						}
+						offset += dataSize;
+					}
+				}
+
+				if ( ( info.SampleRate > 0 ) && ( info.Channels > 0 ) ) {
+					info.BitsPerSample = isFloat ? 32 : static_cast<long>( ( ( flags & 0x3 ) + 1 ) * 8 - ( ( flags >> 13 ) & 0x1f ) );
+					info.Duration = static_cast<float>( totalSamples ) / info.SampleRate;
+
+					// The bitrate includes any correction file, as for the decoder.
+					long long streamsize = source->GetSize();
+					WIN32_FILE_ATTRIBUTE_DATA attributes = {};
+					if ( FALSE != GetFileAttributesEx( ( filename + L"c" ).c_str(), GetFileExInfoStandard, &attributes ) ) {
+						streamsize += ( static_cast<long long>( attributes.nFileSizeHigh ) << 32 ) + attributes.nFileSizeLow;
+					}
+					info.Bitrate = ( streamsize * 8 ) / ( info.Duration * 1000 );
+					success = true;
+				}
+			}
+		}
+	}
+	return success;
+}
+
 Encoder::Ptr HandlerWavpack::OpenEncoder() const
 {
 	return nullptr;
@@ -9,6 +9,7 @@
 #include "HandlerMAC.h"
 #include "HandlerMPC.h"
 
+#include "FileSource.h"
 #include "ShellMetadata.h"
 #include "Utility.h"
 
@@ -24,7 +25,8 @@ Handlers::Handlers() :
 		Handler::Ptr( new HandlerPCM() ),
 		Handler::Ptr( m_HandlerBASS ) } ),
 	m_Decoders(),
-	m_Encoders()
+	m_Encoders(),
+	m_SeekIndexCache( nullptr )
 {
 	for ( const auto& handler : m_Handlers ) {
 		if ( handler->IsDecoder() ) {
@@ -55,26 +57,43 @@ Handler::Ptr Handlers::FindDecoderHandler( const std::wstring& filename ) const
 	return handler;
 }
 
-Decoder::Ptr Handlers::OpenDecoder( const std::wstring& filename ) const
+Decoder::Ptr Handlers::OpenDecoder( const std::wstring& filename, const bool readAhead ) const
 {
 	Decoder::Ptr decoder;
 	if ( IsURL( filename ) ) {
-		decoder = m_HandlerBASS ? m_HandlerBASS->OpenDecoder( filename ) : nullptr;
+		decoder = m_HandlerBASS ? m_HandlerBASS->OpenDecoder( filename, readAhead ) : nullptr;
 	} else if ( !filename.empty() ) {
 		Handler::Ptr handler = FindDecoderHandler( filename );
 		if ( handler ) {
-			decoder = handler->OpenDecoder( filename );
+			decoder = handler->OpenDecoder( filename, readAhead );
 		}
 		if ( !decoder ) {
 			// Try any handler.
 			for ( auto handlerIter = m_Decoders.begin(); !decoder && ( handlerIter != m_Decoders.end() ); handlerIter++ ) {
-				decoder = handlerIter->get()->OpenDecoder( filename );
+				decoder = handlerIter->get()->OpenDecoder( filename, readAhead );
 			}
 		}
+		if ( decoder && ( nullptr != m_SeekIndexCache ) && decoder->SupportsSeekIndex() ) {
+			SeekIndexCache* cache = m_SeekIndexCache;
+			decoder->SetSeekIndex( cache->Get( filename ), [ cache, filename ] ( const SeekIndex& index ) { cache->Set( filename, index ); } );
+		}
 	}
 	return decoder;
 }
 
+bool Handlers::Probe( const std::wstring& filename, Handler::StreamInfo& info ) const
+{
+	bool success = false;
+	if ( !IsURL( filename ) ) {
+		Handler::Ptr handler = FindDecoderHandler( filename );
+		if ( handler ) {
+			info = {};
+			success = handler->Probe( filename, info );
+		}
+	}
+	return success;
+}
+
 bool Handlers::GetTags( const std::wstring& filename, Tags& tags ) const
 {
 	bool success = false;
@@ -171,9 +190,29 @@ void Handlers::SettingsChanged( Settings& settings ) const
 			handler->SettingsChanged( settings );
 		}
 	}
+
+	bool enableReadAhead = true;
+	int windowSize = 0;
+	int throttle = 0;
+	settings.GetReadAheadSettings( enableReadAhead, windowSize, throttle );
+	FileSource::ReadAhead readAhead;
+	readAhead.Enabled = enableReadAhead;
+	readAhead.WindowSize = static_cast<size_t>( windowSize ) << 20;
+	readAhead.Throttle = static_cast<long long>( throttle ) << 10;
+	FileSource::SetReadAhead( readAhead );
 }
 
 void Handlers::Init( Settings& settings )
 {
 	SettingsChanged( settings );
 }
+
+void Handlers::SetSeekIndexCache( SeekIndexCache* cache )
+{
+	m_SeekIndexCache = cache;
+}
+
+SeekIndexCache* Handlers::GetSeekIndexCache() const
+{
+	return m_SeekIndexCache;
+}
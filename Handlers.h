@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Handler.h"
+#include "SeekIndexCache.h"
 
 #include <list>
 
@@ -14,8 +15,14 @@ public:
 
 	// Opens a decoder.
 	// 'filename' - file to open.
+	// 'readAhead' - whether the decoder should read ahead of the file position, which is only worthwhile for playback.
 	// Returns the decoder, or nullptr if the stream could not be opened.
-	Decoder::Ptr OpenDecoder( const std::wstring& filename ) const;
+	Decoder::Ptr OpenDecoder( const std::wstring& filename, const bool readAhead = false ) const;
+
+	// Reads the stream properties of 'filename' from the file headers only, without opening a decoder.
+	// 'info' - out, stream properties.
+	// Returns whether the stream properties were read (if not, a decoder should be opened to obtain them instead).
+	bool Probe( const std::wstring& filename, Handler::StreamInfo& info ) const;
 
 	// Reads 'tags' from 'filename', returning true if the tags were read.
 	bool GetTags( const std::wstring& filename, Tags& tags ) const;
@@ -45,6 +52,12 @@ public:
 	// Initialises the handlers with the application 'settings'.
 	void Init( Settings& settings );
 
+	// Sets the 'cache' which provides and stores the seek index for decoders which support one (or nullptr for no seek indices).
+	void SetSeekIndexCache( SeekIndexCache* cache );
+
+	// Returns the seek index cache, or nullptr if there is none.
+	SeekIndexCache* GetSeekIndexCache() const;
+
 private:
 	// Returns a decoder handler supported by the 'filename' extension, or nullptr of there was no match.
 	Handler::Ptr FindDecoderHandler( const std::wstring& filename ) const;
@@ -60,5 +73,8 @@ private:
 
 	// Available encoders.
 	Handler::List m_Encoders;
+
+	// Seek index cache.
+	SeekIndexCache* m_SeekIndexCache;
 };
 
@@ -3,10 +3,15 @@
 #include "Utility.h"
 #include "VUPlayer.h"
 
+#include <array>
+#include <cmath>
 #include <iomanip>
 #include <list>
 #include <sstream>
 
+// Amount of sample data from each end of a track which is used to calculate its content fingerprint, in seconds.
+static const float s_FingerprintSeconds = 3.0f;
+
 Library::Library( Database& database, const Handlers& handlers ) :
 	m_Database( database ),
 	m_Handlers( handlers ),
@@ -30,7 +35,12 @@ Library::Library( Database& database, const Handlers& handlers ) :
 		Columns::value_type( "GainTrack", Column::GainTrack ),
 		Columns::value_type( "GainAlbum", Column::GainAlbum ),
 		Columns::value_type( "Artwork", Column::Artwork ),
-		Columns::value_type( "Bitrate", Column::Bitrate )
+		Columns::value_type( "Bitrate", Column::Bitrate ),
+		Columns::value_type( "CrossfadePosition", Column::CrossfadePosition ),
+		Columns::value_type( "TruePeak", Column::TruePeak ),
+		Columns::value_type( "LeadingSilence", Column::LeadingSilence ),
+		Columns::value_type( "TrailingSilence", Column::TrailingSilence ),
+		Columns::value_type( "Fingerprint", Column::Fingerprint )
 	} ),
 	m_CDDAColumns( {
 		Columns::value_type( "CDDB", Column::CDDB ),
@@ -45,7 +55,11 @@ Library::Library( Database& database, const Handlers& handlers ) :
 		Columns::value_type( "Comment", Column::Comment ),
 		Columns::value_type( "GainTrack", Column::GainTrack ),
 		Columns::value_type( "GainAlbum", Column::GainAlbum ),
-		Columns::value_type( "Artwork", Column::Artwork )
+		Columns::value_type( "Artwork", Column::Artwork ),
+		Columns::value_type( "CrossfadePosition", Column::CrossfadePosition ),
+		Columns::value_type( "TruePeak", Column::TruePeak ),
+		Columns::value_type( "LeadingSilence", Column::LeadingSilence ),
+		Columns::value_type( "TrailingSilence", Column::TrailingSilence )
 	} )
 {
 	UpdateDatabase();
@@ -66,6 +80,7 @@ void Library::UpdateDatabase()
 	UpdateMediaTable();
 	UpdateCDDATable();
 	UpdateArtworkTable();
+	UpdateAnalysisTable();
 	CreateIndices();
 }
 
@@ -203,6 +218,46 @@ void Library::UpdateArtworkTable()
 	}
 }
 
+void Library::UpdateAnalysisTable()
+{
+	sqlite3* database = m_Database.GetDatabase();
+	if ( nullptr != database ) {
+		// Create the analysis table (if necessary).
+		const std::string analysisTableQuery = "CREATE TABLE IF NOT EXISTS Analysis(Fingerprint,GainTrack,CrossfadePosition,TruePeak,LeadingSilence,TrailingSilence, PRIMARY KEY(Fingerprint));";
+		sqlite3_exec( database, analysisTableQuery.c_str(), NULL /*callback*/, NULL /*arg*/, NULL /*errMsg*/ );
+
+		// Check the columns in the analysis table.
+		const std::string columnsInfoQuery = "PRAGMA table_info('Analysis')";
+		sqlite3_stmt* stmt = nullptr;
+		if ( SQLITE_OK == sqlite3_prepare_v2( database, columnsInfoQuery.c_str(), -1 /*nByte*/, &stmt, nullptr /*tail*/ ) ) {
+			std::set<std::string> columns;
+			while ( SQLITE_ROW == sqlite3_step( stmt ) ) {
+				const int columnCount = sqlite3_column_count( stmt );
+				for ( int columnIndex = 0; columnIndex < columnCount; columnIndex++ ) {
+					const std::string columnName = sqlite3_column_name( stmt, columnIndex );
+					if ( columnName == "name" ) {
+						const std::string name = reinterpret_cast<const char*>( sqlite3_column_text( stmt, columnIndex ) );
+						columns.insert( name );
+						break;
+					}
+				}
+			}
+			sqlite3_finalize( stmt );
+
+			const std::array<std::string, 6> requiredColumns = { "Fingerprint", "GainTrack", "CrossfadePosition", "TruePeak", "LeadingSilence", "TrailingSilence" };
+			for ( const auto& column : requiredColumns ) {
+				if ( columns.end() == columns.find( column ) ) {
+					// Drop the table and recreate (the analysis results can always be recalculated).
+					const std::string dropTableQuery = "DROP TABLE Analysis;";
+					sqlite3_exec( database, dropTableQuery.c_str(), NULL /*callback*/, NULL /*arg*/, NULL /*errMsg*/ );
+					sqlite3_exec( database, analysisTableQuery.c_str(), NULL /*callback*/, NULL /*arg*/, NULL /*errMsg*/ );
+					break;
+				}
+			}
+		}
+	}
+}
+
 void Library::CreateIndices()
 {
 	sqlite3* database = m_Database.GetDatabase();
@@ -229,6 +284,7 @@ bool Library::GetMediaInfo( MediaInfo& mediaInfo, const bool checkFileAttributes
 				// Should be a maximum of one entry.
 				const int result = sqlite3_step( stmt );
 				success = ( SQLITE_ROW == result );
+				bool modified = false;
 				if ( success ) {
 					ExtractMediaInfo( stmt, info );
 					if ( checkFileAttributes ) {
@@ -238,13 +294,29 @@ bool Library::GetMediaInfo( MediaInfo& mediaInfo, const bool checkFileAttributes
 						success = ( info.GetFiletime() == filetime ) && ( info.GetFilesize() == filesize );
 						if ( !success ) {
 							info = mediaInfo;
+							modified = true;
 						}
 					}
 				}
 
 				if ( !success && scanMedia && ( MediaInfo::Source::File == info.GetSource() ) ) {
+					// Any analysis results are specific to the previous contents of the file.
+					info.SetCrossfadePosition( std::nullopt );
+					info.SetTruePeak( std::nullopt );
+					info.SetLeadingSilence( std::nullopt );
+					info.SetTrailingSilence( std::nullopt );
+					info.SetFingerprint( {} );
+
+					// The stored seek index for a modified file is never used again.
+					if ( SeekIndexCache* seekIndexCache = m_Handlers.GetSeekIndexCache(); modified && ( nullptr != seekIndexCache ) ) {
+						seekIndexCache->Remove( info.GetFilename() );
+					}
 					success = GetDecoderInfo( info );
 					if ( success ) {
+						// A file which has been moved, renamed or retagged keeps the analysis results for its audio content.
+						// A fingerprint from the file headers covers the whole of the decoded audio, so all of the results can be applied.
+						GetCachedAnalysis( info, true /*includeLoudness*/ );
+
 						Tags pendingTags;
 						if ( GetPendingTags( info.GetFilename(), pendingTags ) ) {
 							UpdateMediaInfoFromTags( info, pendingTags );
@@ -299,13 +371,29 @@ bool Library::GetFileInfo( const std::wstring& filename, long long& lastModified
 bool Library::GetDecoderInfo( MediaInfo& mediaInfo )
 {
 	bool success = false;
-	Decoder::Ptr stream = m_Handlers.OpenDecoder( mediaInfo.GetFilename() );
-	if ( stream ) {
-		mediaInfo.SetBitsPerSample( stream->GetBPS() );
-		mediaInfo.SetChannels( stream->GetChannels() );
-		mediaInfo.SetDuration( stream->GetDuration() );
-		mediaInfo.SetSampleRate( stream->GetSampleRate() );
-		mediaInfo.SetBitrate( stream->GetBitrate() );
+
+	// The stream properties are read from the file headers where possible, avoiding the cost of opening a decoder.
+	// The audio content is never decoded here, so a file is only fingerprinted now if its headers record a hash of the audio content.
+	// Otherwise, the fingerprint is calculated when the file is next analysed.
+	Handler::StreamInfo info;
+	Decoder::Ptr stream;
+	const bool probed = m_Handlers.Probe( mediaInfo.GetFilename(), info );
+	if ( !probed ) {
+		stream = m_Handlers.OpenDecoder( mediaInfo.GetFilename() );
+		if ( stream ) {
+			info.BitsPerSample = stream->GetBPS();
+			info.Channels = stream->GetChannels();
+			info.Duration = stream->GetDuration();
+			info.SampleRate = stream->GetSampleRate();
+			info.Bitrate = stream->GetBitrate();
+		}
+	}
+	if ( probed || stream ) {
+		mediaInfo.SetBitsPerSample( info.BitsPerSample );
+		mediaInfo.SetChannels( info.Channels );
+		mediaInfo.SetDuration( info.Duration );
+		mediaInfo.SetSampleRate( info.SampleRate );
+		mediaInfo.SetBitrate( info.Bitrate );
 
 		Tags tags;
 		if ( m_Handlers.GetTags( mediaInfo.GetFilename(), tags ) ) {
@@ -318,11 +406,64 @@ bool Library::GetDecoderInfo( MediaInfo& mediaInfo )
 		mediaInfo.SetFiletime( filetime );
 		mediaInfo.SetFilesize( filesize );
 
+		if ( mediaInfo.GetFingerprint().empty() && !info.ContentHash.empty() ) {
+			mediaInfo.SetFingerprint( CalculateFingerprint( info ) );
+		}
+
 		success = true;
 	}
 	return success;
 }
 
+std::wstring Library::CalculateFingerprint( const Handler::StreamInfo& info )
+{
+	std::wstring fingerprint;
+	if ( ( info.Channels > 0 ) && ( info.SampleRate > 0 ) && ( info.Duration > 0 ) && !info.ContentHash.empty() ) {
+		// The fingerprint covers the stream format and length, and the content hash from the file headers.
+		const std::string content = std::to_string( info.SampleRate ) + ":" + std::to_string( info.Channels ) + ":" + std::to_string( std::llround( info.Duration * info.SampleRate ) ) + ":hash:" + info.ContentHash;
+		fingerprint = UTF8ToWideString( CalculateHash( content, CALG_SHA1, true /*base64encode*/ ) );
+	}
+	return fingerprint;
+}
+
+std::wstring Library::CalculateFingerprint( Decoder& decoder )
+{
+	std::wstring fingerprint;
+	const long channels = decoder.GetChannels();
+	const long sampleRate = decoder.GetSampleRate();
+	const float duration = decoder.GetDuration();
+	if ( ( channels > 0 ) && ( sampleRate > 0 ) && ( duration > 0 ) ) {
+		// The fingerprint covers the stream format and length, and the sample data (at 16-bit resolution) from the start and end of the track.
+		std::string content = std::to_string( sampleRate ) + ":" + std::to_string( channels ) + ":" + std::to_string( std::llround( duration * sampleRate ) ) + ":";
+		const long fingerprintSamples = static_cast<long>( s_FingerprintSeconds * sampleRate );
+		std::vector<float> buffer( fingerprintSamples * channels );
+		auto addSamples = [ &decoder, &buffer, &content, channels, fingerprintSamples ] () {
+			long totalSamples = 0;
+			long sampleCount = 0;
+			do {
+				sampleCount = decoder.Read( buffer.data(), fingerprintSamples - totalSamples );
+				for ( long index = 0; index < sampleCount * channels; index++ ) {
+					const short value = static_cast<short>( std::lround( std::clamp( buffer[ index ], -1.0f, 1.0f ) * 32767 ) );
+					content.push_back( static_cast<char>( value & 0xff ) );
+					content.push_back( static_cast<char>( ( value >> 8 ) & 0xff ) );
+				}
+				totalSamples += sampleCount;
+			} while ( ( sampleCount > 0 ) && ( totalSamples < fingerprintSamples ) );
+			return totalSamples;
+		};
+
+		bool success = ( addSamples() > 0 );
+		if ( success && ( duration > 2 * s_FingerprintSeconds ) ) {
+			decoder.Seek( duration - s_FingerprintSeconds );
+			success = ( addSamples() > 0 );
+		}
+		if ( success ) {
+			fingerprint = UTF8ToWideString( CalculateHash( content, CALG_SHA1, true /*base64encode*/ ) );
+		}
+	}
+	return fingerprint;
+}
+
 void Library::ExtractMediaInfo( sqlite3_stmt* stmt, MediaInfo& mediaInfo )
 {
 	if ( nullptr != stmt ) {
@@ -440,6 +581,37 @@ void Library::ExtractMediaInfo( sqlite3_stmt* stmt, MediaInfo& mediaInfo )
 						}
 						break;
 					}
+					case Column::CrossfadePosition : {
+						if ( SQLITE_NULL != sqlite3_column_type( stmt, columnIndex ) ) {
+							mediaInfo.SetCrossfadePosition( static_cast<float>( sqlite3_column_double( stmt, columnIndex ) ) );
+						}
+						break;
+					}
+					case Column::TruePeak : {
+						if ( SQLITE_NULL != sqlite3_column_type( stmt, columnIndex ) ) {
+							mediaInfo.SetTruePeak( static_cast<float>( sqlite3_column_double( stmt, columnIndex ) ) );
+						}
+						break;
+					}
+					case Column::LeadingSilence : {
+						if ( SQLITE_NULL != sqlite3_column_type( stmt, columnIndex ) ) {
+							mediaInfo.SetLeadingSilence( static_cast<float>( sqlite3_column_double( stmt, columnIndex ) ) );
+						}
+						break;
+					}
+					case Column::TrailingSilence : {
+						if ( SQLITE_NULL != sqlite3_column_type( stmt, columnIndex ) ) {
+							mediaInfo.SetTrailingSilence( static_cast<float>( sqlite3_column_double( stmt, columnIndex ) ) );
+						}
+						break;
+					}
+					case Column::Fingerprint : {
+						const char* text = reinterpret_cast<const char*>( sqlite3_column_text( stmt, columnIndex ) );
+						if ( nullptr != text ) {
+							mediaInfo.SetFingerprint( UTF8ToWideString( text ) );
+						}
+						break;
+					}
 				}
 			}
 		}
@@ -571,6 +743,46 @@ bool Library::UpdateMediaLibrary( const MediaInfo& mediaInfo )
 						}
 						break;
 					}
+					case Column::CrossfadePosition : {
+						const auto position = mediaInfo.GetCrossfadePosition();
+						if ( position.has_value() ) {
+							sqlite3_bind_double( stmt, ++param, position.value() );
+						} else {
+							sqlite3_bind_null( stmt, ++param );
+						}
+						break;
+					}
+					case Column::TruePeak : {
+						const auto peak = mediaInfo.GetTruePeak();
+						if ( peak.has_value() ) {
+							sqlite3_bind_double( stmt, ++param, peak.value() );
+						} else {
+							sqlite3_bind_null( stmt, ++param );
+						}
+						break;
+					}
+					case Column::LeadingSilence : {
+						const auto silence = mediaInfo.GetLeadingSilence();
+						if ( silence.has_value() ) {
+							sqlite3_bind_double( stmt, ++param, silence.value() );
+						} else {
+							sqlite3_bind_null( stmt, ++param );
+						}
+						break;
+					}
+					case Column::TrailingSilence : {
+						const auto silence = mediaInfo.GetTrailingSilence();
+						if ( silence.has_value() ) {
+							sqlite3_bind_double( stmt, ++param, silence.value() );
+						} else {
+							sqlite3_bind_null( stmt, ++param );
+						}
+						break;
+					}
+					case Column::Fingerprint : {
+						sqlite3_bind_text( stmt, ++param, WideStringToUTF8( mediaInfo.GetFingerprint() ).c_str(), -1 /*strLen*/, SQLITE_TRANSIENT );
+						break;
+					}
 					default : {
 						break;
 					}
@@ -580,6 +792,10 @@ bool Library::UpdateMediaLibrary( const MediaInfo& mediaInfo )
 			success = ( SQLITE_DONE == result );
 			sqlite3_finalize( stmt );
 		}
+
+		if ( success ) {
+			UpdateCachedAnalysis( mediaInfo );
+		}
 	}
 	return success;
 }
@@ -1147,6 +1363,9 @@ bool Library::RemoveFromLibrary( const MediaInfo& mediaInfo )
 			}
 			sqlite3_finalize( stmt );
 		}
+		if ( SeekIndexCache* seekIndexCache = m_Handlers.GetSeekIndexCache(); nullptr != seekIndexCache ) {
+			seekIndexCache->Remove( filename );
+		}
 	}
 	return removed;
 }
@@ -1306,6 +1525,58 @@ bool Library::UpdateTrackGain( const MediaInfo& previousInfo, const MediaInfo& u
 			}
 		}
 	}
+	if ( updated ) {
+		UpdateCachedAnalysis( updatedInfo );
+	}
+	if ( updated && sendNotification ) {
+		VUPlayer* vuplayer = VUPlayer::Get();
+		if ( nullptr != vuplayer ) {
+			vuplayer->OnMediaUpdated( previousInfo, updatedInfo );
+		}
+	}
+	return updated;
+}
+
+bool Library::UpdateTrackAnalysis( const MediaInfo& previousInfo, const MediaInfo& updatedInfo, const bool sendNotification )
+{
+	bool updated = false;
+	const std::array<std::optional<float>, 4> values = {
+		updatedInfo.GetCrossfadePosition(), updatedInfo.GetTruePeak(), updatedInfo.GetLeadingSilence(), updatedInfo.GetTrailingSilence() };
+	if ( ( previousInfo.GetCrossfadePosition() != values[ 0 ] ) || ( previousInfo.GetTruePeak() != values[ 1 ] ) ||
+			( previousInfo.GetLeadingSilence() != values[ 2 ] ) || ( previousInfo.GetTrailingSilence() != values[ 3 ] ) ) {
+		sqlite3* database = m_Database.GetDatabase();
+		if ( nullptr != database ) {
+			const std::string query = ( MediaInfo::Source::CDDA == updatedInfo.GetSource() ) ?
+				"UPDATE CDDA SET CrossfadePosition=?1,TruePeak=?2,LeadingSilence=?3,TrailingSilence=?4 WHERE CDDB=?5 AND Track=?6;" :
+				"UPDATE Media SET CrossfadePosition=?1,TruePeak=?2,LeadingSilence=?3,TrailingSilence=?4 WHERE Filename=?5 AND Filetime=?6 AND Filesize=?7;";
+			sqlite3_stmt* stmt = nullptr;
+			updated = ( SQLITE_OK == sqlite3_prepare_v2( database, query.c_str(), -1 /*nByte*/, &stmt, nullptr /*tail*/ ) );
+			if ( updated ) {
+				int param = 0;
+				for ( auto value = values.begin(); updated && ( values.end() != value ); value++ ) {
+					++param;
+					updated = value->has_value() ? ( SQLITE_OK == sqlite3_bind_double( stmt, param, value->value() ) ) : ( SQLITE_OK == sqlite3_bind_null( stmt, param ) );
+				}
+				if ( updated ) {
+					if ( MediaInfo::Source::CDDA == updatedInfo.GetSource() ) {
+						updated = ( ( SQLITE_OK == sqlite3_bind_int( stmt, ++param, static_cast<int>( updatedInfo.GetCDDB() ) ) ) &&
+							( SQLITE_OK == sqlite3_bind_int( stmt, ++param, static_cast<int>( updatedInfo.GetTrack() ) ) ) );
+					} else {
+						updated = ( ( SQLITE_OK == sqlite3_bind_text( stmt, ++param, WideStringToUTF8( updatedInfo.GetFilename() ).c_str(), -1 /*strLen*/, SQLITE_TRANSIENT ) ) &&
+							( SQLITE_OK == sqlite3_bind_int64( stmt, ++param, static_cast<sqlite3_int64>( updatedInfo.GetFiletime() ) ) ) &&
+							( SQLITE_OK == sqlite3_bind_int64( stmt, ++param, static_cast<sqlite3_int64>( updatedInfo.GetFilesize() ) ) ) );
+					}
+					if ( updated ) {
+						updated = ( SQLITE_DONE == sqlite3_step( stmt ) ) && ( sqlite3_changes( database ) > 0 );
+					}
+				}
+				sqlite3_finalize( stmt );
+			}
+		}
+	}
+	if ( updated ) {
+		UpdateCachedAnalysis( updatedInfo );
+	}
 	if ( updated && sendNotification ) {
 		VUPlayer* vuplayer = VUPlayer::Get();
 		if ( nullptr != vuplayer ) {
@@ -1342,3 +1613,92 @@ void Library::UpdateMediaInfoFromDecoder( MediaInfo& mediaInfo, const Decoder& d
 		}
 	}
 }
+
+bool Library::GetCachedAnalysis( MediaInfo& mediaInfo, const bool includeLoudness )
+{
+	bool success = false;
+	sqlite3* database = m_Database.GetDatabase();
+	if ( ( nullptr != database ) && !mediaInfo.GetFingerprint().empty() ) {
+		const std::string query = "SELECT GainTrack,CrossfadePosition,TruePeak,LeadingSilence,TrailingSilence FROM Analysis WHERE Fingerprint=?1;";
+		sqlite3_stmt* stmt = nullptr;
+		if ( SQLITE_OK == sqlite3_prepare_v2( database, query.c_str(), -1 /*nByte*/, &stmt, nullptr /*tail*/ ) ) {
+			if ( SQLITE_OK == sqlite3_bind_text( stmt, 1 /*param*/, WideStringToUTF8( mediaInfo.GetFingerprint() ).c_str(), -1 /*strLen*/, SQLITE_TRANSIENT ) ) {
+				success = ( SQLITE_ROW == sqlite3_step( stmt ) );
+				if ( success ) {
+					auto getValue = [ stmt ] ( const int columnIndex ) -> std::optional<float> {
+						return ( SQLITE_NULL != sqlite3_column_type( stmt, columnIndex ) ) ? std::optional<float>( static_cast<float>( sqlite3_column_double( stmt, columnIndex ) ) ) : std::nullopt;
+					};
+					// Any track gain read from the file tags takes precedence.
+					if ( includeLoudness ) {
+						if ( !mediaInfo.GetGainTrack().has_value() ) {
+							mediaInfo.SetGainTrack( getValue( 0 ) );
+						}
+						mediaInfo.SetTruePeak( getValue( 2 ) );
+					}
+					mediaInfo.SetCrossfadePosition( getValue( 1 ) );
+					mediaInfo.SetLeadingSilence( getValue( 3 ) );
+					mediaInfo.SetTrailingSilence( getValue( 4 ) );
+				}
+			}
+			sqlite3_finalize( stmt );
+		}
+	}
+	return success;
+}
+
+bool Library::UpdateFingerprint( MediaInfo& mediaInfo, Decoder& decoder )
+{
+	bool cached = false;
+	if ( mediaInfo.GetFingerprint().empty() && ( MediaInfo::Source::File == mediaInfo.GetSource() ) && !IsURL( mediaInfo.GetFilename() ) ) {
+		const std::wstring fingerprint = CalculateFingerprint( decoder );
+		if ( !fingerprint.empty() ) {
+			mediaInfo.SetFingerprint( fingerprint );
+			sqlite3* database = m_Database.GetDatabase();
+			if ( nullptr != database ) {
+				const std::string query = "UPDATE Media SET Fingerprint=?1 WHERE Filename=?2 AND Filetime=?3 AND Filesize=?4;";
+				sqlite3_stmt* stmt = nullptr;
+				if ( SQLITE_OK == sqlite3_prepare_v2( database, query.c_str(), -1 /*nByte*/, &stmt, nullptr /*tail*/ ) ) {
+					if ( ( SQLITE_OK == sqlite3_bind_text( stmt, 1 /*param*/, WideStringToUTF8( fingerprint ).c_str(), -1 /*strLen*/, SQLITE_TRANSIENT ) ) &&
+							( SQLITE_OK == sqlite3_bind_text( stmt, 2 /*param*/, WideStringToUTF8( mediaInfo.GetFilename() ).c_str(), -1 /*strLen*/, SQLITE_TRANSIENT ) ) &&
+							( SQLITE_OK == sqlite3_bind_int64( stmt, 3 /*param*/, static_cast<sqlite3_int64>( mediaInfo.GetFiletime() ) ) ) &&
+							( SQLITE_OK == sqlite3_bind_int64( stmt, 4 /*param*/, static_cast<sqlite3_int64>( mediaInfo.GetFilesize() ) ) ) ) {
+						sqlite3_step( stmt );
+					}
+					sqlite3_finalize( stmt );
+				}
+			}
+			cached = GetCachedAnalysis( mediaInfo, false /*includeLoudness*/ );
+		}
+	}
+	return cached;
+}
+
+bool Library::UpdateCachedAnalysis( const MediaInfo& mediaInfo )
+{
+	bool updated = false;
+	const std::array<std::optional<float>, 5> values = {
+		mediaInfo.GetGainTrack(), mediaInfo.GetCrossfadePosition(), mediaInfo.GetTruePeak(), mediaInfo.GetLeadingSilence(), mediaInfo.GetTrailingSilence() };
+	const bool hasValues = std::any_of( values.begin(), values.end(), [] ( const std::optional<float>& value ) { return value.has_value(); } );
+	sqlite3* database = m_Database.GetDatabase();
+	if ( ( nullptr != database ) && hasValues && !mediaInfo.GetFingerprint().empty() ) {
+		// Values which are not known for this file do not replace any previously stored results.
+		const std::string query = "INSERT INTO Analysis(Fingerprint,GainTrack,CrossfadePosition,TruePeak,LeadingSilence,TrailingSilence) VALUES(?1,?2,?3,?4,?5,?6) "
+			"ON CONFLICT(Fingerprint) DO UPDATE SET GainTrack=COALESCE(excluded.GainTrack,GainTrack),CrossfadePosition=COALESCE(excluded.CrossfadePosition,CrossfadePosition),"
+			"TruePeak=COALESCE(excluded.TruePeak,TruePeak),LeadingSilence=COALESCE(excluded.LeadingSilence,LeadingSilence),TrailingSilence=COALESCE(excluded.TrailingSilence,TrailingSilence);";
+		sqlite3_stmt* stmt = nullptr;
+		updated = ( SQLITE_OK == sqlite3_prepare_v2( database, query.c_str(), -1 /*nByte*/, &stmt, nullptr /*tail*/ ) );
+		if ( updated ) {
+			int param = 0;
+			updated = ( SQLITE_OK == sqlite3_bind_text( stmt, ++param, WideStringToUTF8( mediaInfo.GetFingerprint() ).c_str(), -1 /*strLen*/, SQLITE_TRANSIENT ) );
+			for ( auto value = values.begin(); updated && ( values.end() != value ); value++ ) {
+				++param;
+				updated = value->has_value() ? ( SQLITE_OK == sqlite3_bind_double( stmt, param, value->value() ) ) : ( SQLITE_OK == sqlite3_bind_null( stmt, param ) );
+			}
+			if ( updated ) {
+				updated = ( SQLITE_DONE == sqlite3_step( stmt ) );
+			}
+			sqlite3_finalize( stmt );
+		}
+	}
+	return updated;
+}
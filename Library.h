@@ -40,6 +40,11 @@ public:
 		Artwork = 20,
 		CDDB = 21,
 		Bitrate = 22,
+		CrossfadePosition = 23,
+		TruePeak = 24,
+		LeadingSilence = 25,
+		TrailingSilence = 26,
+		Fingerprint = 27,
 
 		_Undefined
 	};
@@ -136,6 +141,21 @@ public:
 	// Returns whether the library was updated.
 	bool UpdateTrackGain( const MediaInfo& previousInfo, const MediaInfo& updatedInfo, const bool sendNotification = true );
 
+	// Updates the track analysis results (crossfade position, true peak and silence durations), if necessary.
+	// 'previousInfo' - previous media information.
+	// 'updatedInfo' - updated media information.
+	// 'sendNotification' - whether to notify the main application if the library has been updated.
+	// Returns whether the library was updated.
+	bool UpdateTrackAnalysis( const MediaInfo& previousInfo, const MediaInfo& updatedInfo, const bool sendNotification = true );
+
+	// Calculates and stores the audio content fingerprint for a file which was scanned without one, then applies any previously calculated analysis results for the fingerprint.
+	// This is intended to be called before a file is analysed, as the fingerprint requires part of the audio content to be decoded.
+	// As the fingerprint only covers the ends of the track, the track gain and true peak level are not applied (and the track still needs to be analysed for those).
+	// 'mediaInfo' - in/out, media information.
+	// 'decoder' - decoder for the file, positioned at the start of the track (which is not used if the file already has a fingerprint).
+	// Returns true if analysis results were found.
+	bool UpdateFingerprint( MediaInfo& mediaInfo, Decoder& decoder );
+
 	// Updates 'mediaInfo' with 'decoder' information.
 	// 'sendNotification' - whether to notify the main application if the library has been updated.
 	void UpdateMediaInfoFromDecoder( MediaInfo& mediaInfo, const Decoder& decoder, const bool sendNotification = true );
@@ -159,6 +179,9 @@ private:
 	// Updates the artwork table if necessary.
 	void UpdateArtworkTable();
 
+	// Updates the analysis table if necessary.
+	void UpdateAnalysisTable();
+
 	// Creates indices if necessary.
 	void CreateIndices();
 
@@ -170,6 +193,28 @@ private:
 	// Returns true if the file was successfully opened by a decoder.
 	bool GetDecoderInfo( MediaInfo& mediaInfo );
 
+	// Calculates an audio content fingerprint from the content hash recorded in the file headers, which identifies a track independently of its filename and tags.
+	// 'info' - stream properties, read from the file headers.
+	// Returns the fingerprint, or an empty string if the file headers do not record a content hash.
+	static std::wstring CalculateFingerprint( const Handler::StreamInfo& info );
+
+	// Calculates an audio content fingerprint from the decoded audio, which identifies a track independently of its filename and tags.
+	// The fingerprint only covers the stream format and length, and the sample data from each end of the track (rather than decoding the whole track).
+	// So two versions of a track which differ only in the middle (such as an edit which keeps the original length) share a fingerprint.
+	// 'decoder' - decoder, positioned at the start of the track.
+	// Returns the fingerprint, or an empty string if the fingerprint could not be calculated.
+	static std::wstring CalculateFingerprint( Decoder& decoder );
+
+	// Gets any previously calculated analysis results for the audio content fingerprint of 'mediaInfo'.
+	// 'mediaInfo' - in/out, media information containing the fingerprint to query.
+	// 'includeLoudness' - whether to apply the track gain and true peak level, which depend on the whole of the track (so should only be applied if the fingerprint covers the whole track).
+	// Returns true if analysis results were found.
+	bool GetCachedAnalysis( MediaInfo& mediaInfo, const bool includeLoudness );
+
+	// Stores the analysis results from 'mediaInfo' against its audio content fingerprint.
+	// Returns true if the analysis table was updated.
+	bool UpdateCachedAnalysis( const MediaInfo& mediaInfo );
+
 	// Updates the media library.
 	// 'mediaInfo' - media information.
 	// Returns true if the library was updated.
@@ -0,0 +1,254 @@
+#include "Limiter.h"
+
+#include "SampleKernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Pi.
+static const double s_Pi = 3.14159265358979323846;
+
+// Number of oversampling filter taps per phase.
+static const long s_FilterTaps = 12;
+
+// Number of interpolated phases between each sample (giving 4x oversampling).
+static const long s_FilterPhases = 3;
+
+// Lookahead, in seconds.
+static const float s_LookaheadSeconds = 0.0015f;
+
+// Release time, in seconds.
+static const float s_ReleaseSeconds = 0.1f;
+
+// Time over which limiting is ramped in or out, when the limiter is enabled or disabled, in seconds.
+static const float s_EnableSeconds = 0.01f;
+
+// Maximum number of samples per channel in each processing block.
+static const long s_BlockSize = 256;
+
+// Returns a circular buffer 'position', which must be less than twice the buffer 'capacity', wrapped to the buffer.
+static long Wrap( const long position, const long capacity )
+{
+	return ( position < capacity ) ? position : ( position - capacity );
+}
+
+Limiter::Limiter( const long channels, const long sampleRate, const float ceiling ) :
+	m_Channels( std::max( channels, 1l ) ),
+	m_Ceiling( powf( 10.0f, ceiling / 20.0f ) ),
+	m_Lookahead( std::max( static_cast<long>( 0.5f + s_LookaheadSeconds * sampleRate ), 1l ) ),
+	m_Latency( m_Lookahead - 1 + s_FilterTaps / 2 ),
+	m_ReleaseCoefficient( ( sampleRate > 0 ) ? ( 1.0f - expf( -1.0f / ( s_ReleaseSeconds * sampleRate ) ) ) : 1.0f ),
+	m_AmountStep( ( sampleRate > 0 ) ? std::min( 1.0f / ( s_EnableSeconds * sampleRate ), 1.0f ) : 1.0f ),
+	m_FilterCoefficients( s_FilterPhases * s_FilterTaps ),
+	m_FilterInput( static_cast<size_t>( m_Channels ) * ( s_FilterTaps - 1 + s_BlockSize ) ),
+	m_Peaks( s_BlockSize ),
+	m_Gains( s_BlockSize ),
+	m_Delay( static_cast<size_t>( m_Channels ) * m_Latency ),
+	m_DelayBuffer( static_cast<size_t>( m_Channels ) * ( m_Latency + s_BlockSize ) ),
+	m_DelayPending( 0 ),
+	m_MinimumValues( m_Lookahead + 1 ),
+	m_MinimumIndices( m_Lookahead + 1 ),
+	m_MinimumStart( 0 ),
+	m_MinimumCount( 0 ),
+	m_SampleIndex( 0 ),
+	m_ReleaseGain( 1.0f ),
+	m_SmoothingWindow( m_Lookahead ),
+	m_SmoothingPosition( 0 ),
+	m_SmoothingTotal( 0 ),
+	m_Enabled( true ),
+	m_Amount( 1.0f )
+{
+	// Blackman windowed sinc interpolation filters, for each phase between the middle two taps of the filter history.
+	const double halfWidth = s_FilterTaps / 2;
+	for ( long phase = 0; phase < s_FilterPhases; phase++ ) {
+		const double fraction = static_cast<double>( 1 + phase ) / ( 1 + s_FilterPhases );
+		double total = 0;
+		for ( long tap = 0; tap < s_FilterTaps; tap++ ) {
+			const double x = halfWidth - 1 + fraction - tap;
+			const double sinc = ( 0 == x ) ? 1.0 : ( sin( s_Pi * x ) / ( s_Pi * x ) );
+			const double window = 0.42 + 0.5 * cos( s_Pi * x / halfWidth ) + 0.08 * cos( 2 * s_Pi * x / halfWidth );
+			const double coefficient = sinc * window;
+			m_FilterCoefficients[ phase * s_FilterTaps + tap ] = static_cast<float>( coefficient );
+			total += coefficient;
+		}
+		if ( 0 != total ) {
+			for ( long tap = 0; tap < s_FilterTaps; tap++ ) {
+				m_FilterCoefficients[ phase * s_FilterTaps + tap ] = static_cast<float>( m_FilterCoefficients[ phase * s_FilterTaps + tap ] / total );
+			}
+		}
+	}
+	Reset();
+}
+
+Limiter::~Limiter()
+{
+}
+
+void Limiter::Process( float* buffer, const long sampleCount, const float inputScale )
+{
+	if ( nullptr != buffer ) {
+		for ( long offset = 0; offset < sampleCount; offset += s_BlockSize ) {
+			ProcessBlock( buffer + offset * m_Channels, std::min( s_BlockSize, sampleCount - offset ), inputScale );
+		}
+	}
+}
+
+long Limiter::Flush( float* buffer, const long sampleCount )
+{
+	long samplesFlushed = 0;
+	if ( ( nullptr != buffer ) && ( sampleCount > 0 ) ) {
+		const long pending = m_DelayPending;
+		samplesFlushed = std::min( sampleCount, pending );
+		std::fill( buffer, buffer + samplesFlushed * m_Channels, 0.0f );
+		Process( buffer, samplesFlushed, 1.0f /*inputScale*/ );
+		m_DelayPending = pending - samplesFlushed;
+	}
+	return samplesFlushed;
+}
+
+void Limiter::Reset()
+{
+	std::fill( m_FilterInput.begin(), m_FilterInput.end(), 0.0f );
+	std::fill( m_Delay.begin(), m_Delay.end(), 0.0f );
+	m_DelayPending = 0;
+	m_SampleIndex = 0;
+	m_Amount = m_Enabled ? 1.0f : 0.0f;
+	ResetGain();
+}
+
+void Limiter::ResetGain()
+{
+	m_MinimumStart = 0;
+	m_MinimumCount = 0;
+	m_ReleaseGain = 1.0f;
+	std::fill( m_SmoothingWindow.begin(), m_SmoothingWindow.end(), 1.0f );
+	m_SmoothingPosition = 0;
+	m_SmoothingTotal = static_cast<double>( m_Lookahead );
+}
+
+void Limiter::SetEnabled( const bool enabled )
+{
+	if ( enabled && !m_Enabled && ( 0 == m_Amount ) ) {
+		// The gain calculation is skipped while fully bypassed, so start it afresh.
+		ResetGain();
+	}
+	m_Enabled = enabled;
+}
+
+bool Limiter::GetEnabled() const
+{
+	return m_Enabled;
+}
+
+long Limiter::GetChannels() const
+{
+	return m_Channels;
+}
+
+long Limiter::GetLatency() const
+{
+	return m_Latency;
+}
+
+void Limiter::ProcessBlock( float* buffer, const long sampleCount, const float inputScale )
+{
+	if ( 1.0f != inputScale ) {
+		ScaleSamples( buffer, static_cast<size_t>( sampleCount ) * m_Channels, inputScale );
+	}
+
+	// Append the sample data for each channel to its oversampling filter history.
+	const long historyLength = s_FilterTaps - 1;
+	const long filterInputLength = historyLength + s_BlockSize;
+	for ( long channel = 0; channel < m_Channels; channel++ ) {
+		float* filterInput = &m_FilterInput[ channel * filterInputLength + historyLength ];
+		for ( long sampleIndex = 0; sampleIndex < sampleCount; sampleIndex++ ) {
+			filterInput[ sampleIndex ] = buffer[ sampleIndex * m_Channels + channel ];
+		}
+	}
+
+	// The gain calculation is skipped while fully bypassed.
+	const bool bypassed = !m_Enabled && ( 0 == m_Amount );
+	if ( bypassed ) {
+		m_SampleIndex += sampleCount;
+	} else {
+		// Determine the true peak level of each sample frame across all channels, then the gain required for each frame in turn.
+		std::fill( m_Peaks.begin(), m_Peaks.begin() + sampleCount, 0.0f );
+		for ( long channel = 0; channel < m_Channels; channel++ ) {
+			UpdateInterpolatedPeaks( m_Peaks.data(), &m_FilterInput[ channel * filterInputLength ], static_cast<size_t>( sampleCount ), m_FilterCoefficients.data(), s_FilterTaps, s_FilterPhases );
+		}
+		for ( long sampleIndex = 0; sampleIndex < sampleCount; sampleIndex++ ) {
+			m_Gains[ sampleIndex ] = CalculateGain( m_Peaks[ sampleIndex ] );
+			++m_SampleIndex;
+		}
+	}
+
+	// Keep the most recent sample data for each channel as the oversampling filter history for the next block.
+	for ( long channel = 0; channel < m_Channels; channel++ ) {
+		float* filterInput = &m_FilterInput[ channel * filterInputLength ];
+		std::copy( filterInput + sampleCount, filterInput + sampleCount + historyLength, filterInput );
+	}
+
+	// Delay the sample data, and apply the gain.
+	const size_t delayValues = m_Delay.size();
+	const size_t blockValues = static_cast<size_t>( sampleCount ) * m_Channels;
+	std::copy( m_Delay.begin(), m_Delay.end(), m_DelayBuffer.begin() );
+	std::copy( buffer, buffer + blockValues, m_DelayBuffer.begin() + delayValues );
+	std::copy( m_DelayBuffer.begin(), m_DelayBuffer.begin() + blockValues, buffer );
+	std::copy( m_DelayBuffer.begin() + blockValues, m_DelayBuffer.begin() + blockValues + delayValues, m_Delay.begin() );
+	if ( !bypassed ) {
+		ApplyGainRamp( buffer, static_cast<size_t>( sampleCount ), m_Channels, m_Gains.data() );
+	}
+	m_DelayPending = std::min( m_DelayPending + sampleCount, m_Latency );
+}
+
+float Limiter::CalculateGain( const float peak )
+{
+	// Move the amount of limiting towards its target, so that enabling or disabling the limiter does not cause a step in level.
+	if ( m_Enabled ) {
+		m_Amount = std::min( m_Amount + m_AmountStep, 1.0f );
+	} else {
+		m_Amount = std::max( m_Amount - m_AmountStep, 0.0f );
+	}
+
+	float gain = 1.0f;
+	if ( m_Amount > 0 ) {
+		// Determine the gain required to keep the true peak level below the ceiling, and hold the minimum gain across the lookahead window.
+		const float requiredGain = ( peak > m_Ceiling ) ? ( m_Ceiling / peak ) : 1.0f;
+		const float minimumGain = UpdateMinimum( requiredGain );
+		if ( minimumGain < m_ReleaseGain ) {
+			m_ReleaseGain = minimumGain;
+		} else {
+			m_ReleaseGain += ( minimumGain - m_ReleaseGain ) * m_ReleaseCoefficient;
+		}
+
+		// Average the gain across the lookahead window, so that gain reduction is fully ramped in by the time a peak is output.
+		m_SmoothingTotal += m_ReleaseGain - m_SmoothingWindow[ m_SmoothingPosition ];
+		m_SmoothingWindow[ m_SmoothingPosition ] = m_ReleaseGain;
+		m_SmoothingPosition = Wrap( m_SmoothingPosition + 1, m_Lookahead );
+		const float limitGain = std::min( static_cast<float>( m_SmoothingTotal / m_Lookahead ), 1.0f );
+		gain = 1.0f - m_Amount * ( 1.0f - limitGain );
+	}
+	return gain;
+}
+
+float Limiter::UpdateMinimum( const float gain )
+{
+	const long capacity = static_cast<long>( m_MinimumValues.size() );
+
+	// Remove any values that have left the window.
+	while ( ( m_MinimumCount > 0 ) && ( m_MinimumIndices[ m_MinimumStart ] <= ( m_SampleIndex - capacity ) ) ) {
+		m_MinimumStart = Wrap( m_MinimumStart + 1, capacity );
+		--m_MinimumCount;
+	}
+
+	// Remove any values which can no longer be the minimum, and add the new value.
+	while ( ( m_MinimumCount > 0 ) && ( m_MinimumValues[ Wrap( m_MinimumStart + m_MinimumCount - 1, capacity ) ] >= gain ) ) {
+		--m_MinimumCount;
+	}
+	const long position = Wrap( m_MinimumStart + m_MinimumCount, capacity );
+	m_MinimumValues[ position ] = gain;
+	m_MinimumIndices[ position ] = m_SampleIndex;
+	++m_MinimumCount;
+
+	return m_MinimumValues[ m_MinimumStart ];
+}
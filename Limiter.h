@@ -0,0 +1,130 @@
+#pragma once
+
+#include <vector>
+
+// Lookahead true peak limiter.
+class Limiter
+{
+public:
+	// 'channels' - number of channels.
+	// 'sampleRate' - sample rate.
+	// 'ceiling' - maximum true peak level, in dBTP.
+	Limiter( const long channels, const long sampleRate, const float ceiling = -1.0f );
+
+	virtual ~Limiter();
+
+	// Limits the sample data in 'buffer', containing 'sampleCount' samples per channel.
+	// 'inputScale' - linear gain to apply to the sample data before limiting, in the same pass.
+	// Note that the output is delayed by the limiter latency.
+	void Process( float* buffer, const long sampleCount, const float inputScale = 1.0f );
+
+	// Flushes out any sample data that has been delayed by the limiter.
+	// 'buffer' - out, sample data.
+	// 'sampleCount' - maximum number of samples per channel to flush.
+	// Returns the number of samples per channel written to the 'buffer'.
+	long Flush( float* buffer, const long sampleCount );
+
+	// Resets the limiter, discarding any delayed sample data.
+	void Reset();
+
+	// Sets whether limiting is 'enabled'.
+	// The amount of limiting is ramped in or out, and sample data is still delayed while disabled, so that the limiter can be switched without a discontinuity.
+	void SetEnabled( const bool enabled );
+
+	// Returns whether limiting is enabled.
+	bool GetEnabled() const;
+
+	// Returns the number of channels.
+	long GetChannels() const;
+
+	// Returns the limiter latency, in samples per channel.
+	long GetLatency() const;
+
+private:
+	// Limits a block of sample data.
+	// 'buffer' - in/out, sample data.
+	// 'sampleCount' - number of samples per channel, which must not exceed the block size.
+	// 'inputScale' - linear gain to apply to the sample data before limiting.
+	void ProcessBlock( float* buffer, const long sampleCount, const float inputScale );
+
+	// Returns the gain to apply to the next sample frame, given the true 'peak' level across all channels at the end of the lookahead window.
+	float CalculateGain( const float peak );
+
+	// Resets the gain calculation state, leaving the oversampling filter history and delay line intact.
+	void ResetGain();
+
+	// Adds a 'gain' value to the sliding window minimum filter, returning the minimum gain across the window.
+	float UpdateMinimum( const float gain );
+
+	// Number of channels.
+	const long m_Channels;
+
+	// Maximum true peak level, as a linear value.
+	const float m_Ceiling;
+
+	// Lookahead, in samples per channel.
+	const long m_Lookahead;
+
+	// Latency, in samples per channel.
+	const long m_Latency;
+
+	// Release smoothing coefficient.
+	const float m_ReleaseCoefficient;
+
+	// Change in the amount of limiting per sample, when the limiter is enabled or disabled.
+	const float m_AmountStep;
+
+	// Oversampling filter coefficients, for each interpolated phase.
+	std::vector<float> m_FilterCoefficients;
+
+	// Oversampling filter input, for each channel, containing the filter history followed by a block of sample data.
+	std::vector<float> m_FilterInput;
+
+	// True peak level of each sample frame in the current block.
+	std::vector<float> m_Peaks;
+
+	// Gain to apply to each sample frame in the current block.
+	std::vector<float> m_Gains;
+
+	// Delay line, containing interleaved sample data (oldest first).
+	std::vector<float> m_Delay;
+
+	// Delay line followed by a block of interleaved sample data.
+	std::vector<float> m_DelayBuffer;
+
+	// Number of samples per channel in the delay line that have not yet been output.
+	long m_DelayPending;
+
+	// Sliding window minimum filter values.
+	std::vector<float> m_MinimumValues;
+
+	// Sliding window minimum filter sample indices.
+	std::vector<long long> m_MinimumIndices;
+
+	// Sliding window minimum filter start position.
+	long m_MinimumStart;
+
+	// Sliding window minimum filter count.
+	long m_MinimumCount;
+
+	// Current sample index.
+	long long m_SampleIndex;
+
+	// Current gain, following release smoothing.
+	float m_ReleaseGain;
+
+	// Gain smoothing window.
+	std::vector<float> m_SmoothingWindow;
+
+	// Current gain smoothing window position.
+	long m_SmoothingPosition;
+
+	// Gain smoothing window total.
+	double m_SmoothingTotal;
+
+	// Indicates whether limiting is enabled.
+	bool m_Enabled;
+
+	// Amount of limiting currently applied (0.0 when bypassed, 1.0 when fully applied).
+	float m_Amount;
+};
@@ -139,6 +139,36 @@ public:
 	// Sets the album gain, in dB.
 	void SetGainAlbum( const std::optional<float> gain );
 
+	// Returns the crossfade position, in seconds from the start of the track (or nullopt if the position has not been calculated).
+	std::optional<float> GetCrossfadePosition() const;
+
+	// Sets the crossfade position, in seconds from the start of the track.
+	void SetCrossfadePosition( const std::optional<float> position );
+
+	// Returns the true peak level, in dBTP (or nullopt if the level has not been calculated).
+	std::optional<float> GetTruePeak() const;
+
+	// Sets the true peak level, in dBTP.
+	void SetTruePeak( const std::optional<float> peak );
+
+	// Returns the duration of silence at the start of the track, in seconds (or nullopt if the duration has not been calculated).
+	std::optional<float> GetLeadingSilence() const;
+
+	// Sets the duration of silence at the start of the track, in seconds.
+	void SetLeadingSilence( const std::optional<float> silence );
+
+	// Returns the duration of silence at the end of the track, in seconds (or nullopt if the duration has not been calculated).
+	std::optional<float> GetTrailingSilence() const;
+
+	// Sets the duration of silence at the end of the track, in seconds.
+	void SetTrailingSilence( const std::optional<float> silence );
+
+	// Returns the audio content fingerprint (or an empty string if the fingerprint has not been calculated).
+	std::wstring GetFingerprint() const;
+
+	// Sets the audio content fingerprint.
+	void SetFingerprint( const std::wstring& fingerprint );
+
 	// Returns the title
 	// 'filenameAsTitle' - whether to return the filename if there is no title.
 	std::wstring GetTitle( const bool filenameAsTitle = false ) const;
@@ -197,5 +227,10 @@ private:
 	std::optional<float> m_Bitrate = std::nullopt;
 	std::optional<float> m_GainTrack = std::nullopt;
 	std::optional<float> m_GainAlbum = std::nullopt;
+	std::optional<float> m_CrossfadePosition = std::nullopt;
+	std::optional<float> m_TruePeak = std::nullopt;
+	std::optional<float> m_LeadingSilence = std::nullopt;
+	std::optional<float> m_TrailingSilence = std::nullopt;
+	std::wstring m_Fingerprint = {};
 };
 
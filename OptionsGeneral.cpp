@@ -12,7 +12,9 @@
 std::vector<std::pair<Settings::OutputMode,int>> OptionsGeneral::s_OutputModes = {
 	std::make_pair( Settings::OutputMode::Standard, IDS_OPTIONS_MODE_STANDARD ),
 	std::make_pair( Settings::OutputMode::WASAPIExclusive, IDS_OPTIONS_MODE_WASAPI_EXCLUSIVE ),
-	std::make_pair( Settings::OutputMode::ASIO, IDS_OPTIONS_MODE_ASIO )
+	std::make_pair( Settings::OutputMode::ASIO, IDS_OPTIONS_MODE_ASIO ),
+	std::make_pair( Settings::OutputMode::Null, IDS_OPTIONS_MODE_NULL ),
+	std::make_pair( Settings::OutputMode::File, IDS_OPTIONS_MODE_FILE )
 };
 
 OptionsGeneral::OptionsGeneral( HINSTANCE instance, Settings& settings, Output& output ) :
@@ -241,7 +243,8 @@ void OptionsGeneral::RefreshOutputDeviceList( const HWND hwnd )
 
 			HWND hwndAdvanced = GetDlgItem( hwnd, IDC_OPTIONS_MODE_ADVANCED );
 			if ( nullptr != hwndAdvanced ) {
-				if ( Settings::OutputMode::Standard != GetSelectedMode( hwnd ) ) {
+				const Settings::OutputMode selectedMode = GetSelectedMode( hwnd );
+				if ( ( Settings::OutputMode::WASAPIExclusive == selectedMode ) || ( Settings::OutputMode::ASIO == selectedMode ) ) {
 					EnableWindow( hwndAdvanced, TRUE );
 				} else {
 					EnableWindow( hwndAdvanced, FALSE );
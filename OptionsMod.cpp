@@ -61,6 +61,14 @@ void OptionsMod::OnInit( const HWND hwnd )
 	LoadString( instance, IDS_LOOPING_FADE, buffer, bufferSize );
 	ComboBox_AddString( wndLooping, buffer );
 
+	// Crossfade curve combo
+	HWND wndCrossfadeCurve = GetDlgItem( hwnd, IDC_OPTIONS_CROSSFADE_CURVE );
+	LoadString( instance, IDS_CROSSFADECURVE_LINEAR, buffer, bufferSize );
+	ComboBox_AddString( wndCrossfadeCurve, buffer );
+	LoadString( instance, IDS_CROSSFADECURVE_EQUALPOWER, buffer, bufferSize );
+	ComboBox_AddString( wndCrossfadeCurve, buffer );
+	ComboBox_SetCurSel( wndCrossfadeCurve, static_cast<int>( GetSettings().GetCrossfadeCurve() ) );
+
 	Button_SetCheck( GetDlgItem( hwnd, IDC_OPTIONS_MOD_TYPEMOD ), BST_CHECKED );
 	UpdateControls( hwnd );
 }
@@ -74,6 +82,9 @@ void OptionsMod::OnSave( const HWND hwnd )
 		*m_CurrentSettings |= panning;
 	}
 	GetSettings().SetMODSettings( m_MODSettings, m_MTMSettings, m_S3MSettings, m_XMSettings, m_ITSettings );
+
+	const int crossfadeCurve = ComboBox_GetCurSel( GetDlgItem( hwnd, IDC_OPTIONS_CROSSFADE_CURVE ) );
+	GetSettings().SetCrossfadeCurve( ( 1 == crossfadeCurve ) ? Settings::CrossfadeCurve::EqualPower : Settings::CrossfadeCurve::Linear );
 }
 
 void OptionsMod::OnCommand( const HWND hwnd, const WPARAM wParam, const LPARAM /*lParam*/ )
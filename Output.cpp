@@ -1,7 +1,12 @@
 #include "Output.h"
 
 #include "Bling.h"
-#include "GainCalculator.h"
+#include "DecoderCached.h"
+#include "DecoderMixer.h"
+#include "DecoderResampler.h"
+#include "EncoderPCM.h"
+#include "SampleKernels.h"
+#include "TrackAnalysis.h"
 #include "Utility.h"
 #include "VUPlayer.h"
 
@@ -11,10 +16,28 @@
 #include "bassmix.h"
 #include "basswasapi.h"
 
+#include <array>
+#include <climits>
 #include <cmath>
+#include <thread>
 
-// Output buffer length, in seconds.
-static const float s_BufferLength = 1.5f;
+// Output stream buffer length, in seconds.
+static const float s_OutputBufferLength = 0.5f;
+
+// Maximum decode buffer size, in samples (limits the decode buffer length for high resolution multichannel streams).
+static const long s_MaximumDecodeBufferSamples = 0x400000;
+
+// Amount of sample data to decode between each update of the adaptive buffer statistics, in seconds.
+static const float s_DecodeStatisticsInterval = 10.0f;
+
+// Length of each block of sample data produced by the decode thread, in seconds.
+static const float s_DecodeBlockLength = 0.05f;
+
+// Time over which the output crossfades to the true peak limiter, when it is switched on during playback, in seconds.
+static const float s_LimiterCrossfadeLength = 0.01f;
+
+// Interval at which the decode thread tops up the decode buffer, in milliseconds.
+static const DWORD s_DecodeInterval = 10;
 
 // Cutoff point, in seconds, after which previous track replays the current track from the beginning.
 static const float s_PreviousTrackCutoff = 5.0f;
@@ -22,6 +45,15 @@ static const float s_PreviousTrackCutoff = 5.0f;
 // Amount of time to devote to estimating a gain value, in seconds.
 static const float s_GainPrecalcTime = 0.25f;
 
+// Maximum rate at which the applied gain moves towards a refined gain estimate, in dB per second.
+static const float s_GainTransitionRate = 3.0f;
+
+// Maximum number of loudness precalculation threads.
+static const unsigned int s_MaxLoudnessPrecalcThreads = 4;
+
+// Number of upcoming shuffled items which are prioritised for loudness precalculation, when random play is enabled.
+static const size_t s_LoudnessPrecalcShuffledItems = 10;
+
 // Minimum allowed gain adjustment, in dB.
 static const float s_GainMin = -20.0f;
 
@@ -31,8 +63,11 @@ static const float s_GainMax = 20.0f;
 // Fade out duration, in seconds.
 static const float s_FadeOutDuration = 5.0f;
 
-// The relative volume at which to set the crossfade position on a track.
-static const float s_CrossfadeVolume = 0.3f;
+// Level at or below which leading sample data is skipped as silence, in dBFS.
+static const float s_SilenceThreshold = -90.0f;
+
+// Amount of known leading silence which is decoded rather than skipped by seeking, in seconds (to allow for decoders which do not seek accurately).
+static const float s_SilenceSeekMargin = 0.5f;
 
 // The fade to next duration, in seconds.
 static const float s_FadeToNextDuration = 3.0f;
@@ -46,40 +81,27 @@ static const DWORD s_StopFadeDuration = 20;
 // Maximum number of playlist items to skip when trying to switch decoder streams.
 static const size_t s_MaxSkipItems = 20;
 
-// Define to output debug timing for slow StreamProc calls.
-#undef STREAMPROC_TIMING
+// The amount of sample data pulled from the output stream at a time in offline output modes, in seconds.
+static const float s_SinkBlockLength = 0.1f;
 
-DWORD CALLBACK Output::StreamProc( HSTREAM handle, void *buf, DWORD length, void *user )
+// Output file name (without file extension) for the file output mode.
+static const wchar_t s_SinkFilename[] = L"VUPlayer output";
+
+// Maximum number of entries in the output and stream title queues (older entries are discarded, so that the queues never reallocate).
+static const size_t s_OutputQueueCapacity = 64;
+
+DWORD CALLBACK Output::StreamProc( HSTREAM /*handle*/, void *buf, DWORD length, void *user )
 {
 	DWORD bytesRead = 0;
 	Output* output = static_cast<Output*>( user );
 	if ( nullptr != output ) {
-#ifdef STREAMPROC_TIMING
-		LARGE_INTEGER perfFreq, perfCount1, perfCount2;
-		QueryPerformanceFrequency( &perfFreq );
-		QueryPerformanceCounter( &perfCount1 );
-#endif
-
-		float* sampleBuffer = static_cast<float*>( buf );
-		bytesRead = output->ApplyLeadIn( sampleBuffer, length, handle );
-		length -= bytesRead;
-		if ( length > 0 ) {
-			sampleBuffer += bytesRead / 4;
-			bytesRead += output->ReadSampleData( sampleBuffer, length, handle );
-			if ( 0 == bytesRead ) {
-				bytesRead = BASS_STREAMPROC_END;
-				output->SetOutputStreamFinished( true );
-			}
-		}
-
-#ifdef STREAMPROC_TIMING
-		QueryPerformanceCounter( &perfCount2 );
-		const float msec = 1000 * static_cast<float>( perfCount2.QuadPart - perfCount1.QuadPart ) / perfFreq.QuadPart;
-		if ( msec >= 1.0f ) {
-			const std::wstring debugStr = L"VUPlayer::Output::StreamProc: " + std::to_wstring( msec ) + L"ms\r\n";
-			OutputDebugString( debugStr.c_str() );
+		const auto start = PlaybackMetrics::Clock::now();
+		bytesRead = output->ReadOutputBuffer( static_cast<float*>( buf ), length );
+		if ( 0 == bytesRead ) {
+			bytesRead = BASS_STREAMPROC_END;
+			output->SetOutputStreamFinished( true );
 		}
-#endif
+		output->m_Metrics.RecordTiming( PlaybackMetrics::Timing::StreamCallback, start );
 	}
 	return bytesRead;
 }
@@ -178,14 +200,38 @@ DWORD WINAPI Output::PreloadDecoderProc( LPVOID lpParam )
 	return 0;
 }
 
+DWORD WINAPI Output::DecodeThreadProc( LPVOID lpParam )
+{
+	Output* output = static_cast<Output*>( lpParam );
+	if ( nullptr != output ) {
+		output->DecodeHandler();
+	}
+	return 0;
+}
+
+DWORD WINAPI Output::SinkThreadProc( LPVOID lpParam )
+{
+	Output* output = static_cast<Output*>( lpParam );
+	if ( nullptr != output ) {
+		output->SinkHandler();
+	}
+	return 0;
+}
+
+bool Output::IsOfflineMode( const Settings::OutputMode mode )
+{
+	return ( Settings::OutputMode::Null == mode ) || ( Settings::OutputMode::File == mode );
+}
+
 Output::Output( const HINSTANCE instance, const HWND hwnd, const Handlers& handlers, Settings& settings, const float initialVolume ) :
 	m_hInst( instance ),
 	m_Parent( hwnd ),
 	m_Handlers( handlers ),
 	m_Settings( settings ),
+	m_PCMCache( static_cast<size_t>( settings.GetPCMCacheSize() ) * 0x100000 ),
 	m_Playlist(),
 	m_CurrentItemDecoding( {} ),
-	m_SoftClipStateDecoding(),
+	m_GainStateDecoding(),
 	m_DecoderStream(),
 	m_DecoderSampleRate( 0 ),
 	m_OutputStream( 0 ),
@@ -211,21 +257,31 @@ Output::Output( const HINSTANCE instance, const HWND hwnd, const Handlers& handl
 	m_SwitchToNext( false ),
 	m_FadeOutStartPosition( 0 ),
 	m_LastTransitionPosition( 0 ),
+	m_FadeInEndPosition( 0 ),
 	m_CrossfadePosition( 0 ),
 	m_CrossfadeItem( {} ),
 	m_CrossfadeThread( nullptr ),
 	m_CrossfadeStopEvent( CreateEvent( NULL /*attributes*/, TRUE /*manualReset*/, FALSE /*initialState*/, L"" /*name*/ ) ),
-	m_LoudnessPrecalcThread( nullptr ),
+	m_CrossfadeMutex(),
+	m_LoudnessPrecalcThreads(),
 	m_LoudnessPrecalcStopEvent( CreateEvent( NULL /*attributes*/, TRUE /*manualReset*/, FALSE /*initialState*/, L"" /*name*/ ) ),
+	m_LoudnessPrecalcWakeEvent( CreateEvent( NULL /*attributes*/, TRUE /*manualReset*/, FALSE /*initialState*/, L"" /*name*/ ) ),
+	m_LoudnessPrecalcQueue(),
+	m_LoudnessPrecalcQueueStale( false ),
+	m_LoudnessPrecalcCurrentID( 0 ),
+	m_LoudnessPrecalcChecked(),
+	m_LoudnessPrecalcPlaylist(),
+	m_LoudnessPrecalcMutex(),
 	m_PreloadDecoderThread( nullptr ),
 	m_PreloadDecoderStopEvent( CreateEvent( NULL /*attributes*/, TRUE /*manualReset*/, FALSE /*initialState*/, L"" /*name*/ ) ),
 	m_PreloadDecoderWakeEvent( CreateEvent( NULL /*attributes*/, TRUE /*manualReset*/, FALSE /*initialState*/, L"" /*name*/ ) ),
 	m_CrossfadingStream(),
 	m_CrossfadingStreamMutex(),
 	m_CurrentItemCrossfading( {} ),
-	m_SoftClipStateCrossfading(),
+	m_GainStateCrossfading(),
 	m_CrossfadeSeekOffset( 0 ),
 	m_GainEstimateMap(),
+	m_GainEstimateMutex(),
 	m_BlingMap(),
 	m_CurrentEQ( m_Settings.GetEQSettings() ),
 	m_FX(),
@@ -238,16 +294,54 @@ Output::Output( const HINSTANCE instance, const HWND hwnd, const Handlers& handl
 	m_ResetASIO( false ),
 	m_OutputStreamFinished( false ),
 	m_LeadInSeconds( 0 ),
+	m_NativeSampleRate( false ),
 	m_PreloadedDecoder( {} ),
 	m_PreloadedDecoderMutex(),
+	m_PreloadPrepareMutex(),
 	m_StreamTitleQueue(),
 	m_StreamTitleMutex(),
-	m_OnPlaylistChangeCallback( nullptr )
+	m_StreamTitlePosition(),
+	m_OnPlaylistChangeCallback( nullptr ),
+	m_OutputBuffer(),
+	m_DecodeBuffer(),
+	m_CrossfadeBuffer(),
+	m_FadeRamp(),
+	m_GainRamp(),
+	m_CrossfadeCurve( settings.GetCrossfadeCurve() ),
+	m_Limiter(),
+	m_LimiterFlushing( false ),
+	m_DecodeBlockTransition( false ),
+	m_DecodeBlockScale( 1.0f ),
+	m_DecodeThread( nullptr ),
+	m_DecodeStopEvent( CreateEvent( NULL /*attributes*/, TRUE /*manualReset*/, FALSE /*initialState*/, L"" /*name*/ ) ),
+	m_DecodeReadyEvent( CreateEvent( NULL /*attributes*/, TRUE /*manualReset*/, FALSE /*initialState*/, L"" /*name*/ ) ),
+	m_DecodeFinished( false ),
+	m_DecodedSamples( 0 ),
+	m_UnderrunSamples( 0 ),
+	m_UnderrunCount( 0 ),
+	m_OutputSamples( 0 ),
+	m_OutputFadeStart( 0 ),
+	m_OutputFadeFrontier( 0 ),
+	m_OutputFadeToNext( false ),
+	m_Metrics(),
+	m_AdaptiveBuffer(),
+	m_DecodeTarget( 0 ),
+	m_DecodeTargetUnderruns( 0 ),
+	m_DecodeStatistics(),
+	m_DecodeOnDemand( false ),
+	m_SinkThread( nullptr ),
+	m_SinkStopEvent( CreateEvent( NULL /*attributes*/, TRUE /*manualReset*/, FALSE /*initialState*/, L"" /*name*/ ) ),
+	m_SinkPaused( false ),
+	m_SinkFinished( false ),
+	m_SinkFilename()
 {
 	InitialiseBass();
 	SetVolume( initialVolume );
 	SetPitch( m_Pitch );
 
+	m_OutputQueue.reserve( s_OutputQueueCapacity );
+	m_StreamTitleQueue.reserve( s_OutputQueueCapacity );
+
 	m_Settings.GetGainSettings( m_GainMode, m_LimitMode, m_GainPreamp );
 	m_Settings.GetPlaybackSettings( m_RandomPlay, m_RepeatTrack, m_RepeatPlaylist, m_Crossfade );
 
@@ -259,14 +353,19 @@ Output::~Output()
 	StopCrossfadeThread();
 	CloseHandle( m_CrossfadeStopEvent );
 
-	StopLoudnessPrecalcThread();
+	StopLoudnessPrecalcThreads();
 	CloseHandle( m_LoudnessPrecalcStopEvent );
+	CloseHandle( m_LoudnessPrecalcWakeEvent );
 
 	StopPreloadDecoderThread();
 	CloseHandle( m_PreloadDecoderStopEvent );
 	CloseHandle( m_PreloadDecoderWakeEvent );
 
 	Stop();
+	CloseHandle( m_DecodeStopEvent );
+	CloseHandle( m_DecodeReadyEvent );
+	CloseHandle( m_SinkStopEvent );
+
 	if ( -1 != BASS_ASIO_GetDevice() ) {
 		BASS_ASIO_Free();
 	}
@@ -287,10 +386,10 @@ bool Output::Play( const long playlistID, const float seek )
 	}
 
 	if ( m_Playlist && m_Playlist->GetItem( item ) ) {
-		m_DecoderStream = OpenDecoder( item );
+		m_DecoderStream = OpenDecoder( item, true /*readAhead*/ );
 		if ( m_DecoderStream ) {
 
-			const DWORD outputBufferSize = static_cast<DWORD>( 1000 * ( ( ( MediaInfo::Source::CDDA ) == item.Info.GetSource() ) ? ( 2 * s_BufferLength ) : s_BufferLength ) );
+			const DWORD outputBufferSize = static_cast<DWORD>( 1000 * s_OutputBufferLength );
 			const DWORD previousOutputBufferSize = BASS_GetConfig( BASS_CONFIG_BUFFER );
 			if ( previousOutputBufferSize != outputBufferSize ) {
 				BASS_SetConfig( BASS_CONFIG_BUFFER, outputBufferSize );
@@ -301,6 +400,7 @@ bool Output::Play( const long playlistID, const float seek )
 			m_DecoderSampleRate = m_DecoderStream->GetSampleRate();
 			const DWORD freq = static_cast<DWORD>( m_DecoderSampleRate );
 			float seekPosition = seek;
+			float crossfadeOffset = 0;
 			if ( 0.0f != seekPosition ) {
 				if ( seekPosition < 0 ) {
 					seekPosition = item.Info.GetDuration() + seekPosition;
@@ -309,8 +409,9 @@ bool Output::Play( const long playlistID, const float seek )
 					}
 				}
 				seekPosition = m_DecoderStream->Seek( seekPosition );
+				crossfadeOffset = seekPosition;
 			} else if ( GetCrossfade() ) {
-				m_DecoderStream->SkipSilence();
+				crossfadeOffset = SkipSilence( *m_DecoderStream, item );
 			}
 
 			if ( CreateOutputStream( item.Info ) ) {
@@ -321,15 +422,16 @@ bool Output::Play( const long playlistID, const float seek )
 				}
 				UpdateEQ( m_CurrentEQ );
 
+				AddToOutputQueue( { item, 0, seekPosition } );
+
+				StartDecodeThread( m_AdaptiveBuffer.GetBufferLength( item.Info ) );
+
 				State state = StartOutput();
 				if ( State::Playing == state ) {
-					Queue queue = GetOutputQueue();
-					queue.push_back( { item, 0, seekPosition } );
-					SetOutputQueue( queue );
 					if ( GetCrossfade() ) {
-						CalculateCrossfadePoint( item, seekPosition );
+						CalculateCrossfadePoint( item, crossfadeOffset );
 					}
-					StartLoudnessPrecalcThread();
+					StartLoudnessPrecalcThreads();
 					PreloadNextDecoder( item );
 				} else {
 					Stop();
@@ -379,6 +481,9 @@ void Output::Stop()
 			}
 		}
 
+		StopSinkThread();
+		StopDecodeThread();
+
 		BASS_StreamFree( m_OutputStream );
 		m_OutputStream = 0;
 
@@ -393,24 +498,33 @@ void Output::Stop()
 	m_DecoderStream.reset();
 	m_CrossfadingStream.reset();
 	m_CurrentItemDecoding = {};
-	m_SoftClipStateDecoding.clear();
+	m_GainStateDecoding = {};
 	m_CurrentItemCrossfading = {};
-	m_SoftClipStateCrossfading.clear();
+	m_GainStateCrossfading = {};
 	m_RestartItemID = 0;
-	SetOutputQueue( {} );
+	ClearOutputQueue();
 	m_FadeOut = false;
 	m_FadeToNext = false;
 	m_SwitchToNext = false;
 	m_FadeOutStartPosition = 0;
+	CancelOutputFade();
 	m_LastTransitionPosition = 0;
+	m_FadeInEndPosition = 0;
 	m_WASAPIFailed = false;
 	m_WASAPIPaused = false;
 	m_OutputStreamFinished = false;
 	StopCrossfadeThread();
-	StopLoudnessPrecalcThread();
-	std::lock_guard<std::mutex> lock( m_PreloadedDecoderMutex );
-	m_PreloadedDecoder = {};
-	SetStreamTitleQueue( {} );
+	StopLoudnessPrecalcThreads();
+	{
+		std::lock_guard<std::mutex> lock( m_PreloadedDecoderMutex );
+		m_PreloadedDecoder = {};
+	}
+	{
+		// Wait for any decoder still being prepared, which is abandoned now that the request has been cleared, as the preload decoder thread uses the current playlist.
+		std::lock_guard<std::mutex> prepareLock( m_PreloadPrepareMutex );
+	}
+	ClearStreamTitleQueue();
+	m_StreamTitlePosition.reset();
 }
 
 void Output::Pause()
@@ -443,6 +557,13 @@ void Output::Pause()
 			}
 			break;
 		}
+		case Settings::OutputMode::Null :
+		case Settings::OutputMode::File : {
+			if ( ( State::Paused == state ) || ( State::Playing == state ) ) {
+				m_SinkPaused = !m_SinkPaused;
+			}
+			break;
+		}
 	}
 }
 
@@ -567,6 +688,17 @@ Output::State Output::GetState()
 			}
 			break;
 		}
+		case Settings::OutputMode::Null :
+		case Settings::OutputMode::File : {
+			if ( nullptr != m_SinkThread ) {
+				if ( m_SinkFinished ) {
+					Stop();
+				} else {
+					state = m_SinkPaused ? State::Paused : State::Playing;
+				}
+			}
+			break;
+		}
 	}
 	return state;
 }
@@ -577,21 +709,25 @@ Output::Item Output::GetCurrentPlaying()
 	const State state = GetState();
 	if ( State::Stopped != state ) {
 		const float seconds = GetOutputPosition();
-		const Queue queue = GetOutputQueue();
-		for ( auto iter = queue.rbegin(); iter != queue.rend(); iter++ ) {
-			const Item& item = *iter;
-			if ( item.Position <= seconds ) {
-				currentItem.PlaylistItem = item.PlaylistItem;
-				currentItem.Position = seconds - item.Position + item.InitialSeek;
-				break;
+		{
+			std::lock_guard<std::mutex> lock( m_QueueMutex );
+			for ( auto iter = m_OutputQueue.rbegin(); iter != m_OutputQueue.rend(); iter++ ) {
+				const Item& item = *iter;
+				if ( item.Position <= seconds ) {
+					currentItem.PlaylistItem = item.PlaylistItem;
+					currentItem.Position = seconds - item.Position + item.InitialSeek;
+					break;
+				}
 			}
 		}
-		const auto streamTitleQueue = GetStreamTitleQueue();
-		for ( auto iter = streamTitleQueue.rbegin(); iter != streamTitleQueue.rend(); iter++ ) {
-			const auto& [ titlePosition, title ] = *iter;
-			if ( titlePosition <= seconds ) {
-				currentItem.StreamTitle = title;
-				break;
+		{
+			std::lock_guard<std::mutex> lock( m_StreamTitleMutex );
+			for ( auto iter = m_StreamTitleQueue.rbegin(); iter != m_StreamTitleQueue.rend(); iter++ ) {
+				const auto& [ titlePosition, title ] = *iter;
+				if ( titlePosition <= seconds ) {
+					currentItem.StreamTitle = title;
+					break;
+				}
 			}
 		}
 	}
@@ -609,59 +745,66 @@ DWORD Output::ReadSampleData( float* buffer, const DWORD byteCount, HSTREAM hand
 
 			if ( GetCrossfade() && !GetFadeOut() && !GetFadeToNext() ) {
 				const float crossfadePosition = GetCrossfadePosition();			
-				if ( crossfadePosition > 0 ) {
-					bool checkCrossFade = ( GetRandomPlay() || GetRepeatTrack() );
-					if ( !checkCrossFade ) {
-						std::lock_guard<std::mutex> lock( m_PlaylistMutex );
-						Playlist::Item nextItem = {};
-						checkCrossFade = m_Playlist->GetNextItem( m_CurrentItemDecoding, nextItem, GetRepeatPlaylist() /*wrap*/ );
-					}
-					if ( checkCrossFade ) {
-						// Ensure we don't read past the crossfade point.
-						const long sampleRate = m_DecoderStream->GetSampleRate();
-						if ( sampleRate > 0 ) {
-							const float trackPos = GetDecodePosition() - m_LastTransitionPosition - m_LeadInSeconds;
-							const float secondsTillCrossfade = crossfadePosition - trackPos;
-							const long samplesTillCrossfade = static_cast<long>( secondsTillCrossfade * sampleRate );
-							if ( samplesTillCrossfade < samplesToRead ) {
-								samplesToRead = samplesTillCrossfade;
-								if ( samplesToRead <= 0 ) {
-									samplesToRead = 0;
-									// Hold on the the decoder, and indicate its fade out position.
-									std::lock_guard<std::mutex> crossfadingStreamLock( m_CrossfadingStreamMutex );
-									m_CrossfadingStream = m_DecoderStream;
-									m_CurrentItemCrossfading = m_CurrentItemDecoding;
-									m_SoftClipStateCrossfading = m_SoftClipStateDecoding;
-								}
+				const long sampleRate = m_DecoderStream->GetSampleRate();
+				if ( ( crossfadePosition > 0 ) && ( sampleRate > 0 ) ) {
+					// Ensure we don't read past the crossfade point.
+					const float trackPos = GetDecodePosition() - m_LastTransitionPosition - m_LeadInSeconds;
+					const float secondsTillCrossfade = crossfadePosition - trackPos;
+					const long samplesTillCrossfade = static_cast<long>( secondsTillCrossfade * sampleRate );
+					if ( samplesTillCrossfade < samplesToRead ) {
+						// Only check the playlist once the crossfade point has been reached.
+						bool checkCrossFade = ( GetRandomPlay() || GetRepeatTrack() );
+						if ( !checkCrossFade ) {
+							std::lock_guard<std::mutex> lock( m_PlaylistMutex );
+							checkCrossFade = m_Playlist->HasNextItem( m_CurrentItemDecoding, GetRepeatPlaylist() /*wrap*/ );
+						}
+						if ( checkCrossFade ) {
+							samplesToRead = samplesTillCrossfade;
+							if ( samplesToRead <= 0 ) {
+								samplesToRead = 0;
+								// Hold on the the decoder, and indicate its fade out position.
+								std::lock_guard<std::mutex> crossfadingStreamLock( m_CrossfadingStreamMutex );
+								m_CrossfadingStream = m_DecoderStream;
+								m_CurrentItemCrossfading = m_CurrentItemDecoding;
+								m_GainStateCrossfading = m_GainStateDecoding;
+								m_DecodeBlockTransition = true;
+								// The next track starts from the current decode position, as the outgoing track starts to fade.
+								m_FadeInEndPosition = GetDecodePosition() + GetFadeOutDuration();
 							}
 						}
 					}
 				}
 			} else if ( GetFadeToNext() && m_SwitchToNext ) {
+				// The next track starts part way through the fade out, so fade it in to match the remainder of the outgoing fade.
+				m_FadeInEndPosition = m_FadeOutStartPosition + GetFadeOutDuration();
 				ToggleFadeToNext();
 				samplesToRead = 0;
 				std::lock_guard<std::mutex> crossfadingStreamLock( m_CrossfadingStreamMutex );
 				m_CrossfadingStream = m_DecoderStream;
 				m_CurrentItemCrossfading = m_CurrentItemDecoding;
 				m_CurrentItemCrossfading.ID = s_ItemIsFadingToNext;
-				m_SoftClipStateCrossfading = m_SoftClipStateDecoding;
+				m_GainStateCrossfading = m_GainStateDecoding;
+				m_DecodeBlockTransition = true;
 			}
 
 			bytesRead = static_cast<DWORD>( m_DecoderStream->Read( buffer, samplesToRead ) * channels * 4 );
 		}
 
 		if ( m_DecoderStream->SupportsStreamTitles() ) {
-			auto streamTitleQueue = GetStreamTitleQueue();
-			const auto [ seconds, displayTitle ] = m_DecoderStream->GetStreamTitle();
-			if ( m_StreamTitleQueue.empty() || ( seconds != m_StreamTitleQueue.back().first ) ) {
-				streamTitleQueue.push_back( { seconds, displayTitle } );
-				SetStreamTitleQueue( streamTitleQueue );
+			// Only fetch the stream title when it has changed.
+			const float titlePosition = m_DecoderStream->GetStreamTitlePosition();
+			if ( !m_StreamTitlePosition.has_value() || ( titlePosition != m_StreamTitlePosition.value() ) ) {
+				m_StreamTitlePosition = titlePosition;
+				m_DecodeBlockTransition = true;
+				const auto [ seconds, displayTitle ] = m_DecoderStream->GetStreamTitle();
+				AddToStreamTitleQueue( seconds, displayTitle );
 			}
 		}
 	}
 
 	// Check if we need to switch to the next decoder stream.
 	if ( 0 == bytesRead ) {
+		m_DecodeBlockTransition = true;
 		SetCrossfadePosition( 0 );
 		m_LastTransitionPosition = 0;
 
@@ -669,29 +812,30 @@ DWORD Output::ReadSampleData( float* buffer, const DWORD byteCount, HSTREAM hand
 			// Set a sync on the output stream, so that the states can be toggled when playback actually finishes.
 			m_RestartItemID = {};
 			BASS_ChannelSetSync( handle, BASS_SYNC_END | BASS_SYNC_ONETIME, 0 /*param*/, SyncEnd, this );
-		} else if ( m_DecoderStream && ( 0 != BASS_ChannelGetPosition( m_OutputStream, BASS_POS_DECODE ) ) && !IsURL( m_CurrentItemDecoding.Info.GetFilename() ) ) {
+		} else if ( m_DecoderStream && ( 0 != m_DecodedSamples ) && !IsURL( m_CurrentItemDecoding.Info.GetFilename() ) ) {
 			// Create a stream from the next playlist item, but not if there has been an error starting playback, or if the previous or next stream is a URL.
-			Playlist::Item nextItem = m_CurrentItemDecoding;
-			Decoder::Ptr nextDecoder = GetNextDecoder( nextItem );
+			// The next decoder is normally prepared ahead of time by the preload decoder thread, so that the transition only needs to switch to it.
+			PreloadedDecoder next = GetNextDecoder( m_CurrentItemDecoding );
+			Playlist::Item& nextItem = next.item;
+			Decoder::Ptr& nextDecoder = next.decoder;
 			if ( nextDecoder && !IsURL( nextItem.Info.GetFilename() ) ) {
-				EstimateGain( nextItem );
 				const long channels = m_DecoderStream->GetChannels();
-				const long sampleRate = m_DecoderStream->GetSampleRate();
-				if ( ( nextDecoder->GetChannels() == channels ) && ( nextDecoder->GetSampleRate() == sampleRate ) ) {
-					if ( GetCrossfade() || GetFadeToNext() ) {
-						nextDecoder->SkipSilence();
-					}
-
+				if ( ( nextDecoder->GetChannels() == channels ) && ( nextDecoder->GetSampleRate() == m_DecoderStream->GetSampleRate() ) ) {
 					const long sampleCount = static_cast<long>( byteCount ) / ( channels * 4 );
 					bytesRead = static_cast<DWORD>( nextDecoder->Read( buffer, sampleCount ) * channels * 4 );
 					if ( bytesRead > 0 ) {
 						m_LastTransitionPosition = GetDecodePosition() - m_LeadInSeconds;
-						Queue queue = GetOutputQueue();
-						queue.push_back( { nextItem, m_LastTransitionPosition } );
-						SetOutputQueue( queue );
-
-						if ( GetCrossfade() && ( 0 != bytesRead ) ) {
-							CalculateCrossfadePoint( nextItem );
+						AddToOutputQueue( { nextItem, m_LastTransitionPosition } );
+
+						if ( GetCrossfade() ) {
+							if ( next.crossfadePosition.has_value() ) {
+								// Any calculation still running for the outgoing track is signalled to stop, without waiting for it.
+								std::lock_guard<std::mutex> crossfadeLock( m_CrossfadeMutex );
+								SetEvent( m_CrossfadeStopEvent );
+								SetCrossfadePosition( next.crossfadePosition.value() - next.crossfadeOffset );
+							} else {
+								CalculateCrossfadePoint( nextItem, next.crossfadeOffset );
+							}
 						}
 					} else {
 						nextItem = {};
@@ -702,6 +846,10 @@ DWORD Output::ReadSampleData( float* buffer, const DWORD byteCount, HSTREAM hand
 
 			m_DecoderStream = nextDecoder;
 			m_CurrentItemDecoding = nextItem;
+			m_GainStateDecoding.EstimatedGain.reset();
+			if ( nextItem.ID > 0 ) {
+				WakeLoudnessPrecalc( nextItem.ID );
+			}
 
 			if ( ( 0 == bytesRead ) && ( nextItem.ID > 0 ) ) {
 				// Signal that playback should be restarted from the next playlist item.
@@ -712,31 +860,51 @@ DWORD Output::ReadSampleData( float* buffer, const DWORD byteCount, HSTREAM hand
 				if ( m_CrossfadingStream ) {
 					m_CrossfadingStream.reset();
 					m_CurrentItemCrossfading = {};
-					m_SoftClipStateCrossfading.clear();
+					m_GainStateCrossfading = {};
 				}
 			}
 		}
 	}
 
 	if ( 0 != bytesRead ) {
-		const long currentDecodingChannels = m_CurrentItemDecoding.Info.GetChannels();
+		const long currentDecodingChannels = m_DecoderStream ? m_DecoderStream->GetChannels() : 0;
 		if ( currentDecodingChannels > 0 ) {
-			ApplyGain( buffer, static_cast<long>( bytesRead / ( currentDecodingChannels * 4 ) ), m_CurrentItemDecoding, m_SoftClipStateDecoding );
+			m_DecodeBlockScale = ApplyGain( buffer, static_cast<long>( bytesRead / ( currentDecodingChannels * 4 ) ), currentDecodingChannels, m_CurrentItemDecoding, m_GainStateDecoding, static_cast<bool>( m_Limiter ) /*deferScale*/ );
+
+			if ( m_FadeInEndPosition > 0 ) {
+				// Fade in the incoming track with the complement of the outgoing fade, so that the combined power stays constant for an equal power curve.
+				// This continues until the fade is complete, even if the outgoing track has already finished.
+				const float currentPos = GetDecodePosition();
+				const long samplerate = m_DecoderStream->GetSampleRate();
+				if ( ( currentPos < m_FadeInEndPosition ) && ( samplerate > 0 ) ) {
+					if ( Settings::CrossfadeCurve::EqualPower == m_CrossfadeCurve ) {
+						const long sampleCount = static_cast<long>( bytesRead ) / ( currentDecodingChannels * 4 );
+						const float fadeInPosition = 1.0f - ( m_FadeInEndPosition - currentPos ) / GetFadeOutDuration();
+						GenerateGainRamp( m_FadeRamp.data(), sampleCount, fadeInPosition, -1.0f / ( samplerate * GetFadeOutDuration() ), true /*equalPower*/ );
+						ApplyGainRamp( buffer, sampleCount, currentDecodingChannels, m_FadeRamp.data() );
+					}
+				} else {
+					m_FadeInEndPosition = 0;
+				}
+			}
 		}
 
 		std::lock_guard<std::mutex> crossfadingStreamLock( m_CrossfadingStreamMutex );
 		if ( m_CrossfadingStream ) {
 			// Decode and fade out the crossfading stream and mix with the final output buffer.
-			const long channels = m_CurrentItemCrossfading.Info.GetChannels();
-			const long samplerate = m_CurrentItemCrossfading.Info.GetSampleRate();
+			const long channels = m_CrossfadingStream->GetChannels();
+			const long samplerate = m_CrossfadingStream->GetSampleRate();
 			if ( ( channels > 0 ) && ( samplerate > 0 ) ) {
-				const long samplesToRead = static_cast<long>( bytesRead ) / ( channels * 4 );
-				std::vector<float> crossfadingBuffer( bytesRead / 4 );
-				const long crossfadingBytesRead = m_CrossfadingStream->Read( &crossfadingBuffer[ 0 ], samplesToRead ) * channels * 4;
-				ApplyGain( &crossfadingBuffer[ 0 ], crossfadingBytesRead / ( channels * 4 ), m_CurrentItemCrossfading, m_SoftClipStateCrossfading );
+				// Note that the scratch buffers are allocated up front for a whole decode block, in StartDecodeThread.
+				const long samplesToRead = (std::min)( static_cast<long>( bytesRead ) / ( channels * 4 ), static_cast<long>( m_CrossfadeBuffer.size() ) / channels );
+				float* crossfadingBuffer = m_CrossfadeBuffer.data();
+				const long crossfadingBytesRead = m_CrossfadingStream->Read( crossfadingBuffer, samplesToRead ) * channels * 4;
+				ApplyGain( crossfadingBuffer, crossfadingBytesRead / ( channels * 4 ), channels, m_CurrentItemCrossfading, m_GainStateCrossfading );
 				if ( crossfadingBytesRead <= static_cast<long>( bytesRead ) ) {
 					long crossfadingSamplesRead = crossfadingBytesRead / ( channels * 4 );
 
+					const float fadeStep = 1.0f / ( samplerate * GetFadeOutDuration() );
+					const bool equalPower = ( Settings::CrossfadeCurve::EqualPower == m_CrossfadeCurve );
 					if ( s_ItemIsFadingToNext == m_CurrentItemCrossfading.ID ) {
 						// Fade to next track.
 						const float currentPos = GetDecodePosition();
@@ -745,32 +913,16 @@ DWORD Output::ReadSampleData( float* buffer, const DWORD byteCount, HSTREAM hand
 								crossfadingSamplesRead = 0;
 							} else {
 								const float fadeOutEndPosition = m_FadeOutStartPosition + GetFadeOutDuration();
-								for ( long sampleIndex = 0; sampleIndex < crossfadingSamplesRead; sampleIndex++ ) {
-									const float pos = static_cast<float>( sampleIndex ) / samplerate;			
-									float scale = static_cast<float>( fadeOutEndPosition - currentPos - pos ) / GetFadeOutDuration();
-									if ( ( scale < 0 ) || ( scale > 1.0f ) ) {
-										scale = 0;
-									}
-									for ( long channel = 0; channel < channels; channel++ ) {
-										crossfadingBuffer[ sampleIndex * channels + channel ] *= scale;
-									}
-								}
+								GenerateGainRamp( m_FadeRamp.data(), crossfadingSamplesRead, ( fadeOutEndPosition - currentPos ) / GetFadeOutDuration(), fadeStep, equalPower );
 							}
+						} else {
+							std::fill( m_FadeRamp.begin(), m_FadeRamp.begin() + crossfadingSamplesRead, 1.0f );
 						}
 					} else {
 						// Crossfade.
 						const float trackPos = GetDecodePosition() - m_LastTransitionPosition - m_LeadInSeconds;
 						if ( ( crossfadingBytesRead > 0 ) && ( trackPos < GetFadeOutDuration() ) ) {				
-							for ( long sampleIndex = 0; sampleIndex < crossfadingSamplesRead; sampleIndex++ ) {
-								const float pos = static_cast<float>( sampleIndex ) / samplerate;			
-								float scale = static_cast<float>( GetFadeOutDuration() - trackPos - pos ) / GetFadeOutDuration();
-								if ( ( scale < 0 ) || ( scale > 1.0f ) ) {
-									scale = 0;
-								}
-								for ( long channel = 0; channel < channels; channel++ ) {
-									crossfadingBuffer[ sampleIndex * channels + channel ] *= scale;
-								}
-							}
+							GenerateGainRamp( m_FadeRamp.data(), crossfadingSamplesRead, ( GetFadeOutDuration() - trackPos ) / GetFadeOutDuration(), fadeStep, equalPower );
 						} else {
 							crossfadingSamplesRead = 0;
 						}
@@ -779,11 +931,14 @@ DWORD Output::ReadSampleData( float* buffer, const DWORD byteCount, HSTREAM hand
 					if ( 0 == crossfadingSamplesRead ) {
 						m_CrossfadingStream.reset();
 						m_CurrentItemCrossfading = {};
-						m_SoftClipStateCrossfading.clear();
+						m_GainStateCrossfading = {};
 					} else {
-						for ( long sample = 0; sample < crossfadingSamplesRead * channels; sample++ ) {
-							buffer[ sample ] += crossfadingBuffer[ sample ];
+						// The crossfading stream has its own gain, so any gain left for the limiter needs to be applied to the decoding stream before mixing.
+						if ( 1.0f != m_DecodeBlockScale ) {
+							ScaleSamples( buffer, bytesRead / 4, m_DecodeBlockScale );
+							m_DecodeBlockScale = 1.0f;
 						}
+						MixWithGainRamp( buffer, crossfadingBuffer, crossfadingSamplesRead, channels, m_FadeRamp.data() );
 					}
 				}
 			}
@@ -792,6 +947,10 @@ DWORD Output::ReadSampleData( float* buffer, const DWORD byteCount, HSTREAM hand
 
 	// Apply fade out on the currently decoding track, if necessary.
 	if ( ( GetFadeOut() || GetFadeToNext() ) && ( 0 != bytesRead ) && ( m_FadeOutStartPosition > 0 ) && m_DecoderStream ) {
+		// Any sample data decoded before this point is faded by the output stream callback instead.
+		long long frontier = LLONG_MAX;
+		m_OutputFadeFrontier.compare_exchange_strong( frontier, m_DecodedSamples + m_UnderrunSamples );
+
 		const float currentPos = GetDecodePosition();
 		const long channels = m_DecoderStream->GetChannels();
 		const long samplerate = m_DecoderStream->GetSampleRate();
@@ -804,16 +963,9 @@ DWORD Output::ReadSampleData( float* buffer, const DWORD byteCount, HSTREAM hand
 			} else {
 				const long sampleCount = static_cast<long>( bytesRead ) / ( channels * 4 );
 				const float fadeOutEndPosition = m_FadeOutStartPosition + GetFadeOutDuration();
-				for ( long sampleIndex = 0; sampleIndex < sampleCount; sampleIndex++ ) {
-					const float pos = static_cast<float>( sampleIndex ) / samplerate;			
-					float scale = static_cast<float>( fadeOutEndPosition - currentPos - pos ) / GetFadeOutDuration();
-					if ( ( scale < 0 ) || ( scale > 1.0f ) ) {
-						scale = 0;
-					}
-					for ( long channel = 0; channel < channels; channel++ ) {
-						buffer[ sampleIndex * channels + channel ] *= scale;
-					}
-				}
+				const bool equalPower = GetFadeToNext() && ( Settings::CrossfadeCurve::EqualPower == m_CrossfadeCurve );
+				GenerateGainRamp( m_FadeRamp.data(), sampleCount, ( fadeOutEndPosition - currentPos ) / GetFadeOutDuration(), 1.0f / ( samplerate * GetFadeOutDuration() ), equalPower );
+				ApplyGainRamp( buffer, sampleCount, channels, m_FadeRamp.data() );
 
 				if ( GetFadeToNext() && ( currentPos > ( m_FadeOutStartPosition + GetFadeToNextDuration() ) ) ) {
 					m_SwitchToNext = true;
@@ -995,8 +1147,11 @@ void Output::SetRandomPlay( const bool enabled )
 		if ( m_RandomPlay ) {
 			m_RepeatTrack = m_RepeatPlaylist = false;
 		}
-		std::lock_guard<std::mutex> lock( m_PreloadedDecoderMutex );
-		m_PreloadedDecoder = {};
+		{
+			std::lock_guard<std::mutex> lock( m_PreloadedDecoderMutex );
+			m_PreloadedDecoder = {};
+		}
+		WakeLoudnessPrecalc();
 	}
 }
 
@@ -1036,16 +1191,27 @@ void Output::SetCrossfade( const bool enabled )
 	m_Crossfade = enabled;
 	if ( m_Crossfade ) {
 		if ( GetState() != State::Stopped ) {
-			const Queue queue = GetOutputQueue();
-			auto iter = queue.rbegin();
-			if ( queue.rend() != iter ) {
-				const Item item = *iter;
-				CalculateCrossfadePoint( item.PlaylistItem, item.InitialSeek );
+			std::optional<Item> item;
+			{
+				std::lock_guard<std::mutex> lock( m_QueueMutex );
+				if ( !m_OutputQueue.empty() ) {
+					item = m_OutputQueue.back();
+				}
+			}
+			if ( item.has_value() ) {
+				CalculateCrossfadePoint( item->PlaylistItem, item->InitialSeek );
 			}
 		}
 	} else {
 		StopCrossfadeThread();
 	}
+
+	// Prepare the next decoder again, as it is prepared differently for a crossfade.
+	std::lock_guard<std::mutex> lock( m_PreloadedDecoderMutex );
+	const Playlist::Item preloadItem = ( m_PreloadedDecoder.item.ID > 0 ) ? m_PreloadedDecoder.item : m_PreloadedDecoder.itemToPreload;
+	if ( ( preloadItem.ID > 0 ) && ( m_PreloadedDecoder.crossfade != m_Crossfade ) ) {
+		RequestPreload( preloadItem );
+	}
 }
 
 bool Output::OnUpdatedMedia( const MediaInfo& mediaInfo )
@@ -1061,8 +1227,8 @@ bool Output::OnUpdatedMedia( const MediaInfo& mediaInfo )
 		}
 	} else {
 		const Item currentPlaying = GetCurrentPlaying();
-		Queue queue = GetOutputQueue();
-		for ( auto& iter : queue ) {
+		std::lock_guard<std::mutex> queueLock( m_QueueMutex );
+		for ( auto& iter : m_OutputQueue ) {
 			if ( iter.PlaylistItem.Info.GetFilename() == mediaInfo.GetFilename() ) {
 				iter.PlaylistItem.Info = mediaInfo;
 				if ( currentPlaying.PlaylistItem.ID == iter.PlaylistItem.ID ) {
@@ -1070,9 +1236,6 @@ bool Output::OnUpdatedMedia( const MediaInfo& mediaInfo )
 				}
 			}
 		}
-		if ( changed ) {
-			SetOutputQueue( queue );
-		}
 	}
 	return changed;
 }
@@ -1161,10 +1324,12 @@ void Output::SettingsChanged()
 		m_GainPreamp = gainPreamp;
 		EstimateGain( m_CurrentItemDecoding );
 		if ( State::Stopped != GetState() ) {
-			StartLoudnessPrecalcThread();
+			StartLoudnessPrecalcThreads();
 		}
 	}
 
+	m_CrossfadeCurve = m_Settings.GetCrossfadeCurve();
+
 	m_Handlers.SettingsChanged( m_Settings );
 }
 
@@ -1228,22 +1393,38 @@ void Output::EstimateGain( Playlist::Item& item )
 				gain = trackGain;
 			}
 		}
+		bool estimated = false;
 		if ( !gain.has_value() ) {
-			const auto estimateIter = m_GainEstimateMap.find( item.ID );
-			if ( m_GainEstimateMap.end() != estimateIter ) {
-				item.Info.SetGainTrack( estimateIter->second );
-			} else {
-				Decoder::Ptr tempDecoder = OpenDecoder( item );
-				if ( tempDecoder ) {
-					const auto trackGain = tempDecoder->CalculateTrackGain( [] () { return true; }, s_GainPrecalcTime );
-					item.Info.SetGainTrack( trackGain );
-					m_GainEstimateMap.insert( GainEstimateMap::value_type( item.ID, trackGain ) );
-				}
+			std::lock_guard<std::mutex> lock( m_GainEstimateMutex );
+			estimated = ( m_GainEstimateMap.end() != m_GainEstimateMap.find( item.ID ) );
+		}
+		if ( !gain.has_value() && !estimated && ( MediaInfo::Source::CDDA != item.Info.GetSource() ) ) {
+			// The estimate is applied in place of a track gain, and is refined once the loudness precalculation has analysed the whole track.
+			// Audio CDs are not estimated, as seeking between several positions on an optical drive would delay the start of playback.
+			// The estimate only decodes short excerpts, so the decoder does not read ahead.
+			Decoder::Ptr tempDecoder = OpenDecoder( item, false /*readAhead*/ );
+			if ( tempDecoder ) {
+				GainEstimator estimator( tempDecoder, [ this, info = item.Info ] () { return OpenCachedDecoder( info, false /*record*/ ); } );
+				tempDecoder.reset();
+				const GainEstimator::Estimate estimate = estimator.Calculate( s_GainPrecalcTime );
+				std::lock_guard<std::mutex> lock( m_GainEstimateMutex );
+				m_GainEstimateMap.insert( GainEstimateMap::value_type( item.ID, estimate ) );
 			}
 		}
 	}
 }
 
+float Output::SkipSilence( Decoder& decoder, const Playlist::Item& item )
+{
+	float skipped = 0;
+	const auto leadingSilence = item.Info.GetLeadingSilence();
+	if ( leadingSilence.has_value() && ( leadingSilence.value() > s_SilenceSeekMargin ) ) {
+		skipped = decoder.Seek( leadingSilence.value() - s_SilenceSeekMargin );
+	}
+	skipped += decoder.SkipSilence( s_SilenceThreshold );
+	return skipped;
+}
+
 void Output::CalculateCrossfadePoint( const Playlist::Item& item, const float seekOffset )
 {
 	StopCrossfadeThread();
@@ -1255,58 +1436,42 @@ void Output::CalculateCrossfadePoint( const Playlist::Item& item, const float se
 
 void Output::CalculateCrossfadeHandler()
 {
-	const Decoder::Ptr decoder = IsURL( m_CrossfadeItem.Info.GetFilename() ) ? nullptr : OpenDecoder( m_CrossfadeItem );
-	if ( decoder ) {
-		const float duration = decoder->GetDuration();
-		const long channels = decoder->GetChannels();
-		const long samplerate = decoder->GetSampleRate();
-		if ( ( duration > 0 ) && ( channels > 0 ) && ( samplerate > 0 ) ) {
-			if ( 0.0f == m_CrossfadeSeekOffset ) {
-				decoder->SkipSilence();
-			}
-
-			float position = 0;
-			float crossfadePosition = 0;
-
-			int64_t cumulativeCount = 0;
-			double cumulativeTotal = 0;
-			double cumulativeRMS = 0;
-
-			const double crossfadeRMSRatio = s_CrossfadeVolume;
-			const long windowSize = samplerate / 10;
-			std::vector<float> buffer( windowSize * channels );
-
-			while ( WAIT_OBJECT_0 != WaitForSingleObject( m_CrossfadeStopEvent, 0 ) ) {
-				long sampleCount = decoder->Read( &buffer[ 0 ], windowSize );
-				if ( sampleCount > 0 ) {
-					auto sampleIter = buffer.begin();
-					double windowTotal = 0;
-					for ( long sampleIndex = 0; sampleIndex < sampleCount; sampleIndex++ ) {
-						for ( long channel = 0; channel < channels; channel++, sampleIter++, cumulativeCount++ ) {
-							const double value = *sampleIter * *sampleIter;
-							windowTotal += value;
-							cumulativeTotal += value;
-						}
-					}
+	const std::optional<float> crossfadePosition = FindCrossfadePosition( m_CrossfadeItem, [ stopEvent = m_CrossfadeStopEvent ] ()
+	{
+		return ( WAIT_OBJECT_0 != WaitForSingleObject( stopEvent, 0 ) );
+	} );
+	if ( crossfadePosition.has_value() ) {
+		std::lock_guard<std::mutex> lock( m_CrossfadeMutex );
+		if ( WAIT_OBJECT_0 != WaitForSingleObject( m_CrossfadeStopEvent, 0 ) ) {
+			SetCrossfadePosition( crossfadePosition.value() - m_CrossfadeSeekOffset );
+		}
+	}
+}
 
-					const double windowRMS = sqrt( windowTotal / ( sampleCount * channels ) );
-					cumulativeRMS = sqrt( cumulativeTotal / cumulativeCount );
-					position += static_cast<float>( sampleCount ) / samplerate;
+std::optional<float> Output::FindCrossfadePosition( const Playlist::Item& item, Decoder::CanContinue canContinue )
+{
+	std::optional<float> crossfadePosition;
+	if ( !IsURL( item.Info.GetFilename() ) ) {
+		// Use the crossfade position stored in the media library, if it is still valid for the file.
+		Library& library = m_Playlist->GetLibrary();
+		MediaInfo mediaInfo( item.Info );
+		const bool checkFileAttributes = ( MediaInfo::Source::File == mediaInfo.GetSource() );
+		if ( library.GetMediaInfo( mediaInfo, checkFileAttributes, false /*scanMedia*/, false /*sendNotification*/ ) ) {
+			crossfadePosition = mediaInfo.GetCrossfadePosition();
+		}
 
-					if ( windowRMS > cumulativeRMS ) {
-						crossfadePosition = position;
-					} else if ( ( cumulativeRMS > 0 ) && ( ( windowRMS / cumulativeRMS ) > crossfadeRMSRatio ) ) {
-						crossfadePosition = position;
-					}
-				} else {
-					break;
-				}
-			}
-			if ( WAIT_OBJECT_0 != WaitForSingleObject( m_CrossfadeStopEvent, 0 ) ) {
-				SetCrossfadePosition( crossfadePosition - m_CrossfadeSeekOffset );
+		if ( !crossfadePosition.has_value() ) {
+			Playlist::Item analysisItem( item );
+			TrackAnalysis analysis( OpenDecoder( analysisItem, false /*readAhead*/ ), true /*crossfadeOnly*/ );
+			if ( analysis.Analyse( canContinue ) ) {
+				crossfadePosition = analysis.GetResult().CrossfadePosition;
+				MediaInfo updatedInfo( mediaInfo );
+				analysis.UpdateMediaInfo( updatedInfo );
+				library.UpdateTrackAnalysis( mediaInfo, updatedInfo );
 			}
 		}
 	}
+	return crossfadePosition;
 }
 
 void Output::StopCrossfadeThread()
@@ -1357,9 +1522,10 @@ void Output::ToggleFadeOut()
 {
 	m_FadeOut = !m_FadeOut;
 	if ( m_FadeOut && ( 0 != m_OutputStream ) ) {
-		m_FadeOutStartPosition = GetDecodePosition();
+		StartOutputFade( false /*fadeToNext*/ );
 	} else {
 		m_FadeOutStartPosition = 0;
+		CancelOutputFade();
 	}
 }
 
@@ -1372,14 +1538,18 @@ void Output::ToggleFadeToNext()
 {
 	m_FadeToNext = !m_FadeToNext;
 	if ( m_FadeToNext && ( 0 != m_OutputStream ) ) {
-		m_FadeOutStartPosition = GetDecodePosition();
+		StartOutputFade( true /*fadeToNext*/ );
 	} else {
+		// When switching to the next track, the outgoing track data that is already in the output buffer still needs to be faded.
+		if ( !m_SwitchToNext ) {
+			CancelOutputFade();
+		}
 		m_SwitchToNext = false;
 		std::lock_guard<std::mutex> crossfadingStreamLock( m_CrossfadingStreamMutex );
 		if ( m_CrossfadingStream ) {
 			m_CrossfadingStream.reset();
 			m_CurrentItemCrossfading = {};
-			m_SoftClipStateCrossfading.clear();
+			m_GainStateCrossfading = {};
 		}
 	}
 }
@@ -1389,13 +1559,32 @@ bool Output::GetFadeToNext() const
 	return m_FadeToNext;
 }
 
-void Output::ApplyGain( float* buffer, const long sampleCount, const Playlist::Item& item, std::vector<float>& softClipState )
+void Output::StartOutputFade( const bool fadeToNext )
+{
+	// Fade from the sample data that is next to be fed to the output stream, rather than from the decoding position, which can be some way ahead.
+	const long long position = m_OutputSamples;
+	m_OutputFadeFrontier = LLONG_MAX;
+	m_OutputFadeToNext = fadeToNext;
+	m_OutputFadeStart = (std::max)( position, 1ll );
+	const long sampleRate = m_DecoderSampleRate;
+	m_FadeOutStartPosition = ( sampleRate > 0 ) ? ( static_cast<float>( m_OutputFadeStart ) / sampleRate ) : 0;
+}
+
+void Output::CancelOutputFade()
 {
+	m_OutputFadeStart = 0;
+}
+
+float Output::ApplyGain( float* buffer, const long sampleCount, const long channels, const Playlist::Item& item, GainState& gainState, const bool deferScale )
+{
+	float remainingScale = 1.0f;
 	const bool eqEnabled = m_EQEnabled;
-	const long channels = item.Info.GetChannels();
 	if ( ( 0 != sampleCount ) && ( channels > 0 ) && ( ( Settings::GainMode::Disabled != m_GainMode ) || eqEnabled ) ) {
 		float preamp = eqEnabled ? m_EQPreamp : 0;
 
+		// Change in the estimated gain over the course of the buffer, in dB.
+		float gainChange = 0;
+
 		if ( Settings::GainMode::Disabled != m_GainMode ) {
 			auto gain = item.Info.GetGainAlbum();
 			if ( !gain.has_value() || ( Settings::GainMode::Track == m_GainMode ) ) {
@@ -1411,51 +1600,91 @@ void Output::ApplyGain( float* buffer, const long sampleCount, const Playlist::I
 				}
 				preamp += m_GainPreamp;
 				preamp += gain.value();
+			} else {
+				// An estimate is used for an item without a gain value (or the gain currently applied is held, for an item which is fading out).
+				std::optional<float> estimatedGain = gainState.EstimatedGain;
+				if ( const auto estimate = GetGainEstimate( item.ID ); estimate.Gain.has_value() ) {
+					// Any boost from an uncertain estimate is scaled by its confidence, so that a poor estimate errs on the quiet side.
+					estimatedGain = std::clamp( estimate.Gain.value(), s_GainMin, s_GainMax );
+					if ( estimatedGain.value() > 0 ) {
+						estimatedGain = estimatedGain.value() * estimate.Confidence;
+					}
+				}
+				if ( estimatedGain.has_value() ) {
+					if ( gainState.EstimatedGain.has_value() && ( m_DecoderSampleRate > 0 ) ) {
+						// Move gradually towards a refined estimate, to avoid an audible jump in level.
+						const float maximumChange = s_GainTransitionRate * sampleCount / m_DecoderSampleRate;
+						estimatedGain = std::clamp( estimatedGain.value(), gainState.EstimatedGain.value() - maximumChange, gainState.EstimatedGain.value() + maximumChange );
+						gainChange = estimatedGain.value() - gainState.EstimatedGain.value();
+					}
+					gainState.EstimatedGain = estimatedGain;
+					preamp += m_GainPreamp;
+					preamp += estimatedGain.value();
+				}
 			}
 		}
 
-		if ( 0 != preamp ) {
-			const float scale = powf( 10.0f, preamp / 20.0f );
-			const long totalSamples = sampleCount * channels;
-			for ( long sampleIndex = 0; sampleIndex < totalSamples; sampleIndex++ ) {
-				buffer[ sampleIndex ] *= scale;
+		// The linear scale is only recalculated when the gain changes.
+		const float previousScale = gainState.Scale;
+		if ( preamp != gainState.Preamp ) {
+			gainState.Preamp = preamp;
+			gainState.Scale = powf( 10.0f, preamp / 20.0f );
+		}
+
+		if ( ( 0 != preamp ) || ( 0 != gainChange ) ) {
+			float scale = gainState.Scale;
+			const size_t totalSamples = static_cast<size_t>( sampleCount ) * channels;
+			if ( 0 != gainChange ) {
+				// Apply the change in gain smoothly across the buffer, from the scale previously applied, with any limiting applied afterwards.
+				const float step = ( scale - previousScale ) / sampleCount;
+				for ( long index = 0; index < sampleCount; index++ ) {
+					m_GainRamp[ index ] = previousScale + step * ( index + 1 );
+				}
+				ApplyGainRamp( buffer, sampleCount, channels, m_GainRamp.data() );
+				scale = 1.0f;
 			}
 			switch ( m_LimitMode ) {
 				case Settings::LimitMode::Hard : {
-					for ( long sampleIndex = 0; sampleIndex < totalSamples; sampleIndex++ ) {
-						if ( buffer[ sampleIndex ] < -1.0f ) {
-							buffer[ sampleIndex ] = -1.0f;
-						} else if ( buffer[ sampleIndex ] > 1.0f ) {
-							buffer[ sampleIndex ] = 1.0f;
-						}
-					}
+					ScaleAndClipSamples( buffer, totalSamples, scale );
 					break;
 				}
 				case Settings::LimitMode::Soft : {
-					if ( softClipState.size() != static_cast<size_t>( channels ) ) {
-						softClipState.resize( channels, 0 );
+					if ( static_cast<size_t>( channels ) <= gainState.SoftClip.size() ) {
+						ScaleSamples( buffer, totalSamples, scale );
+						opus_pcm_soft_clip( buffer, sampleCount, channels, gainState.SoftClip.data() );
+					} else {
+						ScaleAndClipSamples( buffer, totalSamples, scale );
 					}
-					opus_pcm_soft_clip( buffer, sampleCount, channels, &softClipState[ 0 ] );
 					break;
 				}
 				default : {
+					// Note that true peak limiting is applied to the final output, in DecodeOutputBlock, where the limiter can also apply a constant gain in the same pass.
+					if ( deferScale ) {
+						remainingScale = scale;
+					} else {
+						ScaleSamples( buffer, totalSamples, scale );
+					}
 					break;
 				}
 			}
 		}
 	}
+	return remainingScale;
 }
 
-Output::Queue Output::GetOutputQueue()
+void Output::AddToOutputQueue( const Item& item )
 {
 	std::lock_guard<std::mutex> lock( m_QueueMutex );
-	return m_OutputQueue;
+	if ( m_OutputQueue.size() >= s_OutputQueueCapacity ) {
+		m_OutputQueue.erase( m_OutputQueue.begin() );
+	}
+	m_OutputQueue.push_back( item );
 }
 
-void Output::SetOutputQueue( const Queue& queue )
+void Output::ClearOutputQueue()
 {
 	std::lock_guard<std::mutex> lock( m_QueueMutex );
-	m_OutputQueue = queue;
+	m_OutputQueue.clear();
 }
 
 float Output::GetPitchRange() const
@@ -1565,29 +1794,17 @@ void Output::UpdateEQ( const Settings::EQ& eq )
 	}
 }
 
-Decoder::Ptr Output::OpenDecoder( Playlist::Item& item, const bool usePreloadedDecoder )
+Decoder::Ptr Output::OpenDecoder( Playlist::Item& item, const bool readAhead )
 {
-	Decoder::Ptr decoder;
-	if ( usePreloadedDecoder ) {
-		std::lock_guard<std::mutex> lock( m_PreloadedDecoderMutex );
-		if ( m_PreloadedDecoder.decoder && ( m_PreloadedDecoder.item.Info.GetFilename() == item.Info.GetFilename() ) && ( m_PreloadedDecoder.item.Info.GetFiletime() == item.Info.GetFiletime() ) ) {
-			decoder = m_PreloadedDecoder.decoder;
-			m_PreloadedDecoder.decoder.reset();
-			m_PreloadedDecoder.item = {};
-		}
-	}
+	const auto start = PlaybackMetrics::Clock::now();
+	Decoder::Ptr decoder = OpenCachedDecoder( item.Info, readAhead /*record*/ );
 
-	if ( !decoder ) {
-		decoder = m_Handlers.OpenDecoder( item.Info.GetFilename() );
-	}
-
-	if ( !decoder ) {
-		auto duplicate = item.Duplicates.begin();
-		while ( !decoder && ( item.Duplicates.end() != duplicate ) ) {
-			decoder = m_Handlers.OpenDecoder( *duplicate );
-			++duplicate;
-		}
+	auto duplicate = item.Duplicates.begin();
+	while ( !decoder && ( item.Duplicates.end() != duplicate ) ) {
+		decoder = m_Handlers.OpenDecoder( *duplicate, readAhead );
+		++duplicate;
 	}
+	m_Metrics.RecordTiming( PlaybackMetrics::Timing::DecoderOpen, start );
 
 	if ( decoder ) {
 		m_Playlist->GetLibrary().UpdateMediaInfoFromDecoder( item.Info, *decoder );
@@ -1596,6 +1813,29 @@ Decoder::Ptr Output::OpenDecoder( Playlist::Item& item, const bool usePreloadedD
 	return decoder;
 }
 
+Decoder::Ptr Output::OpenCachedDecoder( const MediaInfo& mediaInfo, const bool record )
+{
+	Decoder::Ptr decoder;
+	const std::wstring& filename = mediaInfo.GetFilename();
+	const long long filetime = mediaInfo.GetFiletime();
+
+	// Only files whose time is known can be cached, so that a file which has since been modified is decoded again (and nothing is cached if the cache has been disabled).
+	const bool cacheable = ( m_PCMCache.GetMaximumSize() > 0 ) && ( MediaInfo::Source::File == mediaInfo.GetSource() ) && ( 0 != filetime ) && !IsURL( filename );
+	if ( cacheable ) {
+		if ( const PCMCache::TrackPtr track = m_PCMCache.Find( filename, filetime ); track ) {
+			decoder = std::make_shared<DecoderCached>( track );
+		}
+		m_Metrics.Increment( decoder ? PlaybackMetrics::Counter::DecodedCacheHit : PlaybackMetrics::Counter::DecodedCacheMiss );
+	}
+	if ( !decoder ) {
+		decoder = m_Handlers.OpenDecoder( filename, record /*readAhead*/ );
+		if ( decoder && cacheable && record && ( DecoderCached::GetBytesPerValue( decoder->GetBPS() ) > 0 ) ) {
+			decoder = std::make_shared<DecoderCached>( decoder, m_PCMCache, filename, filetime );
+		}
+	}
+	return decoder;
+}
+
 Output::State Output::StartOutput()
 {
 	State state = State::Stopped;
@@ -1632,14 +1872,23 @@ Output::State Output::StartOutput()
 			}
 			break;
 		}
+		case Settings::OutputMode::Null :
+		case Settings::OutputMode::File : {
+			StartSinkThread();
+			if ( nullptr != m_SinkThread ) {
+				state = State::Playing;
+			}
+			break;
+		}
 	}
 	return state;
 }
 
 float Output::GetDecodePosition() const
 {
-	const QWORD bytesPos = BASS_ChannelGetPosition( m_OutputStream, BASS_POS_DECODE );
-	const float seconds = static_cast<float>( BASS_ChannelBytes2Seconds( m_OutputStream, bytesPos ) );
+	// Any silence that has been fed to the output stream due to an underrun precedes the sample data that is yet to be written to the output buffer.
+	const long sampleRate = m_DecoderSampleRate;
+	const float seconds = ( sampleRate > 0 ) ? ( static_cast<float>( m_DecodedSamples + m_UnderrunSamples ) / sampleRate ) : 0;
 	return seconds;
 }
 
@@ -1647,7 +1896,9 @@ float Output::GetOutputPosition() const
 {
 	float seconds = 0;
 	switch ( m_OutputMode ) {
-		case Settings::OutputMode::Standard : {
+		case Settings::OutputMode::Standard :
+		case Settings::OutputMode::Null :
+		case Settings::OutputMode::File : {
 			const QWORD bytePos = BASS_ChannelGetPosition( m_OutputStream, BASS_POS_BYTE );
 			seconds = static_cast<float>( BASS_ChannelBytes2Seconds( m_OutputStream, bytePos ) );
 			break;
@@ -1682,6 +1933,7 @@ float Output::GetInterval( const LONGLONG startTick, const LONGLONG endTick )
 bool Output::CreateOutputStream( const MediaInfo& mediaInfo )
 {
 	bool success = false;
+	m_NativeSampleRate = false;
 	if ( ( mediaInfo.GetSampleRate() > 0 ) && ( mediaInfo.GetChannels() > 0 ) ) {
 		const DWORD samplerate = static_cast<DWORD>( mediaInfo.GetSampleRate() );
 		const DWORD channels = static_cast<DWORD>( mediaInfo.GetChannels() );
@@ -1762,6 +2014,7 @@ bool Output::CreateOutputStream( const MediaInfo& mediaInfo )
 
 					if ( success ) {
 						BASS_WASAPI_SetNotify( WasapiNotifyProc, this );
+						m_NativeSampleRate = !useMixFormat && ( outputSamplerate == samplerate );
 					} else {
 						BASS_WASAPI_Free();
 					}
@@ -1827,12 +2080,23 @@ bool Output::CreateOutputStream( const MediaInfo& mediaInfo )
 						}
 					}
 
-					if ( !success ) {
+					if ( success ) {
+						m_NativeSampleRate = !useDefaultSamplerate && ( static_cast<DWORD>( outputSamplerate ) == samplerate );
+					} else {
 						BASS_ASIO_Free();
 					}
 				}
 				break;
 			}
+
+			case Settings::OutputMode::Null :
+			case Settings::OutputMode::File : {
+				m_LeadInSeconds = 0;
+				const DWORD flags = BASS_SAMPLE_FLOAT | BASS_STREAM_DECODE;
+				m_OutputStream = BASS_StreamCreate( samplerate, channels, flags, StreamProc, this );
+				success = ( 0 != m_OutputStream );
+				break;
+			}
 		}
 	}
 	return success;
@@ -1874,20 +2138,19 @@ bool Output::InitASIO()
 	return success;
 }
 
-DWORD Output::ApplyLeadIn( float* buffer, const DWORD byteCount, HSTREAM handle ) const
+DWORD Output::ApplyLeadIn( float* buffer, const DWORD byteCount ) const
 {
 	DWORD bytesPadded = 0;
-	if ( m_LeadInSeconds > 0 ) {
-		const QWORD bytePos = BASS_ChannelGetPosition( handle, BASS_POS_BYTE );
-		const float position = static_cast<float>( BASS_ChannelBytes2Seconds( handle, bytePos ) );
-		if ( position < m_LeadInSeconds ) {
-			BASS_CHANNELINFO info = {};
-			if ( ( TRUE == BASS_ChannelGetInfo( handle, &info ) ) && ( info.freq > 0 ) && ( info.chans > 0 ) ) {
-				bytesPadded = static_cast<DWORD>( 0.5f + ( m_LeadInSeconds - position ) * info.freq ) * info.chans * 4;
-				bytesPadded = min( bytesPadded, byteCount );
-				if ( bytesPadded > 0 ) {
-					std::fill( buffer, buffer + bytesPadded / 4, 0.0f );
-				}
+	const long channels = m_OutputBuffer.GetChannels();
+	const long sampleRate = m_DecoderSampleRate;
+	if ( ( m_LeadInSeconds > 0 ) && ( channels > 0 ) && ( sampleRate > 0 ) ) {
+		const long long leadInSamples = static_cast<long long>( 0.5f + m_LeadInSeconds * sampleRate );
+		const long long decodedSamples = m_DecodedSamples;
+		if ( decodedSamples < leadInSamples ) {
+			bytesPadded = static_cast<DWORD>( leadInSamples - decodedSamples ) * channels * 4;
+			bytesPadded = min( bytesPadded, byteCount );
+			if ( bytesPadded > 0 ) {
+				std::fill( buffer, buffer + bytesPadded / 4, 0.0f );
 			}
 		}
 	}
@@ -1906,46 +2169,146 @@ float Output::GetFadeToNextDuration() const
 
 void Output::LoudnessPrecalcHandler()
 {
-	// Playlist might have new items, so check back every so often.
-	const DWORD interval = 30 /*sec*/ * 1000;
-
 	Decoder::CanContinue canContinue( [ stopEvent = m_LoudnessPrecalcStopEvent ] ()
 	{
 		return ( WAIT_OBJECT_0 != WaitForSingleObject( stopEvent, 0 ) );
 	} );
 
-	do {
-		Playlist::ItemList items;
-		{
-			std::lock_guard<std::mutex> lock( m_PlaylistMutex );
-			items = m_Playlist->GetItems();
-		}
-		auto item = items.begin();
-		while ( ( items.end() != item ) && canContinue() ) {
-			auto gain = item->Info.GetGainTrack();
-			if ( !gain.has_value() ) {
-				m_Playlist->GetLibrary().GetMediaInfo( item->Info, false /*checkFileAttributes*/, false /*scanMedia*/, false /*sendNotification*/ );
-				gain = item->Info.GetGainTrack();
-				if ( !gain.has_value() ) {
-					gain = GainCalculator::CalculateTrackGain( item->Info.GetFilename(), m_Handlers, canContinue );
-					if ( gain.has_value() ) {
-						const MediaInfo previousMediaInfo( item->Info );
-						item->Info.SetGainTrack( gain );
-						std::lock_guard<std::mutex> lock( m_PlaylistMutex );
-						m_Playlist->UpdateItem( *item );
-						m_Playlist->GetLibrary().UpdateTrackGain( previousMediaInfo, item->Info );
+	// Wait for the playlist or the current item to change, or for items to be queued.
+	const HANDLE handles[ 2 ] = { m_LoudnessPrecalcStopEvent, m_LoudnessPrecalcWakeEvent };
+	while ( WaitForMultipleObjects( 2, handles, FALSE /*waitAll*/, INFINITE ) != WAIT_OBJECT_0 ) {
+		Playlist::Item item;
+		if ( TakeLoudnessPrecalcItem( item ) ) {
+			Library& library = m_Playlist->GetLibrary();
+			library.GetMediaInfo( item.Info, false /*checkFileAttributes*/, false /*scanMedia*/, false /*sendNotification*/ );
+			if ( !item.Info.GetGainTrack().has_value() ) {
+				// Files which were scanned without a fingerprint are fingerprinted first, so that the results are kept should the file be moved or renamed.
+				// The fingerprint does not cover the whole track, so the track is analysed in any case.
+				const MediaInfo previousMediaInfo( item.Info );
+				if ( item.Info.GetFingerprint().empty() && ( MediaInfo::Source::File == item.Info.GetSource() ) ) {
+					if ( const Decoder::Ptr decoder = OpenCachedDecoder( item.Info, false /*record*/ ); decoder ) {
+						library.UpdateFingerprint( item.Info, *decoder );
 					}
 				}
+
+				// Store the other analysis results along with the track gain, as the whole track has to be decoded anyway.
+				TrackAnalysis analysis( OpenCachedDecoder( item.Info, false /*record*/ ) );
+				const bool analysed = analysis.Analyse( canContinue ) && analysis.GetResult().Gain.has_value();
+				if ( analysed ) {
+					analysis.UpdateMediaInfo( item.Info );
+
+					// Refine the gain applied to the item, should it be playing from an estimate.
+					SetGainEstimate( item.ID, { item.Info.GetGainTrack(), 1.0f } );
+
+					std::lock_guard<std::mutex> lock( m_PlaylistMutex );
+					m_Playlist->UpdateItem( item );
+					library.UpdateTrackGain( previousMediaInfo, item.Info );
+					library.UpdateTrackAnalysis( previousMediaInfo, item.Info );
+				}
+			}
+			if ( !canContinue() ) {
+				// The item will need to be taken again, should precalculation restart for the same playlist.
+				std::lock_guard<std::mutex> lock( m_LoudnessPrecalcMutex );
+				m_LoudnessPrecalcChecked.erase( item.ID );
 			}
-			++item;
 		}
-	} while ( WAIT_OBJECT_0 != WaitForSingleObject( m_LoudnessPrecalcStopEvent, interval ) );
+	}
+}
+
+bool Output::TakeLoudnessPrecalcItem( Playlist::Item& item )
+{
+	std::lock_guard<std::mutex> lock( m_LoudnessPrecalcMutex );
+	if ( m_LoudnessPrecalcQueueStale ) {
+		UpdateLoudnessPrecalcQueue();
+		m_LoudnessPrecalcQueueStale = false;
+	}
+
+	bool taken = false;
+	while ( !taken && !m_LoudnessPrecalcQueue.empty() ) {
+		item = m_LoudnessPrecalcQueue.front();
+		m_LoudnessPrecalcQueue.pop_front();
+		taken = m_LoudnessPrecalcChecked.insert( item.ID ).second;
+	}
+	if ( !taken ) {
+		// Nothing left to do until the next change.
+		ResetEvent( m_LoudnessPrecalcWakeEvent );
+	}
+	return taken;
 }
 
-void Output::StartLoudnessPrecalcThread()
+void Output::UpdateLoudnessPrecalcQueue()
 {
-	StopLoudnessPrecalcThread();
-	if ( nullptr != m_LoudnessPrecalcStopEvent ) {
+	m_LoudnessPrecalcQueue.clear();
+
+	Playlist::ItemList items;
+	Playlist::ItemList upcomingItems;
+	const bool randomPlay = GetRandomPlay();
+	{
+		std::lock_guard<std::mutex> lock( m_PlaylistMutex );
+		if ( m_Playlist ) {
+			items = m_Playlist->GetItems();
+			if ( randomPlay ) {
+				{
+					std::lock_guard<std::mutex> preloadLock( m_PreloadedDecoderMutex );
+					upcomingItems.push_back( ( m_PreloadedDecoder.item.ID > 0 ) ? m_PreloadedDecoder.item : m_PreloadedDecoder.itemToPreload );
+				}
+				upcomingItems.splice( upcomingItems.end(), m_Playlist->GetUpcomingRandomItems( s_LoudnessPrecalcShuffledItems ) );
+			}
+		}
+	}
+
+	// The current item comes first, so that a gain estimate for the playing track is refined as soon as possible.
+	const long currentID = m_LoudnessPrecalcCurrentID;
+	const auto currentItem = std::find_if( items.begin(), items.end(), [ currentID ] ( const Playlist::Item& item ) { return currentID == item.ID; } );
+	if ( randomPlay ) {
+		if ( items.end() != currentItem ) {
+			upcomingItems.push_front( *currentItem );
+		}
+	} else if ( items.end() != currentItem ) {
+		// Order the remaining items from the one following the current item, so that they are in playback order.
+		items.splice( items.end(), items, items.begin(), currentItem );
+	}
+
+	// Items known to have a track gain are skipped without querying the library.
+	std::set<long> queuedIDs;
+	for ( const Playlist::ItemList* itemList : { &upcomingItems, &items } ) {
+		for ( const auto& item : *itemList ) {
+			if ( ( item.ID > 0 ) && !item.Info.GetGainTrack().has_value() && !IsURL( item.Info.GetFilename() ) &&
+					( m_LoudnessPrecalcChecked.end() == m_LoudnessPrecalcChecked.find( item.ID ) ) && queuedIDs.insert( item.ID ).second ) {
+				m_LoudnessPrecalcQueue.push_back( item );
+			}
+		}
+	}
+}
+
+void Output::WakeLoudnessPrecalc( const long currentItemID )
+{
+	{
+		std::lock_guard<std::mutex> lock( m_LoudnessPrecalcMutex );
+		if ( currentItemID > 0 ) {
+			m_LoudnessPrecalcCurrentID = currentItemID;
+		}
+		m_LoudnessPrecalcQueueStale = true;
+	}
+	SetEvent( m_LoudnessPrecalcWakeEvent );
+}
+
+void Output::OnPlaylistChanged( const Playlist* playlist )
+{
+	bool isOutputPlaylist = false;
+	{
+		std::lock_guard<std::mutex> lock( m_PlaylistMutex );
+		isOutputPlaylist = ( nullptr != playlist ) && ( m_Playlist.get() == playlist );
+	}
+	if ( isOutputPlaylist ) {
+		WakeLoudnessPrecalc();
+	}
+}
+
+void Output::StartLoudnessPrecalcThreads()
+{
+	StopLoudnessPrecalcThreads();
+	if ( ( nullptr != m_LoudnessPrecalcStopEvent ) && ( nullptr != m_LoudnessPrecalcWakeEvent ) ) {
 		ResetEvent( m_LoudnessPrecalcStopEvent );
 		if ( m_Playlist && ( Playlist::Type::CDDA != m_Playlist->GetType() ) ) {
 			Settings::GainMode gainMode = Settings::GainMode::Disabled;
@@ -1953,23 +2316,43 @@ void Output::StartLoudnessPrecalcThread()
 			float preamp = 0;
 			m_Settings.GetGainSettings( gainMode, limitMode, preamp );
 			if ( Settings::GainMode::Disabled != gainMode ) {
-				m_LoudnessPrecalcThread = CreateThread( NULL /*attributes*/, 0 /*stackSize*/, LoudnessPrecalcThreadProc, reinterpret_cast<LPVOID>( this ), 0 /*flags*/, NULL /*threadId*/ );
-				if ( nullptr != m_LoudnessPrecalcThread ) {
-					SetThreadPriority( m_LoudnessPrecalcThread, THREAD_PRIORITY_BELOW_NORMAL );
+				{
+					std::lock_guard<std::mutex> lock( m_LoudnessPrecalcMutex );
+					if ( m_LoudnessPrecalcPlaylist != m_Playlist ) {
+						m_LoudnessPrecalcChecked.clear();
+						m_LoudnessPrecalcPlaylist = m_Playlist;
+					}
+					m_LoudnessPrecalcCurrentID = m_CurrentItemDecoding.ID;
+					m_LoudnessPrecalcQueueStale = true;
+				}
+				SetEvent( m_LoudnessPrecalcWakeEvent );
+
+				// Use at most half the available cores, to leave room for playback and the user interface.
+				const unsigned int threadCount = std::clamp( std::thread::hardware_concurrency() / 2, 1u, s_MaxLoudnessPrecalcThreads );
+				for ( unsigned int threadIndex = 0; threadIndex < threadCount; threadIndex++ ) {
+					const HANDLE thread = CreateThread( NULL /*attributes*/, 0 /*stackSize*/, LoudnessPrecalcThreadProc, reinterpret_cast<LPVOID>( this ), 0 /*flags*/, NULL /*threadId*/ );
+					if ( nullptr != thread ) {
+						SetThreadPriority( thread, THREAD_PRIORITY_BELOW_NORMAL );
+						m_LoudnessPrecalcThreads.push_back( thread );
+					}
 				}
 			}
 		}
 	}
 }
 
-void Output::StopLoudnessPrecalcThread()
+void Output::StopLoudnessPrecalcThreads()
 {
-	if ( nullptr != m_LoudnessPrecalcThread ) {
-		SetThreadPriority( m_LoudnessPrecalcThread, THREAD_PRIORITY_NORMAL );
+	if ( !m_LoudnessPrecalcThreads.empty() ) {
+		for ( const auto& thread : m_LoudnessPrecalcThreads ) {
+			SetThreadPriority( thread, THREAD_PRIORITY_NORMAL );
+		}
 		SetEvent( m_LoudnessPrecalcStopEvent );
-		WaitForSingleObject( m_LoudnessPrecalcThread, INFINITE );
-		CloseHandle( m_LoudnessPrecalcThread );
-		m_LoudnessPrecalcThread = nullptr;
+		for ( const auto& thread : m_LoudnessPrecalcThreads ) {
+			WaitForSingleObject( thread, INFINITE );
+			CloseHandle( thread );
+		}
+		m_LoudnessPrecalcThreads.clear();
 	}
 }
 
@@ -1983,19 +2366,23 @@ void Output::SetOutputStreamFinished( const bool finished )
 	m_OutputStreamFinished = finished;
 }
 
-Decoder::Ptr Output::GetNextDecoder( Playlist::Item& item )
+Output::PreloadedDecoder Output::GetNextDecoder( const Playlist::Item& item )
 {
-	Decoder::Ptr nextDecoder;
+	PreloadedDecoder next;
+	next.channels = m_OutputBuffer.GetChannels();
+	next.sampleRate = m_DecoderSampleRate;
+	next.crossfade = GetCrossfade() || GetFadeToNext();
 	Playlist::Item nextItem = item;
-	item = {};
 	std::lock_guard<std::mutex> playlistLock( m_PlaylistMutex );
 	if ( m_Playlist ) {
 		size_t skip = 0;
-		while ( !nextDecoder && ( nextItem.ID > 0 ) && ( skip++ < s_MaxSkipItems ) ) {
+		while ( !next.decoder && ( nextItem.ID > 0 ) && ( skip++ < s_MaxSkipItems ) ) {
+			std::unique_lock<std::mutex> preloadLock( m_PreloadedDecoderMutex );
 			if ( GetRandomPlay() ) {
-				std::lock_guard<std::mutex> preloadLock( m_PreloadedDecoderMutex );
-				if ( ( m_PreloadedDecoder.item.ID > 0 ) && ( m_Playlist->ContainsItem( m_PreloadedDecoder.item ) ) ) {
-					nextItem = m_PreloadedDecoder.item;
+				// Follow on with the item that was chosen for preloading, even if it has not finished being prepared.
+				const Playlist::Item& preloadItem = ( m_PreloadedDecoder.item.ID > 0 ) ? m_PreloadedDecoder.item : m_PreloadedDecoder.itemToPreload;
+				if ( ( preloadItem.ID > 0 ) && ( m_Playlist->ContainsItem( preloadItem ) ) ) {
+					nextItem = preloadItem;
 				} else {
 					nextItem = m_Playlist->GetRandomItem( nextItem );
 				}
@@ -2007,16 +2394,70 @@ Decoder::Ptr Output::GetNextDecoder( Playlist::Item& item )
 				m_Playlist->GetNextItem( currentItem, nextItem, GetRepeatPlaylist() /*wrap*/ );
 			}
 			if ( nextItem.ID > 0 ) {
-				nextDecoder = OpenDecoder( nextItem, true /*usePreloadedDecoder*/ );
-				if ( nextDecoder ) {
-					item = nextItem;
-					PreloadNextDecoder( item );
+				const bool preloaded = m_PreloadedDecoder.decoder && ( m_PreloadedDecoder.item.Info.GetFilename() == nextItem.Info.GetFilename() ) && ( m_PreloadedDecoder.item.Info.GetFiletime() == nextItem.Info.GetFiletime() ) &&
+					( m_PreloadedDecoder.channels == next.channels ) && ( m_PreloadedDecoder.sampleRate == next.sampleRate ) && ( m_PreloadedDecoder.crossfade == next.crossfade );
+				if ( preloaded ) {
+					next.item = m_PreloadedDecoder.item;
+					next.decoder = m_PreloadedDecoder.decoder;
+					next.crossfadeOffset = m_PreloadedDecoder.crossfadeOffset;
+					next.crossfadePosition = m_PreloadedDecoder.crossfadePosition;
+					m_PreloadedDecoder.decoder.reset();
+					m_PreloadedDecoder.item = {};
+				}
+				preloadLock.unlock();
+				m_Metrics.Increment( preloaded ? PlaybackMetrics::Counter::PreloadHit : PlaybackMetrics::Counter::PreloadMiss );
+
+				if ( !preloaded ) {
+					next.item = nextItem;
+					PrepareDecoder( next, nullptr /*canContinue*/ );
+				}
+				if ( next.decoder ) {
+					PreloadNextDecoder( next.item );
+				} else {
+					next.item = {};
 				}
 			}
 		}
 	}
+	return next;
+}
+
+void Output::PrepareDecoder( PreloadedDecoder& preloaded, Decoder::CanContinue canContinue )
+{
+	preloaded.crossfadeOffset = 0;
+	preloaded.crossfadePosition.reset();
+	preloaded.decoder = OpenDecoder( preloaded.item, true /*readAhead*/ );
+	if ( preloaded.decoder && !IsURL( preloaded.item.Info.GetFilename() ) ) {
+		EstimateGain( preloaded.item );
+
+		const long channels = preloaded.channels;
+		const long sampleRate = preloaded.sampleRate;
 
-	return nextDecoder;
+		// When the output device runs at the sample rate of each track, a track at a different sample rate restarts the output at its native sample rate instead.
+		// Only a crossfade (which needs both tracks in the same output stream) is then worth the cost of converting the sample rate.
+		const bool convert = ( preloaded.decoder->GetSampleRate() == sampleRate ) || preloaded.crossfade || !m_NativeSampleRate;
+		if ( convert && ( preloaded.decoder->GetChannels() > 0 ) && ( preloaded.decoder->GetSampleRate() > 0 ) && ( channels > 0 ) && ( sampleRate > 0 ) ) {
+			// Convert to the channel layout and sample rate of the output stream, so that the transition is gapless.
+			// When downmixing, mix before resampling so that fewer channels need to be resampled.
+			const bool downmix = ( preloaded.decoder->GetChannels() > channels );
+			if ( downmix ) {
+				preloaded.decoder = std::make_shared<DecoderMixer>( preloaded.decoder, channels );
+			}
+			if ( preloaded.decoder->GetSampleRate() != sampleRate ) {
+				preloaded.decoder = std::make_shared<DecoderResampler>( preloaded.decoder, sampleRate );
+			}
+			if ( preloaded.decoder->GetChannels() != channels ) {
+				preloaded.decoder = std::make_shared<DecoderMixer>( preloaded.decoder, channels );
+			}
+		}
+
+		if ( preloaded.crossfade ) {
+			preloaded.crossfadeOffset = SkipSilence( *preloaded.decoder, preloaded.item );
+			if ( nullptr != canContinue ) {
+				preloaded.crossfadePosition = FindCrossfadePosition( preloaded.item, canContinue );
+			}
+		}
+	}
 }
 
 void Output::StartPreloadDecoderThread()
@@ -2041,16 +2482,40 @@ void Output::PreloadDecoderHandler()
 {
 	const HANDLE handles[ 2 ] = { m_PreloadDecoderStopEvent, m_PreloadDecoderWakeEvent };
 	while ( WaitForMultipleObjects( 2, handles, FALSE /*waitAll*/, INFINITE ) != WAIT_OBJECT_0 ) {
-		std::lock_guard<std::mutex> lock( m_PreloadedDecoderMutex );
-		const std::wstring& filename = m_PreloadedDecoder.itemToPreload.Info.GetFilename();
-		m_PreloadedDecoder.decoder = IsURL( filename ) ? nullptr : m_Handlers.OpenDecoder( filename );
-		if ( m_PreloadedDecoder.decoder ) {
-			m_PreloadedDecoder.item = m_PreloadedDecoder.itemToPreload;
-		} else {
-			m_PreloadedDecoder.item = {};
+		// The decoder is prepared without holding the preloaded decoder mutex, so that the decode thread is never held up at a transition.
+		std::lock_guard<std::mutex> prepareLock( m_PreloadPrepareMutex );
+		PreloadedDecoder request;
+		{
+			std::lock_guard<std::mutex> lock( m_PreloadedDecoderMutex );
+			request = m_PreloadedDecoder;
+			ResetEvent( m_PreloadDecoderWakeEvent );
+		}
+
+		// A request is abandoned if it is superseded (or cleared when playback stops) while the decoder is being prepared.
+		auto isCurrentRequest = [ this, &request ] ()
+		{
+			return ( m_PreloadedDecoder.itemToPreload.ID == request.itemToPreload.ID ) && ( m_PreloadedDecoder.channels == request.channels ) &&
+				( m_PreloadedDecoder.sampleRate == request.sampleRate ) && ( m_PreloadedDecoder.crossfade == request.crossfade );
+		};
+
+		if ( ( request.itemToPreload.ID > 0 ) && !IsURL( request.itemToPreload.Info.GetFilename() ) ) {
+			PreloadedDecoder preloaded( request );
+			preloaded.item = request.itemToPreload;
+			preloaded.itemToPreload = {};
+			PrepareDecoder( preloaded, [ this, &isCurrentRequest, stopEvent = m_PreloadDecoderStopEvent ] ()
+			{
+				std::lock_guard<std::mutex> lock( m_PreloadedDecoderMutex );
+				return ( WAIT_OBJECT_0 != WaitForSingleObject( stopEvent, 0 ) ) && isCurrentRequest();
+			} );
+
+			std::lock_guard<std::mutex> lock( m_PreloadedDecoderMutex );
+			if ( isCurrentRequest() ) {
+				if ( !preloaded.decoder ) {
+					preloaded.item = {};
+				}
+				m_PreloadedDecoder = preloaded;
+			}
 		}
-		m_PreloadedDecoder.itemToPreload = {};
-		ResetEvent( m_PreloadDecoderWakeEvent );
 	}
 }
 
@@ -2067,24 +2532,453 @@ void Output::PreloadNextDecoder( const Playlist::Item& item )
 		}
 
 		std::lock_guard<std::mutex> lock( m_PreloadedDecoderMutex );
-		m_PreloadedDecoder.itemToPreload = preloadItem;
-		SetEvent( m_PreloadDecoderWakeEvent );
+		RequestPreload( preloadItem );
 	}
 }
 
-std::vector<std::pair<float /*seconds*/,std::wstring /*title*/>> Output::GetStreamTitleQueue()
+void Output::RequestPreload( const Playlist::Item& item )
+{
+	// The decoder is prepared for the current output format, so that the decode thread only needs to switch to it at the transition.
+	m_PreloadedDecoder = {};
+	m_PreloadedDecoder.itemToPreload = item;
+	m_PreloadedDecoder.channels = m_OutputBuffer.GetChannels();
+	m_PreloadedDecoder.sampleRate = m_DecoderSampleRate;
+	m_PreloadedDecoder.crossfade = GetCrossfade();
+	SetEvent( m_PreloadDecoderWakeEvent );
+}
+
+void Output::AddToStreamTitleQueue( const float seconds, const std::wstring& title )
 {
 	std::lock_guard<std::mutex> lock( m_StreamTitleMutex );
-	return m_StreamTitleQueue;
+	if ( m_StreamTitleQueue.size() >= s_OutputQueueCapacity ) {
+		m_StreamTitleQueue.erase( m_StreamTitleQueue.begin() );
+	}
+	m_StreamTitleQueue.push_back( { seconds, title } );
 }
 
-void Output::SetStreamTitleQueue( const std::vector<std::pair<float /*seconds*/,std::wstring /*title*/>>& queue )
+void Output::ClearStreamTitleQueue()
 {
 	std::lock_guard<std::mutex> lock( m_StreamTitleMutex );
-	m_StreamTitleQueue = queue;
+	m_StreamTitleQueue.clear();
 }
 
 void Output::SetPlaylistChangeCallback( PlaylistChangeCallback callback )
 {
 	m_OnPlaylistChangeCallback = callback;
 }
+
+long long Output::GetUnderrunCount() const
+{
+	return m_UnderrunCount;
+}
+
+const PlaybackMetrics& Output::GetMetrics() const
+{
+	return m_Metrics;
+}
+
+void Output::ResetMetrics()
+{
+	m_Metrics.Reset();
+}
+
+bool Output::WriteMetrics( const std::wstring& filename ) const
+{
+	return m_Metrics.WriteFile( filename );
+}
+
+GainEstimator::Estimate Output::GetGainEstimate( const long itemID ) const
+{
+	GainEstimator::Estimate estimate;
+	std::lock_guard<std::mutex> lock( m_GainEstimateMutex );
+	if ( const auto estimateIter = m_GainEstimateMap.find( itemID ); m_GainEstimateMap.end() != estimateIter ) {
+		estimate = estimateIter->second;
+	}
+	return estimate;
+}
+
+void Output::SetGainEstimate( const long itemID, const GainEstimator::Estimate& estimate )
+{
+	std::lock_guard<std::mutex> lock( m_GainEstimateMutex );
+	m_GainEstimateMap[ itemID ] = estimate;
+}
+
+DWORD Output::ReadOutputBuffer( float* buffer, const DWORD byteCount )
+{
+	DWORD bytesRead = 0;
+	const long channels = m_OutputBuffer.GetChannels();
+	if ( ( nullptr != buffer ) && ( channels > 0 ) ) {
+		const long sampleCount = static_cast<long>( byteCount ) / ( channels * 4 );
+
+		if ( m_DecodeOnDemand ) {
+			while ( ( m_OutputBuffer.GetReadAvailable() < sampleCount ) && DecodeOutputBlock() ) {}
+		}
+
+		// Check whether decoding has finished before reading, so that no trailing sample data is missed.
+		const bool decodeFinished = m_DecodeFinished;
+		const long long position = m_OutputSamples;
+		long samplesRead = m_OutputBuffer.Read( buffer, sampleCount );
+		if ( ApplyOutputFade( buffer, samplesRead, channels, position ) ) {
+			// The fade out has finished, so discard any remaining sample data, and feed silence until the decode thread has finished.
+			m_OutputBuffer.Skip( m_OutputBuffer.GetReadAvailable() );
+			if ( !decodeFinished ) {
+				std::fill( buffer + samplesRead * channels, buffer + sampleCount * channels, 0.0f );
+				samplesRead = sampleCount;
+			}
+		} else if ( ( samplesRead < sampleCount ) && !decodeFinished && !m_DecodeFinished ) {
+			const long padding = sampleCount - samplesRead;
+			std::fill( buffer + samplesRead * channels, buffer + sampleCount * channels, 0.0f );
+			m_UnderrunSamples += padding;
+			++m_UnderrunCount;
+			m_Metrics.Increment( PlaybackMetrics::Counter::Underrun );
+			samplesRead = sampleCount;
+		} else if ( !m_DecodeFinished && ( m_OutputBuffer.GetReadAvailable() < sampleCount ) ) {
+			// The next callback will underrun, unless the decode thread catches up in the meantime.
+			m_Metrics.Increment( PlaybackMetrics::Counter::NearUnderrun );
+		}
+		// Measure the fill level against the decode buffer target, as the decode thread does not aim to fill the whole output buffer.
+		const long decodeTarget = m_DecodeTarget;
+		if ( decodeTarget > 0 ) {
+			m_Metrics.RecordBufferFill( static_cast<float>( m_OutputBuffer.GetReadAvailable() ) / decodeTarget );
+		}
+		m_OutputSamples += samplesRead;
+		bytesRead = static_cast<DWORD>( samplesRead * channels * 4 );
+	}
+	return bytesRead;
+}
+
+bool Output::ApplyOutputFade( float* buffer, long& sampleCount, const long channels, const long long position )
+{
+	bool fadeOutFinished = false;
+	const long long fadeStart = m_OutputFadeStart;
+	const long sampleRate = m_DecoderSampleRate;
+	if ( ( nullptr != buffer ) && ( fadeStart > 0 ) && ( sampleRate > 0 ) ) {
+		const long long fadeLength = static_cast<long long>( GetFadeOutDuration() * sampleRate );
+		const long long fadeEnd = fadeStart + fadeLength;
+		const bool fadeToNext = m_OutputFadeToNext;
+		if ( !fadeToNext && ( ( position + sampleCount ) >= fadeEnd ) ) {
+			sampleCount = static_cast<long>( (std::max)( fadeEnd - position, 0ll ) );
+			fadeOutFinished = true;
+		}
+
+		// The frontier is checked after the sample data has been read, so that it covers all of the data that the decode thread has not faded.
+		const long long frontier = m_OutputFadeFrontier;
+		const long long rampStart = (std::max)( position, fadeStart );
+		const long long rampEnd = (std::min)( position + sampleCount, frontier );
+		if ( rampEnd > rampStart ) {
+			const bool equalPower = fadeToNext && ( Settings::CrossfadeCurve::EqualPower == m_CrossfadeCurve );
+			const float step = 1.0f / fadeLength;
+			std::array<float, 256> ramp;
+			for ( long long rampPosition = rampStart; rampPosition < rampEnd; ) {
+				const long count = static_cast<long>( (std::min)( rampEnd - rampPosition, static_cast<long long>( ramp.size() ) ) );
+				GenerateGainRamp( ramp.data(), count, static_cast<float>( fadeEnd - rampPosition ) * step, step, equalPower );
+				ApplyGainRamp( buffer + ( rampPosition - position ) * channels, count, channels, ramp.data() );
+				rampPosition += count;
+			}
+		}
+	}
+	return fadeOutFinished;
+}
+
+bool Output::DecodeOutputBlock()
+{
+	bool decoded = false;
+	const long channels = m_OutputBuffer.GetChannels();
+	const long blockSize = ( channels > 0 ) ? static_cast<long>( m_DecodeBuffer.size() ) / channels : 0;
+
+	const long long underruns = m_UnderrunCount;
+	if ( underruns != m_DecodeTargetUnderruns ) {
+		// The output buffer has run dry, so increase the decode buffer target straight away, rather than waiting for the next track.
+		m_DecodeTargetUnderruns = underruns;
+		m_DecodeTarget = (std::min)( 2 * m_DecodeTarget, m_OutputBuffer.GetCapacity() );
+	}
+
+	if ( !m_DecodeFinished && ( blockSize > 0 ) && ( m_OutputBuffer.GetWriteAvailable() >= blockSize ) && ( m_OutputBuffer.GetReadAvailable() < m_DecodeTarget ) ) {
+		float* buffer = m_DecodeBuffer.data();
+		const DWORD byteCount = static_cast<DWORD>( blockSize * channels * 4 );
+
+		long samplesRead = 0;
+		bool finished = false;
+		bool limiterCrossfade = false;
+		if ( !m_LimiterFlushing ) {
+			const bool truePeak = ( Settings::LimitMode::TruePeak == m_LimitMode );
+			if ( truePeak && !m_Limiter ) {
+				// The limiter output is delayed, so crossfade to it from the sample data being decoded (note that this is the only time the limiter is created during decoding).
+				m_Limiter = std::make_unique<Limiter>( channels, m_DecoderSampleRate );
+				limiterCrossfade = true;
+			} else if ( !truePeak && m_Limiter ) {
+				// Flush out any sample data delayed by the limiter, which then leads straight on to the sample data being decoded.
+				samplesRead = m_Limiter->Flush( buffer, blockSize );
+				m_Limiter.reset();
+			}
+		}
+		if ( m_Limiter ) {
+			m_Limiter->SetEnabled( GetLimiterEnabled() );
+		}
+
+		if ( !m_LimiterFlushing ) {
+			m_DecodeBlockScale = 1.0f;
+			const DWORD bytesFlushed = static_cast<DWORD>( samplesRead * channels * 4 );
+			DWORD bytesRead = bytesFlushed + ApplyLeadIn( buffer + bytesFlushed / 4, byteCount - bytesFlushed );
+			if ( bytesRead < byteCount ) {
+				const long itemID = m_CurrentItemDecoding.ID;
+				const auto start = PlaybackMetrics::Clock::now();
+				m_DecodeBlockTransition = false;
+				const DWORD bytesDecoded = ReadSampleData( buffer + bytesRead / 4, byteCount - bytesRead, m_OutputStream );
+				m_Metrics.RecordTiming( PlaybackMetrics::Timing::DecodeBlock, start );
+				UpdateDecodeStatistics( itemID, static_cast<long>( bytesDecoded ) / ( channels * 4 ), std::chrono::duration<double>( PlaybackMetrics::Clock::now() - start ).count() );
+				finished = ( 0 == bytesDecoded );
+				bytesRead += bytesDecoded;
+			}
+			samplesRead = static_cast<long>( bytesRead ) / ( channels * 4 );
+			if ( m_Limiter ) {
+				if ( limiterCrossfade ) {
+					CrossfadeToLimiter( buffer, samplesRead );
+				} else {
+					m_Limiter->Process( buffer, samplesRead, m_DecodeBlockScale );
+				}
+				m_LimiterFlushing = finished;
+			}
+		}
+
+		// Flush out any sample data delayed by the limiter, before flagging that decoding has finished.
+		if ( m_LimiterFlushing ) {
+			const long samplesFlushed = m_Limiter->Flush( buffer + samplesRead * channels, blockSize - samplesRead );
+			finished = ( samplesFlushed < ( blockSize - samplesRead ) );
+			samplesRead += samplesFlushed;
+		}
+
+		if ( samplesRead > 0 ) {
+			m_OutputBuffer.Write( buffer, samplesRead );
+			m_DecodedSamples += samplesRead;
+		}
+
+		// Only flag that decoding has finished once all the sample data has been written to the output buffer.
+		if ( finished ) {
+			m_DecodeFinished = true;
+		}
+		decoded = !finished;
+	}
+	return decoded;
+}
+
+void Output::CrossfadeToLimiter( float* buffer, const long sampleCount )
+{
+	const long channels = m_Limiter->GetChannels();
+	const long crossfadeLength = (std::min)( sampleCount, static_cast<long>( s_LimiterCrossfadeLength * m_DecoderSampleRate ) );
+	if ( crossfadeLength > 0 ) {
+		// Keep the undelayed sample data (with any gain left for the limiter applied), to fade out as the limiter output fades in.
+		float* undelayed = m_CrossfadeBuffer.data();
+		std::copy( buffer, buffer + crossfadeLength * channels, undelayed );
+		ScaleSamples( undelayed, static_cast<size_t>( crossfadeLength ) * channels, m_DecodeBlockScale );
+		const float step = 1.0f / crossfadeLength;
+		GenerateGainRamp( m_FadeRamp.data(), crossfadeLength, 1.0f /*position*/, step, false /*equalPower*/ );
+		GenerateGainRamp( m_GainRamp.data(), crossfadeLength, 0.0f /*position*/, -step, false /*equalPower*/ );
+		m_Limiter->Process( buffer, sampleCount, m_DecodeBlockScale );
+		ApplyGainRamp( buffer, crossfadeLength, channels, m_GainRamp.data() );
+		MixWithGainRamp( buffer, undelayed, crossfadeLength, channels, m_FadeRamp.data() );
+	} else {
+		m_Limiter->Process( buffer, sampleCount, m_DecodeBlockScale );
+	}
+}
+
+bool Output::GetLimiterEnabled() const
+{
+	const bool enabled = ( Settings::LimitMode::TruePeak == m_LimitMode ) && ( ( Settings::GainMode::Disabled != m_GainMode ) || m_EQEnabled );
+	return enabled;
+}
+
+void Output::DecodeHandler()
+{
+	// Signal that output can be started once there is enough sample data to fill the output stream buffer, or the decode buffer target has been reached.
+	const long startThreshold = (std::min)( m_DecodeTarget.load(), static_cast<long>( s_OutputBufferLength * m_DecoderSampleRate ) );
+	bool ready = false;
+	bool decoding = true;
+	do {
+		bool canContinue = true;
+		while ( canContinue ) {
+			canContinue = DecodeOutputBlock() && ( WAIT_OBJECT_0 != WaitForSingleObject( m_DecodeStopEvent, 0 ) );
+			if ( !ready && ( !canContinue || ( m_OutputBuffer.GetReadAvailable() >= startThreshold ) ) ) {
+				SetEvent( m_DecodeReadyEvent );
+				ready = true;
+			}
+		}
+		decoding = !m_DecodeFinished;
+	} while ( decoding && ( WAIT_OBJECT_0 != WaitForSingleObject( m_DecodeStopEvent, s_DecodeInterval ) ) );
+}
+
+void Output::StartDecodeThread( const float bufferLength )
+{
+	StopDecodeThread();
+	const long channels = m_DecoderStream ? m_DecoderStream->GetChannels() : 0;
+	const long sampleRate = m_DecoderSampleRate;
+	if ( ( channels > 0 ) && ( sampleRate > 0 ) && ( nullptr != m_DecodeStopEvent ) ) {
+		// The decode buffer is allocated at its maximum length, so that the decode buffer target can be adjusted without interrupting playback.
+		const long capacity = (std::min)( static_cast<long>( AdaptiveBuffer::GetMaximumBufferLength() * sampleRate ), s_MaximumDecodeBufferSamples / channels );
+		m_OutputBuffer.Reset( channels, (std::max)( capacity, static_cast<long>( bufferLength * sampleRate ) ) );
+		m_DecodeBuffer.resize( static_cast<size_t>( s_DecodeBlockLength * sampleRate ) * channels );
+		m_CrossfadeBuffer.resize( m_DecodeBuffer.size() );
+		m_FadeRamp.resize( m_DecodeBuffer.size() / channels );
+		m_GainRamp.resize( m_DecodeBuffer.size() / channels );
+		m_Limiter.reset();
+		if ( Settings::LimitMode::TruePeak == m_LimitMode ) {
+			m_Limiter = std::make_unique<Limiter>( channels, sampleRate );
+			m_Limiter->SetEnabled( GetLimiterEnabled() );
+		}
+		m_LimiterFlushing = false;
+		m_DecodeFinished = false;
+		m_DecodedSamples = 0;
+		m_UnderrunSamples = 0;
+		m_UnderrunCount = 0;
+		m_DecodeTargetUnderruns = 0;
+		m_OutputSamples = 0;
+		m_FadeInEndPosition = 0;
+		m_DecodeStatistics = { m_CurrentItemDecoding.ID, m_CurrentItemDecoding.Info };
+
+		// Offline output modes decode on demand from the output stream callback, so that output is not throttled to real time.
+		m_DecodeOnDemand = IsOfflineMode( m_OutputMode );
+		m_DecodeTarget = m_DecodeOnDemand ? m_OutputBuffer.GetCapacity() : (std::min)( static_cast<long>( bufferLength * sampleRate ), m_OutputBuffer.GetCapacity() );
+
+		if ( !m_DecodeOnDemand ) {
+			ResetEvent( m_DecodeStopEvent );
+			ResetEvent( m_DecodeReadyEvent );
+			m_DecodeThread = CreateThread( NULL /*attributes*/, 0 /*stackSize*/, DecodeThreadProc, reinterpret_cast<LPVOID>( this ), 0 /*flags*/, NULL /*threadId*/ );
+			if ( nullptr != m_DecodeThread ) {
+				SetThreadPriority( m_DecodeThread, THREAD_PRIORITY_ABOVE_NORMAL );
+
+				// The decode thread fills the output buffer, so only wait until there is enough sample data to start output without an underrun.
+				const HANDLE handles[ 2 ] = { m_DecodeReadyEvent, m_DecodeThread };
+				WaitForMultipleObjects( 2 /*count*/, handles, FALSE /*waitAll*/, INFINITE );
+			}
+		}
+	}
+}
+
+void Output::StopDecodeThread()
+{
+	if ( nullptr != m_DecodeThread ) {
+		SetEvent( m_DecodeStopEvent );
+		WaitForSingleObject( m_DecodeThread, INFINITE );
+		CloseHandle( m_DecodeThread );
+		m_DecodeThread = nullptr;
+	}
+	ReportDecodeStatistics();
+	m_DecodeStatistics = {};
+}
+
+void Output::UpdateDecodeStatistics( const long itemID, const long samples, const double decodeTime )
+{
+	m_DecodeStatistics.samples += samples;
+	m_DecodeStatistics.decodeTime += decodeTime;
+	if ( m_CurrentItemDecoding.ID != itemID ) {
+		// The next track has started decoding, so select a decode buffer target suited to it.
+		ReportDecodeStatistics();
+		m_DecodeStatistics = { m_CurrentItemDecoding.ID, m_CurrentItemDecoding.Info, 0, 0, m_UnderrunCount };
+		if ( ( m_DecodeStatistics.itemID > 0 ) && !m_DecodeOnDemand ) {
+			SetDecodeTarget( m_AdaptiveBuffer.GetBufferLength( m_DecodeStatistics.info ) );
+		}
+	} else if ( ( m_DecoderSampleRate > 0 ) && ( m_DecodeStatistics.samples >= static_cast<long long>( s_DecodeStatisticsInterval * m_DecoderSampleRate ) ) ) {
+		// Only increase the decode buffer target during a track, in case it is decoding more slowly than expected.
+		ReportDecodeStatistics();
+		if ( !m_DecodeOnDemand ) {
+			const float bufferLength = m_AdaptiveBuffer.GetBufferLength( m_DecodeStatistics.info );
+			if ( static_cast<long>( bufferLength * m_DecoderSampleRate ) > m_DecodeTarget ) {
+				SetDecodeTarget( bufferLength );
+			}
+		}
+	}
+}
+
+void Output::ReportDecodeStatistics()
+{
+	if ( ( m_DecodeStatistics.itemID > 0 ) && ( m_DecoderSampleRate > 0 ) ) {
+		const long long underruns = m_UnderrunCount;
+		m_AdaptiveBuffer.Update( m_DecodeStatistics.info, static_cast<double>( m_DecodeStatistics.samples ) / m_DecoderSampleRate, m_DecodeStatistics.decodeTime, underruns - m_DecodeStatistics.underruns );
+		m_DecodeStatistics.samples = 0;
+		m_DecodeStatistics.decodeTime = 0;
+		m_DecodeStatistics.underruns = underruns;
+	}
+}
+
+void Output::SetDecodeTarget( const float seconds )
+{
+	m_DecodeTarget = (std::min)( static_cast<long>( seconds * m_DecoderSampleRate ), m_OutputBuffer.GetCapacity() );
+}
+
+void Output::StartSinkThread()
+{
+	StopSinkThread();
+	if ( ( 0 != m_OutputStream ) && ( nullptr != m_SinkStopEvent ) ) {
+		m_SinkFilename.clear();
+		if ( Settings::OutputMode::File == m_OutputMode ) {
+			std::wstring filename;
+			bool addToLibrary = false;
+			bool joinTracks = false;
+			m_Settings.GetExtractSettings( m_SinkFilename, filename, addToLibrary, joinTracks );
+			if ( !m_SinkFilename.empty() && ( '\\' != m_SinkFilename.back() ) ) {
+				m_SinkFilename += L"\\";
+			}
+			m_SinkFilename += s_SinkFilename;
+		}
+		m_SinkPaused = false;
+		m_SinkFinished = false;
+		ResetEvent( m_SinkStopEvent );
+		m_SinkThread = CreateThread( NULL /*attributes*/, 0 /*stackSize*/, SinkThreadProc, reinterpret_cast<LPVOID>( this ), 0 /*flags*/, NULL /*threadId*/ );
+	}
+}
+
+void Output::StopSinkThread()
+{
+	if ( nullptr != m_SinkThread ) {
+		SetEvent( m_SinkStopEvent );
+		WaitForSingleObject( m_SinkThread, INFINITE );
+		CloseHandle( m_SinkThread );
+		m_SinkThread = nullptr;
+	}
+}
+
+void Output::SinkHandler()
+{
+	BASS_CHANNELINFO channelInfo = {};
+	if ( ( TRUE == BASS_ChannelGetInfo( m_OutputStream, &channelInfo ) ) && ( channelInfo.freq > 0 ) && ( channelInfo.chans > 0 ) ) {
+		const long sampleRate = static_cast<long>( channelInfo.freq );
+		const long channels = static_cast<long>( channelInfo.chans );
+
+		Encoder::Ptr encoder;
+		if ( !m_SinkFilename.empty() ) {
+			// Write the output stream sample data as is, so that any channel layout is supported, and the output is not requantised.
+			encoder = std::make_shared<EncoderPCM>( true /*floatingPoint*/ );
+			std::wstring filename = m_SinkFilename;
+			if ( !encoder->Open( filename, sampleRate, channels, 32 /*bitsPerSample*/, std::string() /*settings*/ ) ) {
+				encoder.reset();
+			}
+		}
+
+		std::vector<float> buffer( static_cast<size_t>( s_SinkBlockLength * sampleRate ) * channels );
+		const DWORD byteCount = static_cast<DWORD>( buffer.size() * sizeof( float ) );
+		long long samplesWritten = 0;
+		const LONGLONG startTick = GetTick();
+		while ( WAIT_OBJECT_0 != WaitForSingleObject( m_SinkStopEvent, m_SinkPaused ? s_DecodeInterval : 0 ) ) {
+			if ( !m_SinkPaused ) {
+				const DWORD bytesRead = BASS_ChannelGetData( m_OutputStream, buffer.data(), byteCount );
+				if ( ( static_cast<DWORD>( -1 ) == bytesRead ) || ( 0 == bytesRead ) ) {
+					break;
+				}
+				const long sampleCount = static_cast<long>( bytesRead ) / ( channels * 4 );
+				if ( encoder ) {
+					encoder->Write( buffer.data(), sampleCount );
+				}
+				samplesWritten += sampleCount;
+			}
+		}
+
+		if ( encoder ) {
+			encoder->Close();
+		}
+
+		const float elapsed = GetInterval( startTick, GetTick() );
+		m_Metrics.Add( PlaybackMetrics::Counter::SinkOutputTime, static_cast<long long>( 1000 * samplesWritten / sampleRate ) );
+		m_Metrics.Add( PlaybackMetrics::Counter::SinkElapsedTime, static_cast<long long>( 1000 * elapsed ) );
+	}
+	m_SinkFinished = true;
+}
@@ -2,13 +2,24 @@
 
 #include "stdafx.h"
 
+#include "AdaptiveBuffer.h"
 #include "bass.h"
+#include "GainEstimator.h"
 #include "Handlers.h"
+#include "Limiter.h"
+#include "PCMCache.h"
+#include "PlaybackMetrics.h"
 #include "Playlist.h"
+#include "RingBuffer.h"
 #include "Settings.h"
 
+#include <array>
 #include <atomic>
+#include <deque>
 #include <functional>
+#include <memory>
+#include <set>
+#include <vector>
 
 // Message ID for signalling that playback needs to be restarted from a playlist item ID (wParam).
 static const UINT MSG_RESTARTPLAYBACK = WM_APP + 191;
@@ -192,12 +203,49 @@ public:
 	// Sets the 'callback' function for when the output playlist changes.
 	void SetPlaylistChangeCallback( PlaylistChangeCallback callback );
 
+	// Called when items are added to or removed from a 'playlist'.
+	void OnPlaylistChanged( const Playlist* playlist );
+
+	// Returns the number of times the output buffer has run dry since playback was started.
+	long long GetUnderrunCount() const;
+
+	// Returns the playback metrics.
+	const PlaybackMetrics& GetMetrics() const;
+
+	// Resets the playback metrics.
+	void ResetMetrics();
+
+	// Writes the playback metrics to 'filename'.
+	// Returns whether the metrics were written.
+	bool WriteMetrics( const std::wstring& filename ) const;
+
+	// Returns the latest gain estimate for a playlist item with 'itemID' (which contains no gain if the item has not been estimated).
+	GainEstimator::Estimate GetGainEstimate( const long itemID ) const;
+
 private:
+	// Allows the unit tests to drive decoding directly, in place of the output stream callback.
+	friend class OutputTest;
+
 	// Output queue.
 	typedef std::vector<Item> Queue;
 
 	// Maps a playlist item ID to a gain estimate.
-	typedef std::map<long, std::optional<float>> GainEstimateMap;
+	typedef std::map<long, GainEstimator::Estimate> GainEstimateMap;
+
+	// Gain processing state for a decoding stream.
+	struct GainState {
+		// Soft-clip state, for each channel (of a fixed size, so that the gain state can be copied on the decode thread without allocating).
+		std::array<float, 32> SoftClip = {};
+
+		// Estimated gain currently applied, in dB, which moves gradually towards the latest estimate.
+		std::optional<float> EstimatedGain;
+
+		// Total gain last applied, in dB.
+		float Preamp = 0;
+
+		// Linear scale for the total gain last applied, which is only recalculated when the gain changes.
+		float Scale = 1.0f;
+	};
 
 	// Maps an ID to a stream handle.
 	typedef std::map<int,HSTREAM> StreamMap;
@@ -210,6 +258,20 @@ private:
 		Playlist::Item itemToPreload = {};			// Item to preload.
 		Playlist::Item item = {};								// Preloaded item.
 		Decoder::Ptr	 decoder = {};						// Preloaded decoder.
+		long channels = 0;											// Number of channels to which the decoder is converted.
+		long sampleRate = 0;										// Sample rate to which the decoder is converted.
+		bool crossfade = false;									// Whether the decoder is prepared for a crossfade (with leading silence skipped).
+		float crossfadeOffset = 0;							// Amount of leading silence skipped, in seconds.
+		std::optional<float> crossfadePosition;	// Crossfade position, in seconds from the start of the track (if it has been calculated).
+	};
+
+	// Decoding statistics for the track currently being decoded.
+	struct DecodeStatistics {
+		long itemID = 0;							// Playlist item ID.
+		MediaInfo info = {};					// Media information.
+		double decodeTime = 0;				// Time spent decoding, in seconds.
+		long long samples = 0;				// Number of samples per channel decoded.
+		long long underruns = 0;			// Underrun count when the statistics were last reported.
 	};
 
 	// BASS stream callback.
@@ -239,6 +301,15 @@ private:
 	// Preload decoder thread procedure.
 	static DWORD WINAPI PreloadDecoderProc( LPVOID lpParam );
 
+	// Decode thread procedure.
+	static DWORD WINAPI DecodeThreadProc( LPVOID lpParam );
+
+	// Offline output sink thread procedure.
+	static DWORD WINAPI SinkThreadProc( LPVOID lpParam );
+
+	// Returns whether the output 'mode' is an offline mode, which does not use a sound device.
+	static bool IsOfflineMode( const Settings::OutputMode mode );
+
 	// Gets the current tick count.
 	static LONGLONG GetTick();
 
@@ -252,6 +323,49 @@ private:
 	// Returns the number of bytes read.
 	DWORD ReadSampleData( float* buffer, const DWORD byteCount, HSTREAM handle );
 
+	// Reads sample data from the output buffer, padding with silence if the decode thread has not kept up.
+	// 'buffer' - sample buffer.
+	// 'byteCount' - number of bytes to read.
+	// Returns the number of bytes read.
+	DWORD ReadOutputBuffer( float* buffer, const DWORD byteCount );
+
+	// Applies a fade to sample data read from the output buffer, which was decoded before the decode thread started to apply the fade itself (output stream callback only).
+	// 'buffer' - sample buffer.
+	// 'sampleCount' - in, number of samples per channel in the buffer, out, number of samples per channel to output (truncated at the end of a fade out).
+	// 'channels' - number of channels.
+	// 'position' - output stream position of the first sample, in samples per channel.
+	// Returns whether a fade out has finished.
+	bool ApplyOutputFade( float* buffer, long& sampleCount, const long channels, const long long position );
+
+	// Starts fading from the current position of the sample data fed to the output stream.
+	// 'fadeToNext' - true to fade to the next track, false to fade out.
+	void StartOutputFade( const bool fadeToNext );
+
+	// Cancels any fade applied to the sample data already in the output buffer.
+	void CancelOutputFade();
+
+	// Decodes a block of sample data into the output buffer, if there is sufficient space.
+	// Returns whether a block was decoded (false if the buffer is full, or the output stream has finished decoding).
+	bool DecodeOutputBlock();
+
+	// Limits a 'buffer' containing 'sampleCount' samples per channel, crossfading from the undelayed sample data to the output of a newly created true peak limiter.
+	void CrossfadeToLimiter( float* buffer, const long sampleCount );
+
+	// Returns whether the true peak limiter should currently be limiting the output.
+	bool GetLimiterEnabled() const;
+
+	// Updates the decoding statistics after a block of sample data has been decoded, and adjusts the decode buffer target as necessary (decode thread only).
+	// 'itemID' - playlist ID of the item that was decoding at the start of the block.
+	// 'samples' - number of samples per channel decoded.
+	// 'decodeTime' - time taken to decode the block, in seconds.
+	void UpdateDecodeStatistics( const long itemID, const long samples, const double decodeTime );
+
+	// Reports the decoding statistics for the track currently being decoded to the adaptive buffer, and resets the statistics.
+	void ReportDecodeStatistics();
+
+	// Sets the decode buffer target, in seconds.
+	void SetDecodeTarget( const float seconds );
+
 	// Called when playback has ended.
 	void OnSyncEnd();
 
@@ -261,19 +375,41 @@ private:
 	// Background thread handler for precalculating loudness values for tracks in the current playlist.
 	void LoudnessPrecalcHandler();
 
+	// Takes the next playlist 'item' for loudness precalculation, rebuilding the queue first if the playlist or current item has changed.
+	// Returns whether an item was taken.
+	bool TakeLoudnessPrecalcItem( Playlist::Item& item );
+
+	// Rebuilds the loudness precalculation queue, with the items due to be played next at the front (the loudness precalculation mutex must be held).
+	void UpdateLoudnessPrecalcQueue();
+
+	// Wakes the loudness precalculation threads, so that the queue is rebuilt.
+	// 'currentItemID' - ID of the item now being decoded, or zero if the current item has not changed.
+	void WakeLoudnessPrecalc( const long currentItemID = 0 );
+
 	// Background thread handler for preloading the next decoder.
 	void PreloadDecoderHandler();
 
+	// Background thread handler for decoding sample data into the output buffer.
+	void DecodeHandler();
+
 	// Initialises the BASS system;
 	void InitialiseBass();
 
 	// Estimates the gain for a playlist 'item' if necessary.
 	void EstimateGain( Playlist::Item& item );
 
-	// Calculates the crossfade point for the 'item'.
-	// 'seekOffset' - indicates the initial seek position of 'item', in seconds.
+	// Skips any leading silence from the 'decoder' for a playlist 'item', seeking past most of the silence if its duration is known from a previous analysis.
+	// Returns the amount of silence skipped, in seconds.
+	float SkipSilence( Decoder& decoder, const Playlist::Item& item );
+
+	// Calculates the crossfade point for the 'item' on the crossfade calculation thread.
+	// 'seekOffset' - indicates the initial decoding position of 'item' (the seek position, or the amount of leading silence skipped), in seconds.
 	void CalculateCrossfadePoint( const Playlist::Item& item, const float seekOffset = 0.0f );
 
+	// Returns the crossfade position for the 'item', in seconds from the start of the track, fetching it from the media library if it has previously been calculated.
+	// 'canContinue' - callback which returns whether the calculation can continue.
+	std::optional<float> FindCrossfadePosition( const Playlist::Item& item, Decoder::CanContinue canContinue );
+
 	// Terminates the crossfade calculation thread.
 	void StopCrossfadeThread();
 
@@ -283,18 +419,28 @@ private:
 	// Sets the crossfade 'position' for the current track, in seconds.
 	void SetCrossfadePosition( const float position );
 
-	// Applies gain (and EQ preamp) to an output 'buffer' containing 'sampleCount' samples, using 'item' information and 'softClipState'.
-	void ApplyGain( float* buffer, const long sampleCount, const Playlist::Item& item, std::vector<float>& softClipState );
+	// Applies gain (and EQ preamp) to an output 'buffer' containing 'sampleCount' samples of 'channels' channels, using 'item' information and 'gainState'.
+	// 'deferScale' - whether a constant gain can be left for the true peak limiter to apply, in the same pass as limiting.
+	// Returns the linear gain that has been left to apply (1.0 if all gain has been applied).
+	float ApplyGain( float* buffer, const long sampleCount, const long channels, const Playlist::Item& item, GainState& gainState, const bool deferScale = false );
+
+	// Sets the gain 'estimate' for a playlist item with 'itemID'.
+	void SetGainEstimate( const long itemID, const GainEstimator::Estimate& estimate );
 
-	// Gets the output queue.
-	Queue GetOutputQueue();
+	// Appends an 'item' to the output queue.
+	void AddToOutputQueue( const Item& item );
 
-	// Sets the output 'queue'.
-	void SetOutputQueue( const Queue& queue );
+	// Clears the output queue.
+	void ClearOutputQueue();
 
 	// Returns a decoder for the 'item' (and updates the item if necessary), or nullptr if a decoder could not be opened.
-	// 'usePreloadedDecoder' - whether to use the preloaded decoder (when available).
-	Decoder::Ptr OpenDecoder( Playlist::Item& item, const bool usePreloadedDecoder = false );
+	// 'readAhead' - whether the decoder streams the whole file for playback, in which case it reads ahead of the file position and records the decoded audio to the cache.
+	Decoder::Ptr OpenDecoder( Playlist::Item& item, const bool readAhead );
+
+	// Returns a decoder for the file in 'mediaInfo', from the decoded audio cache if possible, or nullptr if a decoder could not be opened.
+	// 'record' - whether a decoder opened from the file adds the decoded audio to the cache, once the whole track has been decoded.
+	//            Only playback and preload decoders are recorded, so these are also the only decoders which read ahead of the file position.
+	Decoder::Ptr OpenCachedDecoder( const MediaInfo& mediaInfo, const bool record );
 
 	// Starts the output and returns the output state.
 	State StartOutput();
@@ -318,9 +464,8 @@ private:
 	// Applies lead-in silence when starting playback.
 	// 'buffer' - sample buffer.
 	// 'byteCount' - sample buffer size, in bytes.
-	// 'handle' - stream handle.
 	// Returns the number of bytes that have been fed in to the start of the sample buffer.
-	DWORD ApplyLeadIn( float* buffer, const DWORD byteCount, HSTREAM handle ) const;
+	DWORD ApplyLeadIn( float* buffer, const DWORD byteCount ) const;
 
 	// Returns the fade out duration, in seconds.
 	float GetFadeOutDuration() const;
@@ -328,18 +473,26 @@ private:
 	// Returns the fade to next duration, in seconds.
 	float GetFadeToNextDuration() const;
 
-	// Starts the loudness precalculation thread.
-	void StartLoudnessPrecalcThread();
+	// Starts the loudness precalculation threads.
+	void StartLoudnessPrecalcThreads();
 
-	// Stops the loudness precalculation thread.
-	void StopLoudnessPrecalcThread();
+	// Stops the loudness precalculation threads.
+	void StopLoudnessPrecalcThreads();
 
 	// Sets whether the output stream has finished.
 	void SetOutputStreamFinished( const bool finished );
 
-	// Returns the next decoder on from the 'item', or nullptr if a decoder could not be opened.
-	// Updates 'item' with the next playlist item on success, resets 'item' on failure.
-	Decoder::Ptr GetNextDecoder( Playlist::Item& item );
+	// Returns the next decoder on from the 'item', converted to the output format (the returned decoder is empty if one could not be opened).
+	// The preloaded decoder is used when it has been prepared for the same file and output format, otherwise the decoder is prepared on the calling thread.
+	PreloadedDecoder GetNextDecoder( const Playlist::Item& item );
+
+	// Opens and prepares a decoder for the 'preloaded' item, so that it is ready to switch to at a transition.
+	// The gain is estimated, the decoder is converted to the 'preloaded' channels and sample rate, and when preparing for a crossfade, leading silence is skipped.
+	// 'canContinue' - callback which returns whether calculating the crossfade position can continue, or nullptr to leave the crossfade position to the crossfade calculation thread.
+	void PrepareDecoder( PreloadedDecoder& preloaded, Decoder::CanContinue canContinue );
+
+	// Requests the preload decoder thread to prepare a decoder for the 'item', in the current output format (the preloaded decoder mutex must be held).
+	void RequestPreload( const Playlist::Item& item );
 
 	// Starts the preload decoder thread.
 	void StartPreloadDecoderThread();
@@ -350,11 +503,27 @@ private:
 	// Preloads the next decoder on from the current 'item'.
 	void PreloadNextDecoder( const Playlist::Item& item );
 
-	// Gets the stream title queue.
-	std::vector<std::pair<float /*seconds*/,std::wstring /*title*/>> GetStreamTitleQueue();
+	// Starts the decode thread, waiting until it has buffered enough sample data to start output.
+	// 'bufferLength' - initial decode buffer target, in seconds.
+	void StartDecodeThread( const float bufferLength );
+
+	// Stops the decode thread.
+	void StopDecodeThread();
+
+	// Starts the offline output sink thread, which pulls sample data from the output stream as fast as possible.
+	void StartSinkThread();
+
+	// Stops the offline output sink thread.
+	void StopSinkThread();
+
+	// Offline output sink thread handler.
+	void SinkHandler();
+
+	// Appends a stream 'title', starting at 'seconds', to the stream title queue.
+	void AddToStreamTitleQueue( const float seconds, const std::wstring& title );
 
-	// Sets the stream title 'queue'.
-	void SetStreamTitleQueue( const std::vector<std::pair<float /*seconds*/,std::wstring /*title*/>>& queue );
+	// Clears the stream title queue.
+	void ClearStreamTitleQueue();
 
 	// Module instance handle.
 	const HINSTANCE m_hInst;
@@ -368,14 +537,17 @@ private:
 	// Application settings.
 	Settings& m_Settings;
 
+	// Recently decoded audio, for tracks which are played or analysed again.
+	PCMCache m_PCMCache;
+
 	// The current playlist.
 	Playlist::Ptr m_Playlist;
 
 	// The currently decoding playlist item.
 	Playlist::Item m_CurrentItemDecoding;
 
-	// The soft-clip state for the currently decoding item.
-	std::vector<float> m_SoftClipStateDecoding;
+	// The gain state for the currently decoding item.
+	GainState m_GainStateDecoding;
 
 	// The currently decoding stream.
 	Decoder::Ptr m_DecoderStream;
@@ -452,6 +624,9 @@ private:
 	// Position of the last transition in the output stream, in seconds.
 	float m_LastTransitionPosition;
 
+	// Decode position at which the incoming track reaches full level during an equal power crossfade or fade to next, in seconds (or zero if no fade in is active).
+	float m_FadeInEndPosition;
+
 	// Crossfade position for the current track, in seconds.
 	float m_CrossfadePosition;
 
@@ -464,12 +639,36 @@ private:
 	// Event handle for terminating the crossfade calculation thread.
 	HANDLE m_CrossfadeStopEvent;
 
-	// The thread for loudness precalculation.
-	HANDLE m_LoudnessPrecalcThread;
+	// Crossfade position mutex, so that a calculation which has been stopped cannot overwrite a crossfade position set in the meantime.
+	std::mutex m_CrossfadeMutex;
+
+	// The threads for loudness precalculation.
+	std::vector<HANDLE> m_LoudnessPrecalcThreads;
 
-	// Event handle for terminating the loudness precalculation thread.
+	// Event handle for terminating the loudness precalculation threads.
 	HANDLE m_LoudnessPrecalcStopEvent;
 
+	// Event handle for waking the loudness precalculation threads.
+	HANDLE m_LoudnessPrecalcWakeEvent;
+
+	// Playlist items waiting for loudness precalculation, in priority order.
+	std::deque<Playlist::Item> m_LoudnessPrecalcQueue;
+
+	// Indicates whether the loudness precalculation queue needs to be rebuilt.
+	bool m_LoudnessPrecalcQueueStale;
+
+	// ID of the item being decoded, from which the loudness precalculation queue is ordered.
+	long m_LoudnessPrecalcCurrentID;
+
+	// IDs of the playlist items which have already been taken for loudness precalculation (so that the library is only queried once for each item).
+	std::set<long> m_LoudnessPrecalcChecked;
+
+	// Playlist to which the loudness precalculation state applies.
+	Playlist::Ptr m_LoudnessPrecalcPlaylist;
+
+	// Loudness precalculation mutex.
+	std::mutex m_LoudnessPrecalcMutex;
+
 	// The thread for preloading the next decoder.
 	HANDLE m_PreloadDecoderThread;
 
@@ -488,15 +687,18 @@ private:
 	// The item that is being faded out during a crossfade.
 	Playlist::Item m_CurrentItemCrossfading;
 
-	// The soft-clip state for the currently crossfading item.
-	std::vector<float> m_SoftClipStateCrossfading;
+	// The gain state for the currently crossfading item.
+	GainState m_GainStateCrossfading;
 
-	// Indicates an offset to subtract from the crossfade calculation, in seconds.
+	// Indicates an offset to subtract from the crossfade position, in seconds.
 	float m_CrossfadeSeekOffset;
 
 	// Gain estimates.
 	GainEstimateMap m_GainEstimateMap;
 
+	// Gain estimates mutex.
+	mutable std::mutex m_GainEstimateMutex;
+
 	// Bling map.
 	StreamMap m_BlingMap;
 
@@ -533,18 +735,124 @@ private:
 	// When starting playback in non-standard output mode, the lead-in length before passing through actual sample data.
 	float m_LeadInSeconds;
 
+	// Indicates whether the output device runs at the sample rate of the output stream (when each track is played using its original sample rate, in the WASAPI exclusive and ASIO modes).
+	// In which case, a track at a different sample rate restarts the output rather than being resampled, unless crossfading.
+	std::atomic<bool> m_NativeSampleRate;
+
 	// A preloaded decoder, which can be used to minimize the delay when switching streams.
 	PreloadedDecoder m_PreloadedDecoder;
 
 	// A mutex for the preloaded decoder.
 	std::mutex m_PreloadedDecoderMutex;
 
+	// Held by the preload decoder thread while it prepares a decoder, so that stopping playback can wait for it to finish using the current playlist.
+	std::mutex m_PreloadPrepareMutex;
+
 	// The queue of stream titles, associated with their start times.
 	std::vector<std::pair<float /*seconds*/,std::wstring /*title*/>> m_StreamTitleQueue;
 
 	// Stream title queue mutex.
 	std::mutex m_StreamTitleMutex;
 
+	// The position at which the stream title of the currently decoding stream last changed, in seconds.
+	std::optional<float> m_StreamTitlePosition;
+
 	// Callback function for when the output playlist changes.
 	PlaylistChangeCallback m_OnPlaylistChangeCallback;
+
+	// Buffer of decoded sample data, read by the output stream callback.
+	RingBuffer m_OutputBuffer;
+
+	// Scratch buffer for decoding a block of sample data, prior to writing it to the output buffer.
+	std::vector<float> m_DecodeBuffer;
+
+	// Scratch buffer for decoding a block of sample data from the crossfading stream.
+	std::vector<float> m_CrossfadeBuffer;
+
+	// Scratch buffer for the fade gain values applied to a block of sample data.
+	std::vector<float> m_FadeRamp;
+
+	// Scratch buffer for the gain values applied to a block of sample data, while moving towards a refined gain estimate.
+	std::vector<float> m_GainRamp;
+
+	// Crossfade curve.
+	std::atomic<Settings::CrossfadeCurve> m_CrossfadeCurve;
+
+	// True peak limiter, which only exists in the true peak limit mode (and is flushed out, or crossfaded to, when the limit mode changes during playback).
+	std::unique_ptr<Limiter> m_Limiter;
+
+	// Indicates whether sample data delayed by the limiter is being flushed out, after the output stream has finished decoding (decode thread only).
+	bool m_LimiterFlushing;
+
+	// Indicates whether the block currently being decoded contains a track transition or stream title change, where heap allocations are expected (decode thread only).
+	bool m_DecodeBlockTransition;
+
+	// Linear gain still to be applied to the block currently being decoded, which the limiter applies in the same pass (decode thread only).
+	float m_DecodeBlockScale;
+
+	// The thread for decoding sample data into the output buffer.
+	HANDLE m_DecodeThread;
+
+	// Event handle for terminating the decode thread.
+	HANDLE m_DecodeStopEvent;
+
+	// Event handle signalled by the decode thread once the output buffer holds enough sample data to start output.
+	HANDLE m_DecodeReadyEvent;
+
+	// Indicates whether the output stream has finished decoding.
+	std::atomic<bool> m_DecodeFinished;
+
+	// Number of samples per channel written to the output buffer.
+	std::atomic<long long> m_DecodedSamples;
+
+	// Number of samples per channel of silence fed to the output stream when the output buffer has run dry.
+	std::atomic<long long> m_UnderrunSamples;
+
+	// Number of times the output buffer has run dry.
+	std::atomic<long long> m_UnderrunCount;
+
+	// Number of samples per channel fed to the output stream, including any silence due to underruns.
+	std::atomic<long long> m_OutputSamples;
+
+	// Output stream position at which the current fade started, in samples per channel (0 when not fading).
+	std::atomic<long long> m_OutputFadeStart;
+
+	// Output stream position from which the decode thread applies the current fade itself, in samples per channel.
+	std::atomic<long long> m_OutputFadeFrontier;
+
+	// Indicates whether the current fade is a fade to the next track, rather than a fade out.
+	std::atomic<bool> m_OutputFadeToNext;
+
+	// Playback metrics.
+	PlaybackMetrics m_Metrics;
+
+	// Chooses the decode buffer target for each track.
+	AdaptiveBuffer m_AdaptiveBuffer;
+
+	// Number of samples per channel that the decode thread aims to keep in the output buffer.
+	std::atomic<long> m_DecodeTarget;
+
+	// Underrun count when the decode buffer target was last checked (decode thread only).
+	long long m_DecodeTargetUnderruns;
+
+	// Decoding statistics for the track currently being decoded (decode thread only).
+	DecodeStatistics m_DecodeStatistics;
+
+	// Indicates whether the output buffer is filled on demand by the output stream callback, rather than by the decode thread.
+	bool m_DecodeOnDemand;
+
+	// The thread for pulling sample data from the output stream, in offline output modes.
+	HANDLE m_SinkThread;
+
+	// Event handle for terminating the sink thread.
+	HANDLE m_SinkStopEvent;
+
+	// Indicates whether the sink thread is paused.
+	std::atomic<bool> m_SinkPaused;
+
+	// Indicates whether the sink thread has reached the end of the output stream.
+	std::atomic<bool> m_SinkFinished;
+
+	// Output file name (without file extension) for the file output mode.
+	std::wstring m_SinkFilename;
 };
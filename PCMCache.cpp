@@ -0,0 +1,202 @@
+#include "PCMCache.h"
+
+#include <algorithm>
+
+// Number of free chunks to keep in the pool, which is enough for a few tracks to be recorded at once.
+static const size_t s_MinimumFreeChunks = 4;
+
+// Maximum number of free chunks to hold in the pool, with any further chunks returned to the pool being released.
+static const size_t s_MaximumFreeChunks = 16;
+
+size_t PCMCache::Track::GetSize() const
+{
+	size_t size = 0;
+	for ( const auto& chunk : Chunks ) {
+		size += chunk.size();
+	}
+	return size;
+}
+
+PCMCache::PCMCache( const size_t maximumSize ) :
+	m_MaximumSize( maximumSize ),
+	m_MinimumFreeChunks( ( std::min )( s_MinimumFreeChunks, maximumSize / ChunkSize ) ),
+	m_Size( 0 ),
+	m_Tracks(),
+	m_Index(),
+	m_Mutex(),
+	m_Pending(),
+	m_PendingMutex(),
+	m_FreeChunks(),
+	m_ChunkMutex(),
+	m_StopEvent( CreateEvent( NULL /*attributes*/, TRUE /*manualReset*/, FALSE /*initialState*/, L"" /*name*/ ) ),
+	m_WakeEvent( CreateEvent( NULL /*attributes*/, TRUE /*manualReset*/, FALSE /*initialState*/, L"" /*name*/ ) ),
+	m_AddThread( nullptr )
+{
+	if ( ( nullptr != m_StopEvent ) && ( nullptr != m_WakeEvent ) ) {
+		m_AddThread = CreateThread( NULL /*attributes*/, 0 /*stackSize*/, AddThreadProc, this /*param*/, 0 /*flags*/, NULL /*threadId*/ );
+	}
+}
+
+PCMCache::~PCMCache()
+{
+	if ( nullptr != m_AddThread ) {
+		SetEvent( m_StopEvent );
+		WaitForSingleObject( m_AddThread, INFINITE );
+		CloseHandle( m_AddThread );
+	}
+	CloseHandle( m_StopEvent );
+	CloseHandle( m_WakeEvent );
+}
+
+DWORD WINAPI PCMCache::AddThreadProc( LPVOID lpParam )
+{
+	PCMCache* cache = static_cast<PCMCache*>( lpParam );
+	if ( nullptr != cache ) {
+		cache->AddHandler();
+	}
+	return 0;
+}
+
+void PCMCache::AddHandler()
+{
+	MaintainChunks();
+	const HANDLE handles[ 2 ] = { m_StopEvent, m_WakeEvent };
+	while ( WaitForMultipleObjects( 2, handles, FALSE /*waitAll*/, INFINITE ) != WAIT_OBJECT_0 ) {
+		PendingList pending;
+		{
+			std::lock_guard<std::mutex> lock( m_PendingMutex );
+			pending.swap( m_Pending );
+			ResetEvent( m_WakeEvent );
+		}
+		for ( const auto& [ key, track ] : pending ) {
+			Insert( key, track );
+		}
+		MaintainChunks();
+	}
+}
+
+PCMCache::TrackPtr PCMCache::Find( const std::wstring& filename, const long long filetime )
+{
+	TrackPtr track;
+	std::lock_guard<std::mutex> lock( m_Mutex );
+	if ( const auto entry = m_Index.find( Key( filename, filetime ) ); m_Index.end() != entry ) {
+		m_Tracks.splice( m_Tracks.begin(), m_Tracks, entry->second );
+		track = entry->second->second;
+	}
+	return track;
+}
+
+void PCMCache::Add( const std::wstring& filename, const long long filetime, const std::shared_ptr<Track> track )
+{
+	if ( track && ( nullptr != m_AddThread ) ) {
+		std::lock_guard<std::mutex> lock( m_PendingMutex );
+		m_Pending.push_back( { Key( filename, filetime ), track } );
+		Wake();
+	}
+}
+
+void PCMCache::Insert( const Key& key, const std::shared_ptr<Track> track )
+{
+	// Release any unused capacity at the end of the track.
+	if ( !track->Chunks.empty() ) {
+		track->Chunks.back().shrink_to_fit();
+	}
+
+	const size_t size = track->GetSize();
+	if ( size <= m_MaximumSize ) {
+		// Discarded tracks are released once the cache mutex is unlocked, so that Find is not held up by freeing their sample data.
+		TrackList discarded;
+		{
+			std::lock_guard<std::mutex> lock( m_Mutex );
+			if ( const auto entry = m_Index.find( key ); m_Index.end() != entry ) {
+				m_Size -= entry->second->second->GetSize();
+				discarded.splice( discarded.end(), m_Tracks, entry->second );
+				m_Index.erase( entry );
+			}
+			while ( !m_Tracks.empty() && ( ( m_Size + size ) > m_MaximumSize ) ) {
+				m_Size -= m_Tracks.back().second->GetSize();
+				m_Index.erase( m_Tracks.back().first );
+				discarded.splice( discarded.end(), m_Tracks, std::prev( m_Tracks.end() ) );
+			}
+			m_Tracks.push_front( { key, track } );
+			m_Index.insert( { key, m_Tracks.begin() } );
+			m_Size += size;
+		}
+	}
+}
+
+size_t PCMCache::GetMaximumSize() const
+{
+	return m_MaximumSize;
+}
+
+std::vector<unsigned char> PCMCache::TakeChunk()
+{
+	std::vector<unsigned char> chunk;
+	bool replenish = false;
+	{
+		std::lock_guard<std::mutex> lock( m_ChunkMutex );
+		if ( !m_FreeChunks.empty() ) {
+			chunk = std::move( m_FreeChunks.back() );
+			m_FreeChunks.pop_back();
+		}
+		replenish = ( m_FreeChunks.size() < m_MinimumFreeChunks );
+	}
+	if ( replenish ) {
+		Wake();
+	}
+
+	// Allocate the chunk here if the pool has run dry.
+	if ( chunk.capacity() < ChunkSize ) {
+		chunk.reserve( ChunkSize );
+	}
+	return chunk;
+}
+
+void PCMCache::ReturnChunks( std::vector<std::vector<unsigned char>>& chunks )
+{
+	// Chunks are only pooled when the background thread is running to release any excess.
+	if ( nullptr != m_AddThread ) {
+		{
+			std::lock_guard<std::mutex> lock( m_ChunkMutex );
+			for ( auto& chunk : chunks ) {
+				if ( chunk.capacity() >= ChunkSize ) {
+					chunk.clear();
+					m_FreeChunks.push_back( std::move( chunk ) );
+				}
+			}
+		}
+		Wake();
+	}
+	chunks.clear();
+}
+
+void PCMCache::MaintainChunks()
+{
+	// Chunks are allocated and released outside of the mutex, so that taking a chunk is never held up.
+	std::vector<std::vector<unsigned char>> excess;
+	size_t freeCount = 0;
+	{
+		std::lock_guard<std::mutex> lock( m_ChunkMutex );
+		while ( m_FreeChunks.size() > s_MaximumFreeChunks ) {
+			excess.push_back( std::move( m_FreeChunks.back() ) );
+			m_FreeChunks.pop_back();
+		}
+		freeCount = m_FreeChunks.size();
+	}
+	excess.clear();
+
+	for ( ; freeCount < m_MinimumFreeChunks; freeCount++ ) {
+		std::vector<unsigned char> chunk;
+		chunk.reserve( ChunkSize );
+		std::lock_guard<std::mutex> lock( m_ChunkMutex );
+		m_FreeChunks.push_back( std::move( chunk ) );
+	}
+}
+
+void PCMCache::Wake()
+{
+	if ( nullptr != m_AddThread ) {
+		SetEvent( m_WakeEvent );
+	}
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+// A bounded in-memory cache of recently decoded tracks, so that a track which is played again can be decoded without reading the original file.
+// Sample data is held losslessly as packed 16-bit or 24-bit integer values, and the least recently used tracks are discarded when the cache is full.
+// Tracks are added on a background thread, so that the cost of finalising each track and of releasing discarded tracks is not borne by the caller.
+// The same thread keeps a small pool of preallocated chunks, so that recording a track does not allocate sample data on the decode thread.
+class PCMCache
+{
+public:
+	// Size of each chunk of sample data, in bytes.
+	static constexpr size_t ChunkSize = 0x60000;
+
+	// 'maximumSize' - maximum amount of sample data to hold, in bytes.
+	PCMCache( const size_t maximumSize );
+
+	virtual ~PCMCache();
+
+	// A decoded track.
+	struct Track {
+		// Duration, in seconds, as reported by the original decoder.
+		float Duration = 0;
+
+		// Sample rate.
+		long SampleRate = 0;
+
+		// Number of channels.
+		long Channels = 0;
+
+		// Bits per sample of the original stream (if relevant).
+		std::optional<long> BitsPerSample;
+
+		// Bitrate of the original stream, in kbps (if relevant).
+		std::optional<float> Bitrate;
+
+		// Number of bytes in each packed value (2 or 3).
+		long BytesPerValue = 0;
+
+		// Number of samples per channel.
+		long long SampleCount = 0;
+
+		// Number of samples per channel in each chunk of sample data.
+		long long ChunkSamples = 0;
+
+		// Packed little endian sample data, in chunks of 'ChunkSamples' samples per channel (with the last chunk holding the remainder).
+		std::vector<std::vector<unsigned char>> Chunks;
+
+		// Returns the amount of sample data held, in bytes.
+		size_t GetSize() const;
+	};
+
+	// Decoded track shared pointer type.
+	using TrackPtr = std::shared_ptr<const Track>;
+
+	// Returns the decoded track for 'filename', with the 'filetime' at which it was decoded, or nullptr if the track is not in the cache.
+	TrackPtr Find( const std::wstring& filename, const long long filetime );
+
+	// Queues a decoded 'track' for 'filename', with the 'filetime' at which it was decoded, to be added to the cache.
+	// The track is finalised and added on the background thread, discarding the least recently used tracks as necessary, and must not be modified by the caller afterwards.
+	void Add( const std::wstring& filename, const long long filetime, const std::shared_ptr<Track> track );
+
+	// Returns the maximum amount of sample data to hold, in bytes.
+	size_t GetMaximumSize() const;
+
+	// Returns an empty chunk with a capacity of at least 'ChunkSize' bytes, taken from the pool of preallocated chunks where possible.
+	std::vector<unsigned char> TakeChunk();
+
+	// Returns unused 'chunks' to the pool of preallocated chunks, leaving 'chunks' empty.
+	void ReturnChunks( std::vector<std::vector<unsigned char>>& chunks );
+
+private:
+	// Cache key, pairing a filename with a filetime.
+	using Key = std::pair<std::wstring, long long>;
+
+	// Cached tracks, from most to least recently used.
+	using TrackList = std::list<std::pair<Key, TrackPtr>>;
+
+	// Tracks which have yet to be added.
+	using PendingList = std::list<std::pair<Key, std::shared_ptr<Track>>>;
+
+	// Thread procedure which adds the pending tracks.
+	// 'lpParam' - thread parameter.
+	static DWORD WINAPI AddThreadProc( LPVOID lpParam );
+
+	// Thread handler which adds the pending tracks.
+	void AddHandler();
+
+	// Finalises and adds a 'track' for the 'key', discarding the least recently used tracks as necessary.
+	void Insert( const Key& key, const std::shared_ptr<Track> track );
+
+	// Allocates or releases chunks so that the pool holds between the minimum and maximum number of free chunks.
+	void MaintainChunks();
+
+	// Wakes the thread which adds the pending tracks, if it is running.
+	void Wake();
+
+	// Maximum amount of sample data to hold, in bytes.
+	const size_t m_MaximumSize;
+
+	// Minimum number of free chunks to keep in the pool.
+	const size_t m_MinimumFreeChunks;
+
+	// Current amount of sample data held, in bytes.
+	size_t m_Size;
+
+	// Cached tracks, from most to least recently used.
+	TrackList m_Tracks;
+
+	// Maps a key to its cached track.
+	std::map<Key, TrackList::iterator> m_Index;
+
+	// Cache mutex.
+	std::mutex m_Mutex;
+
+	// Tracks which have yet to be added.
+	PendingList m_Pending;
+
+	// Pending tracks mutex.
+	std::mutex m_PendingMutex;
+
+	// Pool of free chunks.
+	std::vector<std::vector<unsigned char>> m_FreeChunks;
+
+	// Free chunks mutex.
+	std::mutex m_ChunkMutex;
+
+	// Event handle with which to stop the thread which adds the pending tracks.
+	HANDLE m_StopEvent;
+
+	// Event handle with which to wake the thread which adds the pending tracks.
+	HANDLE m_WakeEvent;
+
+	// Thread which adds the pending tracks.
+	HANDLE m_AddThread;
+};
@@ -0,0 +1,270 @@
+#include "PlaybackMetrics.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+// Buffer fill level scale (parts per million).
+static const long s_BufferFillScale = 1000000;
+
+// Percentiles to include in the metrics report.
+static const std::array<double, 3> s_ReportPercentiles = { 50, 95, 99 };
+
+// Updates an atomic 'maximum' with 'value'.
+template<typename T>
+static void UpdateMaximum( std::atomic<T>& maximum, const T value )
+{
+	T current = maximum.load( std::memory_order_relaxed );
+	while ( ( value > current ) && !maximum.compare_exchange_weak( current, value, std::memory_order_relaxed ) ) {}
+}
+
+// Updates an atomic 'minimum' with 'value'.
+template<typename T>
+static void UpdateMinimum( std::atomic<T>& minimum, const T value )
+{
+	T current = minimum.load( std::memory_order_relaxed );
+	while ( ( value < current ) && !minimum.compare_exchange_weak( current, value, std::memory_order_relaxed ) ) {}
+}
+
+double PlaybackMetrics::Histogram::GetPercentile( const double percentile ) const
+{
+	double duration = 0;
+	if ( Count > 0 ) {
+		const long long target = std::max( 1ll, static_cast<long long>( 0.5 + Count * std::clamp( percentile, 0.0, 100.0 ) / 100 ) );
+		long long total = 0;
+		for ( size_t bucket = 0; bucket < HistogramBuckets; bucket++ ) {
+			total += Buckets[ bucket ];
+			if ( total >= target ) {
+				// Use the upper bound of the bucket, limited to the maximum measurement.
+				duration = std::min( static_cast<double>( 1ll << bucket ), static_cast<double>( Maximum ) ) / 1000;
+				break;
+			}
+		}
+	}
+	return duration;
+}
+
+PlaybackMetrics::PlaybackMetrics() :
+	m_Timings(),
+	m_Counters(),
+	m_BufferFill( 0 ),
+	m_BufferFillMinimum( s_BufferFillScale ),
+	m_BufferFillTotal( 0 ),
+	m_BufferFillCount( 0 )
+{
+}
+
+PlaybackMetrics::~PlaybackMetrics()
+{
+}
+
+void PlaybackMetrics::RecordTiming( const Timing timing, const Clock::time_point& start )
+{
+	const size_t index = static_cast<size_t>( timing );
+	if ( index < m_Timings.size() ) {
+		const long long microseconds = std::max( 0ll, static_cast<long long>( std::chrono::duration_cast<std::chrono::microseconds>( Clock::now() - start ).count() ) );
+		size_t bucket = 0;
+		while ( ( bucket < ( HistogramBuckets - 1 ) ) && ( microseconds > ( 1ll << bucket ) ) ) {
+			++bucket;
+		}
+		AtomicHistogram& histogram = m_Timings[ index ];
+		histogram.Buckets[ bucket ].fetch_add( 1, std::memory_order_relaxed );
+		histogram.Total.fetch_add( microseconds, std::memory_order_relaxed );
+		UpdateMaximum( histogram.Maximum, microseconds );
+		histogram.Count.fetch_add( 1, std::memory_order_relaxed );
+	}
+}
+
+void PlaybackMetrics::Increment( const Counter counter )
+{
+	const size_t index = static_cast<size_t>( counter );
+	if ( index < m_Counters.size() ) {
+		m_Counters[ index ].fetch_add( 1, std::memory_order_relaxed );
+	}
+}
+
+void PlaybackMetrics::Add( const Counter counter, const long long value )
+{
+	const size_t index = static_cast<size_t>( counter );
+	if ( ( index < m_Counters.size() ) && ( 0 != value ) ) {
+		m_Counters[ index ].fetch_add( value, std::memory_order_relaxed );
+	}
+}
+
+void PlaybackMetrics::RecordBufferFill( const float fill )
+{
+	const long value = static_cast<long>( std::clamp( fill, 0.0f, 1.0f ) * s_BufferFillScale );
+	m_BufferFill.store( value, std::memory_order_relaxed );
+	UpdateMinimum( m_BufferFillMinimum, value );
+	m_BufferFillTotal.fetch_add( value, std::memory_order_relaxed );
+	m_BufferFillCount.fetch_add( 1, std::memory_order_relaxed );
+}
+
+PlaybackMetrics::Snapshot PlaybackMetrics::GetSnapshot() const
+{
+	Snapshot snapshot;
+	for ( size_t index = 0; index < m_Timings.size(); index++ ) {
+		const AtomicHistogram& source = m_Timings[ index ];
+		Histogram& histogram = snapshot.Timings[ index ];
+		histogram.Count = source.Count.load( std::memory_order_relaxed );
+		histogram.Total = source.Total.load( std::memory_order_relaxed );
+		histogram.Maximum = source.Maximum.load( std::memory_order_relaxed );
+		for ( size_t bucket = 0; bucket < HistogramBuckets; bucket++ ) {
+			histogram.Buckets[ bucket ] = source.Buckets[ bucket ].load( std::memory_order_relaxed );
+		}
+	}
+	for ( size_t index = 0; index < m_Counters.size(); index++ ) {
+		snapshot.Counters[ index ] = m_Counters[ index ].load( std::memory_order_relaxed );
+	}
+	const long long fillCount = m_BufferFillCount.load( std::memory_order_relaxed );
+	if ( fillCount > 0 ) {
+		snapshot.BufferFill = static_cast<float>( m_BufferFill.load( std::memory_order_relaxed ) ) / s_BufferFillScale;
+		snapshot.BufferFillMinimum = static_cast<float>( m_BufferFillMinimum.load( std::memory_order_relaxed ) ) / s_BufferFillScale;
+		snapshot.BufferFillAverage = static_cast<float>( static_cast<double>( m_BufferFillTotal.load( std::memory_order_relaxed ) ) / fillCount / s_BufferFillScale );
+	}
+	return snapshot;
+}
+
+void PlaybackMetrics::Reset()
+{
+	for ( auto& histogram : m_Timings ) {
+		histogram.Count = 0;
+		histogram.Total = 0;
+		histogram.Maximum = 0;
+		for ( auto& bucket : histogram.Buckets ) {
+			bucket = 0;
+		}
+	}
+	for ( auto& counter : m_Counters ) {
+		counter = 0;
+	}
+	m_BufferFill = 0;
+	m_BufferFillMinimum = s_BufferFillScale;
+	m_BufferFillTotal = 0;
+	m_BufferFillCount = 0;
+}
+
+bool PlaybackMetrics::WriteFile( const std::wstring& filename ) const
+{
+	bool success = false;
+	std::ofstream stream( filename, std::ios::out | std::ios::trunc );
+	if ( stream.is_open() ) {
+		const Snapshot snapshot = GetSnapshot();
+		stream << std::fixed << std::setprecision( 3 );
+
+		stream << "Timing (ms),Count,Mean,Maximum";
+		for ( const auto& percentile : s_ReportPercentiles ) {
+			stream << ",P" << static_cast<int>( percentile );
+		}
+		stream << std::endl;
+		for ( size_t index = 0; index < snapshot.Timings.size(); index++ ) {
+			const Histogram& histogram = snapshot.Timings[ index ];
+			const double mean = ( histogram.Count > 0 ) ? ( static_cast<double>( histogram.Total ) / histogram.Count / 1000 ) : 0;
+			stream << GetName( static_cast<Timing>( index ) ) << "," << histogram.Count << "," << mean << "," << ( static_cast<double>( histogram.Maximum ) / 1000 );
+			for ( const auto& percentile : s_ReportPercentiles ) {
+				stream << "," << histogram.GetPercentile( percentile );
+			}
+			stream << std::endl;
+		}
+		stream << std::endl;
+
+		stream << "Histogram (ms)";
+		for ( size_t index = 0; index < snapshot.Timings.size(); index++ ) {
+			stream << "," << GetName( static_cast<Timing>( index ) );
+		}
+		stream << std::endl;
+		for ( size_t bucket = 0; bucket < HistogramBuckets; bucket++ ) {
+			if ( bucket < ( HistogramBuckets - 1 ) ) {
+				stream << "<=" << ( static_cast<double>( 1ll << bucket ) / 1000 );
+			} else {
+				stream << ">" << ( static_cast<double>( 1ll << ( bucket - 1 ) ) / 1000 );
+			}
+			for ( const auto& histogram : snapshot.Timings ) {
+				stream << "," << histogram.Buckets[ bucket ];
+			}
+			stream << std::endl;
+		}
+		stream << std::endl;
+
+		stream << "Counter,Value" << std::endl;
+		for ( size_t index = 0; index < snapshot.Counters.size(); index++ ) {
+			stream << GetName( static_cast<Counter>( index ) ) << "," << snapshot.Counters[ index ] << std::endl;
+		}
+		stream << std::endl;
+
+		stream << "Buffer fill,Value" << std::endl;
+		stream << "Current," << snapshot.BufferFill << std::endl;
+		stream << "Minimum," << snapshot.BufferFillMinimum << std::endl;
+		stream << "Average," << snapshot.BufferFillAverage << std::endl;
+
+		success = stream.good();
+		stream.close();
+	}
+	return success;
+}
+
+std::string PlaybackMetrics::GetName( const Timing timing )
+{
+	std::string name;
+	switch ( timing ) {
+		case Timing::StreamCallback : {
+			name = "Stream callback";
+			break;
+		}
+		case Timing::DecodeBlock : {
+			name = "Decode block";
+			break;
+		}
+		case Timing::DecoderOpen : {
+			name = "Decoder open";
+			break;
+		}
+		default : {
+			break;
+		}
+	}
+	return name;
+}
+
+std::string PlaybackMetrics::GetName( const Counter counter )
+{
+	std::string name;
+	switch ( counter ) {
+		case Counter::Underrun : {
+			name = "Underruns";
+			break;
+		}
+		case Counter::NearUnderrun : {
+			name = "Near underruns";
+			break;
+		}
+		case Counter::PreloadHit : {
+			name = "Preload hits";
+			break;
+		}
+		case Counter::PreloadMiss : {
+			name = "Preload misses";
+			break;
+		}
+		case Counter::DecodedCacheHit : {
+			name = "Decoded cache hits";
+			break;
+		}
+		case Counter::DecodedCacheMiss : {
+			name = "Decoded cache misses";
+			break;
+		}
+		case Counter::SinkOutputTime : {
+			name = "Sink output (ms)";
+			break;
+		}
+		case Counter::SinkElapsedTime : {
+			name = "Sink elapsed (ms)";
+			break;
+		}
+		default : {
+			break;
+		}
+	}
+	return name;
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+// Playback metrics, recorded using lock-free counters so that they can be updated from the output stream callback.
+class PlaybackMetrics
+{
+public:
+	PlaybackMetrics();
+
+	virtual ~PlaybackMetrics();
+
+	// Clock used for timing measurements.
+	using Clock = std::chrono::steady_clock;
+
+	// Timing metric type.
+	enum class Timing {
+		// Duration of each output stream callback.
+		StreamCallback = 0,
+		// Time taken to decode each block of sample data.
+		DecodeBlock,
+		// Time taken to open a decoder.
+		DecoderOpen,
+
+		// Number of timing metric types.
+		Count
+	};
+
+	// Counter metric type.
+	enum class Counter {
+		// Number of output stream callbacks which could not be fully satisfied from the output buffer.
+		Underrun = 0,
+		// Number of output stream callbacks which left the output buffer close to empty.
+		NearUnderrun,
+		// Number of times the next track was opened from the preloaded decoder.
+		PreloadHit,
+		// Number of times the next track could not be opened from the preloaded decoder.
+		PreloadMiss,
+		// Number of times a track was opened from the decoded audio cache.
+		DecodedCacheHit,
+		// Number of times a track could not be opened from the decoded audio cache.
+		DecodedCacheMiss,
+		// Duration of the sample data output by the null and file output modes, in milliseconds.
+		SinkOutputTime,
+		// Time taken to output the sample data in the null and file output modes, in milliseconds.
+		SinkElapsedTime,
+
+		// Number of counter metric types.
+		Count
+	};
+
+	// Number of histogram buckets, where each bucket covers twice the duration of the previous one (the first bucket covering up to 1 microsecond).
+	static constexpr size_t HistogramBuckets = 24;
+
+	// Timing histogram.
+	struct Histogram {
+		// Returns the approximate duration, in milliseconds, below which the 'percentile' (0-100) of measurements fall.
+		double GetPercentile( const double percentile ) const;
+
+		// Number of measurements.
+		long long Count = 0;
+
+		// Total duration, in microseconds.
+		long long Total = 0;
+
+		// Maximum duration, in microseconds.
+		long long Maximum = 0;
+
+		// Number of measurements in each bucket.
+		std::array<long long, HistogramBuckets> Buckets = {};
+	};
+
+	// A snapshot of the metrics.
+	struct Snapshot {
+		// Timing histograms, for each timing metric type.
+		std::array<Histogram, static_cast<size_t>( Timing::Count )> Timings = {};
+
+		// Counter values, for each counter metric type.
+		std::array<long long, static_cast<size_t>( Counter::Count )> Counters = {};
+
+		// Most recent output buffer fill level, relative to the decode buffer target (0.0 to 1.0).
+		float BufferFill = 0;
+
+		// Minimum output buffer fill level, relative to the decode buffer target (0.0 to 1.0).
+		float BufferFillMinimum = 0;
+
+		// Average output buffer fill level, relative to the decode buffer target (0.0 to 1.0).
+		float BufferFillAverage = 0;
+	};
+
+	// Records a timing measurement, from the 'start' time to now.
+	void RecordTiming( const Timing timing, const Clock::time_point& start );
+
+	// Increments a 'counter'.
+	void Increment( const Counter counter );
+
+	// Adds a 'value' to a 'counter'.
+	void Add( const Counter counter, const long long value );
+
+	// Records the output buffer 'fill' level, relative to the decode buffer target (0.0 to 1.0).
+	void RecordBufferFill( const float fill );
+
+	// Returns a snapshot of the current metrics.
+	Snapshot GetSnapshot() const;
+
+	// Resets all metrics.
+	void Reset();
+
+	// Writes a metrics report to 'filename'.
+	// Returns whether the report was written.
+	bool WriteFile( const std::wstring& filename ) const;
+
+	// Returns the name of a 'timing' metric type.
+	static std::string GetName( const Timing timing );
+
+	// Returns the name of a 'counter' metric type.
+	static std::string GetName( const Counter counter );
+
+private:
+	// Timing histogram, using atomic values.
+	struct AtomicHistogram {
+		// Number of measurements.
+		std::atomic<long long> Count = 0;
+
+		// Total duration, in microseconds.
+		std::atomic<long long> Total = 0;
+
+		// Maximum duration, in microseconds.
+		std::atomic<long long> Maximum = 0;
+
+		// Number of measurements in each bucket.
+		std::array<std::atomic<long long>, HistogramBuckets> Buckets = {};
+	};
+
+	// Timing histograms, for each timing metric type.
+	std::array<AtomicHistogram, static_cast<size_t>( Timing::Count )> m_Timings;
+
+	// Counter values, for each counter metric type.
+	std::array<std::atomic<long long>, static_cast<size_t>( Counter::Count )> m_Counters;
+
+	// Most recent output buffer fill level, in parts per million.
+	std::atomic<long> m_BufferFill;
+
+	// Minimum output buffer fill level, in parts per million.
+	std::atomic<long> m_BufferFillMinimum;
+
+	// Total of all output buffer fill levels, in parts per million.
+	std::atomic<long long> m_BufferFillTotal;
+
+	// Number of output buffer fill levels recorded.
+	std::atomic<long long> m_BufferFillCount;
+};
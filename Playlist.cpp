@@ -147,6 +147,24 @@ bool Playlist::GetNextItem( const Item& currentItem, Item& nextItem, const bool
 	return success;
 }
 
+bool Playlist::HasNextItem( const Item& currentItem, const bool wrap )
+{
+	std::lock_guard<std::mutex> lock( m_MutexPlaylist );
+
+	bool hasNext = false;
+	const long currentID = currentItem.ID;
+	auto iter = m_Playlist.begin();
+	while ( iter != m_Playlist.end() ) {
+		const long id = iter->ID;
+		++iter;
+		if ( id == currentID ) {
+			hasNext = wrap || ( iter != m_Playlist.end() );
+			break;
+		}
+	}
+	return hasNext;
+}
+
 bool Playlist::GetPreviousItem( const Item& currentItem, Item& previousItem, const bool wrap )
 {
 	std::lock_guard<std::mutex> lock( m_MutexPlaylist );
@@ -208,6 +226,16 @@ Playlist::Item Playlist::GetRandomItem( const Item& currentItem )
 	return result;
 }
 
+Playlist::ItemList Playlist::GetUpcomingRandomItems( const size_t count )
+{
+	ItemList items;
+	std::lock_guard<std::mutex> shuffleLock( m_MutexShuffled );
+	for ( auto item = m_ShuffledPlaylist.begin(); ( m_ShuffledPlaylist.end() != item ) && ( items.size() < count ); item++ ) {
+		items.push_back( *item );
+	}
+	return items;
+}
+
 Playlist::Item Playlist::AddItem( const MediaInfo& mediaInfo )
 {
 	int position = 0;
@@ -126,6 +126,11 @@ public:
 	// Returns true if a 'nextItem' was returned.
 	bool GetNextItem( const Item& currentItem, Item& nextItem, const bool wrap = true );
 
+	// Returns whether there is a next playlist item, without copying it.
+	// 'currentItem' - the current item.
+	// 'wrap' - whether to wrap round to the first playlist item.
+	bool HasNextItem( const Item& currentItem, const bool wrap = true );
+
 	// Gets the previous playlist item.
 	// 'currentItem' - the current item.
 	// 'previousItem' - out, the previous item.
@@ -137,6 +142,9 @@ public:
 	// 'currentItem' - the current item.
 	Item GetRandomItem( const Item& currentItem );
 
+	// Returns up to 'count' of the items which will next be returned by GetRandomItem, without removing them from the shuffled order.
+	ItemList GetUpcomingRandomItems( const size_t count );
+
 	// Adds 'mediaInfo' to the playlist, returning the added item.
 	Item AddItem( const MediaInfo& mediaInfo );
 
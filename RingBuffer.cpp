@@ -0,0 +1,101 @@
+#include "RingBuffer.h"
+
+#include <algorithm>
+
+RingBuffer::RingBuffer() :
+	m_Buffer(),
+	m_Channels( 0 ),
+	m_Capacity( 0 ),
+	m_ReadCount( 0 ),
+	m_WriteCount( 0 )
+{
+}
+
+RingBuffer::~RingBuffer()
+{
+}
+
+void RingBuffer::Reset( const long channels, const long capacity )
+{
+	m_Channels = std::max( channels, 0l );
+	m_Capacity = std::max( capacity, 0l );
+	m_Buffer.assign( static_cast<size_t>( m_Channels ) * m_Capacity, 0.0f );
+	m_ReadCount = 0;
+	m_WriteCount = 0;
+}
+
+long RingBuffer::GetChannels() const
+{
+	return m_Channels;
+}
+
+long RingBuffer::GetCapacity() const
+{
+	return m_Capacity;
+}
+
+long RingBuffer::GetReadAvailable() const
+{
+	const long long readCount = m_ReadCount.load( std::memory_order_relaxed );
+	const long long writeCount = m_WriteCount.load( std::memory_order_acquire );
+	return static_cast<long>( writeCount - readCount );
+}
+
+long RingBuffer::GetWriteAvailable() const
+{
+	const long long readCount = m_ReadCount.load( std::memory_order_acquire );
+	const long long writeCount = m_WriteCount.load( std::memory_order_relaxed );
+	return m_Capacity - static_cast<long>( writeCount - readCount );
+}
+
+long RingBuffer::Write( const float* buffer, const long sampleCount )
+{
+	long samplesWritten = 0;
+	if ( ( nullptr != buffer ) && ( sampleCount > 0 ) && ( m_Capacity > 0 ) ) {
+		const long long writeCount = m_WriteCount.load( std::memory_order_relaxed );
+		samplesWritten = std::min( sampleCount, GetWriteAvailable() );
+		if ( samplesWritten > 0 ) {
+			const long offset = static_cast<long>( writeCount % m_Capacity );
+			const long firstCount = std::min( samplesWritten, m_Capacity - offset );
+			std::copy( buffer, buffer + firstCount * m_Channels, m_Buffer.begin() + static_cast<size_t>( offset ) * m_Channels );
+			if ( samplesWritten > firstCount ) {
+				std::copy( buffer + firstCount * m_Channels, buffer + samplesWritten * m_Channels, m_Buffer.begin() );
+			}
+			m_WriteCount.store( writeCount + samplesWritten, std::memory_order_release );
+		}
+	}
+	return samplesWritten;
+}
+
+long RingBuffer::Read( float* buffer, const long sampleCount )
+{
+	long samplesRead = 0;
+	if ( ( nullptr != buffer ) && ( sampleCount > 0 ) && ( m_Capacity > 0 ) ) {
+		const long long readCount = m_ReadCount.load( std::memory_order_relaxed );
+		samplesRead = std::min( sampleCount, GetReadAvailable() );
+		if ( samplesRead > 0 ) {
+			const long offset = static_cast<long>( readCount % m_Capacity );
+			const long firstCount = std::min( samplesRead, m_Capacity - offset );
+			const auto first = m_Buffer.begin() + static_cast<size_t>( offset ) * m_Channels;
+			std::copy( first, first + firstCount * m_Channels, buffer );
+			if ( samplesRead > firstCount ) {
+				std::copy( m_Buffer.begin(), m_Buffer.begin() + ( samplesRead - firstCount ) * m_Channels, buffer + firstCount * m_Channels );
+			}
+			m_ReadCount.store( readCount + samplesRead, std::memory_order_release );
+		}
+	}
+	return samplesRead;
+}
+
+long RingBuffer::Skip( const long sampleCount )
+{
+	long samplesSkipped = 0;
+	if ( ( sampleCount > 0 ) && ( m_Capacity > 0 ) ) {
+		const long long readCount = m_ReadCount.load( std::memory_order_relaxed );
+		samplesSkipped = std::min( sampleCount, GetReadAvailable() );
+		if ( samplesSkipped > 0 ) {
+			m_ReadCount.store( readCount + samplesSkipped, std::memory_order_release );
+		}
+	}
+	return samplesSkipped;
+}
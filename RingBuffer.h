@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+// Single producer, single consumer, lock-free ring buffer of interleaved float sample data.
+class RingBuffer
+{
+public:
+	RingBuffer();
+
+	virtual ~RingBuffer();
+
+	// Resets the buffer, discarding any sample data.
+	// 'channels' - number of channels.
+	// 'capacity' - buffer capacity, in samples per channel.
+	// Note that the buffer must not be reset while the producer or consumer are active.
+	void Reset( const long channels, const long capacity );
+
+	// Returns the number of channels.
+	long GetChannels() const;
+
+	// Returns the buffer capacity, in samples per channel.
+	long GetCapacity() const;
+
+	// Returns the number of samples per channel that are available to read.
+	long GetReadAvailable() const;
+
+	// Returns the number of samples per channel that can be written.
+	long GetWriteAvailable() const;
+
+	// Writes sample data to the buffer (should only be called from the producer thread).
+	// 'buffer' - sample data to write.
+	// 'sampleCount' - number of samples per channel to write.
+	// Returns the number of samples per channel written.
+	long Write( const float* buffer, const long sampleCount );
+
+	// Reads sample data from the buffer (should only be called from the consumer thread).
+	// 'buffer' - out, sample data.
+	// 'sampleCount' - maximum number of samples per channel to read.
+	// Returns the number of samples per channel read.
+	long Read( float* buffer, const long sampleCount );
+
+	// Discards sample data from the buffer (should only be called from the consumer thread).
+	// 'sampleCount' - maximum number of samples per channel to discard.
+	// Returns the number of samples per channel discarded.
+	long Skip( const long sampleCount );
+
+private:
+	// Sample data.
+	std::vector<float> m_Buffer;
+
+	// Number of channels.
+	long m_Channels;
+
+	// Buffer capacity, in samples per channel.
+	long m_Capacity;
+
+	// Total number of samples per channel read from the buffer.
+	std::atomic<long long> m_ReadCount;
+
+	// Total number of samples per channel written to the buffer.
+	std::atomic<long long> m_WriteCount;
+};
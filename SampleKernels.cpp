@@ -0,0 +1,806 @@
+#include "SampleKernels.h"
+
+#if defined( _M_X64 ) || defined( _M_IX86 )
+#define SAMPLEKERNELS_SIMD
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+#include <cmath>
+
+#ifdef SAMPLEKERNELS_SIMD
+
+// Returns whether AVX instructions are supported by the CPU and the operating system.
+static bool IsAVXSupported()
+{
+	int cpuInfo[ 4 ] = {};
+	__cpuid( cpuInfo, 1 );
+	const bool osxsave = ( 0 != ( cpuInfo[ 2 ] & ( 1 << 27 ) ) );
+	const bool avx = ( 0 != ( cpuInfo[ 2 ] & ( 1 << 28 ) ) );
+	const bool supported = osxsave && avx && ( 6 == ( _xgetbv( 0 ) & 6 ) );
+	return supported;
+}
+
+// Indicates whether AVX instructions are available.
+static const bool s_AVX = IsAVXSupported();
+
+// AVX implementation of ScaleSamples, returning the number of values processed.
+static size_t ScaleSamplesAVX( float* buffer, const size_t count, const float scale )
+{
+	const __m256 scale8 = _mm256_set1_ps( scale );
+	size_t index = 0;
+	for ( ; ( index + 8 ) <= count; index += 8 ) {
+		_mm256_storeu_ps( buffer + index, _mm256_mul_ps( _mm256_loadu_ps( buffer + index ), scale8 ) );
+	}
+	_mm256_zeroupper();
+	return index;
+}
+
+// AVX implementation of ScaleAndClipSamples, returning the number of values processed.
+static size_t ScaleAndClipSamplesAVX( float* buffer, const size_t count, const float scale )
+{
+	const __m256 scale8 = _mm256_set1_ps( scale );
+	const __m256 min8 = _mm256_set1_ps( -1.0f );
+	const __m256 max8 = _mm256_set1_ps( 1.0f );
+	size_t index = 0;
+	for ( ; ( index + 8 ) <= count; index += 8 ) {
+		const __m256 value = _mm256_mul_ps( _mm256_loadu_ps( buffer + index ), scale8 );
+		_mm256_storeu_ps( buffer + index, _mm256_min_ps( _mm256_max_ps( value, min8 ), max8 ) );
+	}
+	_mm256_zeroupper();
+	return index;
+}
+
+#endif
+
+void ScaleSamples( float* buffer, const size_t count, const float scale )
+{
+	if ( nullptr != buffer ) {
+		size_t index = 0;
+#ifdef SAMPLEKERNELS_SIMD
+		if ( s_AVX ) {
+			index = ScaleSamplesAVX( buffer, count, scale );
+		}
+		const __m128 scale4 = _mm_set1_ps( scale );
+		for ( ; ( index + 4 ) <= count; index += 4 ) {
+			_mm_storeu_ps( buffer + index, _mm_mul_ps( _mm_loadu_ps( buffer + index ), scale4 ) );
+		}
+#endif
+		for ( ; index < count; index++ ) {
+			buffer[ index ] *= scale;
+		}
+	}
+}
+
+void ScaleAndClipSamples( float* buffer, const size_t count, const float scale )
+{
+	if ( nullptr != buffer ) {
+		size_t index = 0;
+#ifdef SAMPLEKERNELS_SIMD
+		if ( s_AVX ) {
+			index = ScaleAndClipSamplesAVX( buffer, count, scale );
+		}
+		const __m128 scale4 = _mm_set1_ps( scale );
+		const __m128 min4 = _mm_set1_ps( -1.0f );
+		const __m128 max4 = _mm_set1_ps( 1.0f );
+		for ( ; ( index + 4 ) <= count; index += 4 ) {
+			const __m128 value = _mm_mul_ps( _mm_loadu_ps( buffer + index ), scale4 );
+			_mm_storeu_ps( buffer + index, _mm_min_ps( _mm_max_ps( value, min4 ), max4 ) );
+		}
+#endif
+		for ( ; index < count; index++ ) {
+			const float value = buffer[ index ] * scale;
+			buffer[ index ] = ( value < -1.0f ) ? -1.0f : ( ( value > 1.0f ) ? 1.0f : value );
+		}
+	}
+}
+
+float DotProduct( const float* a, const float* b, const size_t count )
+{
+	float result = 0;
+	if ( ( nullptr != a ) && ( nullptr != b ) ) {
+		size_t index = 0;
+#ifdef SAMPLEKERNELS_SIMD
+		__m128 total4 = _mm_setzero_ps();
+		for ( ; ( index + 4 ) <= count; index += 4 ) {
+			total4 = _mm_add_ps( total4, _mm_mul_ps( _mm_loadu_ps( a + index ), _mm_loadu_ps( b + index ) ) );
+		}
+		total4 = _mm_add_ps( total4, _mm_movehl_ps( total4, total4 ) );
+		total4 = _mm_add_ss( total4, _mm_shuffle_ps( total4, total4, 1 ) );
+		result = _mm_cvtss_f32( total4 );
+#endif
+		for ( ; index < count; index++ ) {
+			result += a[ index ] * b[ index ];
+		}
+	}
+	return result;
+}
+
+#ifdef SAMPLEKERNELS_SIMD
+
+// AVX implementation of UpdateInterpolatedPeaks, returning the number of peak values processed.
+static size_t UpdateInterpolatedPeaksAVX( float* peaks, const float* input, const size_t count, const float* filters, const long taps, const long phases )
+{
+	const __m256 sign8 = _mm256_set1_ps( -0.0f );
+	size_t index = 0;
+	for ( ; ( index + 8 ) <= count; index += 8 ) {
+		const float* window = input + index;
+		__m256 peak8 = _mm256_andnot_ps( sign8, _mm256_loadu_ps( window + taps / 2 - 1 ) );
+		const float* coefficients = filters;
+		for ( long phase = 0; phase < phases; phase++ ) {
+			__m256 total8 = _mm256_setzero_ps();
+			for ( long tap = 0; tap < taps; tap++ ) {
+				total8 = _mm256_add_ps( total8, _mm256_mul_ps( _mm256_loadu_ps( window + tap ), _mm256_set1_ps( coefficients[ tap ] ) ) );
+			}
+			peak8 = _mm256_max_ps( peak8, _mm256_andnot_ps( sign8, total8 ) );
+			coefficients += taps;
+		}
+		_mm256_storeu_ps( peaks + index, _mm256_max_ps( _mm256_loadu_ps( peaks + index ), peak8 ) );
+	}
+	_mm256_zeroupper();
+	return index;
+}
+
+#endif
+
+void UpdateInterpolatedPeaks( float* peaks, const float* input, const size_t count, const float* filters, const long taps, const long phases )
+{
+	if ( ( nullptr != peaks ) && ( nullptr != input ) && ( nullptr != filters ) && ( taps > 1 ) && ( phases >= 0 ) ) {
+		// Each window is filtered for several output values at once, rather than calculating a dot product for each filter and window in turn.
+		size_t index = 0;
+#ifdef SAMPLEKERNELS_SIMD
+		if ( s_AVX ) {
+			index = UpdateInterpolatedPeaksAVX( peaks, input, count, filters, taps, phases );
+		}
+		const __m128 sign4 = _mm_set1_ps( -0.0f );
+		for ( ; ( index + 4 ) <= count; index += 4 ) {
+			const float* window = input + index;
+			__m128 peak4 = _mm_andnot_ps( sign4, _mm_loadu_ps( window + taps / 2 - 1 ) );
+			const float* coefficients = filters;
+			for ( long phase = 0; phase < phases; phase++ ) {
+				__m128 total4 = _mm_setzero_ps();
+				for ( long tap = 0; tap < taps; tap++ ) {
+					total4 = _mm_add_ps( total4, _mm_mul_ps( _mm_loadu_ps( window + tap ), _mm_set1_ps( coefficients[ tap ] ) ) );
+				}
+				peak4 = _mm_max_ps( peak4, _mm_andnot_ps( sign4, total4 ) );
+				coefficients += taps;
+			}
+			_mm_storeu_ps( peaks + index, _mm_max_ps( _mm_loadu_ps( peaks + index ), peak4 ) );
+		}
+#endif
+		for ( ; index < count; index++ ) {
+			const float* window = input + index;
+			float peak = fabsf( window[ taps / 2 - 1 ] );
+			const float* coefficients = filters;
+			for ( long phase = 0; phase < phases; phase++ ) {
+				float total = 0;
+				for ( long tap = 0; tap < taps; tap++ ) {
+					total += window[ tap ] * coefficients[ tap ];
+				}
+				peak = ( fabsf( total ) > peak ) ? fabsf( total ) : peak;
+				coefficients += taps;
+			}
+			peaks[ index ] = ( peak > peaks[ index ] ) ? peak : peaks[ index ];
+		}
+	}
+}
+
+// Multiplies each sample frame in 'input' by the corresponding 'ramp' gain value, either writing or adding ('mix') the result to 'output'.
+template<bool mix>
+static void ApplyRamp( float* output, const float* input, const size_t sampleCount, const long channels, const float* ramp )
+{
+	if ( ( nullptr == output ) || ( nullptr == input ) || ( nullptr == ramp ) || ( channels <= 0 ) ) {
+		return;
+	}
+	size_t frame = 0;
+#ifdef SAMPLEKERNELS_SIMD
+	if ( 1 == channels ) {
+		for ( ; ( frame + 4 ) <= sampleCount; frame += 4 ) {
+			__m128 value = _mm_mul_ps( _mm_loadu_ps( input + frame ), _mm_loadu_ps( ramp + frame ) );
+			if constexpr ( mix ) {
+				value = _mm_add_ps( value, _mm_loadu_ps( output + frame ) );
+			}
+			_mm_storeu_ps( output + frame, value );
+		}
+	} else if ( 2 == channels ) {
+		for ( ; ( frame + 4 ) <= sampleCount; frame += 4 ) {
+			const __m128 gain = _mm_loadu_ps( ramp + frame );
+			const float* in = input + frame * 2;
+			float* out = output + frame * 2;
+			__m128 value1 = _mm_mul_ps( _mm_loadu_ps( in ), _mm_unpacklo_ps( gain, gain ) );
+			__m128 value2 = _mm_mul_ps( _mm_loadu_ps( in + 4 ), _mm_unpackhi_ps( gain, gain ) );
+			if constexpr ( mix ) {
+				value1 = _mm_add_ps( value1, _mm_loadu_ps( out ) );
+				value2 = _mm_add_ps( value2, _mm_loadu_ps( out + 4 ) );
+			}
+			_mm_storeu_ps( out, value1 );
+			_mm_storeu_ps( out + 4, value2 );
+		}
+	} else if ( 0 == ( channels % 4 ) ) {
+		for ( ; frame < sampleCount; frame++ ) {
+			const __m128 gain = _mm_set1_ps( ramp[ frame ] );
+			const float* in = input + frame * channels;
+			float* out = output + frame * channels;
+			for ( long channel = 0; channel < channels; channel += 4 ) {
+				__m128 value = _mm_mul_ps( _mm_loadu_ps( in + channel ), gain );
+				if constexpr ( mix ) {
+					value = _mm_add_ps( value, _mm_loadu_ps( out + channel ) );
+				}
+				_mm_storeu_ps( out + channel, value );
+			}
+		}
+	}
+#endif
+	for ( ; frame < sampleCount; frame++ ) {
+		const float gain = ramp[ frame ];
+		const float* in = input + frame * channels;
+		float* out = output + frame * channels;
+		for ( long channel = 0; channel < channels; channel++ ) {
+			if constexpr ( mix ) {
+				out[ channel ] += in[ channel ] * gain;
+			} else {
+				out[ channel ] = in[ channel ] * gain;
+			}
+		}
+	}
+}
+
+void GenerateGainRamp( float* ramp, const size_t count, const float position, const float step, const bool equalPower )
+{
+	if ( nullptr != ramp ) {
+		size_t index = 0;
+#ifdef SAMPLEKERNELS_SIMD
+		const __m128 position4 = _mm_set1_ps( position );
+		const __m128 step4 = _mm_set1_ps( step );
+		const __m128 offset4 = _mm_set_ps( 3.0f, 2.0f, 1.0f, 0.0f );
+		const __m128 min4 = _mm_setzero_ps();
+		const __m128 max4 = _mm_set1_ps( 1.0f );
+		for ( ; ( index + 4 ) <= count; index += 4 ) {
+			const __m128 index4 = _mm_add_ps( _mm_set1_ps( static_cast<float>( index ) ), offset4 );
+			const __m128 value = _mm_sub_ps( position4, _mm_mul_ps( index4, step4 ) );
+			_mm_storeu_ps( ramp + index, _mm_min_ps( _mm_max_ps( value, min4 ), max4 ) );
+		}
+#endif
+		for ( ; index < count; index++ ) {
+			const float value = position - static_cast<float>( index ) * step;
+			ramp[ index ] = ( value < 0 ) ? 0 : ( ( value > 1.0f ) ? 1.0f : value );
+		}
+
+		if ( equalPower ) {
+			const float halfPi = 1.57079632679f;
+			for ( index = 0; index < count; index++ ) {
+				ramp[ index ] = sinf( ramp[ index ] * halfPi );
+			}
+		}
+	}
+}
+
+void ApplyGainRamp( float* buffer, const size_t sampleCount, const long channels, const float* ramp )
+{
+	ApplyRamp<false>( buffer, buffer, sampleCount, channels, ramp );
+}
+
+void MixWithGainRamp( float* output, const float* input, const size_t sampleCount, const long channels, const float* ramp )
+{
+	ApplyRamp<true>( output, input, sampleCount, channels, ramp );
+}
+
+size_t FindFirstAboveLevel( const float* buffer, const size_t count, const float level )
+{
+	size_t index = 0;
+	if ( nullptr != buffer ) {
+#ifdef SAMPLEKERNELS_SIMD
+		const __m128 absMask4 = _mm_castsi128_ps( _mm_set1_epi32( 0x7fffffff ) );
+		const __m128 level4 = _mm_set1_ps( level );
+		int mask = 0;
+		for ( ; ( 0 == mask ) && ( ( index + 4 ) <= count ); index += 4 ) {
+			mask = _mm_movemask_ps( _mm_cmpgt_ps( _mm_and_ps( _mm_loadu_ps( buffer + index ), absMask4 ), level4 ) );
+		}
+		if ( 0 != mask ) {
+			// Step back to the first value in the group which exceeded the level.
+			index -= 4;
+			while ( 0 == ( mask & 1 ) ) {
+				mask >>= 1;
+				++index;
+			}
+		}
+#endif
+		while ( ( index < count ) && ( std::fabs( buffer[ index ] ) <= level ) ) {
+			++index;
+		}
+	} else {
+		index = count;
+	}
+	return index;
+}
+
+size_t FindLastAboveLevel( const float* buffer, const size_t count, const float level )
+{
+	size_t result = count;
+	if ( nullptr != buffer ) {
+		// Check any values beyond the last whole group of four, then work backwards a group at a time.
+		size_t index = count;
+		bool found = false;
+		while ( !found && ( 0 != ( index % 4 ) ) ) {
+			found = ( std::fabs( buffer[ --index ] ) > level );
+		}
+		if ( found ) {
+			result = index;
+		} else {
+#ifdef SAMPLEKERNELS_SIMD
+			const __m128 absMask4 = _mm_castsi128_ps( _mm_set1_epi32( 0x7fffffff ) );
+			const __m128 level4 = _mm_set1_ps( level );
+			int mask = 0;
+			for ( ; ( 0 == mask ) && ( index >= 4 ); index -= 4 ) {
+				mask = _mm_movemask_ps( _mm_cmpgt_ps( _mm_and_ps( _mm_loadu_ps( buffer + index - 4 ), absMask4 ), level4 ) );
+			}
+			if ( 0 != mask ) {
+				// Step forward to the last value in the group which exceeded the level.
+				index += 3;
+				while ( 0 == ( mask & 8 ) ) {
+					mask <<= 1;
+					--index;
+				}
+				result = index;
+			}
+#endif
+			while ( ( count == result ) && ( index > 0 ) ) {
+				if ( std::fabs( buffer[ --index ] ) > level ) {
+					result = index;
+				}
+			}
+		}
+	}
+	return result;
+}
+
+size_t FindFirstNonZero( const int32_t* buffer, const size_t count )
+{
+	size_t index = 0;
+	if ( nullptr != buffer ) {
+#ifdef SAMPLEKERNELS_SIMD
+		const __m128i zero4 = _mm_setzero_si128();
+		int mask = 0;
+		for ( ; ( 0 == mask ) && ( ( index + 4 ) <= count ); index += 4 ) {
+			mask = 0xf & ~_mm_movemask_ps( _mm_castsi128_ps( _mm_cmpeq_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>( buffer + index ) ), zero4 ) ) );
+		}
+		if ( 0 != mask ) {
+			// Step back to the first value in the group which was not zero.
+			index -= 4;
+			while ( 0 == ( mask & 1 ) ) {
+				mask >>= 1;
+				++index;
+			}
+		}
+#endif
+		while ( ( index < count ) && ( 0 == buffer[ index ] ) ) {
+			++index;
+		}
+	} else {
+		index = count;
+	}
+	return index;
+}
+
+size_t FindLastNonZero( const int32_t* buffer, const size_t count )
+{
+	size_t result = count;
+	if ( nullptr != buffer ) {
+		// Check any values beyond the last whole group of four, then work backwards a group at a time.
+		size_t index = count;
+		bool found = false;
+		while ( !found && ( 0 != ( index % 4 ) ) ) {
+			found = ( 0 != buffer[ --index ] );
+		}
+		if ( found ) {
+			result = index;
+		} else {
+#ifdef SAMPLEKERNELS_SIMD
+			const __m128i zero4 = _mm_setzero_si128();
+			int mask = 0;
+			for ( ; ( 0 == mask ) && ( index >= 4 ); index -= 4 ) {
+				mask = 0xf & ~_mm_movemask_ps( _mm_castsi128_ps( _mm_cmpeq_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>( buffer + index - 4 ) ), zero4 ) ) );
+			}
+			if ( 0 != mask ) {
+				// Step forward to the last value in the group which was not zero.
+				index += 3;
+				while ( 0 == ( mask & 8 ) ) {
+					mask <<= 1;
+					--index;
+				}
+				result = index;
+			}
+#endif
+			while ( ( count == result ) && ( index > 0 ) ) {
+				if ( 0 != buffer[ --index ] ) {
+					result = index;
+				}
+			}
+		}
+	}
+	return result;
+}
+
+#ifdef SAMPLEKERNELS_SIMD
+
+// Stores the sums of 'left' and 'right' as a pair of adjacent values in 'output'.
+static void StoreStereoSums( float* output, const __m128 left, const __m128 right )
+{
+	__m128 sum = _mm_add_ps( _mm_unpacklo_ps( left, right ), _mm_unpackhi_ps( left, right ) );
+	sum = _mm_add_ps( sum, _mm_movehl_ps( sum, sum ) );
+	_mm_storel_pi( reinterpret_cast<__m64*>( output ), sum );
+}
+
+// SSE implementation of MixChannels for common layouts, returning the number of samples per channel processed.
+static size_t MixChannelsSSE( float* output, const long outputChannels, const float* input, const long inputChannels, const size_t sampleCount, const float* matrix )
+{
+	size_t frame = 0;
+	if ( 2 == outputChannels ) {
+		switch ( inputChannels ) {
+			case 1 : {
+				const __m128 gain = _mm_set_ps( matrix[ 1 ], matrix[ 0 ], matrix[ 1 ], matrix[ 0 ] );
+				for ( ; ( frame + 4 ) <= sampleCount; frame += 4 ) {
+					const __m128 value = _mm_loadu_ps( input + frame );
+					_mm_storeu_ps( output + frame * 2, _mm_mul_ps( _mm_unpacklo_ps( value, value ), gain ) );
+					_mm_storeu_ps( output + frame * 2 + 4, _mm_mul_ps( _mm_unpackhi_ps( value, value ), gain ) );
+				}
+				break;
+			}
+			case 6 : {
+				const __m128 left1 = _mm_loadu_ps( matrix );
+				const __m128 left2 = _mm_set_ps( 0, 0, matrix[ 5 ], matrix[ 4 ] );
+				const __m128 right1 = _mm_loadu_ps( matrix + 6 );
+				const __m128 right2 = _mm_set_ps( 0, 0, matrix[ 11 ], matrix[ 10 ] );
+				for ( ; frame < sampleCount; frame++ ) {
+					const float* in = input + frame * 6;
+					const __m128 value1 = _mm_loadu_ps( in );
+					const __m128 value2 = _mm_loadl_pi( _mm_setzero_ps(), reinterpret_cast<const __m64*>( in + 4 ) );
+					const __m128 left = _mm_add_ps( _mm_mul_ps( value1, left1 ), _mm_mul_ps( value2, left2 ) );
+					const __m128 right = _mm_add_ps( _mm_mul_ps( value1, right1 ), _mm_mul_ps( value2, right2 ) );
+					StoreStereoSums( output + frame * 2, left, right );
+				}
+				break;
+			}
+			case 8 : {
+				const __m128 left1 = _mm_loadu_ps( matrix );
+				const __m128 left2 = _mm_loadu_ps( matrix + 4 );
+				const __m128 right1 = _mm_loadu_ps( matrix + 8 );
+				const __m128 right2 = _mm_loadu_ps( matrix + 12 );
+				for ( ; frame < sampleCount; frame++ ) {
+					const float* in = input + frame * 8;
+					const __m128 value1 = _mm_loadu_ps( in );
+					const __m128 value2 = _mm_loadu_ps( in + 4 );
+					const __m128 left = _mm_add_ps( _mm_mul_ps( value1, left1 ), _mm_mul_ps( value2, left2 ) );
+					const __m128 right = _mm_add_ps( _mm_mul_ps( value1, right1 ), _mm_mul_ps( value2, right2 ) );
+					StoreStereoSums( output + frame * 2, left, right );
+				}
+				break;
+			}
+			default : {
+				break;
+			}
+		}
+	}
+	return frame;
+}
+
+#endif
+
+void MixChannels( float* output, const long outputChannels, const float* input, const long inputChannels, const size_t sampleCount, const float* matrix )
+{
+	if ( ( nullptr != output ) && ( nullptr != input ) && ( nullptr != matrix ) && ( outputChannels > 0 ) && ( inputChannels > 0 ) ) {
+		size_t frame = 0;
+#ifdef SAMPLEKERNELS_SIMD
+		frame = MixChannelsSSE( output, outputChannels, input, inputChannels, sampleCount, matrix );
+#endif
+		for ( ; frame < sampleCount; frame++ ) {
+			const float* in = input + frame * inputChannels;
+			float* out = output + frame * outputChannels;
+			const float* coefficients = matrix;
+			for ( long outputChannel = 0; outputChannel < outputChannels; outputChannel++, coefficients += inputChannels ) {
+				float value = 0;
+				for ( long inputChannel = 0; inputChannel < inputChannels; inputChannel++ ) {
+					value += in[ inputChannel ] * coefficients[ inputChannel ];
+				}
+				out[ outputChannel ] = value;
+			}
+		}
+	}
+}
+
+// Returns the scale factor which converts signed integer values with 'bitsPerSample' to the range +/-1.0.
+static float GetIntegerScale( const long bitsPerSample )
+{
+	return std::ldexp( 1.0f, static_cast<int>( 1 - bitsPerSample ) );
+}
+
+#ifdef SAMPLEKERNELS_SIMD
+
+// Converts eight signed 16-bit values in 'value' to floating point values in 'output', multiplied by 'scale'.
+static void StoreInt16AsFloat( float* output, const __m128i value, const __m128 scale )
+{
+	// Each value is sign extended by placing it in the upper half of a 32-bit lane, then shifting it back down.
+	const __m128i low = _mm_srai_epi32( _mm_unpacklo_epi16( value, value ), 16 );
+	const __m128i high = _mm_srai_epi32( _mm_unpackhi_epi16( value, value ), 16 );
+	_mm_storeu_ps( output, _mm_mul_ps( _mm_cvtepi32_ps( low ), scale ) );
+	_mm_storeu_ps( output + 4, _mm_mul_ps( _mm_cvtepi32_ps( high ), scale ) );
+}
+
+// SSSE3 implementation of ConvertInt24ToFloat (used when AVX is supported, which implies SSSE3), returning the number of values processed.
+static size_t ConvertInt24ToFloatSSSE3( float* output, const uint8_t* input, const size_t count )
+{
+	// Each group of three bytes is shuffled into the upper three bytes of a 32-bit lane, so that the values are sign extended.
+	const __m128i shuffle = _mm_set_epi8( 11, 10, 9, -1, 8, 7, 6, -1, 5, 4, 3, -1, 2, 1, 0, -1 );
+	const __m128 scale4 = _mm_set1_ps( GetIntegerScale( 32 ) );
+	size_t index = 0;
+
+	// Each load reads 16 bytes, of which 12 are converted, so the final group is left for the scalar implementation.
+	for ( ; ( index + 5 ) < count; index += 4 ) {
+		const __m128i value = _mm_shuffle_epi8( _mm_loadu_si128( reinterpret_cast<const __m128i*>( input + index * 3 ) ), shuffle );
+		_mm_storeu_ps( output + index, _mm_mul_ps( _mm_cvtepi32_ps( value ), scale4 ) );
+	}
+	return index;
+}
+
+// AVX implementation of ConvertInt32ToFloat, returning the number of values processed.
+static size_t ConvertInt32ToFloatAVX( float* output, const int32_t* input, const size_t count, const float scale )
+{
+	const __m256 scale8 = _mm256_set1_ps( scale );
+	size_t index = 0;
+	for ( ; ( index + 8 ) <= count; index += 8 ) {
+		const __m256i value = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( input + index ) );
+		_mm256_storeu_ps( output + index, _mm256_mul_ps( _mm256_cvtepi32_ps( value ), scale8 ) );
+	}
+	_mm256_zeroupper();
+	return index;
+}
+
+#endif
+
+void ConvertUInt8ToFloat( float* output, const uint8_t* input, const size_t count )
+{
+	if ( ( nullptr != output ) && ( nullptr != input ) ) {
+		const float scale = GetIntegerScale( 8 );
+		size_t index = 0;
+#ifdef SAMPLEKERNELS_SIMD
+		// Flipping the top bit converts the unsigned values to signed values, which are then sign extended to 16-bit values.
+		const __m128i offset16 = _mm_set1_epi8( -128 );
+		const __m128 scale4 = _mm_set1_ps( scale );
+		for ( ; ( index + 16 ) <= count; index += 16 ) {
+			const __m128i value = _mm_xor_si128( _mm_loadu_si128( reinterpret_cast<const __m128i*>( input + index ) ), offset16 );
+			StoreInt16AsFloat( output + index, _mm_srai_epi16( _mm_unpacklo_epi8( value, value ), 8 ), scale4 );
+			StoreInt16AsFloat( output + index + 8, _mm_srai_epi16( _mm_unpackhi_epi8( value, value ), 8 ), scale4 );
+		}
+#endif
+		for ( ; index < count; index++ ) {
+			output[ index ] = static_cast<float>( static_cast<int>( input[ index ] ) - 128 ) * scale;
+		}
+	}
+}
+
+void ConvertInt16ToFloat( float* output, const int16_t* input, const size_t count )
+{
+	if ( ( nullptr != output ) && ( nullptr != input ) ) {
+		const float scale = GetIntegerScale( 16 );
+		size_t index = 0;
+#ifdef SAMPLEKERNELS_SIMD
+		const __m128 scale4 = _mm_set1_ps( scale );
+		for ( ; ( index + 8 ) <= count; index += 8 ) {
+			StoreInt16AsFloat( output + index, _mm_loadu_si128( reinterpret_cast<const __m128i*>( input + index ) ), scale4 );
+		}
+#endif
+		for ( ; index < count; index++ ) {
+			output[ index ] = static_cast<float>( input[ index ] ) * scale;
+		}
+	}
+}
+
+void ConvertInt24ToFloat( float* output, const uint8_t* input, const size_t count )
+{
+	if ( ( nullptr != output ) && ( nullptr != input ) ) {
+		const float scale = GetIntegerScale( 32 );
+		size_t index = 0;
+#ifdef SAMPLEKERNELS_SIMD
+		if ( s_AVX ) {
+			index = ConvertInt24ToFloatSSSE3( output, input, count );
+		}
+#endif
+		for ( ; index < count; index++ ) {
+			const uint8_t* value = input + index * 3;
+			output[ index ] = static_cast<float>( static_cast<int32_t>( ( static_cast<uint32_t>( value[ 2 ] ) << 24 ) | ( static_cast<uint32_t>( value[ 1 ] ) << 16 ) | ( static_cast<uint32_t>( value[ 0 ] ) << 8 ) ) ) * scale;
+		}
+	}
+}
+
+void ConvertInt32ToFloat( float* output, const int32_t* input, const size_t count, const long bitsPerSample )
+{
+	if ( ( nullptr != output ) && ( nullptr != input ) ) {
+		const float scale = GetIntegerScale( bitsPerSample );
+		size_t index = 0;
+#ifdef SAMPLEKERNELS_SIMD
+		if ( s_AVX ) {
+			index = ConvertInt32ToFloatAVX( output, input, count, scale );
+		}
+		const __m128 scale4 = _mm_set1_ps( scale );
+		for ( ; ( index + 4 ) <= count; index += 4 ) {
+			const __m128i value = _mm_loadu_si128( reinterpret_cast<const __m128i*>( input + index ) );
+			_mm_storeu_ps( output + index, _mm_mul_ps( _mm_cvtepi32_ps( value ), scale4 ) );
+		}
+#endif
+		for ( ; index < count; index++ ) {
+			output[ index ] = static_cast<float>( input[ index ] ) * scale;
+		}
+	}
+}
+
+#ifdef SAMPLEKERNELS_SIMD
+
+// SSE implementation of InterleaveInt32ToFloat, returning the number of samples per channel processed.
+// Each group of 4 channels is transposed 4 samples at a time, with any remaining pair of channels unpacked, and any single remaining channel stored one value at a time.
+// Stereo is handled separately, as each unpacked pair then fills a whole vector of the output.
+static size_t InterleaveInt32ToFloatSSE( float* output, const int32_t* const* input, const size_t offset, const size_t sampleCount, const long channels, const float scale )
+{
+	const __m128 scale4 = _mm_set1_ps( scale );
+	size_t frame = 0;
+	if ( 2 == channels ) {
+		const int32_t* left = input[ 0 ] + offset;
+		const int32_t* right = input[ 1 ] + offset;
+		for ( ; ( frame + 4 ) <= sampleCount; frame += 4 ) {
+			const __m128 leftValue = _mm_mul_ps( _mm_cvtepi32_ps( _mm_loadu_si128( reinterpret_cast<const __m128i*>( left + frame ) ) ), scale4 );
+			const __m128 rightValue = _mm_mul_ps( _mm_cvtepi32_ps( _mm_loadu_si128( reinterpret_cast<const __m128i*>( right + frame ) ) ), scale4 );
+			_mm_storeu_ps( output + frame * 2, _mm_unpacklo_ps( leftValue, rightValue ) );
+			_mm_storeu_ps( output + frame * 2 + 4, _mm_unpackhi_ps( leftValue, rightValue ) );
+		}
+	}
+	for ( ; ( frame + 4 ) <= sampleCount; frame += 4 ) {
+		float* out = output + frame * channels;
+		long channel = 0;
+		for ( ; ( channel + 4 ) <= channels; channel += 4 ) {
+			__m128 row0 = _mm_mul_ps( _mm_cvtepi32_ps( _mm_loadu_si128( reinterpret_cast<const __m128i*>( input[ channel ] + offset + frame ) ) ), scale4 );
+			__m128 row1 = _mm_mul_ps( _mm_cvtepi32_ps( _mm_loadu_si128( reinterpret_cast<const __m128i*>( input[ channel + 1 ] + offset + frame ) ) ), scale4 );
+			__m128 row2 = _mm_mul_ps( _mm_cvtepi32_ps( _mm_loadu_si128( reinterpret_cast<const __m128i*>( input[ channel + 2 ] + offset + frame ) ) ), scale4 );
+			__m128 row3 = _mm_mul_ps( _mm_cvtepi32_ps( _mm_loadu_si128( reinterpret_cast<const __m128i*>( input[ channel + 3 ] + offset + frame ) ) ), scale4 );
+			_MM_TRANSPOSE4_PS( row0, row1, row2, row3 );
+			_mm_storeu_ps( out + channel, row0 );
+			_mm_storeu_ps( out + channels + channel, row1 );
+			_mm_storeu_ps( out + channels * 2 + channel, row2 );
+			_mm_storeu_ps( out + channels * 3 + channel, row3 );
+		}
+		if ( ( channel + 2 ) <= channels ) {
+			const __m128 first = _mm_mul_ps( _mm_cvtepi32_ps( _mm_loadu_si128( reinterpret_cast<const __m128i*>( input[ channel ] + offset + frame ) ) ), scale4 );
+			const __m128 second = _mm_mul_ps( _mm_cvtepi32_ps( _mm_loadu_si128( reinterpret_cast<const __m128i*>( input[ channel + 1 ] + offset + frame ) ) ), scale4 );
+			const __m128 low = _mm_unpacklo_ps( first, second );
+			const __m128 high = _mm_unpackhi_ps( first, second );
+			_mm_storel_pi( reinterpret_cast<__m64*>( out + channel ), low );
+			_mm_storeh_pi( reinterpret_cast<__m64*>( out + channels + channel ), low );
+			_mm_storel_pi( reinterpret_cast<__m64*>( out + channels * 2 + channel ), high );
+			_mm_storeh_pi( reinterpret_cast<__m64*>( out + channels * 3 + channel ), high );
+			channel += 2;
+		}
+		if ( channel < channels ) {
+			const int32_t* in = input[ channel ] + offset + frame;
+			for ( size_t index = 0; index < 4; index++ ) {
+				out[ index * channels + channel ] = static_cast<float>( in[ index ] ) * scale;
+			}
+		}
+	}
+	return frame;
+}
+
+#endif
+
+void InterleaveInt32ToFloat( float* output, const int32_t* const* input, const size_t offset, const size_t sampleCount, const long channels, const long bitsPerSample )
+{
+	if ( ( nullptr != output ) && ( nullptr != input ) && ( channels > 0 ) ) {
+		if ( 1 == channels ) {
+			ConvertInt32ToFloat( output, input[ 0 ] + offset, sampleCount, bitsPerSample );
+		} else {
+			const float scale = GetIntegerScale( bitsPerSample );
+			size_t frame = 0;
+#ifdef SAMPLEKERNELS_SIMD
+			frame = InterleaveInt32ToFloatSSE( output, input, offset, sampleCount, channels, scale );
+#endif
+			for ( long channel = 0; channel < channels; channel++ ) {
+				const int32_t* in = input[ channel ] + offset;
+				float* out = output + channel;
+				for ( size_t index = frame; index < sampleCount; index++ ) {
+					out[ index * channels ] = static_cast<float>( in[ index ] ) * scale;
+				}
+			}
+		}
+	}
+}
+
+// Stores a 'value' as a little endian packed value of 'bytesPerValue' bytes (2 or 3) at 'output'.
+static void StorePackedValue( unsigned char* output, const uint32_t value, const long bytesPerValue )
+{
+	output[ 0 ] = static_cast<unsigned char>( value & 0xff );
+	output[ 1 ] = static_cast<unsigned char>( ( value >> 8 ) & 0xff );
+	if ( 3 == bytesPerValue ) {
+		output[ 2 ] = static_cast<unsigned char>( ( value >> 16 ) & 0xff );
+	}
+}
+
+#ifdef SAMPLEKERNELS_SIMD
+
+// SSE2 implementation of PackInt32 for 16-bit values, returning the number of samples per channel processed.
+static size_t PackInt32ToInt16SSE2( unsigned char* output, const int32_t* const* input, const size_t offset, const size_t sampleCount, const long channels, const long shift )
+{
+	const __m128i shift4 = _mm_cvtsi32_si128( shift );
+	size_t frame = 0;
+	if ( 1 == channels ) {
+		const int32_t* in = input[ 0 ] + offset;
+		for ( ; ( frame + 8 ) <= sampleCount; frame += 8 ) {
+			const __m128i low = _mm_sll_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>( in + frame ) ), shift4 );
+			const __m128i high = _mm_sll_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>( in + frame + 4 ) ), shift4 );
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( output + frame * 2 ), _mm_packs_epi32( low, high ) );
+		}
+	} else if ( 2 == channels ) {
+		const int32_t* left = input[ 0 ] + offset;
+		const int32_t* right = input[ 1 ] + offset;
+		for ( ; ( frame + 4 ) <= sampleCount; frame += 4 ) {
+			const __m128i leftValue = _mm_sll_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>( left + frame ) ), shift4 );
+			const __m128i rightValue = _mm_sll_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>( right + frame ) ), shift4 );
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( output + frame * 4 ), _mm_packs_epi32( _mm_unpacklo_epi32( leftValue, rightValue ), _mm_unpackhi_epi32( leftValue, rightValue ) ) );
+		}
+	}
+	return frame;
+}
+
+#endif
+
+void PackInt32( unsigned char* output, const int32_t* const* input, const size_t offset, const size_t sampleCount, const long channels, const long shift, const long bytesPerValue )
+{
+	if ( ( nullptr != output ) && ( nullptr != input ) && ( channels > 0 ) && ( ( 2 == bytesPerValue ) || ( 3 == bytesPerValue ) ) ) {
+		size_t frame = 0;
+#ifdef SAMPLEKERNELS_SIMD
+		if ( 2 == bytesPerValue ) {
+			frame = PackInt32ToInt16SSE2( output, input, offset, sampleCount, channels, shift );
+		}
+#endif
+		const size_t frameSize = static_cast<size_t>( channels * bytesPerValue );
+		for ( long channel = 0; channel < channels; channel++ ) {
+			const int32_t* in = input[ channel ] + offset;
+			unsigned char* out = output + channel * bytesPerValue;
+			for ( size_t index = frame; index < sampleCount; index++ ) {
+				StorePackedValue( out + index * frameSize, static_cast<uint32_t>( in[ index ] ) << shift, bytesPerValue );
+			}
+		}
+	}
+}
+
+bool PackFloatExact( unsigned char* output, const float* input, const size_t count, const long bytesPerValue )
+{
+	bool exact = ( nullptr != output ) && ( nullptr != input ) && ( ( 2 == bytesPerValue ) || ( 3 == bytesPerValue ) );
+	if ( exact ) {
+		const float scale = static_cast<float>( 1 << ( bytesPerValue * 8 - 1 ) );
+		size_t index = 0;
+#ifdef SAMPLEKERNELS_SIMD
+		if ( 2 == bytesPerValue ) {
+			// Each value must be within range, and unchanged by conversion to an integer.
+			const __m128 scale4 = _mm_set1_ps( scale );
+			const __m128 minimum4 = _mm_set1_ps( -scale );
+			for ( ; exact && ( ( index + 8 ) <= count ); index += 8 ) {
+				const __m128 low = _mm_mul_ps( _mm_loadu_ps( input + index ), scale4 );
+				const __m128 high = _mm_mul_ps( _mm_loadu_ps( input + index + 4 ), scale4 );
+				const __m128i lowValue = _mm_cvtps_epi32( low );
+				const __m128i highValue = _mm_cvtps_epi32( high );
+				const __m128 lowExact = _mm_and_ps( _mm_cmpeq_ps( _mm_cvtepi32_ps( lowValue ), low ), _mm_and_ps( _mm_cmpge_ps( low, minimum4 ), _mm_cmplt_ps( low, scale4 ) ) );
+				const __m128 highExact = _mm_and_ps( _mm_cmpeq_ps( _mm_cvtepi32_ps( highValue ), high ), _mm_and_ps( _mm_cmpge_ps( high, minimum4 ), _mm_cmplt_ps( high, scale4 ) ) );
+				exact = ( 0xf == _mm_movemask_ps( _mm_and_ps( lowExact, highExact ) ) );
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( output + index * 2 ), _mm_packs_epi32( lowValue, highValue ) );
+			}
+		}
+#endif
+		for ( ; exact && ( index < count ); index++ ) {
+			const float scaled = input[ index ] * scale;
+			exact = ( scaled >= -scale ) && ( scaled < scale );
+			if ( exact ) {
+				const int32_t value = static_cast<int32_t>( std::lrint( scaled ) );
+				exact = ( static_cast<float>( value ) == scaled );
+				StorePackedValue( output + index * bytesPerValue, static_cast<uint32_t>( value ), bytesPerValue );
+			}
+		}
+	}
+	return exact;
+}
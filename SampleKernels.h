@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Sample processing kernels, operating on floating point sample data.
+// SSE/AVX implementations are used where the CPU supports them, with a scalar fallback.
+
+// Multiplies 'count' values in 'buffer' by 'scale'.
+void ScaleSamples( float* buffer, const size_t count, const float scale );
+
+// Multiplies 'count' values in 'buffer' by 'scale', hard limiting the result to the range +/-1.0.
+void ScaleAndClipSamples( float* buffer, const size_t count, const float scale );
+
+// Returns the dot product of the first 'count' values of 'a' and 'b'.
+float DotProduct( const float* a, const float* b, const size_t count );
+
+// Raises each of 'count' values in 'peaks' to the peak magnitude of the corresponding window of 'input', including values interpolated between its samples.
+// 'input' - 'count' + 'taps' - 1 values, where each window contains the 'taps' values starting at the corresponding index.
+// 'filters' - interpolation filter coefficients, containing 'taps' coefficients for each of the 'phases'.
+// The peak magnitude of each window is taken from its middle value (at index 'taps' / 2 - 1) and from the output of each interpolation filter.
+void UpdateInterpolatedPeaks( float* peaks, const float* input, const size_t count, const float* filters, const long taps, const long phases );
+
+// Generates 'count' fade gain values into 'ramp'.
+// 'position' - fade position of the first value, where 1.0 is full level and 0.0 is silence.
+// 'step' - amount by which the fade position decreases for each subsequent value (negative to fade in).
+// 'equalPower' - true to generate an equal power curve, false to generate a linear curve.
+void GenerateGainRamp( float* ramp, const size_t count, const float position, const float step, const bool equalPower );
+
+// Multiplies each sample frame in 'buffer' by the corresponding 'ramp' gain value.
+// 'sampleCount' - number of samples per channel.
+// 'channels' - number of channels.
+void ApplyGainRamp( float* buffer, const size_t sampleCount, const long channels, const float* ramp );
+
+// Multiplies each sample frame in 'input' by the corresponding 'ramp' gain value, adding the result to 'output'.
+// 'sampleCount' - number of samples per channel.
+// 'channels' - number of channels.
+void MixWithGainRamp( float* output, const float* input, const size_t sampleCount, const long channels, const float* ramp );
+
+// Returns the index of the first of the 'count' values in 'buffer' whose magnitude is greater than 'level', or 'count' if there is no such value.
+size_t FindFirstAboveLevel( const float* buffer, const size_t count, const float level );
+
+// Returns the index of the last of the 'count' values in 'buffer' whose magnitude is greater than 'level', or 'count' if there is no such value.
+size_t FindLastAboveLevel( const float* buffer, const size_t count, const float level );
+
+// Returns the index of the first of the 'count' integer values in 'buffer' which is not zero, or 'count' if there is no such value.
+size_t FindFirstNonZero( const int32_t* buffer, const size_t count );
+
+// Returns the index of the last of the 'count' integer values in 'buffer' which is not zero, or 'count' if there is no such value.
+size_t FindLastNonZero( const int32_t* buffer, const size_t count );
+
+// Mixes interleaved sample data from one channel layout to another, using a mixing matrix.
+// 'output' - out, sample data containing 'outputChannels' channels (must not overlap 'input').
+// 'input' - sample data containing 'inputChannels' channels.
+// 'sampleCount' - number of samples per channel.
+// 'matrix' - mixing matrix, containing 'inputChannels' coefficients for each output channel.
+void MixChannels( float* output, const long outputChannels, const float* input, const long inputChannels, const size_t sampleCount, const float* matrix );
+
+// Converts 'count' unsigned 8-bit values from 'input' to floating point values in 'output', scaled to +/-1.0.
+void ConvertUInt8ToFloat( float* output, const uint8_t* input, const size_t count );
+
+// Converts 'count' signed 16-bit values from 'input' to floating point values in 'output', scaled to +/-1.0.
+void ConvertInt16ToFloat( float* output, const int16_t* input, const size_t count );
+
+// Converts 'count' packed little endian signed 24-bit values from 'input' to floating point values in 'output', scaled to +/-1.0.
+void ConvertInt24ToFloat( float* output, const uint8_t* input, const size_t count );
+
+// Converts 'count' signed 32-bit values from 'input' to floating point values in 'output', scaled to +/-1.0.
+// 'bitsPerSample' - number of significant bits in each (right justified) value.
+// The conversion can be performed in place, with 'output' and 'input' referring to the same buffer.
+void ConvertInt32ToFloat( float* output, const int32_t* input, const size_t count, const long bitsPerSample );
+
+// Converts planar signed 32-bit sample data to interleaved floating point sample data, scaled to +/-1.0.
+// 'output' - out, interleaved sample data containing 'channels' channels.
+// 'input' - sample data for each channel.
+// 'offset' - offset of the first sample to convert, in samples from the start of each channel.
+// 'sampleCount' - number of samples per channel.
+// 'bitsPerSample' - number of significant bits in each (right justified) value.
+void InterleaveInt32ToFloat( float* output, const int32_t* const* input, const size_t offset, const size_t sampleCount, const long channels, const long bitsPerSample );
+
+// Packs planar signed 32-bit sample data as interleaved little endian signed values of 'bytesPerValue' bytes (2 or 3).
+// 'output' - out, packed sample data containing 'channels' channels.
+// 'input' - sample data for each channel (interleaved sample data can be packed as a single channel).
+// 'offset' - offset of the first sample to pack, in samples from the start of each channel.
+// 'sampleCount' - number of samples per channel.
+// 'shift' - number of bits by which each value is shifted left, which must leave the value within the packed size.
+void PackInt32( unsigned char* output, const int32_t* const* input, const size_t offset, const size_t sampleCount, const long channels, const long shift, const long bytesPerValue );
+
+// Packs 'count' floating point values from 'input', scaled from +/-1.0, as little endian signed values of 'bytesPerValue' bytes (2 or 3) in 'output'.
+// Returns whether every value was packed exactly (the contents of 'output' are undefined otherwise).
+bool PackFloatExact( unsigned char* output, const float* input, const size_t count, const long bytesPerValue );
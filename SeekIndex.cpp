@@ -0,0 +1,115 @@
+#include "SeekIndex.h"
+
+#include <algorithm>
+
+// Serialised index format version.
+static const unsigned char s_Version = 1;
+
+// Appends a variable length unsigned 'value' to 'data'.
+static void WriteValue( std::vector<unsigned char>& data, unsigned long long value )
+{
+	while ( value >= 0x80 ) {
+		data.push_back( static_cast<unsigned char>( value | 0x80 ) );
+		value >>= 7;
+	}
+	data.push_back( static_cast<unsigned char>( value ) );
+}
+
+// Reads a variable length unsigned value from 'data'.
+// 'offset' - in, the offset of the value, out, the offset following the value.
+// 'value' - out, the value.
+// Returns whether the value was read.
+static bool ReadValue( const std::vector<unsigned char>& data, size_t& offset, unsigned long long& value )
+{
+	value = 0;
+	bool success = false;
+	for ( unsigned int shift = 0; !success && ( shift < 64 ) && ( offset < data.size() ); shift += 7 ) {
+		const unsigned char byte = data[ offset++ ];
+		value |= static_cast<unsigned long long>( byte & 0x7f ) << shift;
+		success = ( 0 == ( byte & 0x80 ) );
+	}
+	return success;
+}
+
+SeekIndex::SeekIndex( const long long interval ) :
+	m_Interval( interval ),
+	m_Points()
+{
+}
+
+SeekIndex::~SeekIndex()
+{
+}
+
+void SeekIndex::Add( const long long sample, const long long offset )
+{
+	if ( ( sample >= 0 ) && ( offset >= 0 ) ) {
+		if ( m_Points.empty() || ( ( sample >= ( m_Points.back().Sample + m_Interval ) ) && ( offset > m_Points.back().Offset ) ) ) {
+			m_Points.push_back( { sample, offset } );
+		}
+	}
+}
+
+std::optional<SeekIndex::Point> SeekIndex::Find( const long long sample ) const
+{
+	std::optional<Point> point;
+	const auto next = std::upper_bound( m_Points.begin(), m_Points.end(), sample, [] ( const long long value, const Point& entry ) { return value < entry.Sample; } );
+	if ( m_Points.begin() != next ) {
+		point = *( next - 1 );
+	}
+	return point;
+}
+
+bool SeekIndex::IsEmpty() const
+{
+	return m_Points.empty();
+}
+
+const SeekIndex::Points& SeekIndex::GetPoints() const
+{
+	return m_Points;
+}
+
+std::vector<unsigned char> SeekIndex::Serialise() const
+{
+	std::vector<unsigned char> data;
+	data.reserve( 8 + m_Points.size() * 6 );
+	data.push_back( s_Version );
+	WriteValue( data, static_cast<unsigned long long>( m_Interval ) );
+	WriteValue( data, m_Points.size() );
+	Point previous;
+	for ( const auto& point : m_Points ) {
+		WriteValue( data, static_cast<unsigned long long>( point.Sample - previous.Sample ) );
+		WriteValue( data, static_cast<unsigned long long>( point.Offset - previous.Offset ) );
+		previous = point;
+	}
+	return data;
+}
+
+SeekIndex::Ptr SeekIndex::Deserialise( const std::vector<unsigned char>& data )
+{
+	std::shared_ptr<SeekIndex> index;
+	size_t offset = 1;
+	unsigned long long interval = 0;
+	unsigned long long count = 0;
+	if ( !data.empty() && ( s_Version == data.front() ) && ReadValue( data, offset, interval ) && ReadValue( data, offset, count ) && ( count <= data.size() ) ) {
+		index = std::make_shared<SeekIndex>( static_cast<long long>( interval ) );
+		index->m_Points.reserve( static_cast<size_t>( count ) );
+		Point point;
+		bool valid = true;
+		for ( unsigned long long n = 0; valid && ( n < count ); n++ ) {
+			unsigned long long sampleDelta = 0;
+			unsigned long long offsetDelta = 0;
+			valid = ReadValue( data, offset, sampleDelta ) && ReadValue( data, offset, offsetDelta );
+			if ( valid ) {
+				point.Sample += static_cast<long long>( sampleDelta );
+				point.Offset += static_cast<long long>( offsetDelta );
+				index->m_Points.push_back( point );
+			}
+		}
+		if ( !valid || ( offset != data.size() ) ) {
+			index.reset();
+		}
+	}
+	return index;
+}
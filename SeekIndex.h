@@ -0,0 +1,58 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+// A compact index of seek points, each pairing the first sample of a frame with the byte offset of that frame in the file.
+// An index is built while a stream is decoded from start to finish, and allows later seeks to go straight to the right part of the file.
+class SeekIndex
+{
+public:
+	// 'interval' - minimum distance between seek points, in samples.
+	SeekIndex( const long long interval );
+
+	virtual ~SeekIndex();
+
+	// Seek index shared pointer type.
+	using Ptr = std::shared_ptr<const SeekIndex>;
+
+	// A seek point.
+	struct Point {
+		// Position of the first sample in the frame, in samples from the start of the stream.
+		long long Sample = 0;
+
+		// Offset of the frame, in bytes from the start of the file.
+		long long Offset = 0;
+	};
+
+	// Seek points, in increasing sample order.
+	using Points = std::vector<Point>;
+
+	// Adds a seek point, if it is at least the minimum interval beyond the last seek point.
+	// 'sample' - position of the first sample in the frame, in samples from the start of the stream.
+	// 'offset' - offset of the frame, in bytes from the start of the file.
+	void Add( const long long sample, const long long offset );
+
+	// Returns the last seek point at or before a 'sample' position, or nullopt if there is no such seek point.
+	std::optional<Point> Find( const long long sample ) const;
+
+	// Returns whether the index contains no seek points.
+	bool IsEmpty() const;
+
+	// Returns the seek points.
+	const Points& GetPoints() const;
+
+	// Returns the index in its serialised form, with each seek point stored as variable length differences from the previous one.
+	std::vector<unsigned char> Serialise() const;
+
+	// Returns an index from its serialised form, or nullptr if the 'data' is not a valid index.
+	static Ptr Deserialise( const std::vector<unsigned char>& data );
+
+private:
+	// Minimum distance between seek points, in samples.
+	const long long m_Interval;
+
+	// Seek points.
+	Points m_Points;
+};
@@ -0,0 +1,161 @@
+#include "SeekIndexCache.h"
+
+#include "Utility.h"
+
+SeekIndexCache::SeekIndexCache( Database& database ) :
+	m_Database( database ),
+	m_PendingWrites(),
+	m_PendingWritesMutex(),
+	m_StopEvent( CreateEvent( NULL /*attributes*/, TRUE /*manualReset*/, FALSE /*initialState*/, L"" /*name*/ ) ),
+	m_WakeEvent( CreateEvent( NULL /*attributes*/, TRUE /*manualReset*/, FALSE /*initialState*/, L"" /*name*/ ) ),
+	m_WriterThread( nullptr )
+{
+	CreateTable();
+	if ( ( nullptr != m_StopEvent ) && ( nullptr != m_WakeEvent ) ) {
+		m_WriterThread = CreateThread( NULL /*attributes*/, 0 /*stackSize*/, WriterThreadProc, this /*param*/, 0 /*flags*/, NULL /*threadId*/ );
+	}
+}
+
+SeekIndexCache::~SeekIndexCache()
+{
+	if ( nullptr != m_WriterThread ) {
+		SetEvent( m_StopEvent );
+		WaitForSingleObject( m_WriterThread, INFINITE );
+		CloseHandle( m_WriterThread );
+	}
+	CloseHandle( m_StopEvent );
+	CloseHandle( m_WakeEvent );
+
+	// Perform any writes which were queued after the writer thread stopped (or which could not be performed because the thread was never started).
+	WritePending();
+}
+
+DWORD WINAPI SeekIndexCache::WriterThreadProc( LPVOID lpParam )
+{
+	SeekIndexCache* cache = static_cast<SeekIndexCache*>( lpParam );
+	if ( nullptr != cache ) {
+		cache->WriterHandler();
+	}
+	return 0;
+}
+
+void SeekIndexCache::WriterHandler()
+{
+	const HANDLE handles[ 2 ] = { m_StopEvent, m_WakeEvent };
+	while ( WaitForMultipleObjects( 2, handles, FALSE /*waitAll*/, INFINITE ) != WAIT_OBJECT_0 ) {
+		WritePending();
+	}
+}
+
+void SeekIndexCache::CreateTable()
+{
+	sqlite3* database = m_Database.GetDatabase();
+	if ( nullptr != database ) {
+		const std::string seekIndexTableQuery = "CREATE TABLE IF NOT EXISTS SeekIndex(Filename,Filetime,Filesize,Points, PRIMARY KEY(Filename));";
+		sqlite3_exec( database, seekIndexTableQuery.c_str(), NULL /*callback*/, NULL /*arg*/, NULL /*errMsg*/ );
+	}
+}
+
+bool SeekIndexCache::GetFileInfo( const std::wstring& filename, long long& lastModified, long long& fileSize )
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes = {};
+	const bool success = ( FALSE != GetFileAttributesEx( filename.c_str(), GetFileExInfoStandard, &attributes ) );
+	if ( success ) {
+		lastModified = ( static_cast<long long>( attributes.ftLastWriteTime.dwHighDateTime ) << 32 ) + attributes.ftLastWriteTime.dwLowDateTime;
+		fileSize = ( static_cast<long long>( attributes.nFileSizeHigh ) << 32 ) + attributes.nFileSizeLow;
+	}
+	return success;
+}
+
+SeekIndex::Ptr SeekIndexCache::Get( const std::wstring& filename )
+{
+	SeekIndex::Ptr index;
+	bool pending = false;
+	{
+		// A queued write takes precedence over the database.
+		std::lock_guard<std::mutex> lock( m_PendingWritesMutex );
+		if ( const auto write = m_PendingWrites.find( filename ); m_PendingWrites.end() != write ) {
+			pending = true;
+			if ( write->second.has_value() ) {
+				index = SeekIndex::Deserialise( *write->second );
+			}
+		}
+	}
+
+	long long lastModified = 0;
+	long long fileSize = 0;
+	sqlite3* database = m_Database.GetDatabase();
+	if ( !pending && ( nullptr != database ) && GetFileInfo( filename, lastModified, fileSize ) ) {
+		const std::string query = "SELECT Points FROM SeekIndex WHERE Filename=?1 AND Filetime=?2 AND Filesize=?3;";
+		sqlite3_stmt* stmt = nullptr;
+		if ( SQLITE_OK == sqlite3_prepare_v2( database, query.c_str(), -1 /*nByte*/, &stmt, nullptr /*tail*/ ) ) {
+			sqlite3_bind_text( stmt, 1, WideStringToUTF8( filename ).c_str(), -1 /*strLen*/, SQLITE_TRANSIENT );
+			sqlite3_bind_int64( stmt, 2, lastModified );
+			sqlite3_bind_int64( stmt, 3, fileSize );
+			if ( SQLITE_ROW == sqlite3_step( stmt ) ) {
+				const int numBytes = sqlite3_column_bytes( stmt, 0 /*columnIndex*/ );
+				const unsigned char* bytes = static_cast<const unsigned char*>( sqlite3_column_blob( stmt, 0 /*columnIndex*/ ) );
+				if ( ( nullptr != bytes ) && ( numBytes > 0 ) ) {
+					index = SeekIndex::Deserialise( std::vector<unsigned char>( bytes, bytes + numBytes ) );
+				}
+			}
+			sqlite3_finalize( stmt );
+		}
+	}
+	return index;
+}
+
+void SeekIndexCache::Set( const std::wstring& filename, const SeekIndex& index )
+{
+	if ( !index.IsEmpty() ) {
+		std::vector<unsigned char> points = index.Serialise();
+		std::lock_guard<std::mutex> lock( m_PendingWritesMutex );
+		m_PendingWrites[ filename ] = std::move( points );
+		SetEvent( m_WakeEvent );
+	}
+}
+
+void SeekIndexCache::Remove( const std::wstring& filename )
+{
+	std::lock_guard<std::mutex> lock( m_PendingWritesMutex );
+	m_PendingWrites[ filename ] = std::nullopt;
+	SetEvent( m_WakeEvent );
+}
+
+void SeekIndexCache::WritePending()
+{
+	PendingWrites pendingWrites;
+	{
+		std::lock_guard<std::mutex> lock( m_PendingWritesMutex );
+		pendingWrites.swap( m_PendingWrites );
+		ResetEvent( m_WakeEvent );
+	}
+
+	sqlite3* database = m_Database.GetDatabase();
+	if ( ( nullptr != database ) && !pendingWrites.empty() ) {
+		for ( const auto& [ filename, points ] : pendingWrites ) {
+			long long lastModified = 0;
+			long long fileSize = 0;
+			if ( points.has_value() && GetFileInfo( filename, lastModified, fileSize ) ) {
+				const std::string query = "REPLACE INTO SeekIndex (Filename,Filetime,Filesize,Points) VALUES (?1,?2,?3,?4);";
+				sqlite3_stmt* stmt = nullptr;
+				if ( SQLITE_OK == sqlite3_prepare_v2( database, query.c_str(), -1 /*nByte*/, &stmt, nullptr /*tail*/ ) ) {
+					sqlite3_bind_text( stmt, 1, WideStringToUTF8( filename ).c_str(), -1 /*strLen*/, SQLITE_TRANSIENT );
+					sqlite3_bind_int64( stmt, 2, lastModified );
+					sqlite3_bind_int64( stmt, 3, fileSize );
+					sqlite3_bind_blob( stmt, 4, points->data(), static_cast<int>( points->size() ), SQLITE_STATIC );
+					sqlite3_step( stmt );
+					sqlite3_finalize( stmt );
+				}
+			} else {
+				const std::string query = "DELETE FROM SeekIndex WHERE Filename=?1;";
+				sqlite3_stmt* stmt = nullptr;
+				if ( SQLITE_OK == sqlite3_prepare_v2( database, query.c_str(), -1 /*nByte*/, &stmt, nullptr /*tail*/ ) ) {
+					sqlite3_bind_text( stmt, 1, WideStringToUTF8( filename ).c_str(), -1 /*strLen*/, SQLITE_TRANSIENT );
+					sqlite3_step( stmt );
+					sqlite3_finalize( stmt );
+				}
+			}
+		}
+	}
+}
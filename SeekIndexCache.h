@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Database.h"
+#include "SeekIndex.h"
+
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Stores the seek index for each file in the application database, so that an index built during one decoding pass is available to later decoders.
+// An index is only returned while the file is unchanged since the index was stored.
+// Database writes are queued, and performed on a background thread.
+class SeekIndexCache
+{
+public:
+	// 'database' - application database.
+	SeekIndexCache( Database& database );
+
+	virtual ~SeekIndexCache();
+
+	// Returns the seek index for 'filename', or nullptr if there is no index for the current version of the file.
+	SeekIndex::Ptr Get( const std::wstring& filename );
+
+	// Queues the seek 'index' for 'filename' to be stored.
+	void Set( const std::wstring& filename, const SeekIndex& index );
+
+	// Queues any seek index for 'filename' to be removed.
+	void Remove( const std::wstring& filename );
+
+private:
+	// Serialised seek index points for each file, or nullopt if the seek index for the file is to be removed.
+	using PendingWrites = std::map<std::wstring, std::optional<std::vector<unsigned char>>>;
+
+	// Writer thread procedure.
+	// 'lpParam' - thread parameter.
+	static DWORD WINAPI WriterThreadProc( LPVOID lpParam );
+
+	// Writer thread handler.
+	void WriterHandler();
+
+	// Performs all the pending writes.
+	void WritePending();
+
+	// Creates the seek index table if necessary.
+	void CreateTable();
+
+	// Gets the 'lastModified' time and 'fileSize' of 'filename', returning true if the file information was read.
+	static bool GetFileInfo( const std::wstring& filename, long long& lastModified, long long& fileSize );
+
+	// Database.
+	Database& m_Database;
+
+	// Writes which have yet to be performed.
+	PendingWrites m_PendingWrites;
+
+	// Pending writes mutex.
+	std::mutex m_PendingWritesMutex;
+
+	// Event handle with which to stop the writer thread.
+	HANDLE m_StopEvent;
+
+	// Event handle with which to wake the writer thread.
+	HANDLE m_WakeEvent;
+
+	// Writer thread handle.
+	HANDLE m_WriterThread;
+};
@@ -1641,7 +1641,7 @@ void Settings::GetGainSettings( GainMode& gainMode, LimitMode& limitMode, float&
 		if ( SQLITE_OK == sqlite3_prepare_v2( database, query.c_str(), -1 /*nByte*/, &stmt, nullptr /*tail*/ ) ) {
 			if ( ( SQLITE_ROW == sqlite3_step( stmt ) ) && ( 1 == sqlite3_column_count( stmt ) ) ) {
 				const int value = sqlite3_column_int( stmt, 0 /*columnIndex*/ );
-				if ( ( value >= static_cast<int>( LimitMode::None ) ) && ( value <= static_cast<int>( LimitMode::Soft ) ) ) {
+				if ( ( value >= static_cast<int>( LimitMode::None ) ) && ( value <= static_cast<int>( LimitMode::TruePeak ) ) ) {
 					limitMode = static_cast<LimitMode>( value );
 				}
 			}
@@ -2056,6 +2056,41 @@ void Settings::SetOutputControlType( const int type )
 	}
 }
 
+Settings::CrossfadeCurve Settings::GetCrossfadeCurve()
+{
+	CrossfadeCurve curve = CrossfadeCurve::Linear;
+	sqlite3* database = m_Database.GetDatabase();
+	if ( nullptr != database ) {
+		sqlite3_stmt* stmt = nullptr;
+		const std::string query = "SELECT Value FROM Settings WHERE Setting='CrossfadeCurve';";
+		if ( SQLITE_OK == sqlite3_prepare_v2( database, query.c_str(), -1 /*nByte*/, &stmt, nullptr /*tail*/ ) ) {
+			if ( SQLITE_ROW == sqlite3_step( stmt ) ) {
+				const int value = sqlite3_column_int( stmt, 0 /*columnIndex*/ );
+				if ( ( value >= static_cast<int>( CrossfadeCurve::Linear ) ) && ( value <= static_cast<int>( CrossfadeCurve::EqualPower ) ) ) {
+					curve = static_cast<CrossfadeCurve>( value );
+				}
+			}
+			sqlite3_finalize( stmt );
+		}
+	}
+	return curve;
+}
+
+void Settings::SetCrossfadeCurve( const CrossfadeCurve curve )
+{
+	sqlite3* database = m_Database.GetDatabase();
+	if ( nullptr != database ) {
+		const std::string query = "REPLACE INTO Settings (Setting,Value) VALUES (?1,?2);";
+		sqlite3_stmt* stmt = nullptr;
+		if ( SQLITE_OK == sqlite3_prepare_v2( database, query.c_str(), -1 /*nByte*/, &stmt, nullptr /*tail*/ ) ) {
+			sqlite3_bind_text( stmt, 1, "CrossfadeCurve", -1 /*strLen*/, SQLITE_STATIC );
+			sqlite3_bind_int( stmt, 2, static_cast<int>( curve ) );
+			sqlite3_step( stmt );
+			sqlite3_finalize( stmt );
+		}
+	}
+}
+
 void Settings::GetExtractSettings( std::wstring& folder, std::wstring& filename, bool& addToLibrary, bool& joinTracks )
 {
 	folder.clear();
@@ -3123,6 +3158,125 @@ void Settings::SetAdvancedASIOSettings( const bool useDefaultSamplerate, const i
 	}
 }
 
+void Settings::GetDefaultReadAheadSettings( bool& enable, int& windowSize, int& throttle, int& minWindowSize, int& maxWindowSize )
+{
+	enable = true;
+	windowSize = 16;
+	throttle = 0;
+	minWindowSize = 4;
+	maxWindowSize = 64;
+}
+
+void Settings::GetReadAheadSettings( bool& enable, int& windowSize, int& throttle )
+{
+	int minWindowSize = 0;
+	int maxWindowSize = 0;
+	GetDefaultReadAheadSettings( enable, windowSize, throttle, minWindowSize, maxWindowSize );
+	sqlite3* database = m_Database.GetDatabase();
+	if ( nullptr != database ) {
+		sqlite3_stmt* stmt = nullptr;
+		std::string query = "SELECT Value FROM Settings WHERE Setting='ReadAheadEnable';";
+		if ( SQLITE_OK == sqlite3_prepare_v2( database, query.c_str(), -1 /*nByte*/, &stmt, nullptr /*tail*/ ) ) {
+			if ( ( SQLITE_ROW == sqlite3_step( stmt ) ) && ( 1 == sqlite3_column_count( stmt ) ) ) {
+				enable = ( 0 != sqlite3_column_int( stmt, 0 /*columnIndex*/ ) );
+			}
+			sqlite3_finalize( stmt );
+		}
+		stmt = nullptr;
+		query = "SELECT Value FROM Settings WHERE Setting='ReadAheadWindowSize';";
+		if ( SQLITE_OK == sqlite3_prepare_v2( database, query.c_str(), -1 /*nByte*/, &stmt, nullptr /*tail*/ ) ) {
+			if ( ( SQLITE_ROW == sqlite3_step( stmt ) ) && ( 1 == sqlite3_column_count( stmt ) ) ) {
+				windowSize = std::clamp( sqlite3_column_int( stmt, 0 /*columnIndex*/ ), minWindowSize, maxWindowSize );
+			}
+			sqlite3_finalize( stmt );
+		}
+		stmt = nullptr;
+		query = "SELECT Value FROM Settings WHERE Setting='ReadAheadThrottle';";
+		if ( SQLITE_OK == sqlite3_prepare_v2( database, query.c_str(), -1 /*nByte*/, &stmt, nullptr /*tail*/ ) ) {
+			if ( ( SQLITE_ROW == sqlite3_step( stmt ) ) && ( 1 == sqlite3_column_count( stmt ) ) ) {
+				throttle = (std::max)( sqlite3_column_int( stmt, 0 /*columnIndex*/ ), 0 );
+			}
+			sqlite3_finalize( stmt );
+		}
+	}
+}
+
+void Settings::SetReadAheadSettings( const bool enable, const int windowSize, const int throttle )
+{
+	sqlite3* database = m_Database.GetDatabase();
+	if ( nullptr != database ) {
+		sqlite3_stmt* stmt = nullptr;
+		const std::string query = "REPLACE INTO Settings (Setting,Value) VALUES (?1,?2);";
+		if ( SQLITE_OK == sqlite3_prepare_v2( database, query.c_str(), -1 /*nByte*/, &stmt, nullptr /*tail*/ ) ) {
+			sqlite3_bind_text( stmt, 1, "ReadAheadEnable", -1 /*strLen*/, SQLITE_STATIC );
+			sqlite3_bind_int( stmt, 2, enable );
+			sqlite3_step( stmt );
+			sqlite3_reset( stmt );
+
+			sqlite3_bind_text( stmt, 1, "ReadAheadWindowSize", -1 /*strLen*/, SQLITE_STATIC );
+			sqlite3_bind_int( stmt, 2, windowSize );
+			sqlite3_step( stmt );
+			sqlite3_reset( stmt );
+
+			sqlite3_bind_text( stmt, 1, "ReadAheadThrottle", -1 /*strLen*/, SQLITE_STATIC );
+			sqlite3_bind_int( stmt, 2, throttle );
+			sqlite3_step( stmt );
+			sqlite3_reset( stmt );
+
+			sqlite3_finalize( stmt );
+			stmt = nullptr;
+		}
+	}
+}
+
+void Settings::GetDefaultPCMCacheSize( int& size, int& minSize, int& maxSize )
+{
+#ifdef _WIN64
+	size = 256;
+	maxSize = 2048;
+#else
+	size = 64;
+	maxSize = 256;
+#endif
+	minSize = 0;
+}
+
+int Settings::GetPCMCacheSize()
+{
+	int size = 0;
+	int minSize = 0;
+	int maxSize = 0;
+	GetDefaultPCMCacheSize( size, minSize, maxSize );
+	sqlite3* database = m_Database.GetDatabase();
+	if ( nullptr != database ) {
+		sqlite3_stmt* stmt = nullptr;
+		const std::string query = "SELECT Value FROM Settings WHERE Setting='PCMCacheSize';";
+		if ( SQLITE_OK == sqlite3_prepare_v2( database, query.c_str(), -1 /*nByte*/, &stmt, nullptr /*tail*/ ) ) {
+			if ( ( SQLITE_ROW == sqlite3_step( stmt ) ) && ( 1 == sqlite3_column_count( stmt ) ) ) {
+				size = std::clamp( sqlite3_column_int( stmt, 0 /*columnIndex*/ ), minSize, maxSize );
+			}
+			sqlite3_finalize( stmt );
+		}
+	}
+	return size;
+}
+
+void Settings::SetPCMCacheSize( const int size )
+{
+	sqlite3* database = m_Database.GetDatabase();
+	if ( nullptr != database ) {
+		sqlite3_stmt* stmt = nullptr;
+		const std::string query = "REPLACE INTO Settings (Setting,Value) VALUES (?1,?2);";
+		if ( SQLITE_OK == sqlite3_prepare_v2( database, query.c_str(), -1 /*nByte*/, &stmt, nullptr /*tail*/ ) ) {
+			sqlite3_bind_text( stmt, 1, "PCMCacheSize", -1 /*strLen*/, SQLITE_STATIC );
+			sqlite3_bind_int( stmt, 2, size );
+			sqlite3_step( stmt );
+			sqlite3_finalize( stmt );
+			stmt = nullptr;
+		}
+	}
+}
+
 Settings::ToolbarSize Settings::GetToolbarSize()
 {
 	ToolbarSize size = ToolbarSize::Small;
@@ -41,7 +41,9 @@ public:
 	enum class OutputMode {
 		Standard,
 		WASAPIExclusive,
-		ASIO
+		ASIO,
+		Null,
+		File
 	};
 
 	// Gain mode.
@@ -55,7 +57,8 @@ public:
 	enum class LimitMode {
 		None,
 		Hard,
-		Soft
+		Soft,
+		TruePeak
 	};
 
 	// Notification area icon click commands.
@@ -75,6 +78,12 @@ public:
 		Large
 	};
 
+	// Crossfade curve.
+	enum class CrossfadeCurve {
+		Linear = 0,
+		EqualPower
+	};
+
 	// Toolbar size.
 	enum class ToolbarSize {
 		Small = 0,
@@ -417,6 +426,12 @@ public:
 	// Sets the output control type (volume, pitch, etc).
 	void SetOutputControlType( const int type );
 
+	// Gets the crossfade curve, used when fading out tracks (and, for an equal power curve, when fading in the next track).
+	CrossfadeCurve GetCrossfadeCurve();
+
+	// Sets the crossfade curve, used when fading out tracks (and, for an equal power curve, when fading in the next track).
+	void SetCrossfadeCurve( const CrossfadeCurve curve );
+
 	// Returns the track conversion/extraction settings.
 	void GetExtractSettings( std::wstring& folder, std::wstring& filename, bool& addToLibrary, bool& joinTracks );
 
@@ -532,6 +547,38 @@ public:
 	// 'leadIn' - lead-in length, in milliseconds.
 	void SetAdvancedASIOSettings( const bool useDefaultSamplerate, const int defaultSamplerate, const int leadIn );
 
+	// Gets the default (and allowed range of) read-ahead settings.
+	// 'enable' - out, true to read ahead for files on network drives, removable drives and hard disks.
+	// 'windowSize' - out, amount of upcoming file data to read ahead, in MB.
+	// 'throttle' - out, rate to which file reads are limited, in KB/s, so that read-ahead can be tested on local storage (or 0 for no limit).
+	// 'minWindowSize' - out, minimum window size, in MB.
+	// 'maxWindowSize' - out, maximum window size, in MB.
+	void GetDefaultReadAheadSettings( bool& enable, int& windowSize, int& throttle, int& minWindowSize, int& maxWindowSize );
+
+	// Gets the read-ahead settings.
+	// 'enable' - out, true to read ahead for files on network drives, removable drives and hard disks.
+	// 'windowSize' - out, amount of upcoming file data to read ahead, in MB.
+	// 'throttle' - out, rate to which file reads are limited, in KB/s, so that read-ahead can be tested on local storage (or 0 for no limit).
+	void GetReadAheadSettings( bool& enable, int& windowSize, int& throttle );
+
+	// Sets the read-ahead settings.
+	// 'enable' - true to read ahead for files on network drives, removable drives and hard disks.
+	// 'windowSize' - amount of upcoming file data to read ahead, in MB.
+	// 'throttle' - rate to which file reads are limited, in KB/s, so that read-ahead can be tested on local storage (or 0 for no limit).
+	void SetReadAheadSettings( const bool enable, const int windowSize, const int throttle );
+
+	// Gets the default (and allowed range of) decoded audio cache size, in MB (smaller on 32-bit builds, which have less address space to spare).
+	// 'size' - out, cache size.
+	// 'minSize' - out, minimum cache size (where 0 disables the cache).
+	// 'maxSize' - out, maximum cache size.
+	void GetDefaultPCMCacheSize( int& size, int& minSize, int& maxSize );
+
+	// Returns the decoded audio cache size, in MB.
+	int GetPCMCacheSize();
+
+	// Sets the decoded audio cache 'size', in MB (which takes effect when the application is next started).
+	void SetPCMCacheSize( const int size );
+
 	// Gets the toolbar size.
 	ToolbarSize GetToolbarSize();
 
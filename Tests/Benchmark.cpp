@@ -0,0 +1,355 @@
+#include "Benchmark.h"
+
+#include "Limiter.h"
+#include "SampleKernels.h"
+
+#include "ebur128.h"
+#include "opus.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+
+// Length of each test signal, in seconds.
+static const float s_SignalSeconds = 10.0f;
+
+// Length of each block of sample data, in seconds (matching the output decode block length).
+static const float s_BlockSeconds = 0.05f;
+
+// Number of times each benchmark is repeated, with the fastest time being reported.
+static const int s_Repetitions = 5;
+
+// Sample rates used by the gain benchmarks.
+static const std::array<long, 3> s_GainSampleRates = { 44100, 96000, 192000 };
+
+// Channel counts used by the gain benchmarks.
+static const std::array<long, 2> s_GainChannels = { 2, 8 };
+
+// Gain applied by the gain benchmarks, in dB (enough to push the test signal peaks above full scale).
+static const float s_GainPreamp = 6.0f;
+
+// Sample rates used by the loudness benchmarks.
+static const std::array<long, 2> s_LoudnessSampleRates = { 44100, 96000 };
+
+// Channel counts used by the loudness benchmarks (including odd counts, which leave a channel for the scalar filter).
+static const std::array<long, 4> s_LoudnessChannels = { 1, 2, 3, 6 };
+
+// Loudness measurement mode used by the loudness benchmarks.
+static const int s_LoudnessMode = EBUR128_MODE_I | EBUR128_MODE_LRA;
+
+// Sample rate used by the conversion benchmarks.
+static const long s_ConversionSampleRate = 96000;
+
+// Channel counts used by the conversion benchmarks (stereo being the only channel count with a SIMD interleaving path).
+static const std::array<long, 2> s_ConversionChannels = { 2, 6 };
+
+// Returns whether two loudness values are bit-identical.
+static bool IsIdentical( const double a, const double b )
+{
+	return 0 == memcmp( &a, &b, sizeof( double ) );
+}
+
+bool Benchmark::Run( const std::wstring& filename )
+{
+	bool success = false;
+	std::ofstream stream( filename, std::ios::out | std::ios::trunc );
+	if ( stream.is_open() ) {
+		stream << std::fixed << std::setprecision( 3 );
+		RunGain( stream );
+		RunLoudness( stream );
+		RunConversion( stream );
+		success = stream.good();
+		stream.close();
+	}
+	return success;
+}
+
+void Benchmark::RunGain( std::ostream& stream )
+{
+	// Each path is reported as a multiple of real time.
+	// The baseline paths convert the gain for every block, then make a separate scalar pass to scale the sample data, before either clipping in another scalar pass or soft clipping.
+	// The true peak limiter has no baseline of its own, so its cost is reported relative to the baseline soft clip path, which it is an alternative to.
+	stream << "Gain (x real time)" << std::endl;
+	stream << "Sample rate,Channels,Hard clip (baseline),Hard clip (fused),Speedup,Soft clip (baseline),Soft clip,Speedup,True peak,Relative to soft clip (baseline)" << std::endl;
+	for ( const auto sampleRate : s_GainSampleRates ) {
+		for ( const auto channels : s_GainChannels ) {
+			const std::vector<float> signal = GenerateSignal( sampleRate, channels );
+
+			const double hardClipBaseline = TimeBlocks( signal, sampleRate, channels, [ channels ] ( float* buffer, const long sampleCount )
+			{
+				const float scale = powf( 10.0f, s_GainPreamp / 20.0f );
+				const long totalSamples = sampleCount * channels;
+				for ( long sampleIndex = 0; sampleIndex < totalSamples; sampleIndex++ ) {
+					buffer[ sampleIndex ] *= scale;
+				}
+				for ( long sampleIndex = 0; sampleIndex < totalSamples; sampleIndex++ ) {
+					if ( buffer[ sampleIndex ] < -1.0f ) {
+						buffer[ sampleIndex ] = -1.0f;
+					} else if ( buffer[ sampleIndex ] > 1.0f ) {
+						buffer[ sampleIndex ] = 1.0f;
+					}
+				}
+			} );
+
+			const float scale = powf( 10.0f, s_GainPreamp / 20.0f );
+			const double hardClipFused = TimeBlocks( signal, sampleRate, channels, [ channels, scale ] ( float* buffer, const long sampleCount )
+			{
+				ScaleAndClipSamples( buffer, static_cast<size_t>( sampleCount ) * channels, scale );
+			} );
+
+			std::vector<float> softClipState( channels, 0 );
+			const double softClipBaseline = TimeBlocks( signal, sampleRate, channels, [ channels, &softClipState ] ( float* buffer, const long sampleCount )
+			{
+				const float scale = powf( 10.0f, s_GainPreamp / 20.0f );
+				const long totalSamples = sampleCount * channels;
+				for ( long sampleIndex = 0; sampleIndex < totalSamples; sampleIndex++ ) {
+					buffer[ sampleIndex ] *= scale;
+				}
+				opus_pcm_soft_clip( buffer, sampleCount, channels, softClipState.data() );
+			} );
+
+			std::fill( softClipState.begin(), softClipState.end(), 0.0f );
+			const double softClip = TimeBlocks( signal, sampleRate, channels, [ channels, scale, &softClipState ] ( float* buffer, const long sampleCount )
+			{
+				ScaleSamples( buffer, static_cast<size_t>( sampleCount ) * channels, scale );
+				opus_pcm_soft_clip( buffer, sampleCount, channels, softClipState.data() );
+			} );
+
+			Limiter limiter( channels, sampleRate );
+			const double truePeak = TimeBlocks( signal, sampleRate, channels, [ scale, &limiter ] ( float* buffer, const long sampleCount )
+			{
+				limiter.Process( buffer, sampleCount, scale );
+			} );
+
+			stream << sampleRate << "," << channels << ","
+				<< ( s_SignalSeconds / hardClipBaseline ) << "," << ( s_SignalSeconds / hardClipFused ) << "," << ( hardClipBaseline / hardClipFused ) << ","
+				<< ( s_SignalSeconds / softClipBaseline ) << "," << ( s_SignalSeconds / softClip ) << "," << ( softClipBaseline / softClip ) << ","
+				<< ( s_SignalSeconds / truePeak ) << "," << ( softClipBaseline / truePeak ) << std::endl;
+		}
+	}
+	stream << std::endl;
+}
+
+void Benchmark::RunLoudness( std::ostream& stream )
+{
+	// The scalar and SIMD paths are reported as multiples of real time.
+	// The paths are considered identical if the momentary loudness after every block, the integrated loudness, and the loudness range all match exactly.
+	stream << "Loudness (x real time)" << std::endl;
+	stream << "Sample rate,Channels,Scalar,SIMD,Speedup,Identical" << std::endl;
+	for ( const auto sampleRate : s_LoudnessSampleRates ) {
+		for ( const auto channels : s_LoudnessChannels ) {
+			const std::vector<float> signal = GenerateSignal( sampleRate, channels );
+
+			std::array<double, 2> elapsed = {};
+			for ( size_t path = 0; path < elapsed.size(); path++ ) {
+				ebur128_state* state = ebur128_init( static_cast<unsigned int>( channels ), static_cast<unsigned long>( sampleRate ), s_LoudnessMode );
+				if ( nullptr != state ) {
+					ebur128_set_vectorised( state, static_cast<int>( path ) );
+					elapsed[ path ] = TimeBlocks( signal, sampleRate, channels, [ state ] ( float* buffer, const long sampleCount )
+					{
+						ebur128_add_frames_float( state, buffer, static_cast<size_t>( sampleCount ) );
+					} );
+					ebur128_destroy( &state );
+				}
+			}
+
+			bool identical = true;
+			std::array<ebur128_state*, 2> states = {};
+			for ( size_t path = 0; path < states.size(); path++ ) {
+				states[ path ] = ebur128_init( static_cast<unsigned int>( channels ), static_cast<unsigned long>( sampleRate ), s_LoudnessMode );
+				identical = identical && ( nullptr != states[ path ] );
+				if ( nullptr != states[ path ] ) {
+					ebur128_set_vectorised( states[ path ], static_cast<int>( path ) );
+				}
+			}
+			if ( identical ) {
+				const long totalSamples = static_cast<long>( signal.size() / channels );
+				const long blockSize = static_cast<long>( s_BlockSeconds * sampleRate );
+				for ( long position = 0; identical && ( position < totalSamples ); position += blockSize ) {
+					const float* block = signal.data() + static_cast<size_t>( position ) * channels;
+					const size_t frames = static_cast<size_t>( std::min( blockSize, totalSamples - position ) );
+					std::array<double, 2> momentary = {};
+					for ( size_t path = 0; path < states.size(); path++ ) {
+						ebur128_add_frames_float( states[ path ], block, frames );
+						ebur128_loudness_momentary( states[ path ], &momentary[ path ] );
+					}
+					identical = IsIdentical( momentary[ 0 ], momentary[ 1 ] );
+				}
+				std::array<double, 2> global = {};
+				std::array<double, 2> range = {};
+				for ( size_t path = 0; path < states.size(); path++ ) {
+					ebur128_loudness_global( states[ path ], &global[ path ] );
+					ebur128_loudness_range( states[ path ], &range[ path ] );
+				}
+				identical = identical && IsIdentical( global[ 0 ], global[ 1 ] ) && IsIdentical( range[ 0 ], range[ 1 ] );
+			}
+			for ( auto& state : states ) {
+				if ( nullptr != state ) {
+					ebur128_destroy( &state );
+				}
+			}
+
+			stream << sampleRate << "," << channels << ","
+				<< ( s_SignalSeconds / elapsed[ 0 ] ) << "," << ( s_SignalSeconds / elapsed[ 1 ] ) << "," << ( elapsed[ 0 ] / elapsed[ 1 ] ) << ","
+				<< ( identical ? "Yes" : "No" ) << std::endl;
+		}
+	}
+	stream << std::endl;
+}
+
+void Benchmark::RunConversion( std::ostream& stream )
+{
+	// Each conversion is reported as a multiple of real time, with the native sample data derived from the test signal.
+	// The output blocks are converted from successive positions in the native sample data, wrapping around for each repetition.
+	stream << "Conversion (x real time)" << std::endl;
+	stream << "Format,Channels,Previous,SIMD,Speedup" << std::endl;
+	for ( const auto channels : s_ConversionChannels ) {
+		const std::vector<float> signal = GenerateSignal( s_ConversionSampleRate, channels );
+		const size_t totalValues = signal.size();
+
+		std::vector<uint8_t> input8( totalValues );
+		std::vector<int16_t> input16( totalValues );
+		std::vector<uint8_t> input24( totalValues * 3 );
+		std::vector<int32_t> input32( totalValues );
+		for ( size_t index = 0; index < totalValues; index++ ) {
+			const int32_t value = static_cast<int32_t>( signal[ index ] * 2147483647.0f );
+			input8[ index ] = static_cast<uint8_t>( ( value >> 24 ) + 128 );
+			input16[ index ] = static_cast<int16_t>( value >> 16 );
+			input24[ index * 3 ] = static_cast<uint8_t>( value >> 8 );
+			input24[ index * 3 + 1 ] = static_cast<uint8_t>( value >> 16 );
+			input24[ index * 3 + 2 ] = static_cast<uint8_t>( value >> 24 );
+			input32[ index ] = value;
+		}
+
+		// Planar 24-bit sample data, as decoded by FLAC.
+		const size_t totalSamples = totalValues / channels;
+		std::vector<std::vector<int32_t>> planar( channels, std::vector<int32_t>( totalSamples ) );
+		std::vector<const int32_t*> planarChannels( channels );
+		for ( long channel = 0; channel < channels; channel++ ) {
+			for ( size_t sampleIndex = 0; sampleIndex < totalSamples; sampleIndex++ ) {
+				planar[ channel ][ sampleIndex ] = input32[ sampleIndex * channels + channel ] >> 8;
+			}
+			planarChannels[ channel ] = planar[ channel ].data();
+		}
+
+		// Returns a block function which passes the offset of each block (in samples per channel) to the 'convert' function.
+		auto convertBlocks = [ totalSamples ] ( const std::function<void( float*, const size_t, const size_t )>& convert ) -> BlockFunction
+		{
+			return [ totalSamples, convert, offset = size_t( 0 ) ] ( float* buffer, const long sampleCount ) mutable
+			{
+				convert( buffer, offset, static_cast<size_t>( sampleCount ) );
+				offset = ( offset + sampleCount ) % totalSamples;
+			};
+		};
+
+		const std::array<std::pair<const char*, std::array<BlockFunction, 2>>, 5> conversions = { {
+			{ "8-bit", {
+				convertBlocks( [ &input8, channels ] ( float* output, const size_t offset, const size_t sampleCount )
+				{
+					const uint8_t* input = input8.data() + offset * channels;
+					for ( size_t index = 0; index < sampleCount * channels; index++ ) {
+						output[ index ] = static_cast<float>( static_cast<int>( input[ index ] ) - 128 ) / 128;
+					}
+				} ),
+				convertBlocks( [ &input8, channels ] ( float* output, const size_t offset, const size_t sampleCount )
+				{
+					ConvertUInt8ToFloat( output, input8.data() + offset * channels, sampleCount * channels );
+				} ) } },
+			{ "16-bit", {
+				convertBlocks( [ &input16, channels ] ( float* output, const size_t offset, const size_t sampleCount )
+				{
+					const int16_t* input = input16.data() + offset * channels;
+					for ( size_t index = 0; index < sampleCount * channels; index++ ) {
+						output[ index ] = static_cast<float>( input[ index ] ) / 32768;
+					}
+				} ),
+				convertBlocks( [ &input16, channels ] ( float* output, const size_t offset, const size_t sampleCount )
+				{
+					ConvertInt16ToFloat( output, input16.data() + offset * channels, sampleCount * channels );
+				} ) } },
+			{ "24-bit", {
+				convertBlocks( [ &input24, channels ] ( float* output, const size_t offset, const size_t sampleCount )
+				{
+					const uint8_t* input = input24.data() + offset * channels * 3;
+					for ( size_t index = 0; index < sampleCount * channels; index++ ) {
+						output[ index ] = static_cast<float>( ( input[ index * 3 + 2 ] << 24 ) | ( input[ index * 3 + 1 ] << 16 ) | ( input[ index * 3 ] << 8 ) ) / 2147483648ul;
+					}
+				} ),
+				convertBlocks( [ &input24, channels ] ( float* output, const size_t offset, const size_t sampleCount )
+				{
+					ConvertInt24ToFloat( output, input24.data() + offset * channels * 3, sampleCount * channels );
+				} ) } },
+			{ "32-bit", {
+				convertBlocks( [ &input32, channels ] ( float* output, const size_t offset, const size_t sampleCount )
+				{
+					const int32_t* input = input32.data() + offset * channels;
+					for ( size_t index = 0; index < sampleCount * channels; index++ ) {
+						output[ index ] = static_cast<float>( input[ index ] ) / 2147483648ul;
+					}
+				} ),
+				convertBlocks( [ &input32, channels ] ( float* output, const size_t offset, const size_t sampleCount )
+				{
+					ConvertInt32ToFloat( output, input32.data() + offset * channels, sampleCount * channels, 32 );
+				} ) } },
+			{ "24-bit planar", {
+				convertBlocks( [ &planarChannels, channels ] ( float* output, const size_t offset, const size_t sampleCount )
+				{
+					for ( size_t sampleIndex = 0; sampleIndex < sampleCount; sampleIndex++ ) {
+						for ( long channel = 0; channel < channels; channel++ ) {
+							output[ sampleIndex * channels + channel ] = static_cast<float>( planarChannels[ channel ][ offset + sampleIndex ] ) / ( 1 << ( 24 - 1 ) );
+						}
+					}
+				} ),
+				convertBlocks( [ &planarChannels, channels ] ( float* output, const size_t offset, const size_t sampleCount )
+				{
+					InterleaveInt32ToFloat( output, planarChannels.data(), offset, sampleCount, channels, 24 );
+				} ) } }
+		} };
+
+		for ( const auto& [ format, paths ] : conversions ) {
+			const double previous = TimeBlocks( signal, s_ConversionSampleRate, channels, paths[ 0 ] );
+			const double simd = TimeBlocks( signal, s_ConversionSampleRate, channels, paths[ 1 ] );
+			stream << format << "," << channels << ","
+				<< ( s_SignalSeconds / previous ) << "," << ( s_SignalSeconds / simd ) << "," << ( previous / simd ) << std::endl;
+		}
+	}
+	stream << std::endl;
+}
+
+std::vector<float> Benchmark::GenerateSignal( const long sampleRate, const long channels )
+{
+	// Uniform noise between -0.5 and 0.5, using a linear congruential generator so that every run processes the same signal.
+	std::vector<float> signal( static_cast<size_t>( s_SignalSeconds * sampleRate ) * channels );
+	unsigned int state = 0x12345678;
+	for ( auto& value : signal ) {
+		state = state * 1664525 + 1013904223;
+		value = static_cast<float>( state >> 8 ) / 0x1000000 - 0.5f;
+	}
+	return signal;
+}
+
+double Benchmark::TimeBlocks( const std::vector<float>& signal, const long sampleRate, const long channels, const BlockFunction& process )
+{
+	double fastest = 0;
+	const long totalSamples = ( channels > 0 ) ? static_cast<long>( signal.size() / channels ) : 0;
+	const long blockSize = static_cast<long>( s_BlockSeconds * sampleRate );
+	if ( ( totalSamples > 0 ) && ( blockSize > 0 ) ) {
+		std::vector<float> buffer( signal.size() );
+		for ( int repetition = 0; repetition < s_Repetitions; repetition++ ) {
+			std::copy( signal.begin(), signal.end(), buffer.begin() );
+			const auto start = std::chrono::steady_clock::now();
+			for ( long position = 0; position < totalSamples; position += blockSize ) {
+				process( buffer.data() + static_cast<size_t>( position ) * channels, std::min( blockSize, totalSamples - position ) );
+			}
+			const double elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+			if ( ( 0 == repetition ) || ( elapsed < fastest ) ) {
+				fastest = elapsed;
+			}
+		}
+	}
+	return fastest;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Micro-benchmarks for the sample processing paths, which compare each optimised path against the path it replaced.
+// The benchmarks are run by the unit test application, using the '-benchmark [results file]' command-line argument.
+class Benchmark
+{
+public:
+	// Runs all the benchmarks, writing a report to 'filename'.
+	// Returns whether the report was written.
+	static bool Run( const std::wstring& filename );
+
+private:
+	// Processes a block of sample data.
+	// 'buffer' - in/out, sample data.
+	// 'sampleCount' - number of samples per channel.
+	using BlockFunction = std::function<void( float* buffer, const long sampleCount )>;
+
+	// Runs the gain benchmarks, writing the results to the 'stream'.
+	static void RunGain( std::ostream& stream );
+
+	// Runs the loudness benchmarks, comparing the scalar and SIMD paths of the R128 loudness measurement, writing the results to the 'stream'.
+	static void RunLoudness( std::ostream& stream );
+
+	// Runs the sample conversion benchmarks, comparing the per-sample conversions previously used by the native decoders against the sample kernels, writing the results to the 'stream'.
+	static void RunConversion( std::ostream& stream );
+
+	// Generates a test signal of pseudo-random noise.
+	// 'sampleRate' - sample rate.
+	// 'channels' - number of channels.
+	// Returns the interleaved test signal.
+	static std::vector<float> GenerateSignal( const long sampleRate, const long channels );
+
+	// Times how long it takes to process a test 'signal' in blocks.
+	// 'signal' - interleaved test signal.
+	// 'sampleRate' - sample rate.
+	// 'channels' - number of channels.
+	// 'process' - processes each block of sample data.
+	// Returns the fastest time taken over all repetitions, in seconds.
+	static double TimeBlocks( const std::vector<float>& signal, const long sampleRate, const long channels, const BlockFunction& process );
+};
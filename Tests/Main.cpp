@@ -0,0 +1,41 @@
+#include "Tests.h"
+
+#include "Benchmark.h"
+
+#include <cstdio>
+#include <cwchar>
+#include <string>
+
+// Command line switch to run the sample processing benchmarks in place of the unit tests, writing the results to a file.
+static const wchar_t s_BenchmarkCmdLineSwitch[] = L"-benchmark";
+
+int wmain( int argc, wchar_t* argv[] )
+{
+	std::wstring benchmarkFilename;
+	for ( int arg = 1; arg < argc; arg++ ) {
+		if ( ( 0 == _wcsicmp( argv[ arg ], s_BenchmarkCmdLineSwitch ) ) && ( ( arg + 1 ) < argc ) ) {
+			benchmarkFilename = argv[ ++arg ];
+		}
+	}
+
+	int result = 0;
+	if ( benchmarkFilename.empty() ) {
+		Test test;
+
+		TestRingBuffer( test );
+		TestSampleKernels( test );
+		TestSeekIndex( test );
+		TestDecoderMixer( test );
+		TestDecoderResampler( test );
+		TestLimiter( test );
+		TestLoudness( test );
+		TestTrackAnalysis( test );
+		TestOutput( test );
+
+		std::printf( "%d checks, %d failed\n", test.GetCheckCount(), test.GetFailureCount() );
+		result = ( 0 == test.GetFailureCount() ) ? 0 : 1;
+	} else {
+		result = Benchmark::Run( benchmarkFilename ) ? 0 : 1;
+	}
+	return result;
+}
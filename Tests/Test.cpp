@@ -0,0 +1,48 @@
+#include "Test.h"
+
+#include <chrono>
+#include <cstdio>
+
+Test::Test() :
+	m_Name(),
+	m_CheckCount( 0 ),
+	m_FailureCount( 0 )
+{
+}
+
+Test::~Test()
+{
+}
+
+void Test::Run( const std::string& name, Function function )
+{
+	m_Name = name;
+	const int previousFailures = m_FailureCount;
+	const auto startTime = std::chrono::steady_clock::now();
+	if ( function ) {
+		function( *this );
+	}
+	const std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - startTime;
+	std::printf( "%s %s (%.1fms)\n", ( m_FailureCount == previousFailures ) ? "PASS" : "FAIL", m_Name.c_str(), duration.count() );
+	m_Name.clear();
+}
+
+bool Test::Check( const bool condition, const char* description, const char* file, const int line )
+{
+	++m_CheckCount;
+	if ( !condition ) {
+		++m_FailureCount;
+		std::printf( "  %s(%d): check failed in %s: %s\n", file, line, m_Name.c_str(), description );
+	}
+	return condition;
+}
+
+int Test::GetCheckCount() const
+{
+	return m_CheckCount;
+}
+
+int Test::GetFailureCount() const
+{
+	return m_FailureCount;
+}
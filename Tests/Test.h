@@ -0,0 +1,51 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+// Runs unit tests, and reports any checks that fail.
+class Test
+{
+public:
+	Test();
+
+	virtual ~Test();
+
+	// A test function.
+	// 'test' - the test runner, with which to make checks.
+	using Function = std::function<void( Test& test )>;
+
+	// Runs a test.
+	// 'name' - test name.
+	// 'function' - test function.
+	void Run( const std::string& name, Function function );
+
+	// Checks that a condition holds, reporting a failure if it does not.
+	// 'condition' - condition to check.
+	// 'description' - condition description.
+	// 'file' - source file name.
+	// 'line' - source line number.
+	// Returns the condition.
+	bool Check( const bool condition, const char* description, const char* file, const int line );
+
+	// Returns the total number of checks made.
+	int GetCheckCount() const;
+
+	// Returns the number of checks that failed.
+	int GetFailureCount() const;
+
+private:
+	// Name of the test being run.
+	std::string m_Name;
+
+	// Total number of checks made.
+	int m_CheckCount;
+
+	// Number of checks that failed.
+	int m_FailureCount;
+};
+
+// Checks that a condition holds, as part of a test.
+// 'test' - the test runner.
+// 'condition' - condition to check.
+#define TEST_CHECK( test, condition ) ( test ).Check( ( condition ), #condition, __FILE__, __LINE__ )
@@ -0,0 +1,164 @@
+#include "Tests.h"
+
+#include "DecoderMixer.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+// Largest number of channels with a known speaker layout.
+static const long s_MaxLayoutChannels = 8;
+
+// Index of the LFE channel, in the layouts which have one (BASS channel order).
+static const long s_LFEChannel = 3;
+
+// Decoder which outputs one sample for each channel, containing a full scale value in that channel only.
+class ImpulseDecoder : public Decoder
+{
+public:
+	// 'channels' - number of channels.
+	ImpulseDecoder( const long channels ) :
+		Decoder(),
+		m_Position( 0 )
+	{
+		SetSampleRate( 44100 );
+		SetChannels( channels );
+		SetDuration( static_cast<float>( channels ) / GetSampleRate() );
+	}
+
+protected:
+	// Reads sample data.
+	// 'buffer' - output buffer.
+	// 'sampleCount' - number of samples to read.
+	// Returns the number of samples read, or zero if the stream has ended.
+	long ReadSamples( float* buffer, const long sampleCount ) override
+	{
+		const long channels = GetChannels();
+		long samplesRead = 0;
+		for ( ; ( samplesRead < sampleCount ) && ( m_Position < channels ); samplesRead++, m_Position++ ) {
+			for ( long channel = 0; channel < channels; channel++ ) {
+				buffer[ samplesRead * channels + channel ] = ( channel == m_Position ) ? 1.0f : 0.0f;
+			}
+		}
+		return samplesRead;
+	}
+
+	// Seeks to a 'position' in the stream, in seconds.
+	// Returns the new position in seconds.
+	float SeekTo( const float /*position*/ ) override
+	{
+		m_Position = 0;
+		return 0;
+	}
+
+private:
+	// Current position, in samples per channel.
+	long m_Position;
+};
+
+// Returns the mixing matrix used to mix from 'inputChannels' to 'outputChannels', containing 'inputChannels' coefficients for each output channel.
+// The matrix is recovered from the mixer output, with each input channel being output in turn.
+static std::vector<float> GetMatrix( const long inputChannels, const long outputChannels )
+{
+	DecoderMixer mixer( std::make_shared<ImpulseDecoder>( inputChannels ), outputChannels );
+	std::vector<float> output( static_cast<size_t>( inputChannels ) * outputChannels );
+	std::vector<float> matrix;
+	if ( inputChannels == mixer.Read( output.data(), inputChannels ) ) {
+		matrix.resize( output.size() );
+		for ( long input = 0; input < inputChannels; input++ ) {
+			for ( long channel = 0; channel < outputChannels; channel++ ) {
+				matrix[ channel * inputChannels + input ] = output[ input * outputChannels + channel ];
+			}
+		}
+	}
+	return matrix;
+}
+
+// Returns whether 'a' and 'b' are within a small tolerance of each other.
+static bool IsClose( const float a, const float b )
+{
+	return std::fabs( a - b ) < 1e-5f;
+}
+
+void TestDecoderMixer( Test& test )
+{
+	test.Run( "DecoderMixer matching layouts", []( Test& test ) {
+		// Mixing to the same number of channels, or to and from a layout without known speaker positions, maps each channel directly.
+		for ( long channels = 1; channels <= ( s_MaxLayoutChannels + 2 ); channels++ ) {
+			const std::vector<float> matrix = GetMatrix( channels, channels );
+			bool identity = ( matrix.size() == static_cast<size_t>( channels * channels ) );
+			for ( size_t index = 0; identity && ( index < matrix.size() ); index++ ) {
+				identity = ( matrix[ index ] == ( ( 0 == ( index % ( channels + 1 ) ) ) ? 1.0f : 0.0f ) );
+			}
+			TEST_CHECK( test, identity );
+		}
+
+		const std::vector<float> unknown = GetMatrix( 10, 2 );
+		TEST_CHECK( test, ( 20 == unknown.size() ) && ( 1.0f == unknown[ 0 ] ) && ( 1.0f == unknown[ 11 ] ) );
+		TEST_CHECK( test, ( 20 == unknown.size() ) && ( 2.0f == unknown[ 0 ] + unknown[ 1 ] + unknown[ 10 ] + unknown[ 11 ] ) );
+	} );
+
+	test.Run( "DecoderMixer common layouts", []( Test& test ) {
+		// Mono is played at full level on both front speakers.
+		const std::vector<float> monoToStereo = GetMatrix( 1, 2 );
+		TEST_CHECK( test, ( 2 == monoToStereo.size() ) && ( 1.0f == monoToStereo[ 0 ] ) && ( 1.0f == monoToStereo[ 1 ] ) );
+
+		// Stereo is mixed equally to mono, normalised to prevent clipping.
+		const std::vector<float> stereoToMono = GetMatrix( 2, 1 );
+		TEST_CHECK( test, ( 2 == stereoToMono.size() ) && IsClose( 0.5f, stereoToMono[ 0 ] ) && IsClose( 0.5f, stereoToMono[ 1 ] ) );
+
+		// 5.1 to stereo keeps the left and right channels apart, shares the centre equally, and discards the LFE channel.
+		const std::vector<float> surroundToStereo = GetMatrix( 6, 2 );
+		TEST_CHECK( test, 12 == surroundToStereo.size() );
+		if ( 12 == surroundToStereo.size() ) {
+			const float* left = &surroundToStereo[ 0 ];
+			const float* right = &surroundToStereo[ 6 ];
+			TEST_CHECK( test, ( left[ 0 ] > 0 ) && ( 0 == left[ 1 ] ) && ( left[ 4 ] > 0 ) && ( 0 == left[ 5 ] ) );
+			TEST_CHECK( test, ( 0 == right[ 0 ] ) && ( right[ 1 ] > 0 ) && ( 0 == right[ 4 ] ) && ( right[ 5 ] > 0 ) );
+			TEST_CHECK( test, ( left[ 2 ] > 0 ) && IsClose( left[ 2 ], right[ 2 ] ) );
+			TEST_CHECK( test, ( 0 == left[ 3 ] ) && ( 0 == right[ 3 ] ) );
+			TEST_CHECK( test, IsClose( left[ 0 ], right[ 1 ] ) && IsClose( left[ 4 ], right[ 5 ] ) );
+		}
+
+		// Stereo to 5.1 plays on the front speakers only.
+		const std::vector<float> stereoToSurround = GetMatrix( 2, 6 );
+		const std::vector<float> expected = { 1, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0 };
+		TEST_CHECK( test, expected == stereoToSurround );
+
+		// 7.1 side channels are mixed into the 5.1 rear channels.
+		const std::vector<float> wideToSurround = GetMatrix( 8, 6 );
+		TEST_CHECK( test, ( 48 == wideToSurround.size() ) && ( wideToSurround[ 4 * 8 + 6 ] > 0 ) && ( wideToSurround[ 5 * 8 + 7 ] > 0 ) );
+	} );
+
+	test.Run( "DecoderMixer all layouts", []( Test& test ) {
+		// Between every pair of known layouts, no output channel should be able to clip, and every input channel (other than LFE) should be heard.
+		for ( long inputChannels = 1; inputChannels <= s_MaxLayoutChannels; inputChannels++ ) {
+			for ( long outputChannels = 1; outputChannels <= s_MaxLayoutChannels; outputChannels++ ) {
+				const std::vector<float> matrix = GetMatrix( inputChannels, outputChannels );
+				TEST_CHECK( test, matrix.size() == static_cast<size_t>( inputChannels * outputChannels ) );
+				if ( matrix.size() == static_cast<size_t>( inputChannels * outputChannels ) ) {
+					bool valid = true;
+					for ( long output = 0; output < outputChannels; output++ ) {
+						float total = 0;
+						for ( long input = 0; input < inputChannels; input++ ) {
+							const float coefficient = matrix[ output * inputChannels + input ];
+							valid = valid && ( coefficient >= 0 );
+							total += coefficient;
+						}
+						valid = valid && ( total <= 1.0001f );
+					}
+					const bool hasLFE = ( inputChannels >= 6 );
+					for ( long input = 0; input < inputChannels; input++ ) {
+						float total = 0;
+						for ( long output = 0; output < outputChannels; output++ ) {
+							total += matrix[ output * inputChannels + input ];
+						}
+						const bool lfe = hasLFE && ( s_LFEChannel == input );
+						valid = valid && ( lfe || ( total > 0 ) );
+					}
+					TEST_CHECK( test, valid );
+				}
+			}
+		}
+	} );
+}
@@ -0,0 +1,144 @@
+#include "Tests.h"
+
+#include "DecoderResampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+// Pi.
+static const double s_Pi = 3.14159265358979323846;
+
+// Decoder which generates a sine wave.
+class SineDecoder : public Decoder
+{
+public:
+	// 'sampleRate' - sample rate.
+	// 'channels' - number of channels.
+	// 'frequency' - sine wave frequency, in Hz.
+	// 'sampleCount' - stream length, in samples per channel.
+	SineDecoder( const long sampleRate, const long channels, const double frequency, const long long sampleCount ) :
+		Decoder(),
+		m_Frequency( frequency ),
+		m_SampleCount( sampleCount ),
+		m_Position( 0 )
+	{
+		SetSampleRate( sampleRate );
+		SetChannels( channels );
+		SetDuration( static_cast<float>( sampleCount ) / sampleRate );
+	}
+
+protected:
+	// Reads sample data.
+	// 'buffer' - output buffer.
+	// 'sampleCount' - number of samples to read.
+	// Returns the number of samples read, or zero if the stream has ended.
+	long ReadSamples( float* buffer, const long sampleCount ) override
+	{
+		const long channels = GetChannels();
+		long samplesRead = 0;
+		for ( ; ( samplesRead < sampleCount ) && ( m_Position < m_SampleCount ); samplesRead++, m_Position++ ) {
+			const float value = static_cast<float>( sin( 2 * s_Pi * m_Frequency * m_Position / GetSampleRate() ) );
+			for ( long channel = 0; channel < channels; channel++ ) {
+				buffer[ samplesRead * channels + channel ] = value;
+			}
+		}
+		return samplesRead;
+	}
+
+	// Seeks to a 'position' in the stream, in seconds.
+	// Returns the new position in seconds.
+	float SeekTo( const float position ) override
+	{
+		m_Position = std::llround( static_cast<double>( position ) * GetSampleRate() );
+		return position;
+	}
+
+private:
+	// Sine wave frequency, in Hz.
+	const double m_Frequency;
+
+	// Stream length, in samples per channel.
+	const long long m_SampleCount;
+
+	// Current position, in samples per channel.
+	long long m_Position;
+};
+
+// Resamples a sine wave, returning the interleaved output.
+// 'inputRate' - input sample rate.
+// 'outputRate' - output sample rate.
+// 'channels' - number of channels.
+// 'frequency' - sine wave frequency, in Hz.
+// 'seconds' - input length, in seconds.
+static std::vector<float> ResampleSine( const long inputRate, const long outputRate, const long channels, const double frequency, const float seconds )
+{
+	const long long inputCount = static_cast<long long>( seconds * inputRate );
+	DecoderResampler resampler( std::make_shared<SineDecoder>( inputRate, channels, frequency, inputCount ), outputRate );
+	std::vector<float> output;
+	std::vector<float> buffer( 1000 * channels );
+	long samplesRead = 0;
+	while ( ( samplesRead = resampler.Read( buffer.data(), 1000 ) ) > 0 ) {
+		output.insert( output.end(), buffer.begin(), buffer.begin() + samplesRead * channels );
+	}
+	return output;
+}
+
+// Returns the level of the middle half of a 'channel' of the 'output' (avoiding the filter transients at each end), in dB relative to a full scale sine wave.
+static double MeasureLevel( const std::vector<float>& output, const long channels, const long channel )
+{
+	const size_t sampleCount = output.size() / channels;
+	double total = 0;
+	for ( size_t sampleIndex = sampleCount / 4; sampleIndex < ( sampleCount * 3 / 4 ); sampleIndex++ ) {
+		const double value = output[ sampleIndex * channels + channel ];
+		total += value * value;
+	}
+	const double rms = ( sampleCount > 0 ) ? sqrt( total / ( sampleCount / 2 ) ) : 0;
+	return 20 * log10( std::max( rms * sqrt( 2.0 ), 1e-20 ) );
+}
+
+void TestDecoderResampler( Test& test )
+{
+	// Sample rate conversions to check, including upsampling, downsampling, and a ratio which uses many filter phases.
+	const std::vector<std::pair<long, long>> conversions = { { 44100, 48000 }, { 48000, 44100 }, { 96000, 44100 }, { 44100, 96000 }, { 192000, 48000 }, { 22050, 44100 } };
+
+	test.Run( "DecoderResampler passband", [ &conversions ]( Test& test ) {
+		// Tones in the passband should be passed at full level (the Kaiser window passband ripple is negligible at a 100dB stopband).
+		const long channels = 2;
+		for ( const auto& [ inputRate, outputRate ] : conversions ) {
+			const double nyquist = std::min( inputRate, outputRate ) / 2.0;
+			for ( const double frequency : { 1000.0, nyquist * 0.8 } ) {
+				const std::vector<float> output = ResampleSine( inputRate, outputRate, channels, frequency, 0.5f );
+				for ( long channel = 0; channel < channels; channel++ ) {
+					TEST_CHECK( test, std::fabs( MeasureLevel( output, channels, channel ) ) < 0.05 );
+				}
+			}
+		}
+	} );
+
+	test.Run( "DecoderResampler stopband", [ &conversions ]( Test& test ) {
+		// When downsampling, tones above the output Nyquist frequency should be attenuated by the designed stopband attenuation (allowing for single precision arithmetic).
+		for ( const auto& [ inputRate, outputRate ] : conversions ) {
+			if ( outputRate < inputRate ) {
+				const double outputNyquist = outputRate / 2.0;
+				const double inputNyquist = inputRate / 2.0;
+				for ( const double frequency : { outputNyquist * 1.02, ( outputNyquist + inputNyquist ) / 2 } ) {
+					const std::vector<float> output = ResampleSine( inputRate, outputRate, 1 /*channels*/, frequency, 0.5f );
+					TEST_CHECK( test, MeasureLevel( output, 1 /*channels*/, 0 /*channel*/ ) < -90.0 );
+				}
+			}
+		}
+	} );
+
+	test.Run( "DecoderResampler length", [ &conversions ]( Test& test ) {
+		// The output should cover the whole of the input, and no more.
+		for ( const auto& [ inputRate, outputRate ] : conversions ) {
+			const float seconds = 1.3f;
+			const std::vector<float> output = ResampleSine( inputRate, outputRate, 1 /*channels*/, 1000.0, seconds );
+			const long long expected = static_cast<long long>( seconds * inputRate ) * outputRate / inputRate;
+			TEST_CHECK( test, std::llabs( static_cast<long long>( output.size() ) - expected ) <= 1 );
+		}
+	} );
+}
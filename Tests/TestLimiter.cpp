@@ -0,0 +1,150 @@
+#include "Tests.h"
+
+#include "Limiter.h"
+
+#include "ebur128.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Limiter ceiling, in dBTP.
+static const float s_Ceiling = -1.0f;
+
+// Amount by which the true peak level of the limiter output is allowed to exceed the ceiling, in dB.
+// The limiter estimates true peaks with a short oversampling filter, and changes in gain can themselves produce inter-sample peaks, so the ceiling is approximate (while still leaving headroom below full scale).
+static const float s_TruePeakTolerance = 0.5f;
+
+// Number of samples per channel passed to the limiter at a time (which is deliberately not a multiple of the limiter block size).
+static const long s_BlockSize = 441;
+
+// Returns a test signal of 'sampleCount' samples per channel, containing 'channels' channels, with a peak of roughly 'level' dBFS.
+// The signal mixes low pass filtered pseudo-random noise with a sine wave at a quarter of the sample rate, whose samples fall either side of its peaks, so that the signal has inter-sample peaks.
+static std::vector<float> GenerateSignal( const long sampleCount, const long channels, const float level )
+{
+	const float scale = powf( 10.0f, level / 20.0f ) / 2;
+	std::vector<float> signal( static_cast<size_t>( sampleCount ) * channels );
+	std::vector<float> noise( channels, 0.0f );
+	unsigned int state = 0x12345678;
+	for ( long sampleIndex = 0; sampleIndex < sampleCount; sampleIndex++ ) {
+		const float sine = sinf( 1.57079632679f * sampleIndex + 0.785398163397f );
+		for ( long channel = 0; channel < channels; channel++ ) {
+			state = state * 1664525 + 1013904223;
+			noise[ channel ] += ( static_cast<float>( state >> 8 ) / 0x1000000 * 2 - 1 - noise[ channel ] ) * 0.3f;
+			signal[ sampleIndex * channels + channel ] = ( noise[ channel ] * 2 + sine ) * scale;
+		}
+	}
+	return signal;
+}
+
+// Passes the 'signal' through the 'limiter' in blocks, returning the output.
+static std::vector<float> ProcessSignal( Limiter& limiter, const std::vector<float>& signal, const float inputScale = 1.0f )
+{
+	std::vector<float> output( signal );
+	const long channels = limiter.GetChannels();
+	const long sampleCount = static_cast<long>( output.size() / channels );
+	for ( long position = 0; position < sampleCount; position += s_BlockSize ) {
+		limiter.Process( output.data() + position * channels, std::min( s_BlockSize, sampleCount - position ), inputScale );
+	}
+	return output;
+}
+
+// Returns the highest true peak level of any channel in the 'signal', in dBTP.
+static float MeasureTruePeak( const std::vector<float>& signal, const long channels, const long sampleRate )
+{
+	double peak = 0;
+	ebur128_state* state = ebur128_init( static_cast<unsigned int>( channels ), static_cast<unsigned long>( sampleRate ), EBUR128_MODE_TRUE_PEAK );
+	if ( nullptr != state ) {
+		ebur128_add_frames_float( state, signal.data(), signal.size() / channels );
+		for ( long channel = 0; channel < channels; channel++ ) {
+			double channelPeak = 0;
+			if ( EBUR128_SUCCESS == ebur128_true_peak( state, static_cast<unsigned int>( channel ), &channelPeak ) ) {
+				peak = std::max( peak, channelPeak );
+			}
+		}
+		ebur128_destroy( &state );
+	}
+	return static_cast<float>( 20 * log10( std::max( peak, 1e-10 ) ) );
+}
+
+// Returns the highest sample magnitude in the 'signal'.
+static float MeasureSamplePeak( const std::vector<float>& signal )
+{
+	float peak = 0;
+	for ( const auto value : signal ) {
+		peak = std::max( peak, std::fabs( value ) );
+	}
+	return peak;
+}
+
+void TestLimiter( Test& test )
+{
+	test.Run( "Limiter ceiling", []( Test& test ) {
+		const float ceiling = powf( 10.0f, s_Ceiling / 20.0f );
+		for ( const long sampleRate : { 44100, 96000 } ) {
+			for ( const long channels : { 1, 2, 6 } ) {
+				// A signal which peaks at roughly +6 dBFS, and the same signal at -6 dBFS which is scaled up by the limiter.
+				const long sampleCount = sampleRate * 2;
+				const std::vector<float> loud = GenerateSignal( sampleCount, channels, 6.0f );
+				const std::vector<float> quiet = GenerateSignal( sampleCount, channels, -6.0f );
+				TEST_CHECK( test, MeasureTruePeak( loud, channels, sampleRate ) > 5.0f );
+
+				Limiter limiter( channels, sampleRate, s_Ceiling );
+				const std::vector<float> loudOutput = ProcessSignal( limiter, loud );
+				TEST_CHECK( test, MeasureSamplePeak( loudOutput ) <= ceiling );
+				TEST_CHECK( test, MeasureTruePeak( loudOutput, channels, sampleRate ) <= ( s_Ceiling + s_TruePeakTolerance ) );
+
+				limiter.Reset();
+				const std::vector<float> quietOutput = ProcessSignal( limiter, quiet, 4.0f );
+				TEST_CHECK( test, MeasureSamplePeak( quietOutput ) <= ceiling );
+				TEST_CHECK( test, MeasureTruePeak( quietOutput, channels, sampleRate ) <= ( s_Ceiling + s_TruePeakTolerance ) );
+			}
+		}
+	} );
+
+	test.Run( "Limiter latency", []( Test& test ) {
+		// A signal which is well below the ceiling should be passed through unchanged, other than being delayed.
+		const long channels = 2;
+		const long sampleRate = 44100;
+		const long sampleCount = sampleRate / 2;
+		const std::vector<float> signal = GenerateSignal( sampleCount, channels, -12.0f );
+		Limiter limiter( channels, sampleRate, s_Ceiling );
+		const long latency = limiter.GetLatency();
+		TEST_CHECK( test, latency > 0 );
+
+		const std::vector<float> output = ProcessSignal( limiter, signal );
+		const size_t delay = static_cast<size_t>( latency ) * channels;
+		TEST_CHECK( test, std::all_of( output.begin(), output.begin() + delay, []( const float value ) { return 0 == value; } ) );
+		TEST_CHECK( test, std::equal( signal.begin(), signal.end() - delay, output.begin() + delay ) );
+
+		// Flushing should output the remaining delayed sample data, and then nothing more.
+		std::vector<float> flushed( delay * 2 );
+		TEST_CHECK( test, latency == limiter.Flush( flushed.data(), latency * 2 ) );
+		TEST_CHECK( test, std::equal( signal.end() - delay, signal.end(), flushed.begin() ) );
+		TEST_CHECK( test, 0 == limiter.Flush( flushed.data(), latency ) );
+	} );
+
+	test.Run( "Limiter bypass", []( Test& test ) {
+		const long channels = 2;
+		const long sampleRate = 48000;
+		const long sampleCount = sampleRate;
+		const float ceiling = powf( 10.0f, s_Ceiling / 20.0f );
+		const std::vector<float> signal = GenerateSignal( sampleCount, channels, 6.0f );
+		Limiter limiter( channels, sampleRate, s_Ceiling );
+
+		// When bypassed, the signal should be delayed but otherwise unchanged.
+		limiter.SetEnabled( false );
+		limiter.Reset();
+		TEST_CHECK( test, !limiter.GetEnabled() );
+		const std::vector<float> bypassed = ProcessSignal( limiter, signal );
+		const size_t delay = static_cast<size_t>( limiter.GetLatency() ) * channels;
+		TEST_CHECK( test, std::equal( signal.begin(), signal.end() - delay, bypassed.begin() + delay ) );
+
+		// Once enabled, the limiting is ramped in, after which the ceiling should hold.
+		limiter.SetEnabled( true );
+		const std::vector<float> enabled = ProcessSignal( limiter, signal );
+		const size_t rampLength = static_cast<size_t>( sampleRate / 50 ) * channels;
+		TEST_CHECK( test, MeasureSamplePeak( std::vector<float>( enabled.begin(), enabled.begin() + rampLength ) ) > ceiling );
+		TEST_CHECK( test, MeasureSamplePeak( std::vector<float>( enabled.begin() + rampLength, enabled.end() ) ) <= ceiling );
+	} );
+}
@@ -0,0 +1,162 @@
+#include "Tests.h"
+
+#include "ebur128.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+// Loudness measurement mode used by the tests.
+static const int s_Mode = EBUR128_MODE_I | EBUR128_MODE_LRA | EBUR128_MODE_SAMPLE_PEAK | EBUR128_MODE_TRUE_PEAK;
+
+// Length of the test signal, in seconds (long enough to give a loudness range).
+static const long s_SignalSeconds = 5;
+
+// Number of samples per channel passed at a time (which is deliberately not a multiple of the gating block size).
+static const long s_BlockSize = 1234;
+
+// Returns a test signal of 'seconds' at 'sampleRate', containing 'channels' channels of pseudo-random noise, with a level which differs between channels and changes over time.
+static std::vector<double> GenerateSignal( const long sampleRate, const long channels, const long seconds )
+{
+	std::vector<double> signal( static_cast<size_t>( sampleRate ) * seconds * channels );
+	unsigned int state = 0x2468ace1;
+	for ( size_t index = 0; index < signal.size(); index++ ) {
+		state = state * 1664525 + 1013904223;
+		const long channel = static_cast<long>( index % channels );
+		const long second = static_cast<long>( index / channels / sampleRate );
+		const double level = 0.9 / ( 1 + channel ) / ( 1 + ( second % 3 ) );
+		signal[ index ] = ( static_cast<double>( state >> 8 ) / 0x1000000 * 2 - 1 ) * level;
+	}
+	return signal;
+}
+
+// Returns whether two loudness values are bit-identical.
+static bool IsIdentical( const double a, const double b )
+{
+	return 0 == memcmp( &a, &b, sizeof( double ) );
+}
+
+// Measures a 'signal' with the scalar and the SIMD processing paths, returning whether all of the measurements are bit-identical.
+// 'channelMap' - channel map, or empty to use the default channel map.
+// 'addFrames' - adds frames to a state, from the 'signal' starting at 'offset' (in values).
+static bool IsEquivalent( const long sampleRate, const long channels, const std::vector<int>& channelMap, const std::vector<double>& signal,
+	const std::function<void( ebur128_state* state, const size_t offset, const size_t frames )>& addFrames )
+{
+	bool identical = true;
+	std::array<ebur128_state*, 2> states = {};
+	for ( size_t path = 0; path < states.size(); path++ ) {
+		states[ path ] = ebur128_init( static_cast<unsigned int>( channels ), static_cast<unsigned long>( sampleRate ), s_Mode );
+		identical = identical && ( nullptr != states[ path ] );
+		if ( nullptr != states[ path ] ) {
+			ebur128_set_vectorised( states[ path ], static_cast<int>( path ) );
+			for ( size_t channel = 0; channel < channelMap.size(); channel++ ) {
+				ebur128_set_channel( states[ path ], static_cast<unsigned int>( channel ), channelMap[ channel ] );
+			}
+		}
+	}
+
+	if ( identical ) {
+		// The momentary loudness is compared after each block, so that any difference in the filter state is caught as it occurs.
+		const size_t totalFrames = signal.size() / channels;
+		for ( size_t position = 0; identical && ( position < totalFrames ); position += s_BlockSize ) {
+			const size_t frames = std::min<size_t>( s_BlockSize, totalFrames - position );
+			std::array<double, 2> momentary = {};
+			for ( size_t path = 0; path < states.size(); path++ ) {
+				addFrames( states[ path ], position * channels, frames );
+				ebur128_loudness_momentary( states[ path ], &momentary[ path ] );
+			}
+			identical = IsIdentical( momentary[ 0 ], momentary[ 1 ] );
+		}
+
+		std::array<double, 2> shortterm = {};
+		std::array<double, 2> global = {};
+		std::array<double, 2> range = {};
+		for ( size_t path = 0; path < states.size(); path++ ) {
+			ebur128_loudness_shortterm( states[ path ], &shortterm[ path ] );
+			ebur128_loudness_global( states[ path ], &global[ path ] );
+			ebur128_loudness_range( states[ path ], &range[ path ] );
+		}
+		identical = identical && IsIdentical( shortterm[ 0 ], shortterm[ 1 ] ) && IsIdentical( global[ 0 ], global[ 1 ] ) && IsIdentical( range[ 0 ], range[ 1 ] );
+
+		for ( unsigned int channel = 0; identical && ( channel < static_cast<unsigned int>( channels ) ); channel++ ) {
+			std::array<double, 2> samplePeak = {};
+			std::array<double, 2> truePeak = {};
+			for ( size_t path = 0; path < states.size(); path++ ) {
+				ebur128_sample_peak( states[ path ], channel, &samplePeak[ path ] );
+				ebur128_true_peak( states[ path ], channel, &truePeak[ path ] );
+			}
+			identical = IsIdentical( samplePeak[ 0 ], samplePeak[ 1 ] ) && IsIdentical( truePeak[ 0 ], truePeak[ 1 ] );
+		}
+	}
+
+	for ( auto& state : states ) {
+		if ( nullptr != state ) {
+			ebur128_destroy( &state );
+		}
+	}
+	return identical;
+}
+
+void TestLoudness( Test& test )
+{
+	test.Run( "Loudness SIMD equivalence", []( Test& test ) {
+		// Odd channel counts leave a channel for the scalar filter, alongside the channel pairs filtered in SIMD lanes.
+		for ( const long sampleRate : { 44100, 96000 } ) {
+			for ( long channels = 1; channels <= 8; channels++ ) {
+				const std::vector<double> signal = GenerateSignal( sampleRate, channels, s_SignalSeconds );
+				const std::vector<float> floatSignal( signal.begin(), signal.end() );
+				TEST_CHECK( test, IsEquivalent( sampleRate, channels, {}, signal, [ &floatSignal ] ( ebur128_state* state, const size_t offset, const size_t frames )
+				{
+					ebur128_add_frames_float( state, floatSignal.data() + offset, frames );
+				} ) );
+			}
+		}
+	} );
+
+	test.Run( "Loudness SIMD equivalence sample formats", []( Test& test ) {
+		const long sampleRate = 44100;
+		const long channels = 2;
+		const std::vector<double> signal = GenerateSignal( sampleRate, channels, s_SignalSeconds );
+		std::vector<short> shortSignal( signal.size() );
+		std::vector<int> intSignal( signal.size() );
+		for ( size_t index = 0; index < signal.size(); index++ ) {
+			shortSignal[ index ] = static_cast<short>( signal[ index ] * 32767 );
+			intSignal[ index ] = static_cast<int>( signal[ index ] * 2147483647.0 );
+		}
+
+		TEST_CHECK( test, IsEquivalent( sampleRate, channels, {}, signal, [ &shortSignal ] ( ebur128_state* state, const size_t offset, const size_t frames )
+		{
+			ebur128_add_frames_short( state, shortSignal.data() + offset, frames );
+		} ) );
+		TEST_CHECK( test, IsEquivalent( sampleRate, channels, {}, signal, [ &intSignal ] ( ebur128_state* state, const size_t offset, const size_t frames )
+		{
+			ebur128_add_frames_int( state, intSignal.data() + offset, frames );
+		} ) );
+		TEST_CHECK( test, IsEquivalent( sampleRate, channels, {}, signal, [ &signal ] ( ebur128_state* state, const size_t offset, const size_t frames )
+		{
+			ebur128_add_frames_double( state, signal.data() + offset, frames );
+		} ) );
+	} );
+
+	test.Run( "Loudness SIMD equivalence channel maps", []( Test& test ) {
+		// Unused channels are skipped when pairing channels, and channels which share a filter state fall back to the scalar filter.
+		const long sampleRate = 48000;
+		const std::vector<std::vector<int>> channelMaps = {
+			{ EBUR128_LEFT, EBUR128_UNUSED, EBUR128_RIGHT },
+			{ EBUR128_UNUSED, EBUR128_LEFT, EBUR128_RIGHT, EBUR128_CENTER, EBUR128_UNUSED, EBUR128_LEFT_SURROUND },
+			{ EBUR128_DUAL_MONO },
+			{ EBUR128_LEFT, EBUR128_LEFT, EBUR128_RIGHT },
+		};
+		for ( const auto& channelMap : channelMaps ) {
+			const long channels = static_cast<long>( channelMap.size() );
+			const std::vector<double> signal = GenerateSignal( sampleRate, channels, s_SignalSeconds );
+			const std::vector<float> floatSignal( signal.begin(), signal.end() );
+			TEST_CHECK( test, IsEquivalent( sampleRate, channels, channelMap, signal, [ &floatSignal ] ( ebur128_state* state, const size_t offset, const size_t frames )
+			{
+				ebur128_add_frames_float( state, floatSignal.data() + offset, frames );
+			} ) );
+		}
+	} );
+}
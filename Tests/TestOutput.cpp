@@ -0,0 +1,214 @@
+#include "Tests.h"
+
+#include "Database.h"
+#include "Handlers.h"
+#include "Library.h"
+#include "Output.h"
+#include "Settings.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <new>
+
+// Number of heap allocations made by the current thread.
+static thread_local long long s_ThreadAllocations = 0;
+
+// Replaces the global allocation function (for the tests only), so that allocations on the decode path can be counted.
+void* operator new( size_t size )
+{
+	++s_ThreadAllocations;
+	void* memory = malloc( ( size > 0 ) ? size : 1 );
+	if ( nullptr == memory ) {
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+// Replaces the global deallocation function, to match the allocation function.
+void operator delete( void* memory ) noexcept
+{
+	free( memory );
+}
+
+// Drives decoding directly, in place of the output stream callback, so that each decode block can be checked.
+class OutputTest
+{
+public:
+	// Results of decoding a playlist.
+	struct Result {
+		// Number of blocks decoded.
+		long long Blocks = 0;
+
+		// Number of blocks which contained a track transition.
+		long long TransitionBlocks = 0;
+
+		// Number of blocks which mixed in a crossfading track.
+		long long CrossfadeBlocks = 0;
+
+		// Number of heap allocations made by the blocks which did not contain a track transition.
+		long long Allocations = 0;
+
+		// Playlist item IDs, in the order they were decoded.
+		std::vector<long> ItemIDs;
+	};
+
+	// Decodes a 'playlist' from start to finish, as the output stream callback would in the offline output modes.
+	// 'output' - audio output, which should be stopped and in the null output mode.
+	// Returns the decode results.
+	static Result DecodePlaylist( Output& output, const Playlist::Ptr playlist )
+	{
+		Result result;
+		const Playlist::ItemList items = playlist->GetItems();
+		if ( !items.empty() ) {
+			Playlist::Item item = items.front();
+			output.m_Playlist = playlist;
+			output.m_DecoderStream = output.OpenDecoder( item, true /*readAhead*/ );
+			if ( output.m_DecoderStream ) {
+				output.EstimateGain( item );
+				output.m_DecoderSampleRate = output.m_DecoderStream->GetSampleRate();
+				const float crossfadeOffset = output.GetCrossfade() ? output.SkipSilence( *output.m_DecoderStream, item ) : 0;
+				output.m_CurrentItemDecoding = item;
+				output.AddToOutputQueue( { item, 0, 0 } );
+				output.StartDecodeThread( output.m_AdaptiveBuffer.GetBufferLength( item.Info ) );
+				if ( output.GetCrossfade() ) {
+					const std::optional<float> position = output.FindCrossfadePosition( item, []() { return true; } );
+					if ( position.has_value() ) {
+						output.SetCrossfadePosition( position.value() - crossfadeOffset );
+					}
+				}
+				output.PreloadNextDecoder( item );
+
+				// Reserve up front, so that the results do not allocate while counting.
+				result.ItemIDs.reserve( items.size() + 1 );
+				result.ItemIDs.push_back( item.ID );
+				const long long maximumBlocks = 100000;
+				bool decoding = true;
+				while ( decoding && ( result.Blocks < maximumBlocks ) ) {
+					const long long allocations = s_ThreadAllocations;
+					decoding = output.DecodeOutputBlock();
+					const long long blockAllocations = s_ThreadAllocations - allocations;
+					++result.Blocks;
+					if ( output.m_DecodeBlockTransition ) {
+						++result.TransitionBlocks;
+					} else {
+						result.Allocations += blockAllocations;
+					}
+					if ( output.m_CrossfadingStream ) {
+						++result.CrossfadeBlocks;
+					}
+					if ( ( output.m_CurrentItemDecoding.ID > 0 ) && ( output.m_CurrentItemDecoding.ID != result.ItemIDs.back() ) ) {
+						result.ItemIDs.push_back( output.m_CurrentItemDecoding.ID );
+					}
+
+					// Discard the decoded sample data, as the output stream would have consumed it.
+					output.m_OutputBuffer.Skip( output.m_OutputBuffer.GetReadAvailable() );
+				}
+			}
+			output.Stop();
+		}
+		return result;
+	}
+};
+
+// Writes a 16-bit stereo WAV file containing a sine wave.
+// 'filename' - file name.
+// 'sampleRate' - sample rate.
+// 'seconds' - duration, in seconds.
+// 'frequency' - sine wave frequency, in Hz.
+// Returns whether the file was written.
+static bool WriteTestFile( const std::filesystem::path& filename, const long sampleRate, const long seconds, const double frequency )
+{
+	const uint16_t channels = 2;
+	const uint16_t bitsPerSample = 16;
+	const uint32_t dataSize = static_cast<uint32_t>( sampleRate * seconds * channels * bitsPerSample / 8 );
+	const uint32_t riffSize = 36 + dataSize;
+	const uint32_t formatSize = 16;
+	const uint16_t formatTag = 1;
+	const uint32_t rate = static_cast<uint32_t>( sampleRate );
+	const uint32_t byteRate = rate * channels * bitsPerSample / 8;
+	const uint16_t blockAlign = static_cast<uint16_t>( channels * bitsPerSample / 8 );
+
+	std::ofstream stream( filename, std::ios::binary | std::ios::trunc );
+	stream.write( "RIFF", 4 );
+	stream.write( reinterpret_cast<const char*>( &riffSize ), sizeof( riffSize ) );
+	stream.write( "WAVEfmt ", 8 );
+	stream.write( reinterpret_cast<const char*>( &formatSize ), sizeof( formatSize ) );
+	stream.write( reinterpret_cast<const char*>( &formatTag ), sizeof( formatTag ) );
+	stream.write( reinterpret_cast<const char*>( &channels ), sizeof( channels ) );
+	stream.write( reinterpret_cast<const char*>( &rate ), sizeof( rate ) );
+	stream.write( reinterpret_cast<const char*>( &byteRate ), sizeof( byteRate ) );
+	stream.write( reinterpret_cast<const char*>( &blockAlign ), sizeof( blockAlign ) );
+	stream.write( reinterpret_cast<const char*>( &bitsPerSample ), sizeof( bitsPerSample ) );
+	stream.write( "data", 4 );
+	stream.write( reinterpret_cast<const char*>( &dataSize ), sizeof( dataSize ) );
+
+	std::vector<int16_t> samples( static_cast<size_t>( sampleRate ) * seconds * channels );
+	for ( size_t sample = 0; sample < samples.size() / channels; sample++ ) {
+		const int16_t value = static_cast<int16_t>( 16384 * std::sin( 2 * M_PI * frequency * sample / sampleRate ) );
+		samples[ sample * channels ] = value;
+		samples[ sample * channels + 1 ] = value;
+	}
+	stream.write( reinterpret_cast<const char*>( samples.data() ), dataSize );
+	const bool written = stream.good();
+	return written;
+}
+
+void TestOutput( Test& test )
+{
+	const std::filesystem::path folder = std::filesystem::temp_directory_path() / L"VUPlayerTests";
+	std::error_code error;
+	std::filesystem::create_directories( folder, error );
+	const std::vector<std::filesystem::path> filenames = { folder / L"track1.wav", folder / L"track2.wav", folder / L"track3.wav" };
+	bool filesWritten = true;
+	double frequency = 440;
+	for ( const auto& filename : filenames ) {
+		filesWritten = WriteTestFile( filename, 44100 /*sampleRate*/, 8 /*seconds*/, frequency ) && filesWritten;
+		frequency *= 1.5;
+	}
+	if ( !TEST_CHECK( test, filesWritten ) ) {
+		return;
+	}
+
+	Database database( std::wstring(), Database::Mode::Memory );
+	Handlers handlers;
+	Library library( database, handlers );
+	Settings settings( database, library );
+	settings.SetOutputSettings( std::wstring(), Settings::OutputMode::Null );
+	settings.SetGainSettings( Settings::GainMode::Track, Settings::LimitMode::TruePeak, 6.0f /*preamp*/ );
+
+	const Playlist::Ptr playlist = std::make_shared<Playlist>( library, Playlist::Type::User );
+	for ( const auto& filename : filenames ) {
+		MediaInfo mediaInfo( filename.wstring() );
+		if ( library.GetMediaInfo( mediaInfo, false /*checkFileAttributes*/, true /*scanMedia*/, false /*sendNotification*/ ) ) {
+			playlist->AddItem( mediaInfo );
+		}
+	}
+	if ( !TEST_CHECK( test, static_cast<long>( filenames.size() ) == playlist->GetCount() ) ) {
+		return;
+	}
+
+	Output output( GetModuleHandle( nullptr ), nullptr /*hwnd*/, handlers, settings, 1.0f /*initialVolume*/ );
+
+	test.Run( "Output decode allocations", [ &output, &playlist ]( Test& test ) {
+		output.SetCrossfade( false );
+		const OutputTest::Result result = OutputTest::DecodePlaylist( output, playlist );
+		TEST_CHECK( test, 3 == result.ItemIDs.size() );
+		TEST_CHECK( test, result.TransitionBlocks >= 3 );
+		TEST_CHECK( test, result.Blocks > 2 * result.TransitionBlocks );
+		TEST_CHECK( test, 0 == result.Allocations );
+	} );
+
+	test.Run( "Output crossfade allocations", [ &output, &playlist ]( Test& test ) {
+		output.SetCrossfade( true );
+		const OutputTest::Result result = OutputTest::DecodePlaylist( output, playlist );
+		output.SetCrossfade( false );
+		TEST_CHECK( test, 3 == result.ItemIDs.size() );
+		TEST_CHECK( test, result.CrossfadeBlocks > 0 );
+		TEST_CHECK( test, 0 == result.Allocations );
+	} );
+
+	std::filesystem::remove_all( folder, error );
+}
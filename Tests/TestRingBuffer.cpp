@@ -0,0 +1,163 @@
+#include "Tests.h"
+
+#include "RingBuffer.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// Returns the test value for a channel of a sample.
+static float SampleValue( const long long sample, const long channel )
+{
+	return static_cast<float>( ( sample % 65536 ) * 8 + channel );
+}
+
+void TestRingBuffer( Test& test )
+{
+	test.Run( "RingBuffer reset", []( Test& test ) {
+		RingBuffer buffer;
+		TEST_CHECK( test, 0 == buffer.GetCapacity() );
+		TEST_CHECK( test, 0 == buffer.GetWriteAvailable() );
+
+		const std::vector<float> samples( 8, 1.0f );
+		TEST_CHECK( test, 0 == buffer.Write( samples.data(), 4 ) );
+
+		buffer.Reset( 2, 16 );
+		TEST_CHECK( test, 2 == buffer.GetChannels() );
+		TEST_CHECK( test, 16 == buffer.GetCapacity() );
+		TEST_CHECK( test, 0 == buffer.GetReadAvailable() );
+		TEST_CHECK( test, 16 == buffer.GetWriteAvailable() );
+
+		TEST_CHECK( test, 4 == buffer.Write( samples.data(), 4 ) );
+		buffer.Reset( 2, 16 );
+		TEST_CHECK( test, 0 == buffer.GetReadAvailable() );
+
+		buffer.Reset( -1, -1 );
+		TEST_CHECK( test, 0 == buffer.GetChannels() );
+		TEST_CHECK( test, 0 == buffer.GetCapacity() );
+	} );
+
+	test.Run( "RingBuffer limits", []( Test& test ) {
+		const long channels = 2;
+		const long capacity = 16;
+		RingBuffer buffer;
+		buffer.Reset( channels, capacity );
+
+		std::vector<float> samples( channels * capacity * 2 );
+		for ( long sample = 0; sample < capacity * 2; sample++ ) {
+			for ( long channel = 0; channel < channels; channel++ ) {
+				samples[ sample * channels + channel ] = SampleValue( sample, channel );
+			}
+		}
+
+		TEST_CHECK( test, 0 == buffer.Write( nullptr, 4 ) );
+		TEST_CHECK( test, 0 == buffer.Write( samples.data(), 0 ) );
+		TEST_CHECK( test, capacity == buffer.Write( samples.data(), capacity * 2 ) );
+		TEST_CHECK( test, 0 == buffer.GetWriteAvailable() );
+		TEST_CHECK( test, 0 == buffer.Write( samples.data(), 1 ) );
+
+		std::vector<float> output( channels * capacity * 2 );
+		TEST_CHECK( test, 0 == buffer.Read( nullptr, 4 ) );
+		TEST_CHECK( test, capacity == buffer.Read( output.data(), capacity * 2 ) );
+		TEST_CHECK( test, std::equal( output.begin(), output.begin() + channels * capacity, samples.begin() ) );
+		TEST_CHECK( test, 0 == buffer.Read( output.data(), 1 ) );
+		TEST_CHECK( test, 0 == buffer.Skip( 1 ) );
+	} );
+
+	test.Run( "RingBuffer wrap around", []( Test& test ) {
+		const long channels = 3;
+		const long capacity = 37;
+		RingBuffer buffer;
+		buffer.Reset( channels, capacity );
+
+		// Use block sizes that do not divide the capacity, so that reads, writes & skips straddle the end of the buffer.
+		const long blockSizes[] = { 1, 5, 11, 36, 2, 17, 37, 3 };
+		std::vector<float> block( channels * capacity );
+		long long written = 0;
+		long long read = 0;
+		bool match = true;
+		for ( int iteration = 0; iteration < 1000; iteration++ ) {
+			const long writeSize = blockSizes[ iteration % 8 ];
+			const long expectedWrite = std::min( writeSize, buffer.GetWriteAvailable() );
+			for ( long sample = 0; sample < expectedWrite; sample++ ) {
+				for ( long channel = 0; channel < channels; channel++ ) {
+					block[ sample * channels + channel ] = SampleValue( written + sample, channel );
+				}
+			}
+			const long samplesWritten = buffer.Write( block.data(), writeSize );
+			match = match && ( expectedWrite == samplesWritten );
+			written += samplesWritten;
+			match = match && ( written - read == buffer.GetReadAvailable() );
+
+			const long readSize = blockSizes[ ( iteration + 3 ) % 8 ];
+			if ( 0 == ( iteration % 5 ) ) {
+				const long samplesSkipped = buffer.Skip( readSize );
+				match = match && ( std::min<long long>( readSize, written - read ) == samplesSkipped );
+				read += samplesSkipped;
+			} else {
+				const long samplesRead = buffer.Read( block.data(), readSize );
+				match = match && ( std::min<long long>( readSize, written - read ) == samplesRead );
+				for ( long sample = 0; sample < samplesRead; sample++ ) {
+					for ( long channel = 0; channel < channels; channel++ ) {
+						match = match && ( SampleValue( read + sample, channel ) == block[ sample * channels + channel ] );
+					}
+				}
+				read += samplesRead;
+			}
+			match = match && ( capacity - ( written - read ) == buffer.GetWriteAvailable() );
+		}
+		TEST_CHECK( test, match );
+		TEST_CHECK( test, written > capacity * 100 );
+	} );
+
+	test.Run( "RingBuffer producer & consumer", []( Test& test ) {
+		const long channels = 2;
+		const long capacity = 1024;
+		const long long totalSamples = 4000000;
+		RingBuffer buffer;
+		buffer.Reset( channels, capacity );
+
+		std::thread producer( [ &buffer, channels, totalSamples ]() {
+			std::vector<float> block( channels * 300 );
+			long long written = 0;
+			while ( written < totalSamples ) {
+				const long blockSize = static_cast<long>( std::min<long long>( 1 + written % 300, totalSamples - written ) );
+				for ( long sample = 0; sample < blockSize; sample++ ) {
+					for ( long channel = 0; channel < channels; channel++ ) {
+						block[ sample * channels + channel ] = SampleValue( written + sample, channel );
+					}
+				}
+				long offset = 0;
+				while ( offset < blockSize ) {
+					const long samplesWritten = buffer.Write( block.data() + offset * channels, blockSize - offset );
+					if ( 0 == samplesWritten ) {
+						std::this_thread::yield();
+					}
+					offset += samplesWritten;
+				}
+				written += blockSize;
+			}
+		} );
+
+		std::vector<float> block( channels * 257 );
+		long long read = 0;
+		bool match = true;
+		while ( read < totalSamples ) {
+			const long samplesRead = buffer.Read( block.data(), 257 );
+			if ( 0 == samplesRead ) {
+				std::this_thread::yield();
+			}
+			for ( long sample = 0; sample < samplesRead; sample++ ) {
+				for ( long channel = 0; channel < channels; channel++ ) {
+					match = match && ( SampleValue( read + sample, channel ) == block[ sample * channels + channel ] );
+				}
+			}
+			read += samplesRead;
+		}
+		producer.join();
+
+		TEST_CHECK( test, match );
+		TEST_CHECK( test, totalSamples == read );
+		TEST_CHECK( test, 0 == buffer.GetReadAvailable() );
+	} );
+}
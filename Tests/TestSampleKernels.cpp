@@ -0,0 +1,354 @@
+#include "Tests.h"
+
+#include "SampleKernels.h"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Largest number of values processed by each check, covering several whole SIMD groups followed by each possible remainder.
+static const size_t s_MaxCount = 67;
+
+// Returns 'count' pseudo-random values between -'range' and 'range' (using a linear congruential generator so that every run checks the same values).
+static std::vector<float> RandomValues( const size_t count, const float range )
+{
+	std::vector<float> values( count );
+	unsigned int state = 0x12345678;
+	for ( auto& value : values ) {
+		state = state * 1664525 + 1013904223;
+		value = ( static_cast<float>( state >> 8 ) / 0x1000000 * 2 - 1 ) * range;
+	}
+	return values;
+}
+
+// Returns whether 'a' and 'b' are within 'tolerance' of each other.
+static bool IsClose( const float a, const float b, const float tolerance )
+{
+	return std::fabs( a - b ) <= tolerance;
+}
+
+void TestSampleKernels( Test& test )
+{
+	// Each kernel is compared against a scalar reference implementation, with buffers offset by one value so that SIMD loads and stores are unaligned.
+	test.Run( "SampleKernels scale", []( Test& test ) {
+		const std::vector<float> input = RandomValues( s_MaxCount + 1, 2.0f );
+		for ( size_t count = 0; count <= s_MaxCount; count++ ) {
+			std::vector<float> scaled( input );
+			std::vector<float> clipped( input );
+			ScaleSamples( scaled.data() + 1, count, 0.75f );
+			ScaleAndClipSamples( clipped.data() + 1, count, 0.75f );
+			bool scaledMatch = ( scaled[ 0 ] == input[ 0 ] );
+			bool clippedMatch = ( clipped[ 0 ] == input[ 0 ] );
+			for ( size_t index = 1; index <= s_MaxCount; index++ ) {
+				const float expected = ( index <= count ) ? ( input[ index ] * 0.75f ) : input[ index ];
+				const float expectedClipped = ( index <= count ) ? std::fmin( std::fmax( expected, -1.0f ), 1.0f ) : input[ index ];
+				scaledMatch = scaledMatch && ( scaled[ index ] == expected );
+				clippedMatch = clippedMatch && ( clipped[ index ] == expectedClipped );
+			}
+			TEST_CHECK( test, scaledMatch );
+			TEST_CHECK( test, clippedMatch );
+		}
+	} );
+
+	test.Run( "SampleKernels dot product", []( Test& test ) {
+		const std::vector<float> a = RandomValues( s_MaxCount + 1, 1.0f );
+		const std::vector<float> b = RandomValues( s_MaxCount * 2 + 1, 1.0f );
+		for ( size_t count = 0; count <= s_MaxCount; count++ ) {
+			double expected = 0;
+			for ( size_t index = 0; index < count; index++ ) {
+				expected += static_cast<double>( a[ index + 1 ] ) * b[ index + s_MaxCount ];
+			}
+			TEST_CHECK( test, IsClose( DotProduct( a.data() + 1, b.data() + s_MaxCount, count ), static_cast<float>( expected ), 1e-5f ) );
+		}
+	} );
+
+	test.Run( "SampleKernels interpolated peaks", []( Test& test ) {
+		const long taps = 12;
+		const long phases = 3;
+		const std::vector<float> filters = RandomValues( taps * phases, 0.5f );
+		const std::vector<float> input = RandomValues( s_MaxCount + taps, 1.0f );
+		const std::vector<float> initial = RandomValues( s_MaxCount + 1, 2.0f );
+		for ( size_t count = 0; count <= s_MaxCount; count++ ) {
+			std::vector<float> peaks( initial );
+			for ( auto& peak : peaks ) {
+				peak = std::fabs( peak );
+			}
+			std::vector<float> expected( peaks );
+			UpdateInterpolatedPeaks( peaks.data() + 1, input.data() + 1, count, filters.data(), taps, phases );
+
+			// The reference sums each filter in the same order as the kernel, so the results should match exactly.
+			for ( size_t index = 0; index < count; index++ ) {
+				const float* window = input.data() + 1 + index;
+				float peak = std::fabs( window[ taps / 2 - 1 ] );
+				for ( long phase = 0; phase < phases; phase++ ) {
+					float total = 0;
+					for ( long tap = 0; tap < taps; tap++ ) {
+						total += window[ tap ] * filters[ phase * taps + tap ];
+					}
+					peak = std::fmax( peak, std::fabs( total ) );
+				}
+				expected[ index + 1 ] = std::fmax( expected[ index + 1 ], peak );
+			}
+			TEST_CHECK( test, expected == peaks );
+		}
+	} );
+
+	test.Run( "SampleKernels gain ramps", []( Test& test ) {
+		for ( const bool equalPower : { false, true } ) {
+			for ( size_t count = 0; count <= s_MaxCount; count++ ) {
+				const float step = 1.0f / 40;
+				std::vector<float> ramp( count + 1, -1.0f );
+				GenerateGainRamp( ramp.data() + 1, count, 1.2f, step, equalPower );
+				bool rampMatch = ( -1.0f == ramp[ 0 ] );
+				for ( size_t index = 0; index < count; index++ ) {
+					float expected = std::fmin( std::fmax( 1.2f - static_cast<float>( index ) * step, 0.0f ), 1.0f );
+					if ( equalPower ) {
+						expected = sinf( expected * 1.57079632679f );
+					}
+					rampMatch = rampMatch && ( ramp[ index + 1 ] == expected );
+				}
+				TEST_CHECK( test, rampMatch );
+			}
+		}
+
+		const std::vector<float> ramp = RandomValues( s_MaxCount + 1, 1.0f );
+		for ( const long channels : { 1, 2, 3, 4, 8 } ) {
+			const std::vector<float> input = RandomValues( ( s_MaxCount + 1 ) * channels, 1.0f );
+			const std::vector<float> initial = RandomValues( ( s_MaxCount + 1 ) * channels + 1, 1.0f );
+			for ( size_t count = 0; count <= s_MaxCount; count++ ) {
+				std::vector<float> applied( input );
+				std::vector<float> mixed( initial );
+				ApplyGainRamp( applied.data() + 1, count, channels, ramp.data() + 1 );
+				MixWithGainRamp( mixed.data() + 1, input.data() + 1, count, channels, ramp.data() + 1 );
+				std::vector<float> expectedApplied( input );
+				std::vector<float> expectedMixed( initial );
+				for ( size_t frame = 0; frame < count; frame++ ) {
+					for ( long channel = 0; channel < channels; channel++ ) {
+						const size_t index = 1 + frame * channels + channel;
+						expectedApplied[ index ] = input[ index ] * ramp[ frame + 1 ];
+						expectedMixed[ index ] += input[ index ] * ramp[ frame + 1 ];
+					}
+				}
+				TEST_CHECK( test, expectedApplied == applied );
+				TEST_CHECK( test, expectedMixed == mixed );
+			}
+		}
+	} );
+
+	test.Run( "SampleKernels level search", []( Test& test ) {
+		for ( size_t count = 0; count <= s_MaxCount; count++ ) {
+			// Check each position for a single value above the level, as well as no value above the level.
+			for ( size_t position = 0; position <= count; position++ ) {
+				std::vector<float> buffer( count + 1, 0.25f );
+				if ( position < count ) {
+					buffer[ position + 1 ] = ( 0 == ( position % 2 ) ) ? 0.75f : -0.75f;
+				}
+				TEST_CHECK( test, position == FindFirstAboveLevel( buffer.data() + 1, count, 0.5f ) );
+				TEST_CHECK( test, position == FindLastAboveLevel( buffer.data() + 1, count, 0.5f ) );
+			}
+
+			// Check that the first and last of several values above the level are found.
+			if ( count >= 2 ) {
+				std::vector<float> buffer( count + 1, -0.25f );
+				const size_t first = count / 3;
+				const size_t last = count - 1 - count / 5;
+				buffer[ first + 1 ] = -1.0f;
+				buffer[ last + 1 ] = 1.0f;
+				TEST_CHECK( test, first == FindFirstAboveLevel( buffer.data() + 1, count, 0.5f ) );
+				TEST_CHECK( test, last == FindLastAboveLevel( buffer.data() + 1, count, 0.5f ) );
+			}
+
+			// Check each position for a single non-zero integer value, as well as all zero values.
+			for ( size_t position = 0; position <= count; position++ ) {
+				std::vector<int32_t> buffer( count + 1, 0 );
+				buffer[ 0 ] = 1;
+				if ( position < count ) {
+					buffer[ position + 1 ] = ( 0 == ( position % 2 ) ) ? 1 : INT32_MIN;
+				}
+				TEST_CHECK( test, position == FindFirstNonZero( buffer.data() + 1, count ) );
+				TEST_CHECK( test, position == FindLastNonZero( buffer.data() + 1, count ) );
+			}
+		}
+	} );
+
+	test.Run( "SampleKernels channel mixing", []( Test& test ) {
+		for ( const long inputChannels : { 1, 2, 5, 6, 8 } ) {
+			for ( const long outputChannels : { 1, 2, 6 } ) {
+				const std::vector<float> matrix = RandomValues( static_cast<size_t>( inputChannels ) * outputChannels, 1.0f );
+				const std::vector<float> input = RandomValues( ( s_MaxCount + 1 ) * inputChannels, 1.0f );
+				for ( size_t count = 0; count <= s_MaxCount; count++ ) {
+					std::vector<float> output( s_MaxCount * outputChannels + 1, 2.0f );
+					MixChannels( output.data() + 1, outputChannels, input.data() + 1, inputChannels, count, matrix.data() );
+					bool match = ( 2.0f == output[ 0 ] );
+					for ( size_t frame = 0; frame < s_MaxCount; frame++ ) {
+						for ( long outputChannel = 0; outputChannel < outputChannels; outputChannel++ ) {
+							float expected = 2.0f;
+							if ( frame < count ) {
+								expected = 0;
+								for ( long inputChannel = 0; inputChannel < inputChannels; inputChannel++ ) {
+									expected += input[ 1 + frame * inputChannels + inputChannel ] * matrix[ outputChannel * inputChannels + inputChannel ];
+								}
+							}
+							match = match && IsClose( output[ 1 + frame * outputChannels + outputChannel ], expected, 1e-5f );
+						}
+					}
+					TEST_CHECK( test, match );
+				}
+			}
+		}
+	} );
+
+	test.Run( "SampleKernels conversion", []( Test& test ) {
+		// Integer test values, including the extremes of each range.
+		std::vector<int32_t> values( s_MaxCount + 1 );
+		unsigned int state = 0x87654321;
+		for ( auto& value : values ) {
+			state = state * 1664525 + 1013904223;
+			value = static_cast<int32_t>( state );
+		}
+		values[ 1 ] = INT32_MIN;
+		values[ 2 ] = INT32_MAX;
+
+		std::vector<uint8_t> input8( values.size() );
+		std::vector<int16_t> input16( values.size() );
+		std::vector<uint8_t> input24( values.size() * 3 );
+		std::vector<int32_t> input20( values.size() );
+		for ( size_t index = 0; index < values.size(); index++ ) {
+			input8[ index ] = static_cast<uint8_t>( ( values[ index ] >> 24 ) + 128 );
+			input16[ index ] = static_cast<int16_t>( values[ index ] >> 16 );
+			input24[ index * 3 ] = static_cast<uint8_t>( values[ index ] >> 8 );
+			input24[ index * 3 + 1 ] = static_cast<uint8_t>( values[ index ] >> 16 );
+			input24[ index * 3 + 2 ] = static_cast<uint8_t>( values[ index ] >> 24 );
+			input20[ index ] = values[ index ] >> 12;
+		}
+
+		for ( size_t count = 0; count <= s_MaxCount; count++ ) {
+			std::vector<float> output8( s_MaxCount + 1, 2.0f );
+			std::vector<float> output16( s_MaxCount + 1, 2.0f );
+			std::vector<float> output24( s_MaxCount + 1, 2.0f );
+			std::vector<float> output32( s_MaxCount + 1, 2.0f );
+			std::vector<float> output20( s_MaxCount + 1, 2.0f );
+			ConvertUInt8ToFloat( output8.data() + 1, input8.data() + 1, count );
+			ConvertInt16ToFloat( output16.data() + 1, input16.data() + 1, count );
+			ConvertInt24ToFloat( output24.data() + 1, input24.data() + 3, count );
+			ConvertInt32ToFloat( output32.data() + 1, values.data() + 1, count, 32 );
+			ConvertInt32ToFloat( output20.data() + 1, input20.data() + 1, count, 20 );
+			bool match = true;
+			for ( size_t index = 1; index <= s_MaxCount; index++ ) {
+				const bool converted = ( index <= count );
+				match = match && ( output8[ index ] == ( converted ? ( static_cast<float>( input8[ index ] - 128 ) / 128 ) : 2.0f ) );
+				match = match && ( output16[ index ] == ( converted ? ( static_cast<float>( input16[ index ] ) / 32768 ) : 2.0f ) );
+				match = match && ( output24[ index ] == ( converted ? ( static_cast<float>( values[ index ] & ~0xff ) / 2147483648.0f ) : 2.0f ) );
+				match = match && ( output32[ index ] == ( converted ? ( static_cast<float>( values[ index ] ) / 2147483648.0f ) : 2.0f ) );
+				match = match && ( output20[ index ] == ( converted ? ( static_cast<float>( input20[ index ] ) / 524288 ) : 2.0f ) );
+			}
+			TEST_CHECK( test, match );
+			TEST_CHECK( test, 2.0f == output8[ 0 ] );
+		}
+
+		// Planar to interleaved conversion, starting part way into each channel.
+		for ( const long channels : { 1, 2, 3, 4, 5, 6, 7, 8 } ) {
+			std::vector<std::vector<int32_t>> planar( channels, std::vector<int32_t>( s_MaxCount + 1 ) );
+			std::vector<const int32_t*> planes( channels );
+			for ( long channel = 0; channel < channels; channel++ ) {
+				for ( size_t index = 0; index <= s_MaxCount; index++ ) {
+					planar[ channel ][ index ] = values[ ( index + channel ) % values.size() ] >> 8;
+				}
+				planes[ channel ] = planar[ channel ].data();
+			}
+			for ( size_t count = 0; count <= s_MaxCount; count++ ) {
+				std::vector<float> output( s_MaxCount * channels, 2.0f );
+				InterleaveInt32ToFloat( output.data(), planes.data(), 1 /*offset*/, count, channels, 24 );
+				bool match = true;
+				for ( size_t frame = 0; frame < s_MaxCount; frame++ ) {
+					for ( long channel = 0; channel < channels; channel++ ) {
+						const float expected = ( frame < count ) ? ( static_cast<float>( planar[ channel ][ frame + 1 ] ) / 8388608 ) : 2.0f;
+						match = match && ( output[ frame * channels + channel ] == expected );
+					}
+				}
+				TEST_CHECK( test, match );
+			}
+		}
+	} );
+
+	test.Run( "SampleKernels packing", []( Test& test ) {
+		// Returns the packed little endian value of 'bytesPerValue' bytes at 'data'.
+		const auto readPacked = [] ( const unsigned char* data, const long bytesPerValue )
+		{
+			uint32_t value = static_cast<uint32_t>( data[ 0 ] ) | ( static_cast<uint32_t>( data[ 1 ] ) << 8 );
+			if ( 3 == bytesPerValue ) {
+				value |= static_cast<uint32_t>( data[ 2 ] ) << 16;
+			}
+			return value;
+		};
+
+		for ( const long bytesPerValue : { 2, 3 } ) {
+			const long containerBits = bytesPerValue * 8;
+			const uint32_t mask = ( 1u << containerBits ) - 1;
+
+			// Planar and interleaved integer values, with fewer significant bits than the packed size as well as the full packed size.
+			for ( const long shift : { 0, 4 } ) {
+				const long bits = containerBits - shift;
+				for ( const long channels : { 1, 2, 3 } ) {
+					std::vector<std::vector<int32_t>> planar( channels, std::vector<int32_t>( s_MaxCount + 1 ) );
+					std::vector<const int32_t*> planes( channels );
+					unsigned int state = 0x2468ace0;
+					for ( long channel = 0; channel < channels; channel++ ) {
+						for ( auto& value : planar[ channel ] ) {
+							state = state * 1664525 + 1013904223;
+							value = static_cast<int32_t>( state ) >> ( 32 - bits );
+						}
+						planar[ channel ][ 1 ] = -( 1 << ( bits - 1 ) );
+						planar[ channel ][ 2 ] = ( 1 << ( bits - 1 ) ) - 1;
+						planes[ channel ] = planar[ channel ].data();
+					}
+					for ( size_t count = 0; count <= s_MaxCount; count++ ) {
+						std::vector<unsigned char> output( ( s_MaxCount + 1 ) * channels * bytesPerValue, 0xcd );
+						PackInt32( output.data(), planes.data(), 1 /*offset*/, count, channels, shift, bytesPerValue );
+						bool match = true;
+						for ( size_t frame = 0; frame < s_MaxCount; frame++ ) {
+							for ( long channel = 0; channel < channels; channel++ ) {
+								const unsigned char* packed = output.data() + ( frame * channels + channel ) * bytesPerValue;
+								const uint32_t expected = ( frame < count ) ? ( ( static_cast<uint32_t>( planar[ channel ][ frame + 1 ] ) << shift ) & mask ) : ( 0xcdcdcdcd & mask );
+								match = match && ( readPacked( packed, bytesPerValue ) == expected );
+							}
+						}
+						TEST_CHECK( test, match );
+					}
+				}
+			}
+
+			// Floating point values which are exact at the packed size, and values which are not.
+			const float scale = static_cast<float>( 1 << ( containerBits - 1 ) );
+			std::vector<float> input( s_MaxCount + 1 );
+			std::vector<int32_t> values( s_MaxCount + 1 );
+			unsigned int state = 0x13572468;
+			for ( size_t index = 0; index < values.size(); index++ ) {
+				state = state * 1664525 + 1013904223;
+				values[ index ] = static_cast<int32_t>( state ) >> ( 32 - containerBits );
+			}
+			values[ 1 ] = -( 1 << ( containerBits - 1 ) );
+			values[ 2 ] = ( 1 << ( containerBits - 1 ) ) - 1;
+			for ( size_t index = 0; index < values.size(); index++ ) {
+				input[ index ] = static_cast<float>( values[ index ] ) / scale;
+			}
+			for ( size_t count = 0; count <= s_MaxCount; count++ ) {
+				std::vector<unsigned char> output( s_MaxCount * bytesPerValue, 0xcd );
+				bool match = PackFloatExact( output.data(), input.data() + 1, count, bytesPerValue );
+				for ( size_t index = 0; index < s_MaxCount; index++ ) {
+					const uint32_t expected = ( index < count ) ? ( static_cast<uint32_t>( values[ index + 1 ] ) & mask ) : ( 0xcdcdcdcd & mask );
+					match = match && ( readPacked( output.data() + index * bytesPerValue, bytesPerValue ) == expected );
+				}
+				TEST_CHECK( test, match );
+			}
+			for ( size_t position = 0; position < s_MaxCount; position++ ) {
+				std::vector<unsigned char> output( s_MaxCount * bytesPerValue );
+				for ( const float inexact : { 1.0f, -1.5f, ( 0.5f + values[ position + 1 ] ) / scale } ) {
+					std::vector<float> modified = input;
+					modified[ position + 1 ] = inexact;
+					TEST_CHECK( test, !PackFloatExact( output.data(), modified.data() + 1, s_MaxCount, bytesPerValue ) );
+				}
+			}
+		}
+	} );
+}
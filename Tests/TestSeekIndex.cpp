@@ -0,0 +1,213 @@
+#include "Tests.h"
+
+#include "Decoder.h"
+#include "SeekIndex.h"
+
+#include <memory>
+#include <vector>
+
+// Sample rate of the test stream.
+static const long s_SampleRate = 44100;
+
+// Number of samples per channel in each frame of the test stream.
+static const long long s_FrameSamples = 1152;
+
+// Size of each frame of the test stream, in bytes.
+static const long long s_FrameBytes = 417;
+
+// Offset of the first frame of the test stream, in bytes.
+static const long long s_HeaderBytes = 44;
+
+// Decoder which adds a seek point at the start of each frame, at a fixed frame size.
+class FramedDecoder : public Decoder
+{
+public:
+	// 'seconds' - duration of the stream.
+	FramedDecoder( const long seconds ) :
+		Decoder(),
+		m_Position( 0 ),
+		m_Length( static_cast<long long>( seconds ) * s_SampleRate )
+	{
+		SetSampleRate( s_SampleRate );
+		SetChannels( 1 );
+		SetDuration( static_cast<float>( seconds ) );
+	}
+
+	// Returns whether the decoder can seek using a seek index.
+	bool SupportsSeekIndex() const override
+	{
+		return true;
+	}
+
+	// Returns the seek index which the decoder uses, or nullptr if there is no index.
+	SeekIndex::Ptr GetIndex() const
+	{
+		return GetSeekIndex();
+	}
+
+	// Reads the whole of the remaining stream.
+	void ReadToEnd()
+	{
+		std::vector<float> buffer( 1000 );
+		while ( Read( buffer.data(), static_cast<long>( buffer.size() ) ) > 0 ) {}
+	}
+
+	// Returns the offset of the frame which starts at 'sample', in bytes.
+	static long long GetFrameOffset( const long long sample )
+	{
+		return s_HeaderBytes + sample / s_FrameSamples * s_FrameBytes;
+	}
+
+protected:
+	// Reads sample data.
+	// 'buffer' - output buffer.
+	// 'sampleCount' - number of samples to read.
+	// Returns the number of samples read, or zero if the stream has ended.
+	long ReadSamples( float* buffer, const long sampleCount ) override
+	{
+		long samplesRead = 0;
+		for ( ; ( samplesRead < sampleCount ) && ( m_Position < m_Length ); samplesRead++, m_Position++ ) {
+			if ( 0 == ( m_Position % s_FrameSamples ) ) {
+				AddSeekPoint( m_Position, GetFrameOffset( m_Position ) );
+			}
+			buffer[ samplesRead ] = 0;
+		}
+		return samplesRead;
+	}
+
+	// Seeks to a 'position' in the stream, in seconds.
+	// Returns the new position in seconds.
+	float SeekTo( const float position ) override
+	{
+		m_Position = static_cast<long long>( position * s_SampleRate );
+		return position;
+	}
+
+private:
+	// Current position, in samples.
+	long long m_Position;
+
+	// Stream length, in samples.
+	long long m_Length;
+};
+
+// Returns whether two seek indices contain the same seek points.
+static bool IsEqual( const SeekIndex& a, const SeekIndex& b )
+{
+	bool equal = ( a.GetPoints().size() == b.GetPoints().size() );
+	for ( size_t n = 0; equal && ( n < a.GetPoints().size() ); n++ ) {
+		equal = ( a.GetPoints()[ n ].Sample == b.GetPoints()[ n ].Sample ) && ( a.GetPoints()[ n ].Offset == b.GetPoints()[ n ].Offset );
+	}
+	return equal;
+}
+
+void TestSeekIndex( Test& test )
+{
+	test.Run( "SeekIndex points", []( Test& test ) {
+		SeekIndex index( 1000 );
+		TEST_CHECK( test, index.IsEmpty() );
+		TEST_CHECK( test, !index.Find( 0 ).has_value() );
+
+		// Seek points closer than the interval to the last one, or which do not move forward in the file, are ignored.
+		index.Add( 0, 100 );
+		index.Add( 999, 200 );
+		index.Add( 1000, 100 );
+		index.Add( 1500, 300 );
+		index.Add( 2600, 400 );
+		index.Add( -1, 500 );
+		TEST_CHECK( test, 3 == index.GetPoints().size() );
+		TEST_CHECK( test, !index.Find( -1 ).has_value() );
+		TEST_CHECK( test, index.Find( 0 ).has_value() && ( 0 == index.Find( 0 )->Sample ) );
+		TEST_CHECK( test, index.Find( 1499 ).has_value() && ( 0 == index.Find( 1499 )->Sample ) );
+		TEST_CHECK( test, index.Find( 1500 ).has_value() && ( 300 == index.Find( 1500 )->Offset ) );
+		TEST_CHECK( test, index.Find( 1000000 ).has_value() && ( 2600 == index.Find( 1000000 )->Sample ) );
+	} );
+
+	test.Run( "SeekIndex serialisation", []( Test& test ) {
+		// Large positions and offsets use the longer variable length encodings.
+		SeekIndex index( 44100 );
+		for ( long long n = 0; n < 200; n++ ) {
+			index.Add( n * n * 44100, n * n * n * 1000003 );
+		}
+		const std::vector<unsigned char> data = index.Serialise();
+		const SeekIndex::Ptr restored = SeekIndex::Deserialise( data );
+		TEST_CHECK( test, restored && IsEqual( index, *restored ) );
+		TEST_CHECK( test, restored && ( restored->Serialise() == data ) );
+
+		const SeekIndex::Ptr empty = SeekIndex::Deserialise( SeekIndex( 44100 ).Serialise() );
+		TEST_CHECK( test, empty && empty->IsEmpty() );
+
+		// Truncated data, trailing data and an unknown version are all rejected.
+		bool truncatedRejected = true;
+		for ( size_t size = 0; size < data.size(); size++ ) {
+			truncatedRejected = truncatedRejected && !SeekIndex::Deserialise( std::vector<unsigned char>( data.begin(), data.begin() + size ) );
+		}
+		TEST_CHECK( test, truncatedRejected );
+		std::vector<unsigned char> trailing = data;
+		trailing.push_back( 0 );
+		TEST_CHECK( test, !SeekIndex::Deserialise( trailing ) );
+		std::vector<unsigned char> version = data;
+		version.front()++;
+		TEST_CHECK( test, !SeekIndex::Deserialise( version ) );
+		TEST_CHECK( test, !SeekIndex::Deserialise( { 1, 5, 200 } ) );
+	} );
+
+	test.Run( "Decoder seek index build", []( Test& test ) {
+		// Decoding the whole stream from the start builds an index, which is passed on once and then used by the decoder.
+		FramedDecoder decoder( 10 );
+		int builtCount = 0;
+		SeekIndex::Ptr built;
+		decoder.SetSeekIndex( nullptr, [ &builtCount, &built ] ( const SeekIndex& index )
+		{
+			++builtCount;
+			built = SeekIndex::Deserialise( index.Serialise() );
+		} );
+		decoder.ReadToEnd();
+		decoder.ReadToEnd();
+		TEST_CHECK( test, 1 == builtCount );
+		TEST_CHECK( test, built && !built->IsEmpty() );
+		TEST_CHECK( test, built && decoder.GetIndex() && IsEqual( *built, *decoder.GetIndex() ) );
+
+		bool pointsValid = built && ( 0 == built->GetPoints().front().Sample );
+		for ( size_t n = 0; pointsValid && ( n < built->GetPoints().size() ); n++ ) {
+			const SeekIndex::Point& point = built->GetPoints()[ n ];
+			pointsValid = ( 0 == ( point.Sample % s_FrameSamples ) ) && ( FramedDecoder::GetFrameOffset( point.Sample ) == point.Offset );
+			if ( pointsValid && ( n > 0 ) ) {
+				pointsValid = ( point.Sample - built->GetPoints()[ n - 1 ].Sample ) >= s_SampleRate;
+			}
+		}
+		TEST_CHECK( test, pointsValid );
+	} );
+
+	test.Run( "Decoder seek index abandon", []( Test& test ) {
+		// Seeking part way into the stream abandons the index being built, and seeking back to the start begins a new one.
+		FramedDecoder decoder( 5 );
+		int builtCount = 0;
+		decoder.SetSeekIndex( nullptr, [ &builtCount ] ( const SeekIndex& ) { ++builtCount; } );
+		std::vector<float> buffer( 1000 );
+		decoder.Read( buffer.data(), static_cast<long>( buffer.size() ) );
+		decoder.Seek( 2.0f );
+		decoder.ReadToEnd();
+		TEST_CHECK( test, 0 == builtCount );
+		TEST_CHECK( test, !decoder.GetIndex() );
+
+		decoder.Seek( 0 );
+		decoder.ReadToEnd();
+		TEST_CHECK( test, 1 == builtCount );
+		TEST_CHECK( test, decoder.GetIndex() && !decoder.GetIndex()->IsEmpty() );
+
+		// An index is not rebuilt when the stream already has one.
+		FramedDecoder indexed( 5 );
+		int rebuiltCount = 0;
+		indexed.SetSeekIndex( decoder.GetIndex(), [ &rebuiltCount ] ( const SeekIndex& ) { ++rebuiltCount; } );
+		indexed.ReadToEnd();
+		TEST_CHECK( test, 0 == rebuiltCount );
+		TEST_CHECK( test, indexed.GetIndex() == decoder.GetIndex() );
+
+		// Nor is an index built when there is no callback to receive it.
+		FramedDecoder unindexed( 5 );
+		unindexed.SetSeekIndex( nullptr, nullptr );
+		unindexed.ReadToEnd();
+		TEST_CHECK( test, !unindexed.GetIndex() );
+	} );
+}
@@ -0,0 +1,194 @@
+#include "Tests.h"
+
+#include "TrackAnalysis.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+// Sample rate of the test signal.
+static const long s_SampleRate = 44100;
+
+// Number of channels in the test signal (an odd number, so that one channel is filtered outside of the SIMD lanes).
+static const long s_Channels = 3;
+
+// Number of significant bits in each value of the test signal.
+static const long s_BitsPerSample = 24;
+
+// Length of the test signal, in samples per channel.
+static const long s_SampleCount = s_SampleRate * 8;
+
+// Maximum number of samples per channel in each frame view (which is deliberately not a divisor of the analysis block size).
+static const long s_FrameSize = 1152;
+
+// Layout of the frame views returned by the test decoder.
+enum class Layout {
+	// Interleaved floating point values (the default frame view).
+	InterleavedFloat,
+	// Interleaved integer values.
+	InterleavedInt32,
+	// Planar integer values.
+	PlanarInt32,
+	// Planar floating point values.
+	PlanarFloat
+};
+
+// Returns a test signal of right justified integer values, with channels of pseudo-random noise which start and end at different positions.
+// 'firstSound' - out, the position of the first non-silent sample.
+// 'lastSound' - out, the position of the last non-silent sample.
+static std::vector<int32_t> GenerateSignal( long& firstSound, long& lastSound )
+{
+	std::vector<int32_t> signal( static_cast<size_t>( s_SampleCount ) * s_Channels );
+	const std::vector<long> starts = { 12345, 20000, 10001 };
+	const std::vector<long> ends = { s_SampleCount - 30000, s_SampleCount - 8193, s_SampleCount - 40000 };
+	const int32_t maximum = ( 1 << ( s_BitsPerSample - 1 ) ) - 1;
+	unsigned int state = 0x13579bdf;
+	for ( long sample = 0; sample < s_SampleCount; sample++ ) {
+		for ( long channel = 0; channel < s_Channels; channel++ ) {
+			state = state * 1664525 + 1013904223;
+			if ( ( sample >= starts[ channel ] ) && ( sample <= ends[ channel ] ) ) {
+				// Odd values are never zero, so that every sample between the start and end of the channel is non-silent.
+				const int32_t value = ( static_cast<int32_t>( state >> 8 ) % ( maximum / ( 1 + channel ) ) ) | 1;
+				signal[ static_cast<size_t>( sample ) * s_Channels + channel ] = ( 0 == ( state & 0x80 ) ) ? value : -value;
+			}
+		}
+	}
+	firstSound = *std::min_element( starts.begin(), starts.end() );
+	lastSound = *std::max_element( ends.begin(), ends.end() );
+	return signal;
+}
+
+// Decoder which returns a test signal as frame views of a particular layout.
+class FrameDecoder : public Decoder
+{
+public:
+	// 'signal' - interleaved, right justified, integer values.
+	// 'layout' - frame view layout.
+	FrameDecoder( const std::vector<int32_t>& signal, const Layout layout ) :
+		Decoder(),
+		m_Signal( signal ),
+		m_Layout( layout ),
+		m_Position( 0 ),
+		m_IntBuffer(),
+		m_FloatBuffer()
+	{
+		SetSampleRate( s_SampleRate );
+		SetChannels( s_Channels );
+		SetBPS( s_BitsPerSample );
+		SetDuration( static_cast<float>( s_SampleCount ) / s_SampleRate );
+	}
+
+protected:
+	// Reads sample data.
+	// 'buffer' - output buffer.
+	// 'sampleCount' - number of samples to read.
+	// Returns the number of samples read, or zero if the stream has ended.
+	long ReadSamples( float* buffer, const long sampleCount ) override
+	{
+		const long samplesRead = std::min( sampleCount, s_SampleCount - m_Position );
+		const int32_t* input = m_Signal.data() + static_cast<size_t>( m_Position ) * s_Channels;
+		for ( long index = 0; index < samplesRead * s_Channels; index++ ) {
+			buffer[ index ] = static_cast<float>( input[ index ] ) / ( 1 << ( s_BitsPerSample - 1 ) );
+		}
+		m_Position += samplesRead;
+		return samplesRead;
+	}
+
+	// Reads the next block of sample data as a frame view of the decoder layout.
+	// 'view' - out, the frame view.
+	// 'maximumSamples' - maximum number of samples per channel to return in the view.
+	// Returns the number of samples per channel in the view, or zero if the stream has ended.
+	long ReadFrameView( FrameView& view, const long maximumSamples ) override
+	{
+		long samplesRead = 0;
+		if ( Layout::InterleavedFloat == m_Layout ) {
+			samplesRead = Decoder::ReadFrameView( view, maximumSamples );
+		} else {
+			const long sampleCount = std::min( std::min( maximumSamples, s_FrameSize ), s_SampleCount - m_Position );
+			m_FloatBuffer.resize( static_cast<size_t>( s_FrameSize ) * s_Channels );
+			m_IntBuffer.resize( static_cast<size_t>( s_FrameSize ) * s_Channels );
+			if ( Layout::InterleavedInt32 == m_Layout ) {
+				std::copy_n( m_Signal.data() + static_cast<size_t>( m_Position ) * s_Channels, sampleCount * s_Channels, m_IntBuffer.data() );
+				view.Planes[ 0 ] = m_IntBuffer.data();
+			} else {
+				view.Planar = true;
+				for ( long channel = 0; channel < s_Channels; channel++ ) {
+					int32_t* intPlane = m_IntBuffer.data() + channel * s_FrameSize;
+					float* floatPlane = m_FloatBuffer.data() + channel * s_FrameSize;
+					for ( long sample = 0; sample < sampleCount; sample++ ) {
+						intPlane[ sample ] = m_Signal[ static_cast<size_t>( m_Position + sample ) * s_Channels + channel ];
+						floatPlane[ sample ] = static_cast<float>( intPlane[ sample ] ) / ( 1 << ( s_BitsPerSample - 1 ) );
+					}
+					view.Planes[ channel ] = ( Layout::PlanarInt32 == m_Layout ) ? static_cast<const void*>( intPlane ) : static_cast<const void*>( floatPlane );
+				}
+			}
+			if ( Layout::PlanarFloat != m_Layout ) {
+				view.DataType = FrameView::Type::Int32;
+				view.BitsPerSample = s_BitsPerSample;
+			}
+			m_Position += sampleCount;
+			samplesRead = sampleCount;
+		}
+		return samplesRead;
+	}
+
+	// Seeks to a 'position' in the stream, in seconds.
+	// Returns the new position in seconds.
+	float SeekTo( const float position ) override
+	{
+		m_Position = std::min( s_SampleCount, static_cast<long>( position * s_SampleRate ) );
+		return static_cast<float>( m_Position ) / s_SampleRate;
+	}
+
+private:
+	// Interleaved, right justified, integer values.
+	const std::vector<int32_t>& m_Signal;
+
+	// Frame view layout.
+	const Layout m_Layout;
+
+	// Current position, in samples per channel.
+	long m_Position;
+
+	// Integer sample data referred to by frame views.
+	std::vector<int32_t> m_IntBuffer;
+
+	// Floating point sample data referred to by planar frame views.
+	std::vector<float> m_FloatBuffer;
+};
+
+// Analyses the 'signal', returned by a decoder as frame views of a 'layout'.
+// 'result' - out, the analysis results.
+// Returns whether the analysis completed.
+static bool Analyse( const std::vector<int32_t>& signal, const Layout layout, TrackAnalysis::Result& result )
+{
+	TrackAnalysis analysis( std::make_shared<FrameDecoder>( signal, layout ) );
+	const bool completed = analysis.Analyse( [] () { return true; } );
+	result = analysis.GetResult();
+	return completed;
+}
+
+void TestTrackAnalysis( Test& test )
+{
+	test.Run( "TrackAnalysis frame view layouts", []( Test& test ) {
+		// Native integer and planar sample data are analysed without first being converted, which must give identical results to analysing interleaved floating point data.
+		long firstSound = 0;
+		long lastSound = 0;
+		const std::vector<int32_t> signal = GenerateSignal( firstSound, lastSound );
+		TrackAnalysis::Result expected;
+		TEST_CHECK( test, Analyse( signal, Layout::InterleavedFloat, expected ) );
+		TEST_CHECK( test, expected.Gain.has_value() && expected.TruePeak.has_value() && expected.CrossfadePosition.has_value() );
+		TEST_CHECK( test, expected.LeadingSilence == static_cast<float>( firstSound ) / s_SampleRate );
+		TEST_CHECK( test, expected.TrailingSilence == static_cast<float>( s_SampleCount - lastSound - 1 ) / s_SampleRate );
+
+		for ( const Layout layout : { Layout::InterleavedInt32, Layout::PlanarInt32, Layout::PlanarFloat } ) {
+			TrackAnalysis::Result result;
+			TEST_CHECK( test, Analyse( signal, layout, result ) );
+			TEST_CHECK( test, result.Gain == expected.Gain );
+			TEST_CHECK( test, result.TruePeak == expected.TruePeak );
+			TEST_CHECK( test, result.LeadingSilence == expected.LeadingSilence );
+			TEST_CHECK( test, result.TrailingSilence == expected.TrailingSilence );
+			TEST_CHECK( test, result.CrossfadePosition == expected.CrossfadePosition );
+		}
+	} );
+}
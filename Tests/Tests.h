@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Test.h"
+
+// Channel mixing tests.
+void TestDecoderMixer( Test& test );
+
+// Sample rate conversion tests.
+void TestDecoderResampler( Test& test );
+
+// Limiter tests.
+void TestLimiter( Test& test );
+
+// Loudness measurement tests.
+void TestLoudness( Test& test );
+
+// Audio output tests.
+void TestOutput( Test& test );
+
+// Ring buffer tests.
+void TestRingBuffer( Test& test );
+
+// Sample kernel tests.
+void TestSampleKernels( Test& test );
+
+// Seek index tests.
+void TestSeekIndex( Test& test );
+
+// Track analysis tests.
+void TestTrackAnalysis( Test& test );
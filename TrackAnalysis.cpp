@@ -0,0 +1,336 @@
+#include "TrackAnalysis.h"
+
+#include "SampleKernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Number of samples to decode at a time.
+static const long s_BlockSize = 4096;
+
+// The relative volume at which to set the crossfade position on a track.
+static const double s_CrossfadeVolume = 0.3;
+
+// The length of the end portion of a track which is analysed to find the crossfade position, in seconds.
+static const float s_CrossfadeAnalysisLength = 60.0f;
+
+// Minimum segment length when analysing a track in parallel, in seconds (must exceed the crossfade analysis length, so that the end portion of the track lies within the last segment).
+static const float s_MinimumSegmentLength = 300.0f;
+
+// Returns the index of the first of the 'count' values in 'buffer', of 'type', which is not silent, or 'count' if there is no such value.
+static size_t FindFirstSound( const void* buffer, const Decoder::FrameView::Type type, const size_t count )
+{
+	return ( Decoder::FrameView::Type::Int32 == type ) ? FindFirstNonZero( static_cast<const int32_t*>( buffer ), count ) : FindFirstAboveLevel( static_cast<const float*>( buffer ), count, 0 /*level*/ );
+}
+
+// Returns the index of the last of the 'count' values in 'buffer', of 'type', which is not silent, or 'count' if there is no such value.
+static size_t FindLastSound( const void* buffer, const Decoder::FrameView::Type type, const size_t count )
+{
+	return ( Decoder::FrameView::Type::Int32 == type ) ? FindLastNonZero( static_cast<const int32_t*>( buffer ), count ) : FindLastAboveLevel( static_cast<const float*>( buffer ), count, 0 /*level*/ );
+}
+
+TrackAnalysis::TrackAnalysis( const Decoder::Ptr decoder, const bool crossfadeOnly ) :
+	m_Decoder( decoder ),
+	m_CrossfadeOnly( crossfadeOnly ),
+	m_Channels( decoder ? decoder->GetChannels() : 0 ),
+	m_SampleRate( decoder ? decoder->GetSampleRate() : 0 ),
+	m_OpenDecoder(),
+	m_RunTasks(),
+	m_MaximumSegments( 1 ),
+	m_Segments(),
+	m_Result(),
+	m_CrossfadeStart( 0 ),
+	m_CrossfadeWindowLength( std::max( 1l, m_SampleRate / 10 ) ),
+	m_WindowCount( 0 ),
+	m_WindowTotal( 0 ),
+	m_CumulativeCount( 0 ),
+	m_CumulativeTotal( 0 ),
+	m_CrossfadePosition( 0 )
+{
+}
+
+TrackAnalysis::~TrackAnalysis()
+{
+	for ( auto& segment : m_Segments ) {
+		if ( nullptr != segment.LoudnessState ) {
+			ebur128_destroy( &segment.LoudnessState );
+		}
+	}
+}
+
+void TrackAnalysis::EnableParallel( OpenDecoder openDecoder, RunTasks runTasks, const size_t maximumSegments )
+{
+	m_OpenDecoder = openDecoder;
+	m_RunTasks = runTasks;
+	m_MaximumSegments = std::max( size_t( 1 ), maximumSegments );
+}
+
+bool TrackAnalysis::Analyse( Decoder::CanContinue canContinue )
+{
+	bool completed = false;
+	if ( m_Decoder && ( m_Channels > 0 ) && ( m_SampleRate > 0 ) && ( nullptr != canContinue ) ) {
+		// Only the end portion of the track is analysed for the crossfade position, to find the last point at which the track is still reasonably loud.
+		const float duration = m_Decoder->GetDuration();
+		const float crossfadeStart = ( duration > s_CrossfadeAnalysisLength ) ? ( duration - s_CrossfadeAnalysisLength ) : 0;
+		if ( m_CrossfadeOnly ) {
+			Segment segment;
+			segment.Stream = m_Decoder;
+			if ( crossfadeStart > 0 ) {
+				segment.Position = static_cast<long long>( m_Decoder->Seek( crossfadeStart ) * m_SampleRate );
+			}
+			m_CrossfadeStart = segment.Position;
+			m_Segments.push_back( segment );
+		} else {
+			m_CrossfadeStart = static_cast<long long>( crossfadeStart * m_SampleRate );
+			CreateSegments( duration );
+		}
+		m_Decoder.reset();
+
+		if ( m_Segments.size() > 1 ) {
+			std::vector<std::function<void()>> tasks;
+			for ( size_t index = 0; index < m_Segments.size(); index++ ) {
+				tasks.push_back( [ this, index, canContinue ] ()
+				{
+					AnalyseSegment( m_Segments[ index ], ( index + 1 ) == m_Segments.size(), canContinue );
+				} );
+			}
+			m_RunTasks( tasks );
+		} else if ( !m_Segments.empty() ) {
+			AnalyseSegment( m_Segments.front(), true /*analyseCrossfade*/, canContinue );
+		}
+
+		completed = !m_Segments.empty() && std::all_of( m_Segments.begin(), m_Segments.end(), [] ( const Segment& segment ) { return segment.Completed; } );
+		if ( completed ) {
+			CalculateResult();
+		}
+	}
+	m_Decoder.reset();
+	return completed;
+}
+
+const TrackAnalysis::Result& TrackAnalysis::GetResult() const
+{
+	return m_Result;
+}
+
+void TrackAnalysis::UpdateMediaInfo( MediaInfo& mediaInfo ) const
+{
+	if ( m_Result.Gain.has_value() ) {
+		mediaInfo.SetGainTrack( m_Result.Gain );
+	}
+	if ( m_Result.TruePeak.has_value() ) {
+		mediaInfo.SetTruePeak( m_Result.TruePeak );
+	}
+	if ( m_Result.LeadingSilence.has_value() ) {
+		mediaInfo.SetLeadingSilence( m_Result.LeadingSilence );
+	}
+	if ( m_Result.TrailingSilence.has_value() ) {
+		mediaInfo.SetTrailingSilence( m_Result.TrailingSilence );
+	}
+	if ( m_Result.CrossfadePosition.has_value() ) {
+		mediaInfo.SetCrossfadePosition( m_Result.CrossfadePosition );
+	}
+}
+
+std::vector<ebur128_state*> TrackAnalysis::GetLoudnessStates() const
+{
+	std::vector<ebur128_state*> states;
+	for ( const auto& segment : m_Segments ) {
+		if ( nullptr != segment.LoudnessState ) {
+			states.push_back( segment.LoudnessState );
+		}
+	}
+	return states;
+}
+
+double TrackAnalysis::GetDecodeSeconds() const
+{
+	std::chrono::steady_clock::duration decodeTime = {};
+	for ( const auto& segment : m_Segments ) {
+		decodeTime += segment.DecodeTime;
+	}
+	return std::chrono::duration<double>( decodeTime ).count();
+}
+
+void TrackAnalysis::CreateSegments( const float duration )
+{
+	Segment firstSegment;
+	firstSegment.Stream = m_Decoder;
+	m_Segments.push_back( firstSegment );
+
+	// Additional decoders are positioned at evenly spaced points in the track, with each segment ending where the next one starts.
+	const size_t segmentCount = ( m_OpenDecoder && m_RunTasks ) ? std::min( m_MaximumSegments, static_cast<size_t>( duration / s_MinimumSegmentLength ) ) : 1;
+	for ( size_t index = 1; index < segmentCount; index++ ) {
+		const Decoder::Ptr decoder = m_OpenDecoder();
+		if ( !decoder || ( decoder->GetChannels() != m_Channels ) || ( decoder->GetSampleRate() != m_SampleRate ) ) {
+			break;
+		}
+		Segment segment;
+		segment.Stream = decoder;
+		segment.Position = static_cast<long long>( decoder->Seek( duration * index / segmentCount ) * m_SampleRate );
+		if ( segment.Position <= m_Segments.back().Position ) {
+			break;
+		}
+		m_Segments.back().End = segment.Position;
+		m_Segments.push_back( segment );
+	}
+
+	for ( auto& segment : m_Segments ) {
+		segment.LoudnessState = ebur128_init( static_cast<unsigned int>( m_Channels ), static_cast<unsigned long>( m_SampleRate ), EBUR128_MODE_I | EBUR128_MODE_TRUE_PEAK );
+		if ( nullptr == segment.LoudnessState ) {
+			m_Segments.clear();
+			break;
+		}
+	}
+}
+
+void TrackAnalysis::AnalyseSegment( Segment& segment, const bool analyseCrossfade, Decoder::CanContinue canContinue )
+{
+	std::vector<float> buffer( s_BlockSize * m_Channels );
+	bool continueAnalysis = canContinue();
+	while ( continueAnalysis ) {
+		const long samplesToRead = ( segment.End < 0 ) ? s_BlockSize : static_cast<long>( std::min<long long>( s_BlockSize, segment.End - segment.Position ) );
+		const auto decodeStart = std::chrono::steady_clock::now();
+		Decoder::FrameView view;
+		const long sampleCount = ( samplesToRead > 0 ) ? segment.Stream->ReadFrame( view, samplesToRead ) : 0;
+		segment.DecodeTime += std::chrono::steady_clock::now() - decodeStart;
+		if ( sampleCount > 0 ) {
+			// The loudness and silence analysers work on the native sample data where they can, so it is only converted where it has to be.
+			if ( nullptr != segment.LoudnessState ) {
+				continueAnalysis = AddLoudnessFrames( segment.LoudnessState, view, buffer );
+			}
+			if ( !m_CrossfadeOnly ) {
+				AnalyseSilence( segment, view );
+			}
+			if ( analyseCrossfade && ( ( segment.Position + sampleCount ) > m_CrossfadeStart ) ) {
+				AnalyseCrossfade( view.GetInterleavedFloat( buffer ), sampleCount, segment.Position );
+			}
+			segment.Position += sampleCount;
+			continueAnalysis = continueAnalysis && canContinue();
+		} else {
+			segment.Completed = true;
+			continueAnalysis = false;
+		}
+	}
+	segment.Stream.reset();
+}
+
+bool TrackAnalysis::AddLoudnessFrames( ebur128_state* state, const Decoder::FrameView& view, std::vector<float>& buffer )
+{
+	bool added = false;
+	if ( ( nullptr != state ) && ( view.SampleCount > 0 ) ) {
+		const size_t frames = static_cast<size_t>( view.SampleCount );
+		if ( !view.Planar && ( Decoder::FrameView::Type::Int32 == view.DataType ) && ( EBUR128_ERROR_INVALID_MODE != ebur128_set_int_bits( state, static_cast<unsigned int>( view.BitsPerSample ) ) ) ) {
+			// Measuring the integer values gives identical results to measuring the converted values, for up to 24 significant bits.
+			added = ( EBUR128_SUCCESS == ebur128_add_frames_int( state, static_cast<const int*>( view.Planes[ 0 ] ), frames ) );
+		} else if ( const float* samples = view.GetInterleavedFloat( buffer ); nullptr != samples ) {
+			added = ( EBUR128_SUCCESS == ebur128_add_frames_float( state, samples, frames ) );
+		}
+	}
+	return added;
+}
+
+void TrackAnalysis::AnalyseSilence( Segment& segment, const Decoder::FrameView& view )
+{
+	// Each plane of planar sample data is searched separately, with the first and last sound taken over all channels.
+	const long planes = view.Planar ? view.Channels : 1;
+	const long valuesPerSample = view.Planar ? 1 : view.Channels;
+	const size_t valueCount = static_cast<size_t>( view.SampleCount * valuesPerSample );
+	long long firstSound = -1;
+	long long lastSound = -1;
+	for ( long plane = 0; plane < planes; plane++ ) {
+		const size_t lastIndex = FindLastSound( view.Planes[ plane ], view.DataType, valueCount );
+		if ( lastIndex < valueCount ) {
+			lastSound = std::max( lastSound, static_cast<long long>( lastIndex / valuesPerSample ) );
+			if ( segment.FirstSound < 0 ) {
+				const long long firstIndex = static_cast<long long>( FindFirstSound( view.Planes[ plane ], view.DataType, valueCount ) / valuesPerSample );
+				firstSound = ( firstSound < 0 ) ? firstIndex : std::min( firstSound, firstIndex );
+			}
+		}
+	}
+	if ( lastSound >= 0 ) {
+		segment.LastSound = segment.Position + lastSound;
+		if ( segment.FirstSound < 0 ) {
+			segment.FirstSound = segment.Position + firstSound;
+		}
+	}
+}
+
+void TrackAnalysis::AnalyseCrossfade( const float* buffer, const long sampleCount, const long long position )
+{
+	if ( ( position + sampleCount ) > m_CrossfadeStart ) {
+		long offset = static_cast<long>( std::max( 0ll, m_CrossfadeStart - position ) );
+		while ( offset < sampleCount ) {
+			const long count = std::min( sampleCount - offset, m_CrossfadeWindowLength - m_WindowCount );
+			const float* value = buffer + offset * m_Channels;
+			const float* end = value + count * m_Channels;
+			double total = 0;
+			for ( ; value < end; value++ ) {
+				total += *value * *value;
+			}
+			m_WindowTotal += total;
+			m_CumulativeTotal += total;
+			m_WindowCount += count;
+			m_CumulativeCount += count * m_Channels;
+			offset += count;
+			if ( m_WindowCount >= m_CrossfadeWindowLength ) {
+				EndCrossfadeWindow( position + offset );
+			}
+		}
+	}
+}
+
+void TrackAnalysis::EndCrossfadeWindow( const long long position )
+{
+	if ( ( m_WindowCount > 0 ) && ( m_CumulativeCount > 0 ) ) {
+		const double windowRMS = std::sqrt( m_WindowTotal / ( m_WindowCount * m_Channels ) );
+		const double cumulativeRMS = std::sqrt( m_CumulativeTotal / m_CumulativeCount );
+		if ( windowRMS > cumulativeRMS ) {
+			m_CrossfadePosition = position;
+		} else if ( ( cumulativeRMS > 0 ) && ( ( windowRMS / cumulativeRMS ) > s_CrossfadeVolume ) ) {
+			m_CrossfadePosition = position;
+		}
+	}
+	m_WindowCount = 0;
+	m_WindowTotal = 0;
+}
+
+void TrackAnalysis::CalculateResult()
+{
+	std::vector<ebur128_state*> states = GetLoudnessStates();
+	if ( !states.empty() ) {
+		double loudness = 0;
+		if ( ( EBUR128_SUCCESS == ebur128_loudness_global_multiple( states.data(), states.size(), &loudness ) ) && std::isfinite( loudness ) ) {
+			m_Result.Gain = LOUDNESS_REFERENCE - static_cast<float>( loudness );
+		}
+
+		double peak = 0;
+		for ( const auto& state : states ) {
+			for ( unsigned int channel = 0; channel < static_cast<unsigned int>( m_Channels ); channel++ ) {
+				double channelPeak = 0;
+				if ( EBUR128_SUCCESS == ebur128_true_peak( state, channel, &channelPeak ) ) {
+					peak = std::max( peak, channelPeak );
+				}
+			}
+		}
+		if ( peak > 0 ) {
+			m_Result.TruePeak = static_cast<float>( 20 * std::log10( peak ) );
+		}
+	}
+
+	const long long endPosition = m_Segments.back().Position;
+	if ( !m_CrossfadeOnly ) {
+		const auto firstSegment = std::find_if( m_Segments.begin(), m_Segments.end(), [] ( const Segment& segment ) { return segment.FirstSound >= 0; } );
+		const auto lastSegment = std::find_if( m_Segments.rbegin(), m_Segments.rend(), [] ( const Segment& segment ) { return segment.LastSound >= 0; } );
+		if ( ( m_Segments.end() != firstSegment ) && ( m_Segments.rend() != lastSegment ) ) {
+			m_Result.LeadingSilence = static_cast<float>( firstSegment->FirstSound ) / m_SampleRate;
+			m_Result.TrailingSilence = static_cast<float>( endPosition - lastSegment->LastSound - 1 ) / m_SampleRate;
+		} else {
+			m_Result.LeadingSilence = static_cast<float>( endPosition ) / m_SampleRate;
+			m_Result.TrailingSilence = 0.0f;
+		}
+	}
+
+	EndCrossfadeWindow( endPosition );
+	m_Result.CrossfadePosition = static_cast<float>( m_CrossfadePosition ) / m_SampleRate;
+}
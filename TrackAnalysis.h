@@ -0,0 +1,171 @@
+#pragma once
+
+#include "Decoder.h"
+#include "MediaInfo.h"
+
+#include "ebur128.h"
+
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <vector>
+
+// Analyses a track in a single decoding pass, feeding each block of sample data to the loudness, true peak, silence and crossfade analysers.
+// Long tracks can optionally be divided into segments which are decoded and analysed in parallel.
+class TrackAnalysis
+{
+public:
+	// 'decoder' - decoder from which to read the track (positioned at the start of the track).
+	// 'crossfadeOnly' - true to only calculate the crossfade position, which only requires the end portion of the track to be decoded.
+	TrackAnalysis( const Decoder::Ptr decoder, const bool crossfadeOnly = false );
+
+	virtual ~TrackAnalysis();
+
+	// A callback which opens a new decoder for the track, returning nullptr if the decoder could not be opened.
+	using OpenDecoder = std::function<Decoder::Ptr()>;
+
+	// A callback which runs 'tasks' (possibly concurrently), returning once all of the tasks have completed.
+	using RunTasks = std::function<void( const std::vector<std::function<void()>>& tasks )>;
+
+	// Analysis results.
+	struct Result {
+		// Track gain, in dB.
+		std::optional<float> Gain;
+
+		// True peak level, in dBTP.
+		std::optional<float> TruePeak;
+
+		// Duration of silence at the start of the track, in seconds.
+		std::optional<float> LeadingSilence;
+
+		// Duration of silence at the end of the track, in seconds.
+		std::optional<float> TrailingSilence;
+
+		// Crossfade position, in seconds from the start of the track.
+		std::optional<float> CrossfadePosition;
+	};
+
+	// Enables parallel analysis, where a long track is divided into segments that are decoded concurrently (the track must be seekable).
+	// 'openDecoder' - callback which opens a decoder for each additional segment.
+	// 'runTasks' - callback which runs the segment analysis tasks.
+	// 'maximumSegments' - maximum number of segments into which the track is divided.
+	void EnableParallel( OpenDecoder openDecoder, RunTasks runTasks, const size_t maximumSegments );
+
+	// Analyses the track, releasing the decoder(s) when done.
+	// 'canContinue' - callback which returns whether the analysis can continue.
+	// Returns whether the analysis completed.
+	bool Analyse( Decoder::CanContinue canContinue );
+
+	// Returns the analysis results.
+	const Result& GetResult() const;
+
+	// Updates 'mediaInfo' with the analysis results.
+	void UpdateMediaInfo( MediaInfo& mediaInfo ) const;
+
+	// Returns the loudness measurement states (one for each segment of the track), for calculating album gain.
+	std::vector<ebur128_state*> GetLoudnessStates() const;
+
+	// Returns the time spent reading from the decoder(s), in seconds (summed over all segments).
+	double GetDecodeSeconds() const;
+
+	// Adds the sample data in a 'view' to a loudness measurement 'state', measuring interleaved integer sample data natively.
+	// 'buffer' - buffer into which any other sample data is converted to interleaved floating point values.
+	// Returns whether the sample data was added.
+	static bool AddLoudnessFrames( ebur128_state* state, const Decoder::FrameView& view, std::vector<float>& buffer );
+
+private:
+	// A segment of the track, which is decoded and analysed independently.
+	struct Segment {
+		// Decoder, positioned at the start of the segment.
+		Decoder::Ptr Stream;
+
+		// Loudness measurement state.
+		ebur128_state* LoudnessState = nullptr;
+
+		// Position of the next sample to be analysed, in samples from the start of the track.
+		long long Position = 0;
+
+		// Position at which the segment ends, in samples from the start of the track (or -1 if the segment continues to the end of the track).
+		long long End = -1;
+
+		// Position of the first non-silent sample, or -1 if none has been found.
+		long long FirstSound = -1;
+
+		// Position of the last non-silent sample, or -1 if none has been found.
+		long long LastSound = -1;
+
+		// Indicates whether the whole segment was analysed.
+		bool Completed = false;
+
+		// Time spent reading from the decoder.
+		std::chrono::steady_clock::duration DecodeTime = {};
+	};
+
+	// Divides the track into segments, for a track of 'duration' seconds.
+	void CreateSegments( const float duration );
+
+	// Decodes and analyses a 'segment'.
+	// 'analyseCrossfade' - whether the segment contains the portion of the track which is analysed for the crossfade position.
+	// 'canContinue' - callback which returns whether the analysis can continue.
+	void AnalyseSegment( Segment& segment, const bool analyseCrossfade, Decoder::CanContinue canContinue );
+
+	// Adds the sample data in a 'view' to the silence analysis for a 'segment'.
+	void AnalyseSilence( Segment& segment, const Decoder::FrameView& view );
+
+	// Adds 'sampleCount' samples from 'buffer', starting at 'position' (in samples from the start of the track), to the crossfade analysis.
+	void AnalyseCrossfade( const float* buffer, const long sampleCount, const long long position );
+
+	// Completes the current crossfade analysis window, which ends at 'position' (in samples from the start of the track).
+	void EndCrossfadeWindow( const long long position );
+
+	// Calculates the results, once the whole track has been analysed.
+	void CalculateResult();
+
+	// Decoder.
+	Decoder::Ptr m_Decoder;
+
+	// Indicates whether only the crossfade position is calculated.
+	const bool m_CrossfadeOnly;
+
+	// Number of channels.
+	const long m_Channels;
+
+	// Sample rate.
+	const long m_SampleRate;
+
+	// Callback which opens a decoder for each additional segment, when parallel analysis is enabled.
+	OpenDecoder m_OpenDecoder;
+
+	// Callback which runs the segment analysis tasks, when parallel analysis is enabled.
+	RunTasks m_RunTasks;
+
+	// Maximum number of segments into which the track is divided.
+	size_t m_MaximumSegments;
+
+	// Track segments.
+	std::vector<Segment> m_Segments;
+
+	// Analysis results.
+	Result m_Result;
+
+	// Position from which the crossfade analysis starts, in samples from the start of the track.
+	long long m_CrossfadeStart;
+
+	// Length of each crossfade analysis window, in samples.
+	const long m_CrossfadeWindowLength;
+
+	// Number of samples in the current crossfade analysis window.
+	long m_WindowCount;
+
+	// Sum of squared values in the current crossfade analysis window.
+	double m_WindowTotal;
+
+	// Number of values analysed for the crossfade position.
+	long long m_CumulativeCount;
+
+	// Sum of squared values analysed for the crossfade position.
+	double m_CumulativeTotal;
+
+	// Crossfade position, in samples from the start of the track.
+	long long m_CrossfadePosition;
+};
@@ -2,6 +2,7 @@
 
 #include "CDDAExtract.h"
 #include "Converter.h"
+#include "FileSourcePrefetch.h"
 
 #include "DlgConvert.h"
 #include "DlgOptions.h"
@@ -63,6 +64,7 @@ VUPlayer::VUPlayer( const HINSTANCE instance, const HWND hwnd, const std::list<s
 	m_hAccel( LoadAccelerators( m_hInst, MAKEINTRESOURCE( IDC_VUPLAYER ) ) ),
 	m_Handlers(),
 	m_Database( ( portable ? std::wstring() : ( DocumentsFolder() + s_Database ) ), databaseMode ),
+	m_SeekIndexCache( m_Database ),
 	m_Library( m_Database, m_Handlers ),
 	m_Maintainer( m_hInst, m_Library, m_Handlers ),
 	m_Settings( m_Database, m_Library, portableSettings ),
@@ -137,6 +139,7 @@ VUPlayer::VUPlayer( const HINSTANCE instance, const HWND hwnd, const std::list<s
 	SetFocus( m_List.GetWindowHandle() );
 
 	m_Handlers.Init( m_Settings );
+	m_Handlers.SetSeekIndexCache( &m_SeekIndexCache );
 
 	const int idleSize = 32;
 	WCHAR idleText[ idleSize ] = {};
@@ -575,6 +578,7 @@ void VUPlayer::OnPlaylistItemAdded( Playlist* playlist, const Playlist::Item& it
 		}
 
 		m_Status.Update( playlist );
+		m_Output.OnPlaylistChanged( playlist );
 	}
 }
 
@@ -582,6 +586,7 @@ void VUPlayer::OnPlaylistItemRemoved( Playlist* playlist, const Playlist::Item&
 {
 	m_List.OnFileRemoved( playlist, item );
 	m_Status.Update( playlist );
+	m_Output.OnPlaylistChanged( playlist );
 }
 
 void VUPlayer::OnPlaylistItemUpdated( Playlist* playlist, const Playlist::Item& item )
@@ -1515,6 +1520,14 @@ Settings& VUPlayer::GetApplicationSettings()
 	return m_Settings;
 }
 
+void VUPlayer::WriteMetrics( const std::wstring& filename ) const
+{
+	if ( m_Output.WriteMetrics( filename ) ) {
+		m_GainCalculator.WriteMetrics( filename );
+		FileSourcePrefetch::WriteMetrics( filename );
+	}
+}
+
 void VUPlayer::OnTrayNotify( WPARAM wParam, LPARAM lParam )
 {
 	m_Tray.OnNotify( wParam, lParam );
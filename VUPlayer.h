@@ -137,6 +137,9 @@ public:
 	// Returns the application settings.
 	Settings& GetApplicationSettings();
 
+	// Writes the playback, gain calculation and read-ahead metrics to 'filename'.
+	void WriteMetrics( const std::wstring& filename ) const;
+
 	// Called when a notification area icon message is received.
 	void OnTrayNotify( WPARAM wParam, LPARAM lParam );
 
@@ -291,6 +294,9 @@ private:
 	// Database.
 	Database m_Database;
 
+	// Seek index cache.
+	SeekIndexCache m_SeekIndexCache;
+
 	// Media library.
 	Library m_Library;
 
@@ -32,6 +32,9 @@ static const TCHAR s_portableCmdLineSwitch[] = L"-portable";
 // Command line switch to set the database access mode.
 static const TCHAR s_databasemodeCmdLineSwitch[] = L"-mode";
 
+// Command line switch to write playback metrics to a file on exit.
+static const TCHAR s_metricsCmdLineSwitch[] = L"-metrics";
+
 // Makes a basic check to see whether a command line entry represents Audio CD autoplay.
 // Returns the Audio CD path to autoplay, or an empty string otherwise.
 std::wstring AutoplayAudioCD( LPCWSTR cmdLineEntry )
@@ -66,6 +69,7 @@ int APIENTRY wWinMain( _In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstanc
 	bool portable = false;
 	std::string portableSettings;
 	Database::Mode mode = Database::Mode::Temp;
+	std::wstring metricsFilename;
 
 	int numArgs = 0;
 	LPWSTR* args = CommandLineToArgvW( GetCommandLine(), &numArgs );
@@ -105,6 +109,12 @@ int APIENTRY wWinMain( _In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstanc
 					} catch ( ... ) {
 					}
 				}
+			} else if ( 0 == _wcsicmp( args[ argc ], s_metricsCmdLineSwitch ) ) {
+				// Handle the '-metrics' command-line switch (and the following metrics file argument).
+				if ( ( argc + 1 ) < numArgs ) {
+					metricsFilename = args[ argc + 1 ];
+					++argc;
+				}
 			} else {
 				const DWORD attributes = GetFileAttributes( args[ argc ] );
 				if ( ( INVALID_FILE_ATTRIBUTES != attributes ) && !( FILE_ATTRIBUTE_DIRECTORY & attributes ) ) {
@@ -183,6 +193,10 @@ int APIENTRY wWinMain( _In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstanc
 		}
 	}
 
+	if ( ( nullptr != vuplayer ) && !metricsFilename.empty() ) {
+		vuplayer->WriteMetrics( metricsFilename );
+	}
+
 	delete vuplayer;
 
 	GdiplusShutdown( gdiplusToken );
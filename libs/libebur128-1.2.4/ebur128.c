@@ -87,6 +87,10 @@ struct ebur128_state_internal {
   /** The maximum window duration in ms. */
   unsigned long window;
   unsigned long history;
+  /** Whether channels are filtered and summed in SIMD lanes, if available. */
+  int vectorised;
+  /** The value which scales int samples to +/-1.0. */
+  double int_scaling_factor;
 };
 
 static double relative_gate = -10.0;
@@ -382,6 +386,8 @@ ebur128_state* ebur128_init(unsigned int channels,
 
   st->d->use_histogram = mode & EBUR128_MODE_HISTOGRAM ? 1 : 0;
   st->d->history = ULONG_MAX;
+  st->d->vectorised = 1;
+  st->d->int_scaling_factor = -((double) INT_MIN);
   st->samplerate = samplerate;
   st->d->samples_in_100ms = (st->samplerate + 5) / 10;
   st->mode = mode;
@@ -545,14 +551,141 @@ static void ebur128_check_true_peak(ebur128_state* st, size_t frames) {
     st->d->v[ci][1] = fabs(st->d->v[ci][1]) < DBL_MIN ? 0.0 : st->d->v[ci][1];
 #endif
 
-#define EBUR128_FILTER(type, min_scale, max_scale)                             \
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EBUR128_USE_SSE2
+#include <emmintrin.h>
+
+/* Returns whether the K-weighting filter can process channels in SIMD lanes,
+ * which requires each used channel to have its own filter state. */
+static int ebur128_filter_lanes_usable(ebur128_state* st) {
+  unsigned int used = 0;
+  size_t c;
+  int ci;
+  for (c = 0; c < st->channels; ++c) {
+    ci = st->d->channel_map[c] - 1;
+    if (ci < 0) continue;
+    else if (ci == EBUR128_DUAL_MONO - 1) ci = 0; /*dual mono */
+    if (ci >= 5 || (used & (1u << ci))) return 0;
+    used |= 1u << ci;
+  }
+  return 1;
+}
+
+/* Filters two channels at once, one in each lane. Each lane performs the same
+ * operations in the same order as the scalar filter, so the results are
+ * identical. */
+#define EBUR128_FILTER_PAIR(type)                                              \
+static void ebur128_filter_pair_##type(ebur128_state* st, const type* src,     \
+                                       size_t frames, double scaling_factor,   \
+                                       double* audio_data,                     \
+                                       size_t c0, int ci0,                     \
+                                       size_t c1, int ci1) {                   \
+  const __m128d scale = _mm_set1_pd(scaling_factor);                           \
+  const __m128d a1 = _mm_set1_pd(st->d->a[1]);                                 \
+  const __m128d a2 = _mm_set1_pd(st->d->a[2]);                                 \
+  const __m128d a3 = _mm_set1_pd(st->d->a[3]);                                 \
+  const __m128d a4 = _mm_set1_pd(st->d->a[4]);                                 \
+  const __m128d b0 = _mm_set1_pd(st->d->b[0]);                                 \
+  const __m128d b1 = _mm_set1_pd(st->d->b[1]);                                 \
+  const __m128d b2 = _mm_set1_pd(st->d->b[2]);                                 \
+  const __m128d b3 = _mm_set1_pd(st->d->b[3]);                                 \
+  const __m128d b4 = _mm_set1_pd(st->d->b[4]);                                 \
+  __m128d v0 = _mm_set_pd(st->d->v[ci1][0], st->d->v[ci0][0]);                 \
+  __m128d v1 = _mm_set_pd(st->d->v[ci1][1], st->d->v[ci0][1]);                 \
+  __m128d v2 = _mm_set_pd(st->d->v[ci1][2], st->d->v[ci0][2]);                 \
+  __m128d v3 = _mm_set_pd(st->d->v[ci1][3], st->d->v[ci0][3]);                 \
+  __m128d v4 = _mm_set_pd(st->d->v[ci1][4], st->d->v[ci0][4]);                 \
+  __m128d y;                                                                   \
+  size_t i;                                                                    \
+  int ci;                                                                      \
+  for (i = 0; i < frames; ++i) {                                               \
+    const type* s = src + i * st->channels;                                    \
+    v0 = _mm_div_pd(_mm_set_pd((double) s[c1], (double) s[c0]), scale);        \
+    v0 = _mm_sub_pd(v0, _mm_mul_pd(a1, v1));                                   \
+    v0 = _mm_sub_pd(v0, _mm_mul_pd(a2, v2));                                   \
+    v0 = _mm_sub_pd(v0, _mm_mul_pd(a3, v3));                                   \
+    v0 = _mm_sub_pd(v0, _mm_mul_pd(a4, v4));                                   \
+    y = _mm_mul_pd(b0, v0);                                                    \
+    y = _mm_add_pd(y, _mm_mul_pd(b1, v1));                                     \
+    y = _mm_add_pd(y, _mm_mul_pd(b2, v2));                                     \
+    y = _mm_add_pd(y, _mm_mul_pd(b3, v3));                                     \
+    y = _mm_add_pd(y, _mm_mul_pd(b4, v4));                                     \
+    _mm_storel_pd(audio_data + i * st->channels + c0, y);                      \
+    _mm_storeh_pd(audio_data + i * st->channels + c1, y);                      \
+    v4 = v3;                                                                   \
+    v3 = v2;                                                                   \
+    v2 = v1;                                                                   \
+    v1 = v0;                                                                   \
+  }                                                                            \
+  _mm_storel_pd(&st->d->v[ci0][0], v0);                                        \
+  _mm_storeh_pd(&st->d->v[ci1][0], v0);                                        \
+  _mm_storel_pd(&st->d->v[ci0][1], v1);                                        \
+  _mm_storeh_pd(&st->d->v[ci1][1], v1);                                        \
+  _mm_storel_pd(&st->d->v[ci0][2], v2);                                        \
+  _mm_storeh_pd(&st->d->v[ci1][2], v2);                                        \
+  _mm_storel_pd(&st->d->v[ci0][3], v3);                                        \
+  _mm_storeh_pd(&st->d->v[ci1][3], v3);                                        \
+  _mm_storel_pd(&st->d->v[ci0][4], v4);                                        \
+  _mm_storeh_pd(&st->d->v[ci1][4], v4);                                        \
+  ci = ci0;                                                                    \
+  FLUSH_MANUALLY                                                               \
+  ci = ci1;                                                                    \
+  FLUSH_MANUALLY                                                               \
+  (void) ci;                                                                   \
+}
+EBUR128_FILTER_PAIR(short)
+EBUR128_FILTER_PAIR(int)
+EBUR128_FILTER_PAIR(float)
+EBUR128_FILTER_PAIR(double)
+
+/* Filters the used channels in pairs, returning the channel which is left
+ * over for the scalar filter (or st->channels if there is none). */
+#define EBUR128_FILTER_LANES(type)                                             \
+static size_t ebur128_filter_lanes_##type(ebur128_state* st, const type* src,  \
+                                          size_t frames, double scaling_factor,\
+                                          double* audio_data) {                \
+  size_t pending = st->channels;                                               \
+  int pending_ci = 0;                                                          \
+  size_t c;                                                                    \
+  int ci;                                                                      \
+  for (c = 0; c < st->channels; ++c) {                                         \
+    ci = st->d->channel_map[c] - 1;                                            \
+    if (ci < 0) continue;                                                      \
+    else if (ci == EBUR128_DUAL_MONO - 1) ci = 0; /*dual mono */               \
+    if (pending == st->channels) {                                             \
+      pending = c;                                                             \
+      pending_ci = ci;                                                         \
+    } else {                                                                   \
+      ebur128_filter_pair_##type(st, src, frames, scaling_factor, audio_data,  \
+                                 pending, pending_ci, c, ci);                  \
+      pending = st->channels;                                                  \
+    }                                                                          \
+  }                                                                            \
+  return pending;                                                              \
+}
+EBUR128_FILTER_LANES(short)
+EBUR128_FILTER_LANES(int)
+EBUR128_FILTER_LANES(float)
+EBUR128_FILTER_LANES(double)
+
+#define VECTORISED_FILTER(type)                                                \
+  if (st->d->vectorised && ebur128_filter_lanes_usable(st)) {                                       \
+    remaining = ebur128_filter_lanes_##type(st, src, frames, scaling_factor,   \
+                                            audio_data);                       \
+    vectorised = 1;                                                            \
+  }
+#else
+#define VECTORISED_FILTER(type)
+#endif
+
+#define EBUR128_FILTER(type, scale)                                            \
 static void ebur128_filter_##type(ebur128_state* st, const type* src,          \
                                   size_t frames) {                             \
-  static double scaling_factor =                                               \
-                 -((double) (min_scale)) > (double) (max_scale) ?              \
-                 -((double) (min_scale)) : (double) (max_scale);               \
+  const double scaling_factor = (scale);                                       \
   double* audio_data = st->d->audio_data + st->d->audio_data_index;            \
-  size_t i, c;                                                                 \
+  size_t i, c, remaining;                                                      \
+  int vectorised;                                                              \
                                                                                \
   TURN_ON_FTZ                                                                  \
                                                                                \
@@ -580,9 +713,13 @@ static void ebur128_filter_##type(ebur128_state* st, const type* src,          \
     }                                                                          \
     ebur128_check_true_peak(st, frames);                                       \
   }                                                                            \
+  remaining = st->channels;                                                    \
+  vectorised = 0;                                                              \
+  VECTORISED_FILTER(type)                                                      \
   for (c = 0; c < st->channels; ++c) {                                         \
     int ci = st->d->channel_map[c] - 1;                                        \
     if (ci < 0) continue;                                                      \
+    else if (vectorised && c != remaining) continue;                           \
     else if (ci == EBUR128_DUAL_MONO - 1) ci = 0; /*dual mono */               \
     for (i = 0; i < frames; ++i) {                                             \
       st->d->v[ci][0] = (double) (src[i * st->channels + c] / scaling_factor)  \
@@ -605,10 +742,10 @@ static void ebur128_filter_##type(ebur128_state* st, const type* src,          \
   }                                                                            \
   TURN_OFF_FTZ                                                                 \
 }
-EBUR128_FILTER(short, SHRT_MIN, SHRT_MAX)
-EBUR128_FILTER(int, INT_MIN, INT_MAX)
-EBUR128_FILTER(float, -1.0f, 1.0f)
-EBUR128_FILTER(double, -1.0, 1.0)
+EBUR128_FILTER(short, -((double) SHRT_MIN))
+EBUR128_FILTER(int, st->d->int_scaling_factor)
+EBUR128_FILTER(float, 1.0)
+EBUR128_FILTER(double, 1.0)
 
 static double ebur128_energy_to_loudness(double energy) {
   return 10 * (log(energy) / log(10.0)) - 0.691;
@@ -631,36 +768,100 @@ static size_t find_histogram_index(double energy) {
   return index_min;
 }
 
+/* Returns the sum of the squared filtered values of channel 'c' over the
+ * last 'frames_per_block' frames. */
+static double ebur128_sum_squares(ebur128_state* st, size_t c,
+                                  size_t frames_per_block) {
+  size_t i;
+  double channel_sum = 0.0;
+  if (st->d->audio_data_index < frames_per_block * st->channels) {
+    for (i = 0; i < st->d->audio_data_index / st->channels; ++i) {
+      channel_sum += st->d->audio_data[i * st->channels + c] *
+                     st->d->audio_data[i * st->channels + c];
+    }
+    for (i = st->d->audio_data_frames -
+            (frames_per_block -
+             st->d->audio_data_index / st->channels);
+         i < st->d->audio_data_frames; ++i) {
+      channel_sum += st->d->audio_data[i * st->channels + c] *
+                     st->d->audio_data[i * st->channels + c];
+    }
+  } else {
+    for (i = st->d->audio_data_index / st->channels - frames_per_block;
+         i < st->d->audio_data_index / st->channels;
+         ++i) {
+      channel_sum += st->d->audio_data[i * st->channels + c] *
+                     st->d->audio_data[i * st->channels + c];
+    }
+  }
+  return channel_sum;
+}
+
+#ifdef EBUR128_USE_SSE2
+/* Adds the squared filtered values of a pair of adjacent channels over frames
+ * 'begin' to 'end' to the lanes of 'sums'. */
+static __m128d ebur128_sum_squares_range(ebur128_state* st, size_t c,
+                                         size_t begin, size_t end,
+                                         __m128d sums) {
+  size_t i;
+  __m128d values;
+  for (i = begin; i < end; ++i) {
+    values = _mm_loadu_pd(st->d->audio_data + i * st->channels + c);
+    sums = _mm_add_pd(sums, _mm_mul_pd(values, values));
+  }
+  return sums;
+}
+
+/* Calculates the sums of the squared filtered values of channels 'c' and
+ * 'c + 1' over the last 'frames_per_block' frames, one channel in each lane.
+ * The values are summed in the same order as ebur128_sum_squares. */
+static void ebur128_sum_squares_pair(ebur128_state* st, size_t c,
+                                     size_t frames_per_block,
+                                     double* first, double* second) {
+  size_t index = st->d->audio_data_index / st->channels;
+  __m128d sums = _mm_setzero_pd();
+  if (st->d->audio_data_index < frames_per_block * st->channels) {
+    sums = ebur128_sum_squares_range(st, c, 0, index, sums);
+    sums = ebur128_sum_squares_range(st, c,
+               st->d->audio_data_frames - (frames_per_block - index),
+               st->d->audio_data_frames, sums);
+  } else {
+    sums = ebur128_sum_squares_range(st, c, index - frames_per_block, index,
+                                     sums);
+  }
+  _mm_storel_pd(first, sums);
+  _mm_storeh_pd(second, sums);
+}
+#endif
+
 static int ebur128_calc_gating_block(ebur128_state* st, size_t frames_per_block,
                                      double* optional_output) {
-  size_t i, c;
+  size_t c;
   double sum = 0.0;
   double channel_sum;
+#ifdef EBUR128_USE_SSE2
+  double next_sum = 0.0;
+  int have_next = 0;
+#endif
   for (c = 0; c < st->channels; ++c) {
     if (st->d->channel_map[c] == EBUR128_UNUSED) {
       continue;
     }
-    channel_sum = 0.0;
-    if (st->d->audio_data_index < frames_per_block * st->channels) {
-      for (i = 0; i < st->d->audio_data_index / st->channels; ++i) {
-        channel_sum += st->d->audio_data[i * st->channels + c] *
-                       st->d->audio_data[i * st->channels + c];
-      }
-      for (i = st->d->audio_data_frames -
-              (frames_per_block -
-               st->d->audio_data_index / st->channels);
-           i < st->d->audio_data_frames; ++i) {
-        channel_sum += st->d->audio_data[i * st->channels + c] *
-                       st->d->audio_data[i * st->channels + c];
-      }
+#ifdef EBUR128_USE_SSE2
+    if (have_next) {
+      channel_sum = next_sum;
+      have_next = 0;
+    } else if (st->d->vectorised && c + 1 < st->channels &&
+               st->d->channel_map[c + 1] != EBUR128_UNUSED) {
+      ebur128_sum_squares_pair(st, c, frames_per_block,
+                               &channel_sum, &next_sum);
+      have_next = 1;
     } else {
-      for (i = st->d->audio_data_index / st->channels - frames_per_block;
-           i < st->d->audio_data_index / st->channels;
-           ++i) {
-        channel_sum += st->d->audio_data[i * st->channels + c] *
-                       st->d->audio_data[i * st->channels + c];
-      }
+      channel_sum = ebur128_sum_squares(st, c, frames_per_block);
     }
+#else
+    channel_sum = ebur128_sum_squares(st, c, frames_per_block);
+#endif
     if (st->d->channel_map[c] == EBUR128_Mp110 ||
         st->d->channel_map[c] == EBUR128_Mm110 ||
         st->d->channel_map[c] == EBUR128_Mp060 ||
@@ -868,6 +1069,30 @@ int ebur128_set_max_history(ebur128_state* st, unsigned long history)
   return EBUR128_SUCCESS;
 }
 
+int ebur128_set_vectorised(ebur128_state* st, int vectorised)
+{
+  vectorised = vectorised ? 1 : 0;
+  if (vectorised == st->d->vectorised) {
+    return EBUR128_ERROR_NO_CHANGE;
+  }
+  st->d->vectorised = vectorised;
+  return EBUR128_SUCCESS;
+}
+
+int ebur128_set_int_bits(ebur128_state* st, unsigned int bits)
+{
+  double scaling_factor;
+  if (bits < 1 || bits > 32) {
+    return EBUR128_ERROR_INVALID_MODE;
+  }
+  scaling_factor = ldexp(1.0, (int) bits - 1);
+  if (scaling_factor == st->d->int_scaling_factor) {
+    return EBUR128_ERROR_NO_CHANGE;
+  }
+  st->d->int_scaling_factor = scaling_factor;
+  return EBUR128_SUCCESS;
+}
+
 static int ebur128_energy_shortterm(ebur128_state* st, double* out);
 #define EBUR128_ADD_FRAMES(type)                                               \
 int ebur128_add_frames_##type(ebur128_state* st,                               \
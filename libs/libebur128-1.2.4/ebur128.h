@@ -207,6 +207,40 @@ int ebur128_set_max_window(ebur128_state* st, unsigned long window);
  */
 int ebur128_set_max_history(ebur128_state* st, unsigned long history);
 
+/** \brief Enable or disable SIMD processing.
+ *
+ *  When enabled, the K-weighting filter and the gating block energy process
+ *  channels in pairs, in SIMD lanes, where the compiler targets SSE2. The
+ *  results are identical either way; disabling it is only useful to compare
+ *  the two paths.
+ *
+ *  Default is enabled.
+ *
+ *  @param st library state.
+ *  @param vectorised non-zero to enable SIMD processing, zero to disable it.
+ *  @return
+ *    - EBUR128_SUCCESS on success.
+ *    - EBUR128_ERROR_NO_CHANGE if the setting is not changed.
+ */
+int ebur128_set_vectorised(ebur128_state* st, int vectorised);
+
+/** \brief Set the number of significant bits in int samples.
+ *
+ *  Samples passed to ebur128_add_frames_int() are right justified values
+ *  with this number of significant bits, so that native integer sample data
+ *  can be measured without first converting it to floating point.
+ *
+ *  Default is 32.
+ *
+ *  @param st library state.
+ *  @param bits number of significant bits, from 1 to 32.
+ *  @return
+ *    - EBUR128_SUCCESS on success.
+ *    - EBUR128_ERROR_INVALID_MODE if the number of bits is out of range.
+ *    - EBUR128_ERROR_NO_CHANGE if the setting is not changed.
+ */
+int ebur128_set_int_bits(ebur128_state* st, unsigned int bits);
+
 /** \brief Add frames to be processed.
  *
  *  @param st library state.